@@ -0,0 +1,7 @@
+-- The records of 01db through a filter (see options). The rmid and
+-- the xid decide most of the records on their header; the Database
+-- records have no relation, so "not rel = ..." is true for them once
+-- the relation has been decoded.
+
+CREATE DATABASE testdb;
+DROP DATABASE testdb;
@@ -0,0 +1,4 @@
+-- The records of 01db written as JSON lines (see options).
+
+CREATE DATABASE testdb;
+DROP DATABASE testdb;
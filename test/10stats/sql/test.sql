@@ -0,0 +1,4 @@
+-- The statistics of the records of 01db in JSON (see options).
+
+CREATE DATABASE testdb;
+DROP DATABASE testdb;
@@ -0,0 +1,21 @@
+-- The status of each kind of the end of a transaction, with -t (see
+-- options). A transaction which only takes an xid ends in a compact
+-- commit, and the prepared ones end in the records of the session
+-- running COMMIT/ROLLBACK PREPARED, which has no xid of its own.
+
+SELECT txid_current();
+
+BEGIN;
+SELECT txid_current();
+ROLLBACK;
+
+BEGIN;
+SELECT txid_current();
+PREPARE TRANSACTION 'p1';
+
+BEGIN;
+SELECT txid_current();
+PREPARE TRANSACTION 'p2';
+
+ROLLBACK PREPARED 'p2';
+COMMIT PREPARED 'p1';
@@ -0,0 +1,5 @@
+-- The statistics of the records of 01db in the Prometheus text format
+-- (see options).
+
+CREATE DATABASE testdb;
+DROP DATABASE testdb;
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+# Compares the time taken by two xlogdump binaries over the same
+# segments, e.g. one built before a change and one after it:
+#
+#   ./bench.sh ../xlogdump-old ../xlogdump /path/to/pg_xlog/0000*
+#
+
+OLD=$1
+NEW=$2
+RUNS=${RUNS:-5}
+
+if [ -z "$NEW" ]; then
+    echo "Usage: $0 <OLD_BIN> <NEW_BIN> <segment file(s)>";
+    exit;
+fi;
+shift 2
+
+for m in "-S" "-O jsonl" ""
+  do for b in $OLD $NEW
+       do start=`date +%s.%N`
+	  i=0
+	  while [ $i -lt $RUNS ]
+	    do $b $m "$@" > /dev/null 2>&1
+	       i=`expr $i + 1`
+	  done;
+	  end=`date +%s.%N`
+	  echo "$b $m" | awk -v s=$start -v e=$end -v n=$RUNS \
+	      '{ printf("%-40s %.3f sec\n", $0, (e - s) / n) }'
+     done;
+done;
@@ -19,12 +19,33 @@ function setUp()
 {
     rm -rf ${PGDATA}
     initdb -D ${PGDATA} --no-locale -E UTF-8
+
+    # The settings the test needs, if it has them.
+    if [ -f ${TEST_PATH}/postgresql.conf ]; then
+        cat ${TEST_PATH}/postgresql.conf >> ${PGDATA}/postgresql.conf
+    fi
+
     pg_ctl -w -D ${PGDATA} start -o "-p $PGPORT"
     psql -p $PGPORT -c 'select pg_switch_xlog()' postgres
 
     rm -rf ${TEST_PATH}/output ${TEST_PATH}/result
 }
 
+# Runs xlogdump on the segment in another way of reading it, which
+# must give the same output as the plain run, and compares the two.
+function compareRun()
+{
+    NAME=$1
+    OPTS=$2
+    SEGMENT=$3
+
+    eval ${XLOGDUMP_BIN} ${OPTS} ${XLOGDUMP_OPTS} ${SEGMENT} | \
+        sed -e "s|^${SEGMENT}:\$|${TEST_PATH}/output/000000010000000000000002:|" \
+        > ${TEST_PATH}/output/xlogdump-${NAME}.out
+    diff -c ${TEST_PATH}/output/xlogdump.out ${TEST_PATH}/output/xlogdump-${NAME}.out \
+        > ${TEST_PATH}/result/xlogdump-${NAME}.diff
+}
+
 function tearDown()
 {
     pg_ctl -w -D ${PGDATA} stop
@@ -32,7 +53,13 @@ function tearDown()
     mkdir -p ${TEST_PATH}/output
     cp ${PGDATA}/pg_xlog/000000010000000000000002 ${TEST_PATH}/output
 
-    ${XLOGDUMP_BIN} ${TEST_PATH}/output/000000010000000000000002 > ${TEST_PATH}/output/xlogdump.out
+    # The options to run xlogdump with, if the test has them.
+    XLOGDUMP_OPTS=
+    if [ -f ${TEST_PATH}/options ]; then
+        XLOGDUMP_OPTS=`cat ${TEST_PATH}/options`
+    fi
+
+    eval ${XLOGDUMP_BIN} ${XLOGDUMP_OPTS} ${TEST_PATH}/output/000000010000000000000002 > ${TEST_PATH}/output/xlogdump.out
 
     # Rewrite timestamp strings in the output, and then
     # compare it with the expected one.
@@ -40,6 +67,17 @@ function tearDown()
 
     mkdir -p ${TEST_PATH}/result
     diff -rc ${TEST_PATH}/expected/xlogdump.out ${TEST_PATH}/output/xlogdump.out.ts > ${TEST_PATH}/result/xlogdump.diff
+
+    # The pipeline of reader and formatter threads, a gzip'ed segment,
+    # and the zone maps and the xid index, built by the first run and
+    # used by the second one.
+    mkdir -p ${TEST_PATH}/output/gz ${TEST_PATH}/output/zone
+    gzip -c ${TEST_PATH}/output/000000010000000000000002 > ${TEST_PATH}/output/gz/000000010000000000000002.gz
+
+    compareRun jobs "-j 2" ${TEST_PATH}/output/000000010000000000000002
+    compareRun gzip "" ${TEST_PATH}/output/gz/000000010000000000000002.gz
+    compareRun zone-build "-Z ${TEST_PATH}/output/zone" ${TEST_PATH}/output/000000010000000000000002
+    compareRun zone "-Z ${TEST_PATH}/output/zone" ${TEST_PATH}/output/000000010000000000000002
 }
 
 setUp
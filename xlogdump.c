@@ -27,6 +27,8 @@
  */
 #include "postgres.h"
 
+#include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt_long.h>
 #include <time.h>
@@ -38,13 +40,6 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/pg_control.h"
-#include "utils/pg_crc.h"
-
-#if PG_VERSION_NUM >= 90200
- #include "utils/pg_crc_tables.h"
-#else
- #include "pg_crc32_table.h"
-#endif
 
 #include "libpq-fe.h"
 #include "pg_config.h"
@@ -52,41 +47,136 @@
 
 #include "strlcat.h"
 #include "xlogdump.h"
+#include "xlogdump_archive.h"
+#include "xlogdump_cycle.h"
+#include "xlogdump_distinct.h"
+#include "xlogdump_export.h"
+#include "xlogdump_filter.h"
+#include "xlogdump_follow.h"
+#include "xlogdump_hist.h"
+#include "xlogdump_hotblock.h"
+#include "xlogdump_index.h"
+#include "xlogdump_decode.h"
+#include "xlogdump_jsonl.h"
+#include "xlogdump_arrow.h"
+#include "xlogdump_rate.h"
+#include "xlogdump_reader.h"
+#include "xlogdump_sidecar.h"
 #include "xlogdump_rmgr.h"
 #include "xlogdump_statement.h"
+#include "xlogdump_stream.h"
+#include "xlogdump_version.h"
 #include "xlogdump_oid2name.h"
+#include "xlogdump_out.h"
+#include "xlogdump_pipeline.h"
+#include "xlogdump_zonemap.h"
 
-static int		logFd;	       /* kernel FD for current input file */
+static xlog_reader_t	*reader = NULL;	/* reader of current input file */
+static const xlog_version_t *logVersion;  /* current log file version */
 static TimeLineID	logTLI;	       /* current log file timeline */
 static uint32		logId;	       /* current log file id */
 static uint32		logSeg;	       /* current log file segment */
-static int32		logPageOff;    /* offset of current page in file */
-static int		logRecOff;     /* offset of next record in page */
-static char		pageBuffer[XLOG_BLCKSZ];	/* current page */
 static XLogRecPtr	curRecPtr;     /* logical address of current record */
+static XLogRecord	*curRecord;    /* ReadRecord result */
+static DecodedRecord	*curDecoded = NULL;	/* curRecord decoded by a reader thread */
 static XLogRecPtr	prevRecPtr;    /* logical address of previous record */
-static char		*readRecordBuf = NULL; /* ReadRecord result area */
-static uint32		readRecordBufSize = 0;
+
+uint32			walBlockSize = XLOG_BLCKSZ;	/* of the segments being read */
+uint32			walSegSize = XLogSegSize;
 
 /* command-line parameters */
 static bool		transactions = false;	/* when true we just aggregate transaction info */
 static bool		statements = false;	/* when true we try to rebuild fake sql statements with the xlog data */
 static bool		hideTimestamps = false; /* remove timestamp from dump used for testing */
 static bool		enable_stats = false;	/* collect and show statistics */
+static bool		dump_records = true;	/* print each xlog record */
+static int		output_format = OUTPUT_FORMAT_TEXT;	/* format of the records */
+static int		time_bucket = 0;	/* seconds per bucket of the WAL generation rate */
+static bool		enable_cycles = false;	/* analyze full page writes per checkpoint cycle */
+static int		hot_blocks = 0;		/* number of the hottest blocks to be shown */
+static bool		enable_distinct = false;	/* estimate distinct blocks touched */
+static int		stats_format = STATS_FORMAT_TEXT;	/* format of the statistics */
+static char		*stats_output = NULL;	/* file to write the statistics, or stdout */
+static char		*save_stats_dir = NULL;	/* directory to save the stats files */
+static bool		merge_stats = false;	/* read stats files instead of segments */
+static char		*zone_dir = NULL;	/* directory of the zone maps */
+static bool		build_zone_maps = false;	/* just (re)build the zone maps */
+static char		*follow_dir = NULL;	/* pg_xlog to be followed */
+static zonemap_t	cur_zone;		/* zone map of the current segment */
+static XLogRecPtr	start_lsn = {0, 0};	/* --start-lsn */
+static XLogRecPtr	end_lsn = {0, 0};	/* --end-lsn */
+static uint64		start_pos = 0;		/* --start-lsn as a byte position, or 0 */
+static uint64		end_pos = 0;		/* --end-lsn as a byte position, or 0 */
+static bool		fast_scan = false;	/* skip the records rejected by their header */
+static int		nreaders = 0;		/* reader threads of the pipeline, or 0 */
+static bool		skipping = false;	/* fast_scan while reading a segment through */
+static uint32		skipped_records = 0;	/* records skipped without verifying */
+static uint64		skipped_bytes = 0;
+static uint32		verified_records = 0;	/* records read and CRC-checked */
+static uint64		verified_bytes = 0;
+static bool		find_target = false;	/* find the last commit before target_time */
+static int64	target_time;		/* --find-time, in microseconds */
 static int		rmid = -1;		/* print all RM's xlog records if rmid has negative value. */
 static TransactionId	xid = InvalidTransactionId;
 
-/* Buffers to hold objects names */
-static char		spaceName[NAMEDATALEN] = "";
-static char		dbName[NAMEDATALEN]    = "";
-static char		relName[NAMEDATALEN]   = "";
+/* a segment to be read, planned before reading any of them */
+typedef struct {
+	char	*fname;
+	char	*zone_path;		/* to be built, or NULL */
+	char	*index_path;
+	bool	build_zone;		/* build its zone map while reading it */
+	uint32	*offsets;		/* of the records to be read, or NULL */
+	int	noffsets;
+} segment_job_t;
+
+static segment_job_t	*jobs = NULL;
+static int		njobs = 0;
+
+/* the items passed from the reader threads of the pipeline */
+#define ITEM_BEGIN	1	/* segment_begin_t */
+#define ITEM_FAILED	2	/* errno of open() */
+#define ITEM_PAGE	3	/* page_item_t */
+#define ITEM_REPORT	4	/* a message in the data */
+#define ITEM_RECORD	5	/* DecodedRecord, and the record in the data */
+#define ITEM_SWITCH	6	/* ditto */
+#define ITEM_PARTIAL	7	/* ditto, with the record header only */
+#define ITEM_END	8	/* segment_end_t */
+
+typedef struct {
+	TimeLineID	tli;
+	uint32		id;
+	uint32		seg;
+	uint32		blcksz;
+	uint32		segsize;
+	const xlog_version_t *version;
+} segment_begin_t;
+
+typedef struct {
+	XLogPageHeaderData hdr;
+	uint32		pageno;
+} page_item_t;
+
+typedef struct {
+	reader_stats_t	stats;
+	bool		complete;	/* false if --start-lsn couldn't be sought */
+} segment_end_t;
+
+static int		pipeJob = -1;	/* segment read by the pipeline, or -1 */
+static bool		pipeEnded = false;	/* ITEM_END of pipeJob has been taken */
+static bool		pipeComplete = false;
+
+static bool		pipeFormat = false;	/* records printed by the formatter threads */
+static const char	*curText = NULL;	/* curDecoded as printed by them */
+static uint32		curTextLen = 0;
 
 
 struct xlog_stats_t {
-	int rmgr_count[RM_MAX_ID+1];
-	int rmgr_len[RM_MAX_ID+1];
-	int bkpblock_count;
-	int bkpblock_len;
+	uint64 rmgr_count[RM_MAX_ID+1];
+	uint64 rmgr_len[RM_MAX_ID+1];
+	uint64 bkpblock_count;
+	uint64 bkpblock_len;
+	hist_t rmgr_hist[RM_MAX_ID+1];	/* distribution of xl_tot_len */
+	hist_t bkpblock_hist;
 };
 
 struct xlog_stats_t xlogstats;
@@ -97,18 +187,49 @@ transInfoPtr		transactionsInfo = NULL;
 
 /* prototypes */
 static void print_xlog_stats();
-
-static bool readXLogPage(void);
+static void print_xlog_hist(const hist_t *);
+static void export_xlog_stats(void);
+static char *save_stats(const char *);
+static void zone_file_path(char *, size_t, const char *, const char *);
+static void load_stats(const char *);
+
+static void printXLogPage(void *, XLogPageHeader, uint32);
+static bool skipXLogRecord(void *, xlog_reader_t *, XLogRecPtr, XLogRecord *);
+static void reportXLog(void *, const char *);
+static bool report_on_stdout(void);
+static void printSegmentName(const char *);
+static bool parse_lsn(const char *, XLogRecPtr *);
+static bool segment_start_pos(const char *, uint64 *);
 void exit_gracefuly(int);
-static bool RecordIsValid(XLogRecord *, XLogRecPtr);
 static bool ReadRecord(void);
-
-static void dumpXLogRecord(XLogRecord *, bool);
-static void print_backup_blocks(XLogRecPtr, XLogRecord *);
-
-static void addTransaction(XLogRecord *);
+static bool readPipedRecord(void);
+static bool seekStartLSN(xlog_reader_t *);
+static void pipePage(void *, XLogPageHeader, uint32);
+static bool pipeSkip(void *, xlog_reader_t *, XLogRecPtr, XLogRecord *);
+static void pipeReport(void *, const char *);
+static bool pipeRecord(pipeline_reader_t *, xlog_reader_t *, int, XLogRecPtr, XLogRecord *);
+static void readSegment(pipeline_reader_t *, int);
+static bool beginPipedXLog(int, char *);
+
+static void dumpXLogRecord(DecodedRecord *);
+static void formatXLogRecord(DecodedRecord *);
+static void formatItem(pipeline_item_t *);
+static void print_backup_blocks(DecodedRecord *);
+static void account_backup_blocks(DecodedRecord *);
+static void account_block_refs(DecodedRecord *);
+static void account_rate(DecodedRecord *);
+
+static void addTransaction(DecodedRecord *);
+static void setTransaction(TransactionId, uint32, int);
 static void dumpTransactions();
-static void dumpXLog(char *);
+static void beginXLog(char *, int);
+static void endXLog(void);
+static void dumpXLog(char *, int, const uint32 *, int);
+static int compare_segments(const void *, const void *);
+static char *str_usec(int64, char *, size_t);
+static bool first_commit_time(char *, int64 *);
+static void find_time(char **, int);
+static bool handleRecord(void);
 static void help(void);
 
 static void
@@ -129,12 +250,13 @@ print_xlog_stats()
 		if ( xlogstats.rmgr_count[i]>0 )
 			avg = (double)xlogstats.rmgr_len[i] / (double)xlogstats.rmgr_count[i];
 		  
-		printf("  [%d]%-10s: %d record%s, %d byte%s (avg %.1f byte%s)\n",
-		       i, RM_names[i],
+		printf("  [%d]%-10s: " UINT64_FORMAT " record%s, " UINT64_FORMAT " byte%s (avg %.1f byte%s)\n",
+		       i, RM_table[i].name,
 		       xlogstats.rmgr_count[i], (xlogstats.rmgr_count[i]>1) ? "s" : "",
 		       xlogstats.rmgr_len[i], (xlogstats.rmgr_len[i]>1) ? "s" : "",
 		       avg, (avg>1) ? "s" : "");
 
+		print_xlog_hist(&xlogstats.rmgr_hist[i]);
 		print_xlog_rmgr_stats(i);
 	}
 
@@ -142,554 +264,1571 @@ print_xlog_stats()
 	if ( xlogstats.bkpblock_count>0 )
 		avg = (double)xlogstats.bkpblock_len / (double)xlogstats.bkpblock_count;
 
-	printf("\nBackup block stats: %d block%s, %d byte%s (avg %.1f byte%s)\n",
+	printf("\nBackup block stats: " UINT64_FORMAT " block%s, " UINT64_FORMAT " byte%s (avg %.1f byte%s)\n",
 	       xlogstats.bkpblock_count, (xlogstats.bkpblock_count>1) ? "s" : "",
 	       xlogstats.bkpblock_len,  (xlogstats.bkpblock_len>1) ? "s" : "",
 	       avg, (avg>1) ? "s" : "");
+	print_xlog_hist(&xlogstats.bkpblock_hist);
 
 	printf("\n");
 }
 
-/* Read another page, if possible */
-static bool
-readXLogPage(void)
+/*
+ * print_xlog_hist()
+ *
+ * prints the percentiles of the record sizes, which can't be seen
+ * from the average alone.
+ */
+static void
+print_xlog_hist(const hist_t *h)
 {
-	size_t nread = read(logFd, pageBuffer, XLOG_BLCKSZ);
+	if (h->count == 0)
+		return;
 
-	if (nread == XLOG_BLCKSZ)
-	{
-		logPageOff += XLOG_BLCKSZ;
-		if (((XLogPageHeader) pageBuffer)->xlp_magic != XLOG_PAGE_MAGIC)
-		{
-			printf("Bogus page magic number %04X at offset %X\n",
-				   ((XLogPageHeader) pageBuffer)->xlp_magic, logPageOff);
-		}
+	printf("                 size p50: %u, p90: %u, p99: %u, max: %u\n",
+	       hist_percentile(h, 50),
+	       hist_percentile(h, 90),
+	       hist_percentile(h, 99),
+	       h->max);
+}
 
-		/*
-		 * FIXME: check xlp_magic here.
-		 */
-		if (!enable_stats)
-		{
-			printf("[page:%d, xlp_info:%d, xlp_tli:%d, xlp_pageaddr:%X/%X] ",
-			       logPageOff / XLOG_BLCKSZ,
-			       ((XLogPageHeader) pageBuffer)->xlp_info,
-			       ((XLogPageHeader) pageBuffer)->xlp_tli,
-			       ((XLogPageHeader) pageBuffer)->xlp_pageaddr.xlogid,
-			       ((XLogPageHeader) pageBuffer)->xlp_pageaddr.xrecoff);
-			
-			if ( (((XLogPageHeader)pageBuffer)->xlp_info & XLP_FIRST_IS_CONTRECORD) )
-				printf("XLP_FIRST_IS_CONTRECORD ");
-			if ((((XLogPageHeader)pageBuffer)->xlp_info & XLP_LONG_HEADER) )
-				printf("XLP_LONG_HEADER ");
-#if PG_VERSION_NUM >= 90200
-			if ((((XLogPageHeader)pageBuffer)->xlp_info & XLP_BKP_REMOVABLE) )
-				printf("XLP_BKP_REMOVABLE ");
-#endif
-			
-			printf("\n");
-		}
+/*
+ * export_xlog_stats()
+ *
+ * exports the same statistics as print_xlog_stats(), and the per-block
+ * and per-relation statistics if they are collected.
+ */
+static void
+export_xlog_stats(void)
+{
+	const char *labels[] = { "rmgr", NULL, NULL };
+	int i;
 
-		return true;
+	export_open(stats_format, stats_output);
+
+	for (i=0 ; i<RM_MAX_ID+1 ; i++)
+	{
+		labels[1] = RM_table[i].name;
+		export_counter("xlogdump_records_total",
+			       "Number of xlog records per resource manager.",
+			       labels, xlogstats.rmgr_count[i]);
 	}
-	if (nread != 0)
+	for (i=0 ; i<RM_MAX_ID+1 ; i++)
 	{
-		fprintf(stderr, "Partial page of %d bytes ignored\n",
-			(int) nread);
+		labels[1] = RM_table[i].name;
+		export_counter("xlogdump_record_data_bytes_total",
+			       "Bytes of the resource manager data (xl_len) per resource manager.",
+			       labels, xlogstats.rmgr_len[i]);
 	}
-	return false;
+	for (i=0 ; i<RM_MAX_ID+1 ; i++)
+	{
+		labels[1] = RM_table[i].name;
+		export_hist("xlogdump_record_size_bytes",
+			    "Distribution of the total record length (xl_tot_len) per resource manager.",
+			    labels, &xlogstats.rmgr_hist[i]);
+	}
+	export_xlog_rmgr_stats();
+
+	export_counter("xlogdump_backup_blocks_total",
+		       "Number of backup blocks (full page writes).",
+		       NULL, xlogstats.bkpblock_count);
+	export_counter("xlogdump_backup_block_bytes_total",
+		       "Bytes of the page images in the backup blocks.",
+		       NULL, xlogstats.bkpblock_len);
+	export_hist("xlogdump_backup_block_size_bytes",
+		    "Distribution of the page image sizes in the backup blocks.",
+		    NULL, &xlogstats.bkpblock_hist);
+
+	if (hot_blocks > 0)
+		export_xlog_hotblocks();
+	if (enable_distinct)
+		export_xlog_distinct();
+
+	export_close();
 }
 
-/* 
- * Exit closing active database connections
+/*
+ * save_stats()
+ *
+ * saves the statistics of the segment just read into a stats file
+ * in save_stats_dir, and resets them for the next segment. Returns
+ * the path of the stats file.
  */
-void
-exit_gracefuly(int status)
+static char *
+save_stats(const char *fname)
 {
-	DBDisconnect();
+	char path[MAXPGPATH];
+	const char *fnamebase;
+	FILE *fp;
+	long pos;
+	int i;
 
-	close(logFd);
-	exit(status);
+	fnamebase = strrchr(fname, '/');
+	if (fnamebase)
+		fnamebase++;
+	else
+		fnamebase = fname;
+	snprintf(path, sizeof(path), "%s/%s%s", save_stats_dir, fnamebase, SIDECAR_SUFFIX);
+
+	fp = sidecar_create(path);
+
+	pos = sidecar_begin_section(fp, SIDECAR_XLOG_STATS);
+	sidecar_write_u32(fp, logTLI);
+	sidecar_write_u32(fp, logId);
+	sidecar_write_u32(fp, logSeg);
+	sidecar_write_u32(fp, RM_MAX_ID+1);
+	for (i=0 ; i<RM_MAX_ID+1 ; i++)
+	{
+		sidecar_write_u64(fp, xlogstats.rmgr_count[i]);
+		sidecar_write_u64(fp, xlogstats.rmgr_len[i]);
+		sidecar_write_hist(fp, &xlogstats.rmgr_hist[i]);
+	}
+	sidecar_write_u64(fp, xlogstats.bkpblock_count);
+	sidecar_write_u64(fp, xlogstats.bkpblock_len);
+	sidecar_write_hist(fp, &xlogstats.bkpblock_hist);
+	sidecar_end_section(fp, pos);
+
+	save_xlog_rmgr_stats(fp);
+	if (hot_blocks > 0)
+		save_xlog_hotblocks(fp);
+	if (enable_distinct)
+		save_xlog_distinct(fp);
+	if (time_bucket > 0)
+		save_xlog_rate(fp);
+
+	sidecar_close(fp, path);
+
+	memset(&xlogstats, 0, sizeof(xlogstats));
+	reset_xlog_rmgr_stats();
+	if (hot_blocks > 0)
+		reset_xlog_hotblocks();
+	if (enable_distinct)
+		reset_xlog_distinct();
+	if (time_bucket > 0)
+		reset_xlog_rate();
+
+	return strdup(path);
 }
 
 /*
- * CRC-check an XLOG record.  We do not believe the contents of an XLOG
- * record (other than to the minimal extent of computing the amount of
- * data to read in) until we've checked the CRCs.
+ * load_stats()
  *
- * We assume all of the record has been read into memory at *record.
+ * merges a stats file into the current statistics. The sections not
+ * needed by the current options are skipped.
  */
-static bool
-RecordIsValid(XLogRecord *record, XLogRecPtr recptr)
+static void
+load_stats(const char *path)
 {
-	pg_crc32	crc;
-	int			i;
-	uint32		len = record->xl_len;
-	BkpBlock	bkpb;
-	char	   *blk;
+	FILE *fp;
+	uint32 tag;
+	uint64 len;
+	int i;
 
-	/* First the rmgr data */
-	INIT_CRC32(crc);
-	COMP_CRC32(crc, XLogRecGetData(record), len);
+	fp = sidecar_open(path);
 
-	/* Add in the backup blocks, if any */
-	blk = (char *) XLogRecGetData(record) + len;
-	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
+	while (sidecar_next_section(fp, &tag, &len))
 	{
-		uint32	blen;
+		switch (tag)
+		{
+			case SIDECAR_XLOG_STATS:
+				logTLI = sidecar_read_u32(fp);
+				logId = sidecar_read_u32(fp);
+				logSeg = sidecar_read_u32(fp);
+				if (sidecar_read_u32(fp) != RM_MAX_ID+1)
+				{
+					fprintf(stderr, "ERROR: %s is written by xlogdump for another PostgreSQL version.\n", path);
+					exit(1);
+				}
+				for (i=0 ; i<RM_MAX_ID+1 ; i++)
+				{
+					xlogstats.rmgr_count[i] += sidecar_read_u64(fp);
+					xlogstats.rmgr_len[i] += sidecar_read_u64(fp);
+					sidecar_read_hist(fp, &xlogstats.rmgr_hist[i]);
+				}
+				xlogstats.bkpblock_count += sidecar_read_u64(fp);
+				xlogstats.bkpblock_len += sidecar_read_u64(fp);
+				sidecar_read_hist(fp, &xlogstats.bkpblock_hist);
+				break;
 
-		if (!(record->xl_info & XLR_SET_BKP_BLOCK(i)))
-			continue;
+			case SIDECAR_RMGR_STATS:
+				load_xlog_rmgr_stats(fp);
+				break;
 
-		memcpy(&bkpb, blk, sizeof(BkpBlock));
-		if (bkpb.hole_offset + bkpb.hole_length > BLCKSZ)
-		{
-			printf("incorrect hole size in record at %X/%X\n",
-				   recptr.xlogid, recptr.xrecoff);
-			return false;
-		}
-		blen = sizeof(BkpBlock) + BLCKSZ - bkpb.hole_length;
-		COMP_CRC32(crc, blk, blen);
-		blk += blen;
-	}
+			case SIDECAR_HOT_BLOCKS:
+				if (hot_blocks > 0)
+					load_xlog_hotblocks(fp);
+				else
+					sidecar_skip_section(fp, len);
+				break;
 
-	/* skip total xl_tot_len check if physical log has been removed. */
-#if PG_VERSION_NUM < 80300 || PG_VERSION_NUM >= 90200
-	if (record->xl_info & XLR_BKP_BLOCK_MASK)
-#else
-	if (!(record->xl_info & XLR_BKP_REMOVABLE) ||
-		record->xl_info & XLR_BKP_BLOCK_MASK)
-#endif
-	{
-		/* Check that xl_tot_len agrees with our calculation */
-		if (blk != (char *) record + record->xl_tot_len)
-		{
-			printf("incorrect total length in record at %X/%X\n",
-				   recptr.xlogid, recptr.xrecoff);
-			return false;
+			case SIDECAR_DISTINCT:
+				if (enable_distinct)
+					load_xlog_distinct(fp);
+				else
+					sidecar_skip_section(fp, len);
+				break;
+
+			case SIDECAR_RATE:
+				if (time_bucket > 0)
+					load_xlog_rate(fp);
+				else
+					sidecar_skip_section(fp, len);
+				break;
+
+			default:
+				sidecar_skip_section(fp, len);
+				break;
 		}
 	}
 
-	/* Finally include the record header */
-	COMP_CRC32(crc, (char *) record + sizeof(pg_crc32),
-			   SizeOfXLogRecord - sizeof(pg_crc32));
-	FIN_CRC32(crc);
+	fclose(fp);
+}
 
-	if (!EQ_CRC32(record->xl_crc, crc))
-	{
-		printf("incorrect resource manager data checksum in record at %X/%X\n",
-			   recptr.xlogid, recptr.xrecoff);
-		return false;
-	}
+/*
+ * zone_file_path()
+ *
+ * makes the path of the zone map or the xid index of the segment.
+ */
+static void
+zone_file_path(char *buf, size_t buflen, const char *fname, const char *suffix)
+{
+	const char *fnamebase = strrchr(fname, '/');
 
-	return true;
+	fnamebase = fnamebase ? fnamebase + 1 : fname;
+	snprintf(buf, buflen, "%s/%s%s", zone_dir, fnamebase, suffix);
 }
 
 /*
- * Attempt to read an XLOG record into readRecordBuf.
+ * parse_lsn()
+ *
+ * parses a LSN like "0/16B3748".
  */
 static bool
-ReadRecord(void)
+parse_lsn(const char *str, XLogRecPtr *lsn)
 {
-	char	   *buffer;
-	XLogRecord *record;
-	XLogContRecord *contrecord;
-	uint32		len,
-				total_len;
-	int			retries = 0;
+	char dummy;
 
-restart:
-	while (logRecOff <= 0 || logRecOff > XLOG_BLCKSZ - SizeOfXLogRecord)
-	{
-		/* Need to advance to new page */
-		if (! readXLogPage())
-			return false;
-		logRecOff = XLogPageHeaderSize((XLogPageHeader) pageBuffer);
-		if ((((XLogPageHeader) pageBuffer)->xlp_info & ~XLP_LONG_HEADER) != 0)
-		{
-			printf("Unexpected page info flags %04X at offset %X\n",
-				   ((XLogPageHeader) pageBuffer)->xlp_info, logPageOff);
-			/* Check for a continuation record */
-			if (((XLogPageHeader) pageBuffer)->xlp_info & XLP_FIRST_IS_CONTRECORD)
-			{
-				printf("Skipping unexpected continuation record at offset %X\n",
-					   logPageOff);
-				contrecord = (XLogContRecord *) (pageBuffer + logRecOff);
-				logRecOff += MAXALIGN(contrecord->xl_rem_len + SizeOfXLogContRecord);
-			}
-		}
-	}
+	return (sscanf(str, "%X/%X%c", &lsn->xlogid, &lsn->xrecoff, &dummy) == 2);
+}
 
-	curRecPtr.xlogid = logId;
-	curRecPtr.xrecoff = logSeg * XLogSegSize + logPageOff + logRecOff;
-	record = (XLogRecord *) (pageBuffer + logRecOff);
+/*
+ * segment_start_pos()
+ *
+ * gets the byte position where the segment file starts from its name.
+ * Returns false if the file name is not a segment name.
+ */
+static bool
+segment_start_pos(const char *fname, uint64 *pos)
+{
+	const char *fnamebase = strrchr(fname, '/');
+	uint32 tli, id, seg;
 
-	if (record->xl_len == 0)
-	{
-		/* Stop if XLOG_SWITCH was found. */
-		if (record->xl_rmid == RM_XLOG_ID && record->xl_info == XLOG_SWITCH)
-		{
-			dumpXLogRecord(record, false);
-			return false;
-		}
+	fnamebase = fnamebase ? fnamebase + 1 : fname;
+	if (sscanf(fnamebase, "%8x%8x%8x", &tli, &id, &seg) != 3)
+		return false;
 
-		printf("ReadRecord: record with zero len at %u/%08X\n",
-		   curRecPtr.xlogid, curRecPtr.xrecoff);
+	*pos = (uint64) id * WalFileSize + (uint64) seg * walSegSize;
+	return true;
+}
 
-		/* Attempt to recover on new page, but give up after a few... */
-		logRecOff = 0;
-		if (++retries > 4)
-			return false;
-		goto restart;
-	}
-	if (record->xl_tot_len < SizeOfXLogRecord + record->xl_len ||
-		record->xl_tot_len > SizeOfXLogRecord + record->xl_len +
-		XLR_MAX_BKP_BLOCKS * (sizeof(BkpBlock) + BLCKSZ))
-	{
-		printf(
-			"invalid record length(expected %lu ~ %lu, actual %d) at %X/%X\n",
-			(unsigned long) (SizeOfXLogRecord + record->xl_len),
-			(unsigned long) (SizeOfXLogRecord + record->xl_len +
-							 XLR_MAX_BKP_BLOCKS * (sizeof(BkpBlock) + BLCKSZ)),
-			record->xl_tot_len,
-			curRecPtr.xlogid, curRecPtr.xrecoff);
-		printf("HINT: Make sure you're using the correct xlogdump binary built against\n"
-		       "      the same architecture and version of PostgreSQL where the WAL file\n"
-		       "      comes from.\n");
+/*
+ * parse_time()
+ *
+ * parses a time like "2012-04-01 12:34:56[.123456]" as the local time,
+ * or "2012-04-01 12:34:56+09", "...-05:30" or "... UTC" with the offset,
+ * into microseconds since the Unix epoch.
+ */
+bool
+parse_time(const char *str, int64 *t)
+{
+	struct tm tm;
+	const char *rest;
+	int n = 0;
+	int offset = 0;
+	int y, m;
+	int64 days;
+	int64 usec = 0;
+	int64 scale = 100000;
+
+	memset(&tm, 0, sizeof(tm));
+	if (sscanf(str, "%d-%d-%d %d:%d:%d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+		   &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &n) != 6)
+		return false;
+	if (tm.tm_mon < 1 || tm.tm_mon > 12 || tm.tm_mday < 1 || tm.tm_mday > 31)
 		return false;
+	rest = str + n;
+
+	/* the fraction of a second, down to a microsecond */
+	if (*rest == '.')
+	{
+		rest++;
+		if (!isdigit((unsigned char) *rest))
+			return false;
+		for (; isdigit((unsigned char) *rest); rest++)
+		{
+			usec += (*rest - '0') * scale;
+			scale /= 10;
+		}
 	}
-	total_len = record->xl_tot_len;
 
-	/*
-	 * Allocate or enlarge readRecordBuf as needed.  To avoid useless
-	 * small increases, round its size to a multiple of XLOG_BLCKSZ, and make
-	 * sure it's at least 4*BLCKSZ to start with.  (That is enough for all
-	 * "normal" records, but very large commit or abort records might need
-	 * more space.)
-	 */
-	if (total_len > readRecordBufSize)
+	if (*rest == '\0')
 	{
-		uint32		newSize = total_len;
+		time_t sec;
 
-		newSize += XLOG_BLCKSZ - (newSize % XLOG_BLCKSZ);
-		newSize = Max(newSize, 4 * XLOG_BLCKSZ);
-		if (readRecordBuf)
-			free(readRecordBuf);
-		readRecordBuf = (char *) malloc(newSize);
-		if (!readRecordBuf)
-		{
-			readRecordBufSize = 0;
-			/* We treat this as a "bogus data" condition */
-			fprintf(stderr, "record length %u at %X/%X too long\n",
-					total_len, curRecPtr.xlogid, curRecPtr.xrecoff);
+		tm.tm_year -= 1900;
+		tm.tm_mon -= 1;
+		tm.tm_isdst = -1;
+		sec = mktime(&tm);
+		if (sec == -1)
 			return false;
-		}
-		readRecordBufSize = newSize;
+		*t = (int64) sec * USECS_PER_SEC + usec;
+		return true;
 	}
 
-	buffer = readRecordBuf;
-	len = XLOG_BLCKSZ - curRecPtr.xrecoff % XLOG_BLCKSZ; /* available in block */
-	if (total_len > len)
+	if (strcmp(rest, " UTC") == 0 || strcmp(rest, "Z") == 0)
+		offset = 0;
+	else if ((rest[0] == '+' || rest[0] == '-') &&
+		 isdigit((unsigned char) rest[1]) && isdigit((unsigned char) rest[2]))
 	{
-		/* Need to reassemble record */
-		uint32			gotlen = len;
+		int sign = (rest[0] == '-') ? -1 : 1;
 
-		memcpy(buffer, record, len);
-		record = (XLogRecord *) buffer;
-		buffer += len;
-		for (;;)
+		offset = ((rest[1] - '0') * 10 + (rest[2] - '0')) * 3600;
+		rest += 3;
+		if (*rest == ':')
+			rest++;
+		if (isdigit((unsigned char) rest[0]) && isdigit((unsigned char) rest[1]))
 		{
-			uint32	pageHeaderSize;
-
-			if (! readXLogPage())
-			{
-				/* XXX ought to be able to advance to new input file! */
-				fprintf(stderr, "Unable to read continuation page?\n");
-				dumpXLogRecord(record, true);
-				return false;
-			}
-			if (!(((XLogPageHeader) pageBuffer)->xlp_info & XLP_FIRST_IS_CONTRECORD))
-			{
-				printf("ReadRecord: there is no ContRecord flag in logfile %u seg %u off %u\n",
-					   logId, logSeg, logPageOff);
-				return false;
-			}
-			pageHeaderSize = XLogPageHeaderSize((XLogPageHeader) pageBuffer);
-			contrecord = (XLogContRecord *) (pageBuffer + pageHeaderSize);
-			if (contrecord->xl_rem_len == 0 || 
-				total_len != (contrecord->xl_rem_len + gotlen))
-			{
-				printf("ReadRecord: invalid cont-record len %u in logfile %u seg %u off %u\n",
-					   contrecord->xl_rem_len, logId, logSeg, logPageOff);
-				return false;
-			}
-			len = XLOG_BLCKSZ - pageHeaderSize - SizeOfXLogContRecord;
-			if (contrecord->xl_rem_len > len)
-			{
-				memcpy(buffer, (char *)contrecord + SizeOfXLogContRecord, len);
-				gotlen += len;
-				buffer += len;
-				continue;
-			}
-			memcpy(buffer, (char *) contrecord + SizeOfXLogContRecord,
-				   contrecord->xl_rem_len);
-			logRecOff = MAXALIGN(pageHeaderSize + SizeOfXLogContRecord + contrecord->xl_rem_len);
-			break;
+			offset += ((rest[0] - '0') * 10 + (rest[1] - '0')) * 60;
+			rest += 2;
 		}
-		if (!RecordIsValid(record, curRecPtr))
+		if (*rest != '\0')
 			return false;
-		return true;
+		offset *= sign;
 	}
-	/* Record is contained in this page */
-	memcpy(buffer, record, total_len);
-	record = (XLogRecord *) buffer;
-	logRecOff += MAXALIGN(total_len);
-	if (!RecordIsValid(record, curRecPtr))
+	else
 		return false;
+
+	/* days since 1970-01-01 of the civil date */
+	y = tm.tm_year - (tm.tm_mon <= 2);
+	m = tm.tm_mon;
+	days = (int64) y * 365 + y / 4 - y / 100 + y / 400 +
+		(153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + tm.tm_mday - 1 - 719468;
+
+	*t = (days * 86400 + tm.tm_hour * 3600 + tm.tm_min * 60 +
+	      tm.tm_sec - offset) * USECS_PER_SEC + usec;
 	return true;
 }
 
+/*
+ * probeXLogGeometry()
+ *
+ * takes the geometry from the first segment which can be read, before
+ * the segments are picked by their names.
+ */
 static void
-dumpXLogRecord(XLogRecord *record, bool header_only)
+probeXLogGeometry(char **files, int nfiles)
 {
-	uint8	info = record->xl_info & ~XLR_INFO_MASK;
+	int i;
+
+	for (i = 0; i < nfiles; i++)
+	{
+		XLogLongPageHeaderData hdr;
+		xlog_reader_t *r;
+		ssize_t len;
 
-	/* check if the user wants a specific rmid */
-	if (rmid>=0 && record->xl_rmid!=rmid)
+		/* the standard input can be read only once */
+		if (stream_is_stdin(files[i]))
+			continue;
+		len = stream_read_head(files[i], (char *) &hdr, sizeof(hdr));
+		if (len < 0)
+			continue;
+		r = reader_open_buffer((const char *) &hdr, len, files[i]);
+		walBlockSize = reader_block_size(r);
+		walSegSize = reader_seg_size(r);
+		reader_close(r);
 		return;
+	}
+}
 
-	if (xid!=InvalidTransactionId && xid!=record->xl_xid)
+/*
+ * printXLogPage()
+ *
+ * prints the header of each page read, with the records.
+ */
+static void
+printXLogPage(void *arg, XLogPageHeader page, uint32 pageno)
+{
+	if (!dump_records)
 		return;
 
-#ifdef NOT_USED
-	printf("%u/%08X: prv %u/%08X",
-		   curRecPtr.xlogid, curRecPtr.xrecoff,
-		   record->xl_prev.xlogid, record->xl_prev.xrecoff);
+	out_str("[page:");
+	out_int(pageno);
+	out_str(", xlp_info:");
+	out_int(page->xlp_info);
+	out_str(", xlp_tli:");
+	out_int((int32) page->xlp_tli);
+	out_str(", xlp_pageaddr:");
+	out_hex(page->xlp_pageaddr.xlogid);
+	out_char('/');
+	out_hex(page->xlp_pageaddr.xrecoff);
+	out_str("] ");
+
+	if ( (page->xlp_info & XLP_FIRST_IS_CONTRECORD) )
+		out_str("XLP_FIRST_IS_CONTRECORD ");
+	if ( (page->xlp_info & XLP_LONG_HEADER) )
+		out_str("XLP_LONG_HEADER ");
+#if PG_VERSION_NUM >= 90200
+	if ( (page->xlp_info & XLP_BKP_REMOVABLE) )
+		out_str("XLP_BKP_REMOVABLE ");
+#endif
 
-	if (!XLByteEQ(record->xl_prev, prevRecPtr))
-		printf("(?)");
+	out_char('\n');
+}
 
-	printf("; xid %u; ", record->xl_xid);
+/*
+ * skipXLogRecord()
+ *
+ * In the fast scan, a record rejected by the filter on its header is
+ * passed over without copying or verifying it.
+ */
+static bool
+skipXLogRecord(void *arg, xlog_reader_t *r, XLogRecPtr lsn, XLogRecord *record)
+{
+	DecodedRecord dec;
 
-	if (record->xl_rmid <= RM_MAX_ID)
-		printf("%s", RM_names[record->xl_rmid]);
+	if (!skipping)
+		return false;
+
+	decode_record(&dec, logVersion, lsn, record, true);
+	return !filter_match(&dec);
+}
+
+/*
+ * report_on_stdout()
+ *
+ * returns true if the segment names and the messages can be printed
+ * among the records. They go to stderr not to break the records of -O
+ * jsonl and arrow, or the statistics of -F json and prom.
+ */
+static bool
+report_on_stdout(void)
+{
+	return output_format == OUTPUT_FORMAT_TEXT && stats_format == STATS_FORMAT_TEXT;
+}
+
+/*
+ * reportXLog()
+ *
+ * prints a message about a broken page or record among the records.
+ */
+static void
+reportXLog(void *arg, const char *msg)
+{
+	if (report_on_stdout())
+		out_str(msg);
 	else
-		printf("RM %2d", record->xl_rmid);
+		fputs(msg, stderr);
+}
 
-	printf(" info %02X len %u tot_len %u\n", record->xl_info,
-		   record->xl_len, record->xl_tot_len);
-#endif
+/*
+ * printSegmentName()
+ *
+ * prints the name of the segment before its records and messages.
+ */
+static void
+printSegmentName(const char *fname)
+{
+	if (report_on_stdout())
+		out_printf("\n%s:\n\n", fname);
+	else
+		fprintf(stderr, "\n%s:\n\n", fname);
+}
+
+/* 
+ * Exit closing active database connections
+ */
+void
+exit_gracefuly(int status)
+{
+	DBDisconnect();
+
+	out_flush();
+	if (reader != NULL)
+		reader_close(reader);
+	exit(status);
+}
+
+/*
+ * Attempt to read an XLOG record into curRecord. A XLOG_SWITCH, or
+ * a record whose continuation can't be read, is printed here as the
+ * last one of the segment.
+ */
+static bool
+ReadRecord(void)
+{
+	XLogRecord *record;
+	DecodedRecord dec;
+	int rc;
 
-	if (header_only)
+	if (pipeJob >= 0)
+		return readPipedRecord();
+
+	rc = reader_next_record(reader, &curRecPtr, &record);
+	if (rc == READER_RECORD)
 	{
-		printf(" ** maybe continues to next segment **\n");
-		return;
+		curRecord = record;
+		return true;
 	}
 
-	/*
-	 * See rmgr.h for more details about the built-in resource managers.
-	 */
-	xlogstats.rmgr_count[record->xl_rmid]++;
-	xlogstats.rmgr_len[record->xl_rmid] += record->xl_len;
-	switch (record->xl_rmid)
+	if (rc != READER_END)
 	{
-		case RM_XLOG_ID:
-			print_rmgr_xlog(curRecPtr, record, info, hideTimestamps);
-			break;
-		case RM_XACT_ID:
-			print_rmgr_xact(curRecPtr, record, info, hideTimestamps);
-			break;
-		case RM_SMGR_ID:
-			print_rmgr_smgr(curRecPtr, record, info);
-			break;
-		case RM_CLOG_ID:
-			print_rmgr_clog(curRecPtr, record, info);
-			break;
-		case RM_DBASE_ID:
-			print_rmgr_dbase(curRecPtr, record, info);
-			break;
-		case RM_TBLSPC_ID:
-			print_rmgr_tblspc(curRecPtr, record, info);
-			break;
-		case RM_MULTIXACT_ID:
-			print_rmgr_multixact(curRecPtr, record, info);
-			break;
-#if PG_VERSION_NUM >= 90000
-		case RM_RELMAP_ID:
-			print_rmgr_relmap(curRecPtr, record, info);
-			break;
-		case RM_STANDBY_ID:
-			print_rmgr_standby(curRecPtr, record, info);
-			break;
-#endif
-		case RM_HEAP2_ID:
-			print_rmgr_heap2(curRecPtr, record, info);
-			break;
-		case RM_HEAP_ID:
-			print_rmgr_heap(curRecPtr, record, info, statements);
-			break;
-		case RM_BTREE_ID:
-			print_rmgr_btree(curRecPtr, record, info);
-			break;
-		case RM_HASH_ID:
-			print_rmgr_hash(curRecPtr, record, info);
-			break;
-		case RM_GIN_ID:
-			print_rmgr_gin(curRecPtr, record, info);
-			break;
-		case RM_GIST_ID:
-			print_rmgr_gist(curRecPtr, record, info);
-			break;
-		case RM_SEQ_ID:
-			print_rmgr_seq(curRecPtr, record, info);
-			break;
-		default:
-			fprintf(stderr, "Unknown RMID %d.\n", record->xl_rmid);
-			break;
+		decode_record(&dec, logVersion, curRecPtr, record, rc == READER_PARTIAL);
+		dumpXLogRecord(&dec);
 	}
+	return false;
+}
 
-	/*
-	 * print info about backup blocks.
+/*
+ * readPipedRecord()
+ *
+ * takes the next record of the segment from its reader thread, with
+ * the pages and the messages before it, as ReadRecord() does.
+ */
+static bool
+readPipedRecord(void)
+{
+	for (;;)
+	{
+		pipeline_item_t *item = pipeline_get(pipeJob);
+		void *body = PipelineItemBody(item);
+		const segment_end_t *end;
+
+		switch (item->kind)
+		{
+			case ITEM_PAGE:
+				if (pipeFormat)
+					out_bytes(pipeline_item_text(pipeJob, item), item->textlen);
+				else
+					printXLogPage(NULL, &((page_item_t *) body)->hdr,
+						      ((page_item_t *) body)->pageno);
+				break;
+
+			case ITEM_REPORT:
+				reportXLog(NULL, (const char *) PipelineItemData(item));
+				break;
+
+			case ITEM_RECORD:
+				curDecoded = (DecodedRecord *) body;
+				curRecPtr = curDecoded->lsn;
+				curRecord = curDecoded->record;
+				curText = pipeline_item_text(pipeJob, item);
+				curTextLen = item->textlen;
+				return true;
+
+			case ITEM_SWITCH:
+			case ITEM_PARTIAL:
+				curRecPtr = ((DecodedRecord *) body)->lsn;
+				curText = pipeline_item_text(pipeJob, item);
+				curTextLen = item->textlen;
+				dumpXLogRecord((DecodedRecord *) body);
+				break;
+
+			case ITEM_END:
+				end = (const segment_end_t *) body;
+				verified_records += end->stats.verified_records;
+				verified_bytes += end->stats.verified_bytes;
+				skipped_records += end->stats.skipped_records;
+				skipped_bytes += end->stats.skipped_bytes;
+				pipeComplete = end->complete;
+				pipeEnded = true;
+				curDecoded = NULL;
+				return false;
+		}
+	}
+}
+
+/*
+ * dumpXLogRecord()
+ *
+ * accounts a record to the statistics, and prints it if the user wants
+ * it. With pipeFormat, it has been printed by a formatter thread into
+ * curText, which is written here in its place.
+ */
+static void
+dumpXLogRecord(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	const rmgr_desc_t *desc;
+
+	if (zone_dir != NULL)
+	{
+		zonemap_add_record(&cur_zone, dec);
+		index_add_record(record->xl_xid, curRecPtr.xrecoff % walSegSize);
+	}
+
+	/* check if the user wants the record, before printing it */
+	if (!filter_match(dec))
+		return;
+
+	if (pipeFormat)
+		out_bytes(curText, curTextLen);
+	else if (output_format != OUTPUT_FORMAT_ARROW)
+		formatXLogRecord(dec);
+
+	if (output_format == OUTPUT_FORMAT_JSONL)
+		return;
+	if (output_format == OUTPUT_FORMAT_ARROW)
+	{
+		if (!dec->partial)
+			arrow_add_record(dec);
+		return;
+	}
+	if (dec->partial)
+		return;
+
+	/*
+	 * See rmgr.h for more details about the built-in resource managers.
+	 */
+	xlogstats.rmgr_count[record->xl_rmid]++;
+	xlogstats.rmgr_len[record->xl_rmid] += record->xl_len;
+	hist_add(&xlogstats.rmgr_hist[record->xl_rmid], record->xl_tot_len);
+
+	desc = (record->xl_rmid <= RM_MAX_ID) ? &RM_table[record->xl_rmid] : NULL;
+	if (desc != NULL && desc->format != NULL)
+	{
+		decode_fields(dec, DECODE_PAYLOAD);
+		if (desc->account != NULL)
+			desc->account(dec);
+	}
+
+	account_backup_blocks(dec);
+}
+
+/*
+ * formatXLogRecord()
+ *
+ * prints a record accepted by the filter, with -O text or jsonl. It
+ * only reads the record and the settings, so that it can be called in
+ * the formatter threads of the pipeline.
+ */
+static void
+formatXLogRecord(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	const rmgr_desc_t *desc;
+
+#ifdef NOT_USED
+	printf("%u/%08X: prv %u/%08X",
+		   curRecPtr.xlogid, curRecPtr.xrecoff,
+		   record->xl_prev.xlogid, record->xl_prev.xrecoff);
+
+	if (!XLByteEQ(record->xl_prev, prevRecPtr))
+		printf("(?)");
+
+	printf("; xid %u; ", record->xl_xid);
+
+	if (record->xl_rmid <= RM_MAX_ID)
+		printf("%s", RM_table[record->xl_rmid].name);
+	else
+		printf("RM %2d", record->xl_rmid);
+
+	printf(" info %02X len %u tot_len %u\n", record->xl_info,
+		   record->xl_len, record->xl_tot_len);
+#endif
+
+	if (output_format == OUTPUT_FORMAT_JSONL)
+	{
+		if (!dec->partial)
+			jsonl_write_record(dec);
+		return;
+	}
+
+	if (dec->partial)
+	{
+		out_printf(" ** maybe continues to next segment **\n");
+		return;
+	}
+
+	desc = (record->xl_rmid <= RM_MAX_ID) ? &RM_table[record->xl_rmid] : NULL;
+	if (desc != NULL && !dec->version->native)
+		print_rmgr_decoded(dec);
+	else if (desc != NULL && desc->format != NULL)
+	{
+		decode_fields(dec, DECODE_PAYLOAD);
+		desc->format(dec);
+	}
+	else
+		fprintf(stderr, "Unknown RMID %d.\n", record->xl_rmid);
+
+	/*
+	 * print info about backup blocks.
+	 */
+	print_backup_blocks(dec);
+}
+
+/*
+ * account_block_refs()
+ *
+ * counts the blocks touched by the current xlog record, including
+ * the backup blocks, to find the hottest blocks and to estimate the
+ * number of distinct blocks.
+ */
+static void
+account_block_refs(DecodedRecord *dec)
+{
+	const block_ref_t *refs;
+	int nrefs, i;
+
+	collect_block_refs(dec);
+	nrefs = get_block_refs(&refs);
+	for (i = 0 ; i < nrefs ; i++)
+	{
+		if (hot_blocks > 0)
+			hotblock_add(&refs[i].node, refs[i].block);
+		if (enable_distinct)
+			distinct_add_block(&refs[i].node, refs[i].block);
+	}
+}
+
+static void
+print_backup_blocks(DecodedRecord *dec)
+{
+	int i;
+	char buf[1024];
+	char spaceName[NAMEDATALEN];
+	char dbName[NAMEDATALEN];
+	char relName[NAMEDATALEN];
+
+	if (!dump_records)
+		return;
+
+	/*
+	 * backup blocks by full_page_write
 	 */
-	print_backup_blocks(curRecPtr, record);
+	decode_fields(dec, DECODE_BKP);
+	for (i = 0; i < dec->nbkp; i++)
+	{
+		DecodedBkpBlock *bkb = &dec->bkp[i];
+
+		getSpaceName(bkb->node.spcNode, spaceName, sizeof(spaceName));
+		getDbName(bkb->node.dbNode, dbName, sizeof(dbName));
+		getRelName(bkb->node.dbNode, bkb->node.relNode, relName, sizeof(relName));
+		snprintf(buf, sizeof(buf), "bkpblock[%d]: s/d/r:%s/%s/%s blk:%u hole_off/len:%u/%u\n", 
+				bkb->id+1, spaceName, dbName, relName,
+				bkb->block, bkb->hole_offset, bkb->hole_length);
+
+		PRINT_XLOGRECORD_HEADER(dec->lsn, dec->record);
+		out_str(buf);
+	}
+}
+
+/*
+ * account_backup_blocks()
+ *
+ * accounts the backup blocks of a record to the statistics.
+ */
+static void
+account_backup_blocks(DecodedRecord *dec)
+{
+	int i;
+
+	decode_fields(dec, DECODE_BKP);
+	for (i = 0; i < dec->nbkp; i++)
+	{
+		xlogstats.bkpblock_count++;
+		xlogstats.bkpblock_len += (BLCKSZ - dec->bkp[i].hole_length);
+		hist_add(&xlogstats.bkpblock_hist, BLCKSZ - dec->bkp[i].hole_length);
+	}
+}
+
+/*
+ * account_rate()
+ *
+ * accounts a xlog record to the WAL generation rate, and uses the
+ * timestamp in the record, if any, as a time anchor.
+ */
+static void
+account_rate(DecodedRecord *dec)
+{
+	decode_fields(dec, DECODE_TIME | DECODE_BKP);
+
+	rate_add_record(dec->record->xl_tot_len, dec->bkp_len, dec->commit);
+
+	if (dec->has_time)
+		rate_anchor(dec->time);
+}
+
+/* a commit without relations or invalidations, written since 9.2 */
+#ifndef XLOG_XACT_COMMIT_COMPACT
+#define XLOG_XACT_COMMIT_COMPACT	0x60
+#endif
+
+/*
+ * Adds a transaction to a linked list of transactions
+ * If the transactions xid already is on the list it sums the total len and check for a status change
+ */
+static void
+addTransaction(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	int	status = 0;
+
+	if (record->xl_rmid == RM_XACT_ID)
+	{
+		switch (dec->info)
+		{
+			case XLOG_XACT_COMMIT:
+			case XLOG_XACT_COMMIT_COMPACT:
+				status = 1;
+				break;
+			case XLOG_XACT_ABORT:
+				status = 2;
+				break;
+			case XLOG_XACT_COMMIT_PREPARED:
+			case XLOG_XACT_ABORT_PREPARED:
+				/*
+				 * Ends the prepared transaction, whose xid leads the
+				 * record data in every version, and not xl_xid, the
+				 * one of the session running COMMIT PREPARED.
+				 */
+				if (record->xl_len >= sizeof(TransactionId))
+				{
+					TransactionId xid;
+
+					memcpy(&xid, XLogRecGetData(record), sizeof(TransactionId));
+					setTransaction(xid, 0,
+						       dec->info == XLOG_XACT_COMMIT_PREPARED ? 1 : 2);
+				}
+				break;
+		}
+	}
+
+	setTransaction(record->xl_xid, record->xl_tot_len, status);
+}
+
+/*
+ * setTransaction()
+ *
+ * sums the length to the transaction of the xid on the list, and sets
+ * its status unless it is already known.
+ */
+static void
+setTransaction(TransactionId xid, uint32 tot_len, int status)
+{
+	if(transactionsInfo != NULL)
+	{
+		transInfoPtr element = transactionsInfo;
+		while (element->next != NULL || element->xid == xid)
+		{
+			if(element->xid == xid)
+			{
+				element->tot_len += tot_len;
+				if(element->status == 0)
+					element->status = status;
+				return;
+			}
+			element = element->next;
+		}
+		element->next = (transInfoPtr) malloc(sizeof(transInfo));
+		element = element->next;
+		element->xid = xid;
+		element->tot_len = tot_len;
+		element->status = status;
+		element->next = NULL;
+		return;
+	}
+	else
+	{
+		transactionsInfo = (transInfoPtr) malloc(sizeof(transInfo));
+		transactionsInfo->xid = xid;
+		transactionsInfo->tot_len = tot_len;
+		transactionsInfo->status = status;
+		transactionsInfo->next = NULL;
+	}
+}
+
+static void
+dumpTransactions()
+{
+	transInfo * element = transactionsInfo;
+	if(!element)
+	{
+		out_printf("\nCorrupt or incomplete transaction.\n");
+		return;
+	}
+
+	while (element->next != NULL)
+	{
+		out_printf("\nxid: %u total length: %u status: %s", element->xid, element->tot_len, status_names[element->status]);
+		element = element->next;
+	}
+	out_printf("\n");
+}
+
+/*
+ * handleRecord()
+ *
+ * processes the record just read. Returns false if the record is
+ * at or after --end-lsn, and the rest of the segment should be skipped.
+ */
+static bool
+handleRecord(void)
+{
+	uint64 pos = XLogRecPtrToBytePos(curRecPtr);
+	DecodedRecord local;
+	DecodedRecord *dec = curDecoded;
+
+	if (end_pos > 0 && pos >= end_pos)
+		return false;
+	if (pos < start_pos)
+		return true;
+
+	/* decoded once here, and shared by all the consumers below */
+	if (dec == NULL)
+	{
+		decode_record(&local, logVersion, curRecPtr, curRecord, false);
+		dec = &local;
+	}
+
+	if (time_bucket > 0)
+		account_rate(dec);
+	if (enable_cycles)
+		cycle_add_record(dec);
+	/* the blocks of the records shown, with -t as well */
+	if ((hot_blocks > 0 || enable_distinct) && !dec->partial && filter_match(dec))
+		account_block_refs(dec);
+
+	if(!transactions)
+		dumpXLogRecord(dec);
+	else
+	{
+		if (zone_dir != NULL)
+		{
+			zonemap_add_record(&cur_zone, dec);
+			index_add_record(dec->record->xl_xid,
+					 curRecPtr.xrecoff % walSegSize);
+		}
+		addTransaction(dec);
+	}
+
+	if (enable_distinct)
+		distinct_add_record(dec);
+
+	prevRecPtr = curRecPtr;
+
+	return true;
+}
+
+/*
+ * beginXLog()
+ *
+ * gets ready to read the segment just opened as fd.
+ */
+static void
+beginXLog(char *fname, int fd)
+{
+	reader_hooks_t hooks;
+
+	reader = reader_open_fd(fd, fname);
+	reader_segment(reader, &logTLI, &logId, &logSeg);
+	walBlockSize = reader_block_size(reader);
+	walSegSize = reader_seg_size(reader);
+	logVersion = version_of_reader(reader);
+
+	hooks.page = printXLogPage;
+	hooks.skip = skipXLogRecord;
+	hooks.report = reportXLog;
+	hooks.arg = NULL;
+	reader_set_hooks(reader, &hooks);
+}
+
+/*
+ * endXLog()
+ *
+ * closes the segment, counting the records read through or skipped.
+ */
+static void
+endXLog(void)
+{
+	const reader_stats_t *stats;
+
+	if (pipeJob >= 0)
+	{
+		/* the reader thread has stopped where the records were */
+		while (!pipeEnded)
+			readPipedRecord();
+		pipeJob = -1;
+		return;
+	}
+
+	stats = reader_stats(reader);
+
+	verified_records += stats->verified_records;
+	verified_bytes += stats->verified_bytes;
+	skipped_records += stats->skipped_records;
+	skipped_bytes += stats->skipped_bytes;
+
+	reader_close(reader);
+	reader = NULL;
+}
+
+/*
+ * dumpXLog()
+ *
+ * reads the records in the segment. If `offsets' is given, only the
+ * records at those offsets are read, with seeking to each of them.
+ * Otherwise, reading starts at the page of --start-lsn if it is in
+ * the segment.
+ */
+static void
+dumpXLog(char* fname, int fd, const uint32 *offsets, int noffsets)
+{
+	printSegmentName(fname);
+
+	if (pipeJob >= 0)
+	{
+		/* the records come from a reader thread, sought as below */
+		while (ReadRecord())
+		{
+			if (!handleRecord())
+				break;
+		}
+		endXLog();
+		if (transactions && offsets == NULL && pipeComplete)
+			dumpTransactions();
+		return;
+	}
+	beginXLog(fname, fd);
+
+	if (offsets != NULL)
+	{
+		int i;
+
+		for (i = 0; i < noffsets; i++)
+		{
+			if (!reader_seek_record(reader, offsets[i]) || !ReadRecord())
+				continue;
+			if (!handleRecord())
+				break;
+		}
+		endXLog();
+		return;
+	}
+
+	if (!seekStartLSN(reader))
+	{
+		endXLog();
+		return;
+	}
+
+	skipping = fast_scan;
+	while (ReadRecord())
+	{
+		if (!handleRecord())
+			break;
+	}
+	skipping = false;
+	endXLog();
+	if(transactions)
+		dumpTransactions();
+}
+
+/*
+ * followXLog()
+ *
+ * reads the segment being written, from fname, as far as the records
+ * have been written, and waits for more to be written. When it has been
+ * filled, goes on to the next one. Stops only at --end-lsn.
+ */
+static void
+followXLog(const char *fname)
+{
+	char path[MAXPGPATH];
+	bool first = true;
+	uint64 seg_pos;
+
+	strlcpy(path, fname, sizeof(path));
+
+	/* --start-lsn after the segment is waited for in its own segment */
+	if (start_pos > 0 && segment_start_pos(fname, &seg_pos) &&
+	    start_pos >= seg_pos + walSegSize)
+	{
+		const char *fnamebase = strrchr(fname, '/');
+		TimeLineID tli;
+
+		fnamebase = fnamebase ? fnamebase + 1 : fname;
+		if (sscanf(fnamebase, "%8X", &tli) == 1)
+			follow_segment_path(path, sizeof(path), tli, start_lsn.xlogid,
+					    start_lsn.xrecoff / walSegSize);
+	}
+
+	for (;;)
+	{
+		int fd;
+
+		/* the next segment may not have been created yet */
+		while ((fd = open(path, O_RDONLY | PG_BINARY, 0)) < 0)
+		{
+			if (errno != ENOENT)
+			{
+				perror(path);
+				exit_gracefuly(1);
+			}
+			out_flush();
+			follow_wait(path);
+		}
+
+		printSegmentName(path);
+		beginXLog(path, fd);
+		reader_set_follow(reader, true);
+		/* the page of --start-lsn may not have been written yet */
+		while (first && !seekStartLSN(reader))
+		{
+			out_flush();
+			follow_wait(path);
+		}
+		first = false;
+
+		for (;;)
+		{
+			while (ReadRecord())
+			{
+				if (!handleRecord())
+				{
+					endXLog();
+					return;
+				}
+			}
+			if (!reader_retry(reader))
+				break;
+
+			/* all written so far is out, before sleeping */
+			out_flush();
+			follow_wait(path);
+		}
+		endXLog();
+
+		/* the segments per log id, as WalFileSize */
+		if (++logSeg >= ((uint32) 0xffffffff) / walSegSize)
+		{
+			logSeg = 0;
+			logId++;
+		}
+		follow_segment_path(path, sizeof(path), logTLI, logId, logSeg);
+	}
+}
+
+/*
+ * seekStartLSN()
+ *
+ * moves to the page of --start-lsn if it is in the segment. Returns
+ * false if the page can't be read.
+ */
+static bool
+seekStartLSN(xlog_reader_t *r)
+{
+	TimeLineID tli;
+	uint32 id, seg;
+	uint32 blcksz = reader_block_size(r);
+	uint32 segsize = reader_seg_size(r);
+	uint64 seg_pos;
+
+	if (start_pos == 0)
+		return true;
+
+	reader_segment(r, &tli, &id, &seg);
+	seg_pos = (uint64) id * WalFileSizeOf(segsize) + (uint64) seg * segsize;
+	if (start_pos > seg_pos && start_pos < seg_pos + segsize)
+	{
+		uint32 off = (uint32) (start_pos - seg_pos);
+
+		return reader_seek_page(r, off - off % blcksz);
+	}
+	return true;
+}
+
+/*
+ * formatItem()
+ *
+ * prints a page header or a record accepted by the filter in a
+ * formatter thread, for readPipedRecord() to write it in order.
+ */
+static void
+formatItem(pipeline_item_t *item)
+{
+	void *body = PipelineItemBody(item);
+
+	switch (item->kind)
+	{
+		case ITEM_PAGE:
+			printXLogPage(NULL, &((page_item_t *) body)->hdr,
+				      ((page_item_t *) body)->pageno);
+			break;
+
+		case ITEM_RECORD:
+		case ITEM_SWITCH:
+		case ITEM_PARTIAL:
+			if (filter_match((DecodedRecord *) body))
+				formatXLogRecord((DecodedRecord *) body);
+			break;
+	}
+}
+
+/*
+ * The hooks of a reader in a reader thread, which pass the pages and
+ * the messages on to the main thread, and skip the records as
+ * skipXLogRecord() does. The filter is evaluated without any state.
+ */
+static void
+pipePage(void *arg, XLogPageHeader page, uint32 pageno)
+{
+	pipeline_item_t *item;
+	page_item_t *body;
+
+	if (!dump_records)
+		return;
+
+	item = pipeline_alloc((pipeline_reader_t *) arg, ITEM_PAGE, sizeof(page_item_t), 0);
+	body = (page_item_t *) PipelineItemBody(item);
+	body->hdr = *page;
+	body->pageno = pageno;
+}
+
+static bool
+pipeSkip(void *arg, xlog_reader_t *r, XLogRecPtr lsn, XLogRecord *record)
+{
+	DecodedRecord dec;
+
+	decode_record(&dec, version_of_reader(r), lsn, record, true);
+	return !filter_match(&dec);
+}
+
+static void
+pipeReport(void *arg, const char *msg)
+{
+	pipeline_item_t *item;
+
+	item = pipeline_alloc((pipeline_reader_t *) arg, ITEM_REPORT, 0, strlen(msg) + 1);
+	strcpy((char *) PipelineItemData(item), msg);
+}
+
+/*
+ * pipeRecord()
+ *
+ * passes a record returned by the reader on to the main thread, with
+ * its fields decoded here. Returns false where the main thread will
+ * stop reading the segment, at --end-lsn.
+ */
+static bool
+pipeRecord(pipeline_reader_t *pr, xlog_reader_t *r, int rc,
+	   XLogRecPtr lsn, XLogRecord *record)
+{
+	pipeline_item_t *item;
+	DecodedRecord *dec;
+	uint32 len;
+	int kind;
+
+	if (rc == READER_RECORD)
+	{
+		kind = ITEM_RECORD;
+		len = record->xl_tot_len;
+	}
+	else
+	{
+		kind = (rc == READER_SWITCH) ? ITEM_SWITCH : ITEM_PARTIAL;
+		len = SizeOfXLogRecord;
+	}
+
+	item = pipeline_alloc(pr, kind, sizeof(DecodedRecord), len);
+	memcpy(PipelineItemData(item), record, len);
+
+	dec = (DecodedRecord *) PipelineItemBody(item);
+	decode_record(dec, version_of_reader(r), lsn,
+		      (XLogRecord *) PipelineItemData(item), rc == READER_PARTIAL);
+	if (rc != READER_PARTIAL)
+		decode_fields(dec, DECODE_ALL);
+
+	return !(rc == READER_RECORD && end_pos > 0 &&
+		 XLogRecPtrToBytePosOf(lsn, reader_seg_size(r)) >= end_pos);
+}
+
+/*
+ * readSegment()
+ *
+ * reads the job-th segment in a reader thread, as dumpXLog() does.
+ */
+static void
+readSegment(pipeline_reader_t *pr, int jobno)
+{
+	segment_job_t *job = &jobs[jobno];
+	xlog_reader_t *r;
+	reader_hooks_t hooks;
+	pipeline_item_t *item;
+	segment_begin_t *begin;
+	segment_end_t *end;
+	XLogRecPtr lsn;
+	XLogRecord *record;
+	bool complete = true;
+	int fd, rc, i;
+
+	fd = stream_open(job->fname);
+	if (fd < 0)
+	{
+		item = pipeline_alloc(pr, ITEM_FAILED, sizeof(int), 0);
+		*(int *) PipelineItemBody(item) = errno;
+		pipeline_end_job(pr);
+		return;
+	}
+
+	r = reader_open_fd(fd, job->fname);
+	item = pipeline_alloc(pr, ITEM_BEGIN, sizeof(segment_begin_t), 0);
+	begin = (segment_begin_t *) PipelineItemBody(item);
+	reader_segment(r, &begin->tli, &begin->id, &begin->seg);
+	begin->blcksz = reader_block_size(r);
+	begin->segsize = reader_seg_size(r);
+	begin->version = version_of_reader(r);
+
+	hooks.page = pipePage;
+	hooks.skip = (fast_scan && job->offsets == NULL) ? pipeSkip : NULL;
+	hooks.report = pipeReport;
+	hooks.arg = pr;
+	reader_set_hooks(r, &hooks);
+
+	if (job->offsets != NULL)
+	{
+		for (i = 0; i < job->noffsets; i++)
+		{
+			if (!reader_seek_record(r, job->offsets[i]))
+				continue;
+			rc = reader_next_record(r, &lsn, &record);
+			if (rc != READER_END && !pipeRecord(pr, r, rc, lsn, record))
+				break;
+		}
+	}
+	else if (seekStartLSN(r))
+	{
+		while ((rc = reader_next_record(r, &lsn, &record)) != READER_END)
+		{
+			if (!pipeRecord(pr, r, rc, lsn, record))
+				break;
+		}
+	}
+	else
+		complete = false;
+
+	item = pipeline_alloc(pr, ITEM_END, sizeof(segment_end_t), 0);
+	end = (segment_end_t *) PipelineItemBody(item);
+	end->stats = *reader_stats(r);
+	end->complete = complete;
+
+	reader_close(r);
+	pipeline_end_job(pr);
+}
+
+/*
+ * beginPipedXLog()
+ *
+ * gets ready to take the records of the job-th segment from its reader
+ * thread. Returns false if it couldn't be opened.
+ */
+static bool
+beginPipedXLog(int job, char *fname)
+{
+	pipeline_item_t *item = pipeline_get(job);
+	const segment_begin_t *begin;
+
+	if (item->kind == ITEM_FAILED)
+	{
+		errno = *(int *) PipelineItemBody(item);
+		perror(fname);
+		return false;
+	}
+
+	begin = (const segment_begin_t *) PipelineItemBody(item);
+	logTLI = begin->tli;
+	logId = begin->id;
+	logSeg = begin->seg;
+	/* the reader threads use the geometry of their own segments */
+	walBlockSize = begin->blcksz;
+	walSegSize = begin->segsize;
+	logVersion = begin->version;
+
+	pipeJob = job;
+	pipeEnded = false;
+	return true;
+}
+
+static int
+compare_segments(const void *a, const void *b)
+{
+	const char *fa = *(char * const *) a;
+	const char *fb = *(char * const *) b;
+	uint64 pa, pb;
+
+	if (segment_start_pos(fa, &pa) && segment_start_pos(fb, &pb) && pa != pb)
+		return (pa < pb) ? -1 : 1;
+	return strcmp(fa, fb);
+}
+
+/*
+ * str_usec()
+ *
+ * formats microseconds since the Unix epoch as the local time.
+ */
+static char *
+str_usec(int64 usec, char *buf, size_t buflen)
+{
+	time_t tt = (time_t) (usec / USECS_PER_SEC);
+	char tbuf[32];
+	char zbuf[16];
+
+	strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+	strftime(zbuf, sizeof(zbuf), "%Z", localtime(&tt));
+	snprintf(buf, buflen, "%s.%06d %s", tbuf, (int) (usec % USECS_PER_SEC), zbuf);
+	return buf;
 }
 
-static void
-print_backup_blocks(XLogRecPtr cur, XLogRecord *rec)
+/*
+ * first_commit_time()
+ *
+ * gets the time of the first commit in the segment, from its zone map
+ * if there is a fresh one, or by reading the segment up to the commit.
+ * Returns false if the segment has no commit.
+ */
+static bool
+first_commit_time(char *fname, int64 *t)
 {
-	char *blk;
-	int i;
-	char buf[1024];
+	bool commit = false;
+	int fd;
 
-	/*
-	 * backup blocks by full_page_write
-	 */
-	blk = (char*)XLogRecGetData(rec) + rec->xl_len;
-	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
+	if (zone_dir != NULL)
 	{
-		BkpBlock  bkb;
-
-		if (!(rec->xl_info & (XLR_SET_BKP_BLOCK(i))))
-			continue;
-		memcpy(&bkb, blk, sizeof(BkpBlock));
-		getSpaceName(bkb.node.spcNode, spaceName, sizeof(spaceName));
-		getDbName(bkb.node.dbNode, dbName, sizeof(dbName));
-		getRelName(bkb.node.relNode, relName, sizeof(relName));
-		snprintf(buf, sizeof(buf), "bkpblock[%d]: s/d/r:%s/%s/%s blk:%u hole_off/len:%u/%u\n", 
-				i+1, spaceName, dbName, relName,
-				bkb.block, bkb.hole_offset, bkb.hole_length);
-		blk += sizeof(BkpBlock) + (BLCKSZ - bkb.hole_length);
+		char zone_path[MAXPGPATH];
+		zonemap_t zone;
 
-		if (!enable_stats)
+		zone_file_path(zone_path, sizeof(zone_path), fname, ZONEMAP_SUFFIX);
+		if (zonemap_load(&zone, zone_path, fname) && zone.has_commit_time)
 		{
-			PRINT_XLOGRECORD_HEADER(cur, rec);
-			printf("%s", buf);
+			*t = zone.first_commit_time;
+			return (zone.first_commit_time != 0);
 		}
-
-		xlogstats.bkpblock_count++;
-		xlogstats.bkpblock_len += (BLCKSZ - bkb.hole_length);
 	}
-}
 
-
-/*
- * Adds a transaction to a linked list of transactions
- * If the transactions xid already is on the list it sums the total len and check for a status change
- */
-static void
-addTransaction(XLogRecord *record)
-{
-	uint8	info = record->xl_info & ~XLR_INFO_MASK;
-	int	status = 0;
-	if(record->xl_rmid == RM_XACT_ID)
+	fd = stream_open(fname);
+	if (fd < 0)
 	{
-		if (info == XLOG_XACT_COMMIT)
-			status = 1;
-		else if (info == XLOG_XACT_ABORT)
-			status = 2;
+		perror(fname);
+		return false;
 	}
+	beginXLog(fname, fd);
 
-	if(transactionsInfo != NULL)
+	while (ReadRecord())
 	{
-		transInfoPtr element = transactionsInfo;
-		while (element->next != NULL || element->xid == record->xl_xid)
+		DecodedRecord dec;
+
+		decode_record(&dec, logVersion, curRecPtr, curRecord, false);
+		decode_fields(&dec, DECODE_TIME);
+		if (dec.commit)
 		{
-			if(element->xid == record->xl_xid)
-			{
-				element->tot_len += record->xl_tot_len;
-				if(element->status == 0)
-					element->status = status;
-				return;
-			}
-			element = element->next;
+			*t = dec.usec;
+			commit = true;
+			break;
 		}
-		element->next = (transInfoPtr) malloc(sizeof(transInfo));
-		element = element->next;
-		element->xid = record->xl_xid;
-		element->tot_len = record->xl_tot_len;
-		element->status = status;
-		element->next = NULL;
-		return;
-	}
-	else
-	{
-		transactionsInfo = (transInfoPtr) malloc(sizeof(transInfo));
-		transactionsInfo->xid = record->xl_xid;
-		transactionsInfo->tot_len = record->xl_tot_len;
-		transactionsInfo->status = status;
-		transactionsInfo->next = NULL;
 	}
+	endXLog();
+
+	return commit;
 }
 
+/*
+ * find_time()
+ *
+ * finds the last commit before --find-time. The segments are sorted,
+ * and binary-searched for the last one whose first commit is not after
+ * the target. Only that segment is read through, up to the first commit
+ * after the target, as recovery_target_time would stop there.
+ */
 static void
-dumpTransactions()
+find_time(char **files, int nfiles)
 {
-	transInfo * element = transactionsInfo;
-	if(!element)
+	int lo = 0;
+	int hi = nfiles - 1;
+	int cand = -1;
+	int nprobes = 0;
+	int64 t = 0;
+	bool found = false;
+	XLogRecPtr found_lsn = {0, 0};
+	TransactionId found_xid = InvalidTransactionId;
+	int64 found_time = 0;
+	char buf[64];
+
+	qsort(files, nfiles, sizeof(char *), compare_segments);
+
+	while (lo <= hi)
 	{
-		printf("\nCorrupt or incomplete transaction.\n");
-		return;
-	}
+		int mid = lo + (hi - lo) / 2;
+		int j;
 
-	while (element->next != NULL)
-	{
-		printf("\nxid: %u total length: %u status: %s", element->xid, element->tot_len, status_names[element->status]);
-		element = element->next;
+		/* probe the first segment having a commit from the middle. */
+		for (j = mid; j <= hi; j++)
+		{
+			nprobes++;
+			if (first_commit_time(files[j], &t))
+				break;
+		}
+
+		if (j <= hi && t <= target_time)
+		{
+			cand = j;
+			lo = j + 1;
+		}
+		else
+			hi = mid - 1;
 	}
-	printf("\n");
-}
 
-static void
-dumpXLog(char* fname)
-{
-	char	*fnamebase;
+	str_usec(target_time, buf, sizeof(buf));
+	out_printf("target time: %s\n", buf);
+	out_printf("segments probed: %d of %d\n", nprobes, nfiles);
 
-	printf("\n%s:\n\n", fname);
-	/*
-	 * Extract logfile id and segment from file name
-	 */
-	fnamebase = strrchr(fname, '/');
-	if (fnamebase)
-		fnamebase++;
-	else
-		fnamebase = fname;
-	if (sscanf(fnamebase, "%8x%8x%8x", &logTLI, &logId, &logSeg) != 3)
+	if (cand >= 0)
 	{
-		fprintf(stderr, "Can't recognize logfile name '%s'\n", fnamebase);
-		logTLI = logId = logSeg = 0;
+		int fd = stream_open(files[cand]);
+
+		if (fd < 0)
+		{
+			perror(files[cand]);
+			exit_gracefuly(1);
+		}
+		beginXLog(files[cand], fd);
+
+		while (ReadRecord())
+		{
+			DecodedRecord dec;
+
+			decode_record(&dec, logVersion, curRecPtr, curRecord, false);
+			decode_fields(&dec, DECODE_TIME);
+			if (!dec.commit)
+				continue;
+			if (dec.usec > target_time)
+				break;
+			found = true;
+			found_lsn = curRecPtr;
+			found_xid = dec.record->xl_xid;
+			found_time = dec.usec;
+		}
+		endXLog();
 	}
-	logPageOff = -XLOG_BLCKSZ;		/* so 1st increment in readXLogPage gives 0 */
-	logRecOff = 0;
-	while (ReadRecord())
-	{
-		if(!transactions)
-			dumpXLogRecord((XLogRecord *) readRecordBuf, false);
-		else
-			addTransaction((XLogRecord *) readRecordBuf);
 
-		prevRecPtr = curRecPtr;
+	if (!found)
+	{
+		out_printf("No commit found before the target time.\n");
+		return;
 	}
-	if(transactions)
-		dumpTransactions();
+
+	str_usec(found_time, buf, sizeof(buf));
+	out_printf("last commit: lsn: %X/%X xid: %u time: %s\n",
+	       found_lsn.xlogid, found_lsn.xrecoff, found_xid, buf);
+	out_printf("segment: %s\n", files[cand]);
 }
 
 static void
@@ -700,20 +1839,81 @@ help(void)
 	printf("xlogdump version %s\n\n", VERSION_STR);
 	printf("Usage:\n");
 	printf("  xlogdump [OPTION]... [segment file(s)]\n");
+	printf("  xlogdump [OPTION]... --archive-dir=DIR\n");
+	printf("  xlogdump [OPTION]... - < segment file\n");
 	printf("\nOptions:\n");
 	printf("  -r, --rmid=RMID           Outputs only the transaction log records\n"); 
 	printf("                            containing the specified operation.\n");
 	printf("                            RMID:Resource Manager\n");
 	for (i=0 ; i<RM_MAX_ID+1 ; i++)
-		printf("                              %2d:%s\n", i, RM_names[i]);
+		printf("                              %2d:%s\n", i, RM_table[i].name);
 	printf("  -x, --xid=XID             Outputs only the transaction log records\n"); 
 	printf("                            containing the specified transaction id.\n");
+	printf("  -X, --filter=EXPR         Outputs only the transaction log records\n");
+	printf("                            matching EXPR, like \"rmid in (10, 11) and\n");
+	printf("                            xid = 1000..2000\". Fields are rmid, xid, lsn,\n");
+	printf("                            info, spc, db, rel (relfilenode or\n");
+	printf("                            spc/db/rel) and time (quoted, of the commits,\n");
+	printf("                            aborts and checkpoints), with =, in, !=, <,\n");
+	printf("                            <=, > and >=, combined by and, or, not and\n");
+	printf("                            parentheses.\n");
+	printf("  -Q, --fast-scan           Passes over the records rejected by the filter\n");
+	printf("                            on their headers, without reading them through\n");
+	printf("                            or checking their CRC.\n");
+	printf("  -j, --jobs=N              Reads and checks the segments in N threads\n");
+	printf("                            ahead of the output, prints the records of\n");
+	printf("                            text and jsonl in N more threads, and shows\n");
+	printf("                            how busy the threads were.\n");
+	printf("  -O, --format=FORMAT       Outputs the records in FORMAT, one of text\n");
+	printf("                            (default), jsonl (a JSON object per line) or\n");
+	printf("                            arrow (an Arrow IPC file of the record headers,\n");
+	printf("                            relations, blocks and backup blocks).\n");
 	printf("  -t, --transactions        Outputs only transaction info: the xid,\n");
 	printf("                            total length and status of each transaction.\n");
 	printf("  -s, --statements          Tries to build fake statements that produce the\n");
 	printf("                            physical changes found within the xlog segments.\n");
 	printf("  -S, --stats               Collects and shows statistics of the transaction\n");
 	printf("                            log records from the xlog segments.\n");
+	printf("  -F, --stats-format=FORMAT Shows the statistics in FORMAT, one of text\n");
+	printf("                            (default), json or prom (Prometheus text\n");
+	printf("                            format). Implies -S.\n");
+	printf("  -o, --stats-output=FILE   Writes the statistics to FILE, replacing it\n");
+	printf("                            atomically, instead of stdout.\n");
+	printf("  -w, --save-stats=DIR      Saves the statistics of each segment into\n");
+	printf("                            DIR/<segment>.stats to be merged later.\n");
+	printf("                            Implies -S.\n");
+	printf("  -m, --merge-stats         Reads stats files saved by -w instead of\n");
+	printf("                            segment files, and shows the merged statistics.\n");
+	printf("  -W, --follow=DIR          Follows the segments being written into DIR,\n");
+	printf("                            a pg_xlog, from the newest one, printing the\n");
+	printf("                            records as soon as they are written.\n");
+	printf("  -A, --archive-dir=DIR     Reads the segments in DIR, sorted by their\n");
+	printf("                            timeline, log and segment numbers.\n");
+	printf("  -M, --manifest=FILE       Reads the files listed in FILE, a path per line,\n");
+	printf("                            or in stdin for \"-\", sorted as well as -A.\n");
+	printf("  -l, --start-lsn=LSN       Outputs only the records at or after LSN,\n");
+	printf("                            seeking to its page without reading before.\n");
+	printf("  -e, --end-lsn=LSN         Outputs only the records before LSN.\n");
+	printf("  -Z, --zone-maps=DIR       Skips the segments which can't match the filter,\n");
+	printf("                            using the zone maps in DIR, and reads only the\n");
+	printf("                            records of -x with the xid indexes in DIR. They\n");
+	printf("                            are built when a whole segment is read.\n");
+	printf("  -I, --build-zone-maps     Just builds the zone maps of the segments\n");
+	printf("                            into the directory given by -Z.\n");
+	printf("  -R, --find-time=TIME      Finds the LSN and xid of the last commit before\n");
+	printf("                            TIME (e.g. \"2012-04-01 12:34:56.789+09\"),\n");
+	printf("                            reading only a few segments, or their zone\n");
+	printf("                            maps of -Z.\n");
+	printf("  -b, --time-bucket=INTERVAL\n");
+	printf("                            Shows WAL bytes, records, commits and FPI bytes\n");
+	printf("                            per time bucket (e.g. 1s, 10s, 1min), using the\n");
+	printf("                            commit and checkpoint timestamps.\n");
+	printf("  -c, --checkpoint-cycles   Shows full page writes against rmgr data per\n");
+	printf("                            checkpoint cycle, and by distance from redo.\n");
+	printf("  -k, --hot-blocks=K        Shows the K blocks which take the most xlog\n");
+	printf("                            records, with an error bound per block.\n");
+	printf("  -B, --distinct-blocks     Estimates the number of distinct blocks touched\n");
+	printf("                            per relation and per checkpoint cycle.\n");
 	printf("  -n, --oid2name            Show object names instead of OIDs with looking up\n");
 	printf("                            the system catalogs or a cache file.\n");
 	printf("  -g, --gen_oid2name        Generate an oid2name cache file (oid2name.out)\n");
@@ -721,6 +1921,12 @@ help(void)
 	printf("  -T, --hide-timestamps     Do not print timestamps.\n");
 	printf("  -?, --help                Show this help.\n");
 	printf("\n");
+	printf("The segments of PostgreSQL 8.3 to 9.2 are read, even mixed. The records\n");
+	printf("of another major version than %d.%d, the one xlogdump is built against,\n",
+	       XLOGDUMP_MAJOR_VERSION / 10, XLOGDUMP_MAJOR_VERSION % 10);
+	printf("are printed in a short form, with the operation, relation, tuple, time\n");
+	printf("and redo pointer only, and are not rebuilt into statements by -s.\n");
+	printf("\n");
 	printf("oid2name supplimental options:\n");
 	printf("  -h, --host=HOST           database server host or socket directory\n");
 	printf("  -p, --port=PORT           database server port number\n");
@@ -738,21 +1944,49 @@ main(int argc, char** argv)
 	int	c, i, optindex;
 	bool oid2name = false;
 	bool oid2name_gen = false;
+	bool filter_given = false;
+	char filter_expr[64];
 	char *pghost = NULL; /* connection host */
 	char *pgport = NULL; /* connection port */
 	char *pguser = NULL; /* connection username */
 	char *dbname = NULL; /* connection database name */
 	char *oid2name_file = NULL;
+	char **files;
+	int nfiles;
+	int nstdin = 0;
+	bool manifest_stdin = false;
+	char follow_path[MAXPGPATH];
+	char *follow_file = follow_path;
 
 	static struct option long_options[] = {
 		{"transactions", no_argument, NULL, 't'},
 		{"statements", no_argument, NULL, 's'},
 		{"stats", no_argument, NULL, 'S'},
+		{"stats-format", required_argument, NULL, 'F'},
+		{"stats-output", required_argument, NULL, 'o'},
+		{"save-stats", required_argument, NULL, 'w'},
+		{"merge-stats", no_argument, NULL, 'm'},
+		{"start-lsn", required_argument, NULL, 'l'},
+		{"end-lsn", required_argument, NULL, 'e'},
+		{"zone-maps", required_argument, NULL, 'Z'},
+		{"build-zone-maps", no_argument, NULL, 'I'},
+		{"find-time", required_argument, NULL, 'R'},
+		{"time-bucket", required_argument, NULL, 'b'},
+		{"checkpoint-cycles", no_argument, NULL, 'c'},
+		{"hot-blocks", required_argument, NULL, 'k'},
+		{"distinct-blocks", no_argument, NULL, 'B'},
 		{"hide-timestamps", no_argument, NULL, 'T'},	
 		{"rmid", required_argument, NULL, 'r'},
 		{"oid2name", no_argument, NULL, 'n'},
 		{"gen_oid2name", no_argument, NULL, 'g'},
 		{"xid", required_argument, NULL, 'x'},
+		{"filter", required_argument, NULL, 'X'},
+		{"fast-scan", no_argument, NULL, 'Q'},
+		{"format", required_argument, NULL, 'O'},
+		{"jobs", required_argument, NULL, 'j'},
+		{"archive-dir", required_argument, NULL, 'A'},
+		{"follow", required_argument, NULL, 'W'},
+		{"manifest", required_argument, NULL, 'M'},
 		{"host", required_argument, NULL, 'h'},
 		{"port", required_argument, NULL, 'p'},
 		{"user", required_argument, NULL, 'U'},
@@ -771,7 +2005,7 @@ main(int argc, char** argv)
 	dbname = strdup("postgres");
 	oid2name_file = strdup(DATADIR "/contrib/" OID2NAME_FILE);
 
-	while ((c = getopt_long(argc, argv, "sStTngr:x:h:p:U:d:f:",
+	while ((c = getopt_long(argc, argv, "sStTngF:o:w:mZ:IR:l:e:b:ck:Br:x:X:QO:j:A:M:W:h:p:U:d:f:",
 							long_options, &optindex)) != -1)
 	{
 		switch (c)
@@ -782,6 +2016,110 @@ main(int argc, char** argv)
 
 			case 'S':			/* show statistics */
 				enable_stats = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'F':			/* format of the statistics */
+				stats_format = export_parse_format(optarg);
+				if (stats_format < 0)
+				{
+					fprintf(stderr, "invalid stats format \"%s\"\n", optarg);
+					exit(1);
+				}
+				enable_stats = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'o':			/* file to write the statistics */
+				stats_output = optarg;
+				break;
+
+			case 'w':			/* save stats files */
+				save_stats_dir = optarg;
+				enable_stats = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'm':			/* merge stats files */
+				merge_stats = true;
+				enable_stats = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'l':			/* start of the LSN range */
+				if (!parse_lsn(optarg, &start_lsn))
+				{
+					fprintf(stderr, "invalid LSN \"%s\"\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case 'e':			/* end of the LSN range */
+				if (!parse_lsn(optarg, &end_lsn))
+				{
+					fprintf(stderr, "invalid LSN \"%s\"\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case 'Z':			/* directory of the zone maps */
+				zone_dir = optarg;
+				break;
+
+			case 'I':			/* build the zone maps */
+				build_zone_maps = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'R':			/* find the last commit before the time */
+				if (!parse_time(optarg, &target_time))
+				{
+					fprintf(stderr, "invalid time \"%s\"\n", optarg);
+					exit(1);
+				}
+				find_target = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'b':			/* show WAL generation rate */
+				time_bucket = rate_parse_interval(optarg);
+				if (time_bucket <= 0)
+				{
+					fprintf(stderr, "invalid time bucket interval \"%s\"\n", optarg);
+					exit(1);
+				}
+				rate_init(time_bucket);
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'c':			/* show checkpoint cycles */
+				enable_cycles = true;
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'k':			/* show hot blocks */
+				hot_blocks = atoi(optarg);
+				if (hot_blocks <= 0)
+				{
+					fprintf(stderr, "invalid number of hot blocks \"%s\"\n", optarg);
+					exit(1);
+				}
+				hotblock_init(hot_blocks);
+				dump_records = false;
+				enable_rmgr_dump(false);
+				break;
+
+			case 'B':			/* show distinct blocks */
+				enable_distinct = true;
+				dump_records = false;
 				enable_rmgr_dump(false);
 				break;
 
@@ -800,9 +2138,59 @@ main(int argc, char** argv)
 				break;
 			case 'r':			/* output only rmid passed */
 			  	rmid = atoi(optarg);
+				if (rmid < 0)		/* all the resource managers */
+					break;
+				snprintf(filter_expr, sizeof(filter_expr), "rmid = %d", rmid);
+				if (!filter_add(filter_expr))
+					exit(1);
 				break;
 			case 'x':			/* output only xid passed */
 			  	xid = atoi(optarg);
+				if (xid == InvalidTransactionId)
+					break;
+				snprintf(filter_expr, sizeof(filter_expr), "xid = %u", xid);
+				if (!filter_add(filter_expr))
+					exit(1);
+				break;
+			case 'X':			/* output only records matching the filter */
+				if (!filter_add(optarg))
+					exit(1);
+				filter_given = true;
+				break;
+			case 'Q':			/* skip the rejected records without verifying */
+				fast_scan = true;
+				break;
+			case 'O':			/* format of the records */
+				if (strcmp(optarg, "text") == 0)
+					output_format = OUTPUT_FORMAT_TEXT;
+				else if (strcmp(optarg, "jsonl") == 0)
+					output_format = OUTPUT_FORMAT_JSONL;
+				else if (strcmp(optarg, "arrow") == 0)
+					output_format = OUTPUT_FORMAT_ARROW;
+				else
+				{
+					fprintf(stderr, "invalid format \"%s\"\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'j':			/* reader threads of the pipeline */
+				nreaders = atoi(optarg);
+				if (nreaders < 1)
+				{
+					fprintf(stderr, "invalid number of jobs \"%s\"\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'A':			/* segments in an archive directory */
+				archive_add_dir(optarg);
+				break;
+			case 'W':			/* pg_xlog being written */
+				follow_dir = optarg;
+				break;
+			case 'M':			/* files listed in a manifest */
+				archive_add_manifest(optarg);
+				if (stream_is_stdin(optarg))
+					manifest_stdin = true;
 				break;
 			case 'h':			/* host for tranlsting oids */
 				pghost = optarg;
@@ -825,6 +2213,16 @@ main(int argc, char** argv)
 		}
 	}
 
+	/* the segments of the command line, -A and -M */
+	for (i = optind; i < argc; i++)
+		archive_add_file(argv[i]);
+	files = archive_files(&nfiles);
+	for (i = 0; i < nfiles; i++)
+	{
+		if (stream_is_stdin(files[i]))
+			nstdin++;
+	}
+
 	if (statements && transactions)
 	{
 		fprintf(stderr, "options \"statements\" (-s) and \"transactions\" (-t) cannot be used together\n");
@@ -837,6 +2235,105 @@ main(int argc, char** argv)
 		exit(1);
 	}
 
+	if (filter_given && transactions)
+	{
+		fprintf(stderr, "options \"filter\" (-X) and \"transactions\" (-t) cannot be used together\n");
+		exit(1);
+	}
+
+	if (stats_format != STATS_FORMAT_TEXT && stats_output == NULL &&
+	    (time_bucket > 0 || enable_cycles))
+	{
+		fprintf(stderr, "options \"time-bucket\" (-b) and \"checkpoint-cycles\" (-c) need \"stats-output\" (-o) with \"stats-format\" (-F)\n");
+		exit(1);
+	}
+
+	if (stats_output != NULL && stats_format == STATS_FORMAT_TEXT)
+	{
+		fprintf(stderr, "option \"stats-output\" (-o) needs \"stats-format\" (-F) json or prom\n");
+		exit(1);
+	}
+
+	if ((save_stats_dir != NULL || merge_stats) && (enable_cycles || transactions))
+	{
+		fprintf(stderr, "options \"checkpoint-cycles\" (-c) and \"transactions\" (-t) cannot be used with stats files (-w, -m)\n");
+		exit(1);
+	}
+
+	if (fast_scan && (!filter_enabled() || transactions || build_zone_maps ||
+			  time_bucket > 0 || enable_cycles || enable_distinct ||
+			  save_stats_dir != NULL))
+	{
+		fprintf(stderr, "option \"fast-scan\" (-Q) needs a filter (-r, -x or -X), and cannot be used with -t, -I, -b, -c, -B or -w\n");
+		exit(1);
+	}
+
+	if (output_format != OUTPUT_FORMAT_TEXT &&
+	    (!dump_records || transactions || statements || merge_stats))
+	{
+		fprintf(stderr, "option \"format\" (-O) cannot be used with -s, -t, -S, -I, -R, -b, -c, -k or -B\n");
+		exit(1);
+	}
+	if (output_format != OUTPUT_FORMAT_TEXT)
+	{
+		/* no page headers, and no text from the rmgr printers */
+		dump_records = false;
+		enable_rmgr_dump(false);
+	}
+	set_rmgr_format(hideTimestamps, statements);
+
+	if (build_zone_maps && zone_dir == NULL)
+	{
+		fprintf(stderr, "option \"build-zone-maps\" (-I) needs \"zone-maps\" (-Z)\n");
+		exit(1);
+	}
+
+	if (save_stats_dir != NULL && merge_stats)
+	{
+		fprintf(stderr, "options \"save-stats\" (-w) and \"merge-stats\" (-m) cannot be used together\n");
+		exit(1);
+	}
+
+	if (nreaders > 0 && (merge_stats || find_target))
+	{
+		fprintf(stderr, "option \"jobs\" (-j) cannot be used with -m or -R\n");
+		exit(1);
+	}
+
+	if (follow_dir != NULL &&
+	    (nfiles > 0 || enable_stats || transactions || time_bucket > 0 ||
+	     enable_cycles || hot_blocks > 0 || enable_distinct ||
+	     save_stats_dir != NULL || merge_stats || find_target ||
+	     zone_dir != NULL || nreaders > 0 || output_format == OUTPUT_FORMAT_ARROW))
+	{
+		fprintf(stderr, "option \"follow\" (-W) just prints the records, and cannot be used with segment files, -A, -M, -S, -t, -b, -c, -k, -B, -w, -m, -R, -Z, -j or -O arrow\n");
+		exit(1);
+	}
+
+	if (nstdin > 1 || (nstdin > 0 && manifest_stdin))
+	{
+		fprintf(stderr, "the standard input (-) can be read only once\n");
+		exit(1);
+	}
+
+	if (nstdin > 0 && (merge_stats || find_target || zone_dir != NULL ||
+			   save_stats_dir != NULL))
+	{
+		fprintf(stderr, "the standard input (-) cannot be read with -m, -R, -Z or -w\n");
+		exit(1);
+	}
+
+	/*
+	 * The segment being written is the one to be read first, and to
+	 * tell the geometry.
+	 */
+	if (follow_dir != NULL)
+	{
+		follow_start(follow_dir, follow_path, sizeof(follow_path));
+		files = &follow_file;
+		nfiles = 1;
+	}
+
 	if (oid2name)
 	{
 		if ( !oid2name_from_file(oid2name_file) )
@@ -865,22 +2362,208 @@ main(int argc, char** argv)
 		exit_gracefuly(0);
 	}
 
-	for (i = optind; i < argc; i++)
+	/*
+	 * The LSN range is turned into byte positions once the geometry of
+	 * the segments is known.
+	 */
+	if (!merge_stats)
+		probeXLogGeometry(files, nfiles);
+	start_pos = XLogRecPtrToBytePos(start_lsn);
+	end_pos = XLogRecPtrToBytePos(end_lsn);
+
+	if (find_target)
+	{
+		find_time(files, nfiles);
+		exit_gracefuly(0);
+	}
+
+	if (output_format == OUTPUT_FORMAT_ARROW)
+		arrow_open();
+
+	if (follow_dir != NULL)
+		followXLog(follow_path);
+	else if (merge_stats)
+	{
+		for (i = 0; i < nfiles; i++)
+			load_stats(files[i]);
+	}
+	else
 	{
-		char *fname = argv[i];
-		logFd = open(fname, O_RDONLY | PG_BINARY, 0);
+		char **saved = (char **) malloc(sizeof(char *) * (nfiles + 1));
+		int nsaved = 0;
 
-		if (logFd < 0)
+		/*
+		 * A segment can be skipped only when nothing is accounted
+		 * before the filter.
+		 */
+		bool can_skip = filter_enabled() &&
+			!transactions && !build_zone_maps && time_bucket == 0 &&
+			!enable_cycles && !enable_distinct && save_stats_dir == NULL;
+
+		/*
+		 * Plan which segments to read, and how, before reading any of
+		 * them, so the pipeline can read ahead.
+		 */
+		jobs = (segment_job_t *) malloc(sizeof(segment_job_t) * (nfiles + 1));
+		for (i = 0; i < nfiles; i++)
 		{
-			perror(fname);
-			continue;
+			char *fname = files[i];
+			char zone_path[MAXPGPATH];
+			char index_path[MAXPGPATH];
+			uint64 seg_pos;
+			bool whole = true;
+			bool build_zone = false;
+			uint32 *offsets = NULL;
+			int noffsets = 0;
+
+			/* skip the segments out of the LSN range by the file name. */
+			if (segment_start_pos(fname, &seg_pos))
+			{
+				if (end_pos > 0 && seg_pos >= end_pos)
+					continue;
+				if (start_pos > 0 && seg_pos + walSegSize <= start_pos)
+					continue;
+				whole = (start_pos <= seg_pos &&
+					 (end_pos == 0 || seg_pos + walSegSize <= end_pos));
+			}
+
+			if (zone_dir != NULL)
+			{
+				zonemap_t zone;
+
+				zone_file_path(zone_path, MAXPGPATH, fname, ZONEMAP_SUFFIX);
+				zone_file_path(index_path, MAXPGPATH, fname, INDEX_SUFFIX);
+
+				if (!build_zone_maps && zonemap_load(&zone, zone_path, fname))
+				{
+					if (can_skip && !filter_may_match_zone(&zone))
+						continue;
+					if (can_skip && xid!=InvalidTransactionId)
+					{
+						noffsets = index_lookup_xid(index_path, fname, xid, &offsets);
+						if (noffsets == 0)
+							continue;
+						/* no fresh index: read it through, and build it again */
+						if (noffsets < 0)
+						{
+							noffsets = 0;
+							build_zone = whole && !fast_scan;
+						}
+					}
+				}
+				else
+					build_zone = whole && !fast_scan;
+			}
+
+			jobs[njobs].fname = fname;
+			jobs[njobs].zone_path = NULL;
+			jobs[njobs].index_path = NULL;
+			if (build_zone)
+			{
+				jobs[njobs].zone_path = strdup(zone_path);
+				jobs[njobs].index_path = strdup(index_path);
+			}
+			jobs[njobs].build_zone = build_zone;
+			jobs[njobs].offsets = offsets;
+			jobs[njobs].noffsets = noffsets;
+			njobs++;
+		}
+
+		/*
+		 * The records are printed in the formatter threads as well,
+		 * but the transactions and the statements, which are built up
+		 * record by record, and arrow, which is written in columns.
+		 */
+		pipeFormat = nreaders > 0 && !transactions && !statements &&
+			((output_format == OUTPUT_FORMAT_TEXT && dump_records) ||
+			 output_format == OUTPUT_FORMAT_JSONL);
+		if (nreaders > 0)
+			pipeline_start(nreaders, njobs, readSegment,
+				       pipeFormat ? nreaders : 0, formatItem);
+
+		for (i = 0; i < njobs; i++)
+		{
+			segment_job_t *job = &jobs[i];
+			int fd = -1;
+
+			if (zone_dir != NULL)
+			{
+				zonemap_reset(&cur_zone);
+				index_reset();
+			}
+
+			if (nreaders > 0)
+			{
+				if (!beginPipedXLog(i, job->fname))
+					continue;
+			}
+			else
+			{
+				/* the next one is read ahead while this one is read */
+				if (i + 1 < njobs && !stream_is_stdin(jobs[i + 1].fname))
+					archive_willneed(jobs[i + 1].fname);
+
+				fd = stream_open(job->fname);
+
+				if (fd < 0)
+				{
+					perror(job->fname);
+					continue;
+				}
+			}
+			dumpXLog(job->fname, fd, job->offsets, job->noffsets);
+
+			if (job->build_zone)
+			{
+				zonemap_save(&cur_zone, job->zone_path);
+				index_save(job->index_path);
+				free(job->zone_path);
+				free(job->index_path);
+			}
+			if (job->offsets != NULL)
+				free(job->offsets);
+
+			if (save_stats_dir != NULL)
+				saved[nsaved++] = save_stats(job->fname);
 		}
-		dumpXLog(fname);
+
+		if (nreaders > 0)
+			pipeline_finish();
+
+		/*
+		 * The statistics have been reset per segment, so the report
+		 * is made from the stats files, as well as -m does.
+		 */
+		for (i = 0; i < nsaved; i++)
+			load_stats(saved[i]);
 	}
 
-	if (enable_stats)
+	if (output_format == OUTPUT_FORMAT_ARROW)
+		arrow_close();
+	out_flush();
+
+	if (enable_stats && stats_format == STATS_FORMAT_TEXT)
 		print_xlog_stats();
 
+	if (time_bucket > 0)
+		print_xlog_rate();
+
+	if (enable_cycles)
+		print_xlog_cycles();
+
+	if (hot_blocks > 0 && stats_format == STATS_FORMAT_TEXT)
+		print_xlog_hotblocks();
+
+	if (enable_distinct && stats_format == STATS_FORMAT_TEXT)
+		print_xlog_distinct();
+
+	if (stats_format != STATS_FORMAT_TEXT)
+		export_xlog_stats();
+
+	if (fast_scan)
+		fprintf(stderr, "fast scan: %u records (" UINT64_FORMAT " bytes) skipped, %u records (" UINT64_FORMAT " bytes) verified\n",
+			skipped_records, skipped_bytes, verified_records, verified_bytes);
+
 	exit_gracefuly(0);
 	
 	/* just to avoid a warning */
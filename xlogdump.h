@@ -6,16 +6,72 @@
 #ifndef __XLOGDUMP_H__
 #define __XLOGDUMP_H__
 
+/*
+ * Prints a xlog record header into the output buffer (xlogdump_out.h),
+ * as printf("[cur:%X/%X, xid:%d, rmid:%d(%s), len/tot_len:%d/%d,
+ * info:%d, prev:%X/%X] ") would do.
+ */
 #define PRINT_XLOGRECORD_HEADER(X,Y) \
-	printf("[cur:%X/%X, xid:%d, rmid:%d(%s), len/tot_len:%d/%d, info:%d, prev:%X/%X] ", \
-	       (X).xlogid, (X).xrecoff, \
-	       (Y)->xl_xid,		\
-	       (Y)->xl_rmid,		\
-	       RM_names[(Y)->xl_rmid],	\
-	       (Y)->xl_len,		\
-	       (Y)->xl_tot_len,		\
-	       (Y)->xl_info,		\
-	       (Y)->xl_prev.xlogid, (Y)->xl_prev.xrecoff)
+	do { \
+		out_str("[cur:");		\
+		out_hex((X).xlogid);		\
+		out_char('/');			\
+		out_hex((X).xrecoff);		\
+		out_str(", xid:");		\
+		out_int((int32) (Y)->xl_xid);	\
+		out_str(", rmid:");		\
+		out_int((Y)->xl_rmid);		\
+		out_char('(');			\
+		out_str(RM_table[(Y)->xl_rmid].name);	\
+		out_str("), len/tot_len:");	\
+		out_int((int32) (Y)->xl_len);	\
+		out_char('/');			\
+		out_int((int32) (Y)->xl_tot_len);	\
+		out_str(", info:");		\
+		out_int((Y)->xl_info);		\
+		out_str(", prev:");		\
+		out_hex((Y)->xl_prev.xlogid);	\
+		out_char('/');			\
+		out_hex((Y)->xl_prev.xrecoff);	\
+		out_str("] ");			\
+	} while (0)
+
+/* formats of the record dump (--format) */
+#define OUTPUT_FORMAT_TEXT	0
+#define OUTPUT_FORMAT_JSONL	1
+#define OUTPUT_FORMAT_ARROW	2
+
+/*
+ * The geometry of the segments being read, taken from the long page
+ * header of their first page instead of XLOG_BLCKSZ and XLogSegSize.
+ * They're set in the main thread only; the reader threads of the
+ * pipeline take the geometry from their own reader, with the *Of()
+ * macros.
+ */
+extern uint32 walBlockSize;
+extern uint32 walSegSize;
+
+#define WalFileSizeOf(segsize) \
+	((((uint32) 0xffffffff) / (segsize)) * (segsize))
+#define WalFileSize	WalFileSizeOf(walSegSize)
+
+/*
+ * Converts a XLogRecPtr into a byte position in the whole xlog stream,
+ * to compute a distance between two locations.
+ */
+#define XLogRecPtrToBytePosOf(X, segsize) \
+	((uint64) (X).xlogid * WalFileSizeOf(segsize) + (X).xrecoff)
+#define XLogRecPtrToBytePos(X)	XLogRecPtrToBytePosOf(X, walSegSize)
+
+/*
+ * Converts a XLogRecPtr into a key in the order of the locations, which
+ * does not depend on the geometry.
+ */
+#define XLogRecPtrToKey(X) \
+	(((uint64) (X).xlogid << 32) | (X).xrecoff)
+
+/* parses the time of --find-time and of the filters, in xlogdump.c */
+bool parse_time(const char *, int64 *);
 
 struct transInfo
 {
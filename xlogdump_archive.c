@@ -0,0 +1,214 @@
+/*
+ * xlogdump_archive.c
+ *
+ * a collection of functions to list the segments to be read from the
+ * command line, an archive directory and manifest files.
+ *
+ * A whole archive has too many segments to be passed as arguments, so
+ * they can be listed from the directory (--archive-dir), or from a
+ * file with a path per line (--manifest). The segments listed so are
+ * sorted by their timeline, log and segment numbers, along with the
+ * ones on the command line, which are kept as given otherwise.
+ *
+ * Only the names are kept here. Each segment is opened when it is
+ * read, and closed before the next one, so the number of segments is
+ * not bounded by the limit of open files.
+ */
+#include "postgres.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "xlogdump_archive.h"
+#include "xlogdump_stream.h"
+
+static char **files = NULL;
+static int nfiles = 0;
+static int maxfiles = 0;
+static bool sort_files = false;		/* listed from a directory or manifest */
+
+static void add_path(const char *, size_t);
+static bool is_segment_name(const char *);
+static bool parse_segment_name(const char *, uint32 *, uint32 *, uint32 *);
+static int compare_names(const void *, const void *);
+
+static void
+add_path(const char *path, size_t len)
+{
+	if (nfiles >= maxfiles)
+	{
+		maxfiles = (maxfiles == 0) ? 1024 : maxfiles * 2;
+		files = (char **) realloc(files, sizeof(char *) * maxfiles);
+		if (files == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory.\n");
+			exit(1);
+		}
+	}
+
+	files[nfiles] = (char *) malloc(len + 1);
+	memcpy(files[nfiles], path, len);
+	files[nfiles][len] = '\0';
+	nfiles++;
+}
+
+/*
+ * A segment file is named by 24 hex digits, followed by the suffix of
+ * its compression if any, and the history and backup files in an
+ * archive are not.
+ */
+static bool
+is_segment_name(const char *name)
+{
+	if (strspn(name, "0123456789ABCDEF") != 24)
+		return false;
+	return (name[24] == '\0' || stream_kind_of_name(name) != STREAM_RAW);
+}
+
+static bool
+parse_segment_name(const char *path, uint32 *tli, uint32 *id, uint32 *seg)
+{
+	const char *name = strrchr(path, '/');
+
+	name = name ? name + 1 : path;
+	return (sscanf(name, "%8X%8X%8X", tli, id, seg) == 3);
+}
+
+/*
+ * Sorts by the timeline, log and segment numbers, and the files not
+ * named like a segment after the segments.
+ */
+static int
+compare_names(const void *a, const void *b)
+{
+	const char *fa = *(char * const *) a;
+	const char *fb = *(char * const *) b;
+	uint32 ta, ia, sa, tb, ib, sb;
+	bool va = parse_segment_name(fa, &ta, &ia, &sa);
+	bool vb = parse_segment_name(fb, &tb, &ib, &sb);
+
+	if (va != vb)
+		return va ? -1 : 1;
+	if (va)
+	{
+		if (ta != tb)
+			return (ta < tb) ? -1 : 1;
+		if (ia != ib)
+			return (ia < ib) ? -1 : 1;
+		if (sa != sb)
+			return (sa < sb) ? -1 : 1;
+	}
+	return strcmp(fa, fb);
+}
+
+/*
+ * archive_add_file()
+ *
+ * adds a file given on the command line.
+ */
+void
+archive_add_file(const char *path)
+{
+	add_path(path, strlen(path));
+}
+
+/*
+ * archive_add_dir()
+ *
+ * adds the segments in an archive directory.
+ */
+void
+archive_add_dir(const char *dir)
+{
+	DIR *d;
+	struct dirent *de;
+	char path[MAXPGPATH];
+
+	if ((d = opendir(dir)) == NULL)
+	{
+		fprintf(stderr, "ERROR: Can't open the directory %s.\n", dir);
+		exit(1);
+	}
+
+	while ((de = readdir(d)) != NULL)
+	{
+		if (!is_segment_name(de->d_name))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		add_path(path, strlen(path));
+	}
+	closedir(d);
+
+	sort_files = true;
+}
+
+/*
+ * archive_add_manifest()
+ *
+ * adds the files listed in a manifest, a path per line. Empty lines
+ * and lines beginning with '#' are ignored. "-" reads the list from
+ * the standard input.
+ */
+void
+archive_add_manifest(const char *manifest)
+{
+	FILE *fp;
+	char line[MAXPGPATH];
+
+	if (stream_is_stdin(manifest))
+		fp = stdin;
+	else if ((fp = fopen(manifest, "r")) == NULL)
+	{
+		fprintf(stderr, "ERROR: Can't open the manifest %s.\n", manifest);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		size_t len = strcspn(line, "\r\n");
+
+		if (len == 0 || line[0] == '#')
+			continue;
+		add_path(line, len);
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+
+	sort_files = true;
+}
+
+/*
+ * archive_files()
+ *
+ * returns the files to be read, and their number in *n.
+ */
+char **
+archive_files(int *n)
+{
+	if (sort_files && nfiles > 1)
+		qsort(files, nfiles, sizeof(char *), compare_names);
+
+	*n = nfiles;
+	return files;
+}
+
+/*
+ * archive_willneed()
+ *
+ * asks the kernel to read the file ahead, while the one before it is
+ * being read. The pages stay in the cache after the file is closed.
+ */
+void
+archive_willneed(const char *path)
+{
+#ifdef USE_POSIX_FADVISE
+	int fd = open(path, O_RDONLY | PG_BINARY, 0);
+
+	if (fd < 0)
+		return;
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	close(fd);
+#endif
+}
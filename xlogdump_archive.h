@@ -0,0 +1,18 @@
+/*
+ * xlogdump_archive.h
+ *
+ * a collection of functions to list the segments to be read from the
+ * command line, an archive directory and manifest files.
+ */
+#ifndef __XLOGDUMP_ARCHIVE_H__
+#define __XLOGDUMP_ARCHIVE_H__
+
+#include "postgres.h"
+
+void archive_add_file(const char *);
+void archive_add_dir(const char *);
+void archive_add_manifest(const char *);
+char **archive_files(int *);
+void archive_willneed(const char *);
+
+#endif /* __XLOGDUMP_ARCHIVE_H__ */
@@ -0,0 +1,565 @@
+/*
+ * xlogdump_arrow.c
+ *
+ * a writer to export the xlog records in the Apache Arrow IPC file
+ * format, one column per field of the records.
+ *
+ * The records are collected column-wise into fixed-size arrays, and
+ * each ARROW_BATCH_ROWS records are written out as a record batch. The
+ * file is laid out as:
+ *
+ *   "ARROW1\0\0"
+ *   schema message
+ *   record batch messages
+ *   end-of-stream marker
+ *   footer, footer length, "ARROW1"
+ *
+ * where each message is a 0xFFFFFFFF marker, the length of the
+ * metadata, the metadata as a flatbuffer, and the body of the message
+ * (the buffers of the columns). The flatbuffers are built by hand with
+ * the small builder below, which lays the tables out front to back, so
+ * every offset points forward as the format requires.
+ *
+ * The flatbuffers and the column buffers are little-endian, so the
+ * writer works only on little-endian hosts.
+ */
+#include "xlogdump_arrow.h"
+
+#include "access/xlog_internal.h"
+
+#include "xlogdump_out.h"
+#include "xlogdump_rmgr.h"
+
+/* the values of the Arrow schema used here */
+#define ARROW_METADATA_V5		4
+#define ARROW_HEADER_SCHEMA		1
+#define ARROW_HEADER_RECORDBATCH	3
+#define ARROW_TYPE_INT			2
+
+#define ARROW_MAX_FIELDS		8
+
+/* a flatbuffer being built */
+typedef struct fb_t {
+	char	   *data;
+	uint32		len;
+	uint32		cap;
+} fb_t;
+
+/* a column to export */
+typedef struct arrow_column_t {
+	const char *name;
+	int			width;			/* in bytes */
+	void	   *values;
+	uint8	   *valid;			/* NULL if not nullable */
+	int		   *nnulls;
+} arrow_column_t;
+
+/* a record batch written, for the footer */
+typedef struct arrow_block_t {
+	int64		offset;
+	int32		meta_len;
+	int32		pad;
+	int64		body_len;
+} arrow_block_t;
+
+/* the fixed part of a record batch, as FieldNode and Buffer in Arrow */
+typedef struct arrow_node_t {
+	int64		length;
+	int64		null_count;
+} arrow_node_t;
+
+typedef struct arrow_buffer_t {
+	int64		offset;
+	int64		length;
+} arrow_buffer_t;
+
+static uint64 col_lsn[ARROW_BATCH_ROWS];
+static uint32 col_xid[ARROW_BATCH_ROWS];
+static uint8 col_rmid[ARROW_BATCH_ROWS];
+static uint8 col_info[ARROW_BATCH_ROWS];
+static uint32 col_len[ARROW_BATCH_ROWS];
+static uint32 col_tot_len[ARROW_BATCH_ROWS];
+static uint32 col_spc[ARROW_BATCH_ROWS];
+static uint32 col_db[ARROW_BATCH_ROWS];
+static uint32 col_rel[ARROW_BATCH_ROWS];
+static uint32 col_block[ARROW_BATCH_ROWS];
+static uint8 col_bkp_count[ARROW_BATCH_ROWS];
+static uint32 col_bkp_bytes[ARROW_BATCH_ROWS];
+
+static uint8 valid_rel[ARROW_BATCH_ROWS / 8];
+static uint8 valid_block[ARROW_BATCH_ROWS / 8];
+static int nnulls_rel = 0;
+static int nnulls_block = 0;
+
+static arrow_column_t columns[] = {
+	{"lsn", 8, col_lsn, NULL, NULL},
+	{"xid", 4, col_xid, NULL, NULL},
+	{"rmid", 1, col_rmid, NULL, NULL},
+	{"info", 1, col_info, NULL, NULL},
+	{"len", 4, col_len, NULL, NULL},
+	{"tot_len", 4, col_tot_len, NULL, NULL},
+	{"spc", 4, col_spc, valid_rel, &nnulls_rel},
+	{"db", 4, col_db, valid_rel, &nnulls_rel},
+	{"rel", 4, col_rel, valid_rel, &nnulls_rel},
+	{"block", 4, col_block, valid_block, &nnulls_block},
+	{"bkp_count", 1, col_bkp_count, NULL, NULL},
+	{"bkp_bytes", 4, col_bkp_bytes, NULL, NULL},
+};
+
+#define NUM_COLUMNS	(sizeof(columns) / sizeof(columns[0]))
+
+static int nrows = 0;
+static int64 filepos = 0;
+
+static arrow_block_t *blocks = NULL;
+static int nblocks = 0;
+static int maxblocks = 0;
+
+static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+static uint32 fb_append(fb_t *, const void *, uint32);
+static void fb_align(fb_t *, uint32);
+static void fb_set(fb_t *, uint32, const void *, uint32);
+static void fb_ref(fb_t *, uint32, uint32);
+static uint32 fb_table(fb_t *, int, const int *, uint32 *);
+static uint32 fb_vector(fb_t *, uint32, uint32, uint32);
+static uint32 fb_string(fb_t *, const char *);
+static uint32 build_schema(fb_t *);
+static void arrow_write(const void *, size_t);
+static void arrow_write_message(fb_t *, int64 *, int32 *);
+static void arrow_write_batch(void);
+
+/*
+ * fb_append()
+ *
+ * appends n bytes of p, or zeros if p is NULL, and returns the position
+ * where they are.
+ */
+static uint32
+fb_append(fb_t *fb, const void *p, uint32 n)
+{
+	uint32 pos = fb->len;
+
+	if (fb->len + n > fb->cap)
+	{
+		while (fb->len + n > fb->cap)
+			fb->cap = fb->cap > 0 ? fb->cap * 2 : 1024;
+		fb->data = (char *) realloc(fb->data, fb->cap);
+	}
+	if (p != NULL)
+		memcpy(fb->data + pos, p, n);
+	else
+		memset(fb->data + pos, 0, n);
+	fb->len += n;
+
+	return pos;
+}
+
+static void
+fb_align(fb_t *fb, uint32 align)
+{
+	if (fb->len % align != 0)
+		fb_append(fb, NULL, align - fb->len % align);
+}
+
+static void
+fb_set(fb_t *fb, uint32 pos, const void *p, uint32 n)
+{
+	memcpy(fb->data + pos, p, n);
+}
+
+/* makes the offset at pos point to target, which must be after pos. */
+static void
+fb_ref(fb_t *fb, uint32 pos, uint32 target)
+{
+	uint32 off = target - pos;
+
+	fb_set(fb, pos, &off, sizeof(off));
+}
+
+/*
+ * fb_table()
+ *
+ * appends a table with its vtable, where sizes[i] is the size of the
+ * i-th field, or 0 if the field is absent. The positions of the fields
+ * are returned in pos to be filled by the caller.
+ */
+static uint32
+fb_table(fb_t *fb, int nfields, const int *sizes, uint32 *pos)
+{
+	uint16 vtable[2 + ARROW_MAX_FIELDS];
+	uint32 off = sizeof(int32);
+	uint32 vtpos;
+	uint32 tpos;
+	int32 soff;
+	int i;
+
+	for (i = 0; i < nfields; i++)
+	{
+		if (sizes[i] == 0)
+		{
+			vtable[2 + i] = 0;
+			continue;
+		}
+		off = (off + sizes[i] - 1) / sizes[i] * sizes[i];
+		vtable[2 + i] = off;
+		off += sizes[i];
+	}
+	vtable[0] = (2 + nfields) * sizeof(uint16);
+	vtable[1] = off;
+
+	fb_align(fb, sizeof(uint16));
+	vtpos = fb_append(fb, vtable, vtable[0]);
+
+	/* the table is aligned for its widest field */
+	fb_align(fb, 8);
+	tpos = fb_append(fb, NULL, off);
+	soff = tpos - vtpos;
+	fb_set(fb, tpos, &soff, sizeof(soff));
+
+	for (i = 0; i < nfields; i++)
+		pos[i] = vtable[2 + i] > 0 ? tpos + vtable[2 + i] : 0;
+
+	return tpos;
+}
+
+/*
+ * fb_vector()
+ *
+ * appends a vector of n elements, and returns the position of the
+ * first element. The vector itself is referred at 4 bytes before it.
+ */
+static uint32
+fb_vector(fb_t *fb, uint32 n, uint32 elemsize, uint32 align)
+{
+	fb_align(fb, sizeof(uint32));
+	while ((fb->len + sizeof(uint32)) % align != 0)
+		fb_append(fb, NULL, sizeof(uint32));
+	fb_append(fb, &n, sizeof(n));
+
+	return fb_append(fb, NULL, n * elemsize);
+}
+
+static uint32
+fb_string(fb_t *fb, const char *s)
+{
+	uint32 len = strlen(s);
+	uint32 pos;
+
+	fb_align(fb, sizeof(uint32));
+	pos = fb_append(fb, &len, sizeof(len));
+	fb_append(fb, s, len + 1);
+
+	return pos;
+}
+
+/*
+ * build_schema()
+ *
+ * appends the Schema table of the columns, and returns its position.
+ */
+static uint32
+build_schema(fb_t *fb)
+{
+	static const int schema_sizes[] = {2, 4};
+	static const int field_sizes[] = {4, 1, 1, 4, 0, 4};
+	static const int int_sizes[] = {4, 1};
+	uint32 schema[2];
+	uint32 tpos;
+	uint32 vec;
+	int16 endianness = 0;		/* little */
+	int i;
+
+	tpos = fb_table(fb, 2, schema_sizes, schema);
+	fb_set(fb, schema[0], &endianness, sizeof(endianness));
+
+	vec = fb_vector(fb, NUM_COLUMNS, sizeof(uint32), sizeof(uint32));
+	fb_ref(fb, schema[1], vec - sizeof(uint32));
+
+	for (i = 0; i < NUM_COLUMNS; i++)
+	{
+		uint32 field[6];
+		uint32 type[2];
+		uint32 pos;
+		uint8 nullable = columns[i].valid != NULL;
+		uint8 type_type = ARROW_TYPE_INT;
+		int32 bit_width = columns[i].width * 8;
+		uint8 is_signed = 0;
+
+		pos = fb_table(fb, 6, field_sizes, field);
+		fb_ref(fb, vec + i * sizeof(uint32), pos);
+		fb_set(fb, field[1], &nullable, sizeof(nullable));
+		fb_set(fb, field[2], &type_type, sizeof(type_type));
+
+		fb_ref(fb, field[0], fb_string(fb, columns[i].name));
+
+		pos = fb_table(fb, 2, int_sizes, type);
+		fb_set(fb, type[0], &bit_width, sizeof(bit_width));
+		fb_set(fb, type[1], &is_signed, sizeof(is_signed));
+		fb_ref(fb, field[3], pos);
+
+		/* no children, but readers want the vector */
+		pos = fb_vector(fb, 0, sizeof(uint32), sizeof(uint32));
+		fb_ref(fb, field[5], pos - sizeof(uint32));
+	}
+
+	return tpos;
+}
+
+static void
+arrow_write(const void *data, size_t len)
+{
+	out_bytes(data, len);
+	filepos += len;
+}
+
+/*
+ * arrow_write_message()
+ *
+ * writes the message in fb with its marker and length, and returns
+ * where it was written and the length of the metadata.
+ */
+static void
+arrow_write_message(fb_t *fb, int64 *offset, int32 *meta_len)
+{
+	uint32 marker = 0xFFFFFFFF;
+	int32 len;
+
+	fb_align(fb, 8);
+	len = fb->len;
+
+	*offset = filepos;
+	*meta_len = sizeof(marker) + sizeof(len) + len;
+
+	arrow_write(&marker, sizeof(marker));
+	arrow_write(&len, sizeof(len));
+	arrow_write(fb->data, fb->len);
+}
+
+/*
+ * arrow_open()
+ *
+ * writes the header and the schema of the file.
+ */
+void
+arrow_open(void)
+{
+	static const int msg_sizes[] = {2, 1, 4, 8};
+	fb_t fb = {NULL, 0, 0};
+	uint32 msg[4];
+	uint32 pos;
+	int16 version = ARROW_METADATA_V5;
+	uint8 header_type = ARROW_HEADER_SCHEMA;
+	int64 offset;
+	int32 meta_len;
+
+#ifdef WORDS_BIGENDIAN
+	fprintf(stderr, "the arrow format is not supported on big-endian hosts\n");
+	exit(1);
+#endif
+
+	arrow_write("ARROW1", 6);
+	arrow_write(zeros, 2);
+
+	fb_append(&fb, NULL, sizeof(uint32));
+	pos = fb_table(&fb, 4, msg_sizes, msg);
+	fb_ref(&fb, 0, pos);
+	fb_set(&fb, msg[0], &version, sizeof(version));
+	fb_set(&fb, msg[1], &header_type, sizeof(header_type));
+	fb_ref(&fb, msg[2], build_schema(&fb));
+
+	arrow_write_message(&fb, &offset, &meta_len);
+	free(fb.data);
+
+	memset(valid_rel, 0, sizeof(valid_rel));
+	memset(valid_block, 0, sizeof(valid_block));
+}
+
+/*
+ * arrow_add_record()
+ *
+ * adds a record to the current batch. The record must have been read
+ * as a whole.
+ */
+void
+arrow_add_record(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+
+	decode_fields(dec, DECODE_RELATION | DECODE_TID | DECODE_BKP);
+
+	col_lsn[nrows] = ((uint64) dec->lsn.xlogid << 32) | dec->lsn.xrecoff;
+	col_xid[nrows] = record->xl_xid;
+	col_rmid[nrows] = record->xl_rmid;
+	col_info[nrows] = record->xl_info;
+	col_len[nrows] = record->xl_len;
+	col_tot_len[nrows] = record->xl_tot_len;
+
+	if (dec->has_node)
+	{
+		col_spc[nrows] = dec->node.spcNode;
+		col_db[nrows] = dec->node.dbNode;
+		col_rel[nrows] = dec->node.relNode;
+		valid_rel[nrows / 8] |= 1 << (nrows % 8);
+	}
+	else
+	{
+		col_spc[nrows] = col_db[nrows] = col_rel[nrows] = 0;
+		nnulls_rel++;
+	}
+
+	if (dec->has_tid)
+	{
+		col_block[nrows] = dec->block;
+		valid_block[nrows / 8] |= 1 << (nrows % 8);
+	}
+	else
+	{
+		col_block[nrows] = 0;
+		nnulls_block++;
+	}
+
+	col_bkp_count[nrows] = dec->nbkp;
+	col_bkp_bytes[nrows] = dec->bkp_header_len + dec->bkp_len;
+
+	if (++nrows == ARROW_BATCH_ROWS)
+		arrow_write_batch();
+}
+
+/*
+ * arrow_write_batch()
+ *
+ * writes the records collected as a record batch, and starts a new
+ * batch.
+ */
+static void
+arrow_write_batch(void)
+{
+	static const int msg_sizes[] = {2, 1, 4, 8};
+	static const int batch_sizes[] = {8, 4, 4};
+	fb_t fb = {NULL, 0, 0};
+	uint32 msg[4];
+	uint32 batch[3];
+	uint32 pos;
+	uint32 nodes;
+	uint32 buffers;
+	int16 version = ARROW_METADATA_V5;
+	uint8 header_type = ARROW_HEADER_RECORDBATCH;
+	int64 length = nrows;
+	int64 body_len = 0;
+	arrow_block_t *block;
+	int i;
+
+	fb_append(&fb, NULL, sizeof(uint32));
+	pos = fb_table(&fb, 4, msg_sizes, msg);
+	fb_ref(&fb, 0, pos);
+	fb_set(&fb, msg[0], &version, sizeof(version));
+	fb_set(&fb, msg[1], &header_type, sizeof(header_type));
+
+	pos = fb_table(&fb, 3, batch_sizes, batch);
+	fb_ref(&fb, msg[2], pos);
+	fb_set(&fb, batch[0], &length, sizeof(length));
+
+	nodes = fb_vector(&fb, NUM_COLUMNS, sizeof(arrow_node_t), 8);
+	fb_ref(&fb, batch[1], nodes - sizeof(uint32));
+	buffers = fb_vector(&fb, NUM_COLUMNS * 2, sizeof(arrow_buffer_t), 8);
+	fb_ref(&fb, batch[2], buffers - sizeof(uint32));
+
+	/* the validity bitmap and the values of each column, aligned to 8 */
+	for (i = 0; i < NUM_COLUMNS; i++)
+	{
+		arrow_node_t node;
+		arrow_buffer_t buf[2];
+
+		node.length = nrows;
+		node.null_count = columns[i].nnulls != NULL ? *columns[i].nnulls : 0;
+		fb_set(&fb, nodes + i * sizeof(node), &node, sizeof(node));
+
+		buf[0].offset = body_len;
+		buf[0].length = columns[i].valid != NULL ? (nrows + 7) / 8 : 0;
+		body_len += TYPEALIGN(8, buf[0].length);
+
+		buf[1].offset = body_len;
+		buf[1].length = (int64) nrows * columns[i].width;
+		body_len += TYPEALIGN(8, buf[1].length);
+
+		fb_set(&fb, buffers + i * sizeof(buf), buf, sizeof(buf));
+	}
+
+	fb_set(&fb, msg[3], &body_len, sizeof(body_len));
+
+	if (nblocks == maxblocks)
+	{
+		maxblocks = maxblocks > 0 ? maxblocks * 2 : 16;
+		blocks = (arrow_block_t *) realloc(blocks, sizeof(arrow_block_t) * maxblocks);
+	}
+	block = &blocks[nblocks++];
+	arrow_write_message(&fb, &block->offset, &block->meta_len);
+	block->pad = 0;
+	block->body_len = body_len;
+	free(fb.data);
+
+	for (i = 0; i < NUM_COLUMNS; i++)
+	{
+		size_t len;
+
+		if (columns[i].valid != NULL)
+		{
+			len = (nrows + 7) / 8;
+			arrow_write(columns[i].valid, len);
+			arrow_write(zeros, TYPEALIGN(8, len) - len);
+		}
+
+		len = (size_t) nrows * columns[i].width;
+		arrow_write(columns[i].values, len);
+		arrow_write(zeros, TYPEALIGN(8, len) - len);
+	}
+
+	nrows = 0;
+	nnulls_rel = 0;
+	nnulls_block = 0;
+	memset(valid_rel, 0, sizeof(valid_rel));
+	memset(valid_block, 0, sizeof(valid_block));
+}
+
+/*
+ * arrow_close()
+ *
+ * writes the last batch, the end-of-stream marker and the footer.
+ */
+void
+arrow_close(void)
+{
+	static const int footer_sizes[] = {2, 4, 4, 4};
+	fb_t fb = {NULL, 0, 0};
+	uint32 footer[4];
+	uint32 pos;
+	uint32 eos[2] = {0xFFFFFFFF, 0};
+	int16 version = ARROW_METADATA_V5;
+	int32 len;
+
+	if (nrows > 0)
+		arrow_write_batch();
+
+	arrow_write(eos, sizeof(eos));
+
+	fb_append(&fb, NULL, sizeof(uint32));
+	pos = fb_table(&fb, 4, footer_sizes, footer);
+	fb_ref(&fb, 0, pos);
+	fb_set(&fb, footer[0], &version, sizeof(version));
+	fb_ref(&fb, footer[1], build_schema(&fb));
+
+	pos = fb_vector(&fb, 0, sizeof(arrow_block_t), 8);
+	fb_ref(&fb, footer[2], pos - sizeof(uint32));
+
+	pos = fb_vector(&fb, nblocks, sizeof(arrow_block_t), 8);
+	fb_ref(&fb, footer[3], pos - sizeof(uint32));
+	if (nblocks > 0)
+		fb_set(&fb, pos, blocks, sizeof(arrow_block_t) * nblocks);
+
+	len = fb.len;
+	arrow_write(fb.data, fb.len);
+	arrow_write(&len, sizeof(len));
+	arrow_write("ARROW1", 6);
+	free(fb.data);
+}
@@ -0,0 +1,22 @@
+/*
+ * xlogdump_arrow.h
+ *
+ * a writer to export the xlog records in the Apache Arrow IPC file
+ * format, one column per field of the records.
+ */
+#ifndef __XLOGDUMP_ARROW_H__
+#define __XLOGDUMP_ARROW_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+
+#include "xlogdump_decode.h"
+
+/* number of records in a record batch */
+#define ARROW_BATCH_ROWS	65536
+
+void arrow_open(void);
+void arrow_add_record(DecodedRecord *);
+void arrow_close(void);
+
+#endif /* __XLOGDUMP_ARROW_H__ */
@@ -0,0 +1,452 @@
+/*
+ * xlogdump_cycle.c
+ *
+ * a collection of functions to analyze the full page writes within
+ * each checkpoint cycle.
+ *
+ * A checkpoint cycle starts at the redo pointer of a checkpoint, and
+ * ends at the redo pointer of the next one. The checkpoint record itself
+ * is written when the (spread) checkpoint completes, long after its redo
+ * pointer. So the records of the current cycle are kept in fine-grained
+ * LSN bins, and the cycle is closed when the next checkpoint record tells
+ * where it actually ended.
+ */
+#include "xlogdump_cycle.h"
+
+#include "access/xlog_internal.h"
+
+#include "xlogdump.h"
+#include "xlogdump_hash.h"
+#include "xlogdump_rmgr.h"
+
+#define CYCLE_BIN_SHIFT		16	/* 64kB per LSN bin */
+#define CYCLE_BIN_SIZE		((uint64) 1 << CYCLE_BIN_SHIFT)
+
+/* distance from redo: < 64kB, < 128kB, ... < 64GB, and beyond */
+#define CYCLE_DIST_BUCKETS	22
+
+struct cycle_bin_t {
+	uint64 rmgr_bytes;
+	uint64 fpi_bytes;
+	uint64 fpi_count;
+};
+
+/*
+ * An entry of the hash set of the blocks written as full page images.
+ * first/last are the byte positions of the first and the last FPI.
+ */
+struct fpi_block_t {
+	bool used;
+	RelFileNode node;
+	BlockNumber block;
+	uint64 first;
+	uint64 last;
+};
+
+struct fpi_set_t {
+	struct fpi_block_t *entries;
+	uint32 size;			/* power of two */
+	uint32 count;
+};
+
+/* summary of a closed cycle */
+struct cycle_t {
+	XLogRecPtr redo;
+	uint64 length;
+	bool partial;			/* the beginning or the end is not seen */
+	struct cycle_bin_t total;
+	uint32 distinct_blocks;
+};
+
+/* the current (open) cycle */
+static bool cycle_started = false;
+static bool redo_known = false;
+static XLogRecPtr cur_redo;
+static uint64 cur_redo_pos;
+static uint64 bin_base;			/* byte position of bins[0] */
+static struct cycle_bin_t *bins = NULL;
+static int nbins = 0;
+static int maxbins = 0;
+static uint64 last_pos;
+
+static struct fpi_set_t fpi_blocks;
+
+/* the closed cycles and the profile by distance from redo */
+static struct cycle_t *cycles = NULL;
+static int ncycles = 0;
+static int maxcycles = 0;
+static struct cycle_bin_t dist_profile[CYCLE_DIST_BUCKETS];
+
+static struct cycle_bin_t *cycle_bin(uint64);
+static void cycle_close(uint64, bool);
+static int dist_bucket(uint64);
+static struct fpi_block_t *fpi_lookup(struct fpi_set_t *, const RelFileNode *, BlockNumber);
+static void fpi_insert(struct fpi_set_t *, const RelFileNode *, BlockNumber, uint64, uint64);
+static void fpi_add(const RelFileNode *, BlockNumber, uint64);
+static uint32 fpi_rebuild(uint64);
+
+static struct fpi_block_t *
+fpi_lookup(struct fpi_set_t *set, const RelFileNode *node, BlockNumber block)
+{
+	uint32 i = hash_block(node, block) & (set->size - 1);
+
+	while (set->entries[i].used)
+	{
+		struct fpi_block_t *e = &set->entries[i];
+
+		if (e->block == block && e->node.relNode == node->relNode &&
+		    e->node.dbNode == node->dbNode && e->node.spcNode == node->spcNode)
+			return e;
+
+		i = (i + 1) & (set->size - 1);
+	}
+
+	return &set->entries[i];
+}
+
+static void
+fpi_insert(struct fpi_set_t *set, const RelFileNode *node, BlockNumber block,
+	   uint64 first, uint64 last)
+{
+	struct fpi_block_t *e;
+
+	/* keep the load factor below 1/2 */
+	if (set->entries == NULL || (set->count + 1) * 2 > set->size)
+	{
+		struct fpi_set_t newset;
+		uint32 i;
+
+		newset.size = (set->entries == NULL) ? 1024 : set->size * 2;
+		newset.count = 0;
+		newset.entries = (struct fpi_block_t *) malloc(sizeof(struct fpi_block_t) * newset.size);
+		if (newset.entries == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the checkpoint cycle stats.\n");
+			exit(1);
+		}
+		memset(newset.entries, 0, sizeof(struct fpi_block_t) * newset.size);
+
+		for (i = 0 ; set->entries != NULL && i < set->size ; i++)
+		{
+			if (set->entries[i].used)
+				fpi_insert(&newset, &set->entries[i].node, set->entries[i].block,
+					   set->entries[i].first, set->entries[i].last);
+		}
+		if (set->entries)
+			free(set->entries);
+		*set = newset;
+	}
+
+	e = fpi_lookup(set, node, block);
+	e->used = true;
+	e->node = *node;
+	e->block = block;
+	e->first = first;
+	e->last = last;
+	set->count++;
+}
+
+static void
+fpi_add(const RelFileNode *node, BlockNumber block, uint64 pos)
+{
+	struct fpi_block_t *e = NULL;
+
+	if (fpi_blocks.entries != NULL)
+		e = fpi_lookup(&fpi_blocks, node, block);
+
+	if (e != NULL && e->used)
+		e->last = pos;
+	else
+		fpi_insert(&fpi_blocks, node, block, pos, pos);
+}
+
+/*
+ * fpi_rebuild()
+ *
+ * returns the number of the distinct blocks first written before the
+ * redo pointer, which belong to the cycle being closed, and keeps only
+ * the blocks written again after the redo pointer for the next cycle.
+ */
+static uint32
+fpi_rebuild(uint64 redo_pos)
+{
+	struct fpi_set_t old = fpi_blocks;
+	uint32 distinct = 0;
+	uint32 i;
+
+	memset(&fpi_blocks, 0, sizeof(fpi_blocks));
+
+	for (i = 0 ; old.entries != NULL && i < old.size ; i++)
+	{
+		if (!old.entries[i].used)
+			continue;
+
+		if (old.entries[i].first < redo_pos)
+			distinct++;
+
+		if (old.entries[i].last >= redo_pos)
+			fpi_insert(&fpi_blocks, &old.entries[i].node, old.entries[i].block,
+				   old.entries[i].last, old.entries[i].last);
+	}
+
+	if (old.entries)
+		free(old.entries);
+
+	return distinct;
+}
+
+/*
+ * cycle_bin()
+ *
+ * returns the LSN bin of the current cycle for the byte position,
+ * extending the bin array when needed.
+ */
+static struct cycle_bin_t *
+cycle_bin(uint64 pos)
+{
+	int idx;
+
+	if (pos < bin_base)
+		pos = bin_base;
+
+	idx = (int) ((pos - bin_base) >> CYCLE_BIN_SHIFT);
+
+	if (idx >= maxbins)
+	{
+		int newmax = (maxbins == 0) ? 1024 : maxbins;
+
+		while (newmax <= idx)
+			newmax *= 2;
+
+		bins = (struct cycle_bin_t *) realloc(bins, sizeof(struct cycle_bin_t) * newmax);
+		if (bins == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the checkpoint cycle stats.\n");
+			exit(1);
+		}
+		memset(bins + maxbins, 0, sizeof(struct cycle_bin_t) * (newmax - maxbins));
+		maxbins = newmax;
+	}
+
+	if (idx >= nbins)
+		nbins = idx + 1;
+
+	return &bins[idx];
+}
+
+static int
+dist_bucket(uint64 dist)
+{
+	int b = 0;
+
+	dist >>= CYCLE_BIN_SHIFT;
+	while (dist > 0 && b < CYCLE_DIST_BUCKETS - 1)
+	{
+		dist >>= 1;
+		b++;
+	}
+
+	return b;
+}
+
+/*
+ * cycle_close()
+ *
+ * closes the current cycle at the byte position `end', and moves the
+ * bins after that to the next cycle. The boundary has the granularity
+ * of a LSN bin. If `partial', the cycle is closed at the last record
+ * without knowing its end.
+ */
+static void
+cycle_close(uint64 end, bool partial)
+{
+	struct cycle_t c;
+	int endbin;
+	int i;
+
+	memset(&c, 0, sizeof(c));
+	c.redo = cur_redo;
+	c.partial = partial || !redo_known;
+	c.length = end - cur_redo_pos;
+
+	if (partial)
+		endbin = nbins;
+	else if (end < bin_base)
+		endbin = 0;
+	else
+		endbin = (int) Min((uint64) nbins, (end - bin_base) >> CYCLE_BIN_SHIFT);
+
+	for (i = 0 ; i < endbin ; i++)
+	{
+		uint64 start = bin_base + ((uint64) i << CYCLE_BIN_SHIFT);
+		int d = dist_bucket((start > cur_redo_pos) ? start - cur_redo_pos : 0);
+
+		c.total.rmgr_bytes += bins[i].rmgr_bytes;
+		c.total.fpi_bytes += bins[i].fpi_bytes;
+		c.total.fpi_count += bins[i].fpi_count;
+
+		dist_profile[d].rmgr_bytes += bins[i].rmgr_bytes;
+		dist_profile[d].fpi_bytes += bins[i].fpi_bytes;
+		dist_profile[d].fpi_count += bins[i].fpi_count;
+	}
+
+	if (partial)
+		c.distinct_blocks = fpi_blocks.count;
+	else
+		c.distinct_blocks = fpi_rebuild(end);
+
+	if (ncycles >= maxcycles)
+	{
+		maxcycles = (maxcycles == 0) ? 16 : maxcycles * 2;
+		cycles = (struct cycle_t *) realloc(cycles, sizeof(struct cycle_t) * maxcycles);
+		if (cycles == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the checkpoint cycle stats.\n");
+			exit(1);
+		}
+	}
+	cycles[ncycles++] = c;
+
+	/* shift the remaining bins */
+	memmove(bins, bins + endbin, sizeof(struct cycle_bin_t) * (nbins - endbin));
+	memset(bins + (nbins - endbin), 0, sizeof(struct cycle_bin_t) * endbin);
+	nbins -= endbin;
+	bin_base += (uint64) endbin << CYCLE_BIN_SHIFT;
+}
+
+/*
+ * cycle_add_record()
+ *
+ * accounts a xlog record to the current checkpoint cycle.
+ */
+void
+cycle_add_record(DecodedRecord *dec)
+{
+	XLogRecPtr cur = dec->lsn;
+	uint64 pos = XLogRecPtrToBytePos(cur);
+	uint64 fpi_bytes = 0;
+	struct cycle_bin_t *bin;
+	XLogRecPtr redo;
+	int i;
+
+	if (!cycle_started)
+	{
+		cycle_started = true;
+		cur_redo = cur;
+		cur_redo_pos = pos;
+		bin_base = pos & ~(CYCLE_BIN_SIZE - 1);
+	}
+
+	bin = cycle_bin(pos);
+
+	decode_fields(dec, DECODE_BKP | DECODE_REDO);
+
+	for (i = 0; i < dec->nbkp; i++)
+	{
+		fpi_add(&dec->bkp[i].node, dec->bkp[i].block, pos);
+		bin->fpi_count++;
+	}
+	fpi_bytes = dec->bkp_header_len + dec->bkp_len;
+
+	bin->fpi_bytes += fpi_bytes;
+	bin->rmgr_bytes += dec->record->xl_tot_len - fpi_bytes;
+	last_pos = pos + dec->record->xl_tot_len;
+
+	if (!dec->has_redo)
+		return;
+	redo = dec->redo;
+
+	/*
+	 * The first checkpoint may point back before the first record we
+	 * have seen. Then, it just tells where the current cycle started.
+	 */
+	if (XLogRecPtrToBytePos(redo) <= cur_redo_pos)
+	{
+		if (!redo_known)
+		{
+			cur_redo = redo;
+			cur_redo_pos = XLogRecPtrToBytePos(redo);
+			redo_known = true;
+		}
+		return;
+	}
+
+	cycle_close(XLogRecPtrToBytePos(redo), false);
+	cur_redo = redo;
+	cur_redo_pos = XLogRecPtrToBytePos(redo);
+	redo_known = true;
+}
+
+static void
+print_cycle_bin(const struct cycle_bin_t *bin)
+{
+	char rmgr_bytes[32], fpi_bytes[32], fpi_count[32];
+	uint64 total = bin->rmgr_bytes + bin->fpi_bytes;
+
+	snprintf(rmgr_bytes, sizeof(rmgr_bytes), UINT64_FORMAT, bin->rmgr_bytes);
+	snprintf(fpi_bytes, sizeof(fpi_bytes), UINT64_FORMAT, bin->fpi_bytes);
+	snprintf(fpi_count, sizeof(fpi_count), UINT64_FORMAT, bin->fpi_count);
+
+	printf(" %14s %14s %9s %6.1f%%",
+	       rmgr_bytes, fpi_bytes, fpi_count,
+	       (total > 0) ? 100.0 * bin->fpi_bytes / total : 0.0);
+}
+
+void
+print_xlog_cycles(void)
+{
+	int i;
+
+	if (cycle_started)
+		cycle_close(last_pos, true);
+
+	printf("---------------------------------------------------------------\n");
+	printf("Checkpoint cycle stats:\n\n");
+
+	if (ncycles == 0)
+	{
+		printf("No xlog record found.\n\n");
+		return;
+	}
+
+	printf("  %-18s %14s %14s %14s %9s %7s %9s\n",
+	       "redo", "length", "rmgr bytes", "fpi bytes", "fpi", "ratio", "blocks");
+
+	for (i = 0 ; i < ncycles ; i++)
+	{
+		char redo[32], length[32];
+
+		snprintf(redo, sizeof(redo), "%X/%08X%s",
+			 cycles[i].redo.xlogid, cycles[i].redo.xrecoff,
+			 cycles[i].partial ? "*" : "");
+		snprintf(length, sizeof(length), UINT64_FORMAT, cycles[i].length);
+
+		printf("  %-18s %14s", redo, length);
+		print_cycle_bin(&cycles[i].total);
+		printf(" %9u\n", cycles[i].distinct_blocks);
+	}
+	printf("  (*: the cycle is not seen from the beginning or to the end.)\n");
+
+	printf("\nFull page writes by distance from redo:\n\n");
+	printf("  %-18s %14s %14s %9s %7s\n",
+	       "distance", "rmgr bytes", "fpi bytes", "fpi", "ratio");
+
+	for (i = 0 ; i < CYCLE_DIST_BUCKETS ; i++)
+	{
+		char dist[32];
+		uint64 upper = CYCLE_BIN_SIZE << i;
+
+		if (dist_profile[i].rmgr_bytes == 0 && dist_profile[i].fpi_bytes == 0)
+			continue;
+
+		if (i == CYCLE_DIST_BUCKETS - 1)
+			snprintf(dist, sizeof(dist), ">= " UINT64_FORMAT "kB", (upper >> 1) / 1024);
+		else
+			snprintf(dist, sizeof(dist), "< " UINT64_FORMAT "kB", upper / 1024);
+
+		printf("  %-18s", dist);
+		print_cycle_bin(&dist_profile[i]);
+		printf("\n");
+	}
+	printf("\n");
+}
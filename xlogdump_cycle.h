@@ -0,0 +1,18 @@
+/*
+ * xlogdump_cycle.h
+ *
+ * a collection of functions to analyze the full page writes within
+ * each checkpoint cycle.
+ */
+#ifndef __XLOGDUMP_CYCLE_H__
+#define __XLOGDUMP_CYCLE_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+
+#include "xlogdump_decode.h"
+
+void cycle_add_record(DecodedRecord *);
+void print_xlog_cycles(void);
+
+#endif /* __XLOGDUMP_CYCLE_H__ */
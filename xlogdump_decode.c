@@ -0,0 +1,776 @@
+/*
+ * xlogdump_decode.c
+ *
+ * a collection of functions to decode the fields of a xlog record
+ * once, to be shared by the statistics, the filters and the output
+ * formats.
+ *
+ * decode_record() only sets up the header, and decode_fields() decodes
+ * the parts asked by a caller which haven't been decoded yet, so each
+ * consumer of a record pays only for what it uses, and no part is
+ * decoded twice for the same record.
+ */
+#include "xlogdump_decode.h"
+
+#include <math.h>
+
+#include "access/htup.h"
+#include "access/nbtree.h"
+#include "access/xact.h"
+#include "access/xlog_internal.h"
+#include "catalog/pg_control.h"
+#include "commands/dbcommands.h"
+
+#include "xlogdump_reader.h"
+#include "xlogdump_rmgr.h"
+#include "xlogdump_version.h"
+
+static void decode_node(DecodedRecord *);
+static void decode_bkp(DecodedRecord *);
+static void set_xact_time(DecodedRecord *, TimestampTz);
+static void copy_payload(DecodedRecord *, void *, size_t);
+static void decode_btree_payload(DecodedRecord *);
+
+/* copy from utils/adt/timestamp.c, and renamed because of the name conflict. */
+pg_time_t
+_timestamptz_to_time_t(TimestampTz t)
+{
+  pg_time_t       result;
+
+#ifdef HAVE_INT64_TIMESTAMP
+  result = (pg_time_t) (t / USECS_PER_SEC +
+			((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY));
+#else
+  result = (pg_time_t) (t +
+			((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY));
+#endif
+
+  return result;
+}
+
+/*
+ * _timestamptz_to_usec()
+ *
+ * converts a TimestampTz into microseconds since the Unix epoch, which
+ * keeps the fraction of a second _timestamptz_to_time_t() truncates.
+ */
+int64
+_timestamptz_to_usec(TimestampTz t)
+{
+#ifdef HAVE_INT64_TIMESTAMP
+  return (int64) t +
+	(int64) (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY * USECS_PER_SEC;
+#else
+  return (int64) rint(t * USECS_PER_SEC) +
+	(int64) (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY * USECS_PER_SEC;
+#endif
+}
+
+static void
+set_xact_time(DecodedRecord *dec, TimestampTz t)
+{
+	dec->time = _timestamptz_to_time_t(t);
+	dec->usec = _timestamptz_to_usec(t);
+	dec->has_time = true;
+}
+
+/*
+ * copy_payload()
+ *
+ * copies the fixed part of the record data into the payload. A record
+ * shorter than that leaves the rest zeroed.
+ */
+static void
+copy_payload(DecodedRecord *dec, void *dst, size_t len)
+{
+	size_t avail = Min(len, dec->record->xl_len);
+
+	memcpy(dst, XLogRecGetData(dec->record), avail);
+	if (avail < len)
+		memset((char *) dst + avail, 0, len - avail);
+	dec->has_payload = true;
+}
+
+/*
+ * decode_record()
+ *
+ * sets up a decoded record for the record at `cur', written by
+ * `version'. Nothing of the record data is looked at until
+ * decode_fields() is called, and never if `partial'.
+ */
+void
+decode_record(DecodedRecord *dec, const xlog_version_t *version,
+	      XLogRecPtr cur, XLogRecord *record, bool partial)
+{
+	dec->version = version;
+	dec->lsn = cur;
+	dec->record = record;
+	dec->info = record->xl_info & ~XLR_INFO_MASK;
+	dec->partial = partial;
+	dec->decoded = 0;
+}
+
+/*
+ * decode_fields()
+ *
+ * decodes the DECODE_* parts in `fields' which haven't been decoded.
+ * The parts a record doesn't have are left as absent.
+ */
+void
+decode_fields(DecodedRecord *dec, int fields)
+{
+	fields &= ~dec->decoded;
+	if (fields == 0)
+		return;
+	dec->decoded |= fields;
+
+	if (fields & DECODE_RELATION)
+		dec->has_node = false;
+	if (fields & DECODE_TID)
+		dec->has_tid = false;
+	if (fields & DECODE_TIME)
+	{
+		dec->has_time = false;
+		dec->commit = false;
+	}
+	if (fields & DECODE_REDO)
+		dec->has_redo = false;
+	if (fields & DECODE_OP)
+		dec->op = NULL;
+	if (fields & DECODE_PAYLOAD)
+		dec->has_payload = false;
+	if (fields & DECODE_BKP)
+	{
+		dec->nbkp = 0;
+		dec->bkp_header_len = 0;
+		dec->bkp_len = 0;
+	}
+
+	if (dec->partial)
+		return;
+
+	dec->version->decode(dec, fields);
+
+	if (fields & DECODE_BKP)
+		decode_bkp(dec);
+}
+
+void
+decode_xlog(DecodedRecord *dec, int fields)
+{
+	if (fields & (DECODE_TIME | DECODE_REDO | DECODE_PAYLOAD))
+	{
+		switch (dec->info)
+		{
+		case XLOG_CHECKPOINT_SHUTDOWN:
+		case XLOG_CHECKPOINT_ONLINE:
+			copy_payload(dec, &dec->payload.checkpoint, sizeof(CheckPoint));
+			if (fields & DECODE_TIME)
+			{
+				dec->time = dec->payload.checkpoint.time;
+				dec->usec = (int64) dec->payload.checkpoint.time * USECS_PER_SEC;
+				dec->has_time = true;
+			}
+			if (fields & DECODE_REDO)
+			{
+				dec->redo = dec->payload.checkpoint.redo;
+				dec->has_redo = true;
+			}
+			break;
+
+		case XLOG_NEXTOID:
+			copy_payload(dec, &dec->payload.next_oid, sizeof(Oid));
+			break;
+
+#if PG_VERSION_NUM >= 90000
+		case XLOG_BACKUP_END:
+			copy_payload(dec, &dec->payload.backup_start, sizeof(XLogRecPtr));
+			break;
+#endif
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info)
+	{
+	case XLOG_CHECKPOINT_SHUTDOWN:	dec->op = "checkpoint_shutdown"; break;
+	case XLOG_CHECKPOINT_ONLINE:	dec->op = "checkpoint_online"; break;
+#if PG_VERSION_NUM >= 80300
+	case XLOG_NOOP:			dec->op = "noop"; break;
+#endif
+	case XLOG_NEXTOID:		dec->op = "nextoid"; break;
+	case XLOG_SWITCH:		dec->op = "switch"; break;
+#if PG_VERSION_NUM >= 90000
+	case XLOG_BACKUP_END:		dec->op = "backup_end"; break;
+	case XLOG_PARAMETER_CHANGE:	dec->op = "parameter_change"; break;
+#endif
+#if PG_VERSION_NUM >= 90100
+	case XLOG_RESTORE_POINT:	dec->op = "restore_point"; break;
+#endif
+#if PG_VERSION_NUM >= 90200
+	case XLOG_FPW_CHANGE:		dec->op = "fpw_change"; break;
+#endif
+	}
+}
+
+void
+decode_xact(DecodedRecord *dec, int fields)
+{
+	DecodedPayload *p = &dec->payload;
+	TimestampTz t = 0;
+	bool has_time = true;
+	bool commit = false;
+
+	if (fields & (DECODE_TIME | DECODE_PAYLOAD))
+	{
+		switch (dec->info)
+		{
+		case XLOG_XACT_COMMIT:
+			copy_payload(dec, &p->xact_commit, sizeof(xl_xact_commit));
+#if PG_VERSION_NUM >= 80300
+			t = p->xact_commit.xact_time;
+#else
+			t = p->xact_commit.xtime;
+#endif
+			commit = true;
+			break;
+
+		case XLOG_XACT_ABORT:
+			copy_payload(dec, &p->xact_abort, sizeof(xl_xact_abort));
+#if PG_VERSION_NUM >= 80300
+			t = p->xact_abort.xact_time;
+#else
+			t = p->xact_abort.xtime;
+#endif
+			break;
+
+		case XLOG_XACT_COMMIT_PREPARED:
+		case XLOG_XACT_ABORT_PREPARED:
+			copy_payload(dec, &p->xact_prepared, sizeof(xl_xact_commit_prepared));
+#if PG_VERSION_NUM >= 80300
+			t = p->xact_prepared.crec.xact_time;
+#else
+			t = p->xact_prepared.crec.xtime;
+#endif
+			commit = (dec->info == XLOG_XACT_COMMIT_PREPARED);
+			break;
+
+#if PG_VERSION_NUM >= 90000
+		case XLOG_XACT_ASSIGNMENT:
+			copy_payload(dec, &p->xact_assignment, sizeof(xl_xact_assignment));
+			has_time = false;
+			break;
+#endif
+
+#if PG_VERSION_NUM >= 90200
+		case XLOG_XACT_COMMIT_COMPACT:
+			copy_payload(dec, &p->xact_commit_compact, sizeof(xl_xact_commit_compact));
+			t = p->xact_commit_compact.xact_time;
+			commit = true;
+			break;
+#endif
+
+		default:
+			has_time = false;
+			break;
+		}
+
+		if ((fields & DECODE_TIME) && has_time)
+		{
+			set_xact_time(dec, t);
+			dec->commit = commit;
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info)
+	{
+	case XLOG_XACT_COMMIT:		dec->op = "commit"; break;
+	case XLOG_XACT_PREPARE:		dec->op = "prepare"; break;
+	case XLOG_XACT_ABORT:		dec->op = "abort"; break;
+	case XLOG_XACT_COMMIT_PREPARED:	dec->op = "commit_prepared"; break;
+	case XLOG_XACT_ABORT_PREPARED:	dec->op = "abort_prepared"; break;
+#if PG_VERSION_NUM >= 90000
+	case XLOG_XACT_ASSIGNMENT:	dec->op = "assignment"; break;
+#endif
+#if PG_VERSION_NUM >= 90200
+	case XLOG_XACT_COMMIT_COMPACT:	dec->op = "commit_compact"; break;
+#endif
+	}
+}
+
+void
+decode_smgr(DecodedRecord *dec, int fields)
+{
+	if (fields & DECODE_PAYLOAD)
+	{
+		switch (dec->info)
+		{
+		case XLOG_SMGR_CREATE:
+			copy_payload(dec, &dec->payload.smgr_create, sizeof(xl_smgr_create));
+			break;
+		case XLOG_SMGR_TRUNCATE:
+			copy_payload(dec, &dec->payload.smgr_truncate, sizeof(xl_smgr_truncate));
+			break;
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info)
+	{
+	case XLOG_SMGR_CREATE:		dec->op = "create"; break;
+	case XLOG_SMGR_TRUNCATE:	dec->op = "truncate"; break;
+	}
+}
+
+void
+decode_clog(DecodedRecord *dec, int fields)
+{
+	if (fields & DECODE_PAYLOAD)
+		copy_payload(dec, &dec->payload.pageno, sizeof(int));
+}
+
+void
+decode_dbase(DecodedRecord *dec, int fields)
+{
+	if (fields & DECODE_PAYLOAD)
+	{
+		switch (dec->info)
+		{
+		case XLOG_DBASE_CREATE:
+			copy_payload(dec, &dec->payload.dbase_create, sizeof(xl_dbase_create_rec));
+			break;
+		case XLOG_DBASE_DROP:
+			copy_payload(dec, &dec->payload.dbase_drop, sizeof(xl_dbase_drop_rec));
+			break;
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info)
+	{
+	case XLOG_DBASE_CREATE:		dec->op = "create"; break;
+	case XLOG_DBASE_DROP:		dec->op = "drop"; break;
+	}
+}
+
+void
+decode_multixact(DecodedRecord *dec, int fields)
+{
+	if (!(fields & DECODE_PAYLOAD))
+		return;
+
+	switch (dec->info & XLOG_HEAP_OPMASK)
+	{
+	case XLOG_MULTIXACT_ZERO_OFF_PAGE:
+	case XLOG_MULTIXACT_ZERO_MEM_PAGE:
+		copy_payload(dec, &dec->payload.pageno, sizeof(int));
+		break;
+	case XLOG_MULTIXACT_CREATE_ID:
+		copy_payload(dec, &dec->payload.multixact_create, sizeof(xl_multixact_create));
+		break;
+	}
+}
+
+#if PG_VERSION_NUM >= 90000
+void
+decode_relmap(DecodedRecord *dec, int fields)
+{
+	if ((fields & DECODE_PAYLOAD) && dec->info == XLOG_RELMAP_UPDATE)
+		copy_payload(dec, &dec->payload.relmap_update, offsetof(xl_relmap_update, data));
+}
+#endif
+
+void
+decode_heap2(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+	DecodedPayload *p = &dec->payload;
+
+	if (fields & DECODE_RELATION)
+		decode_node(dec);
+
+	if (fields & DECODE_PAYLOAD)
+	{
+		switch (dec->info)
+		{
+		case XLOG_HEAP2_FREEZE:
+			copy_payload(dec, &p->heap_freeze, sizeof(xl_heap_freeze));
+			break;
+
+#if PG_VERSION_NUM >= 80300
+		case XLOG_HEAP2_CLEAN:
+#if PG_VERSION_NUM < 90000
+		case XLOG_HEAP2_CLEAN_MOVE:
+#endif
+			{
+			int total_off = 0;
+
+			copy_payload(dec, &p->heap_clean.xlrec, sizeof(xl_heap_clean));
+			if (record->xl_len > SizeOfHeapClean)
+				total_off = (record->xl_len - SizeOfHeapClean) / sizeof(OffsetNumber);
+
+			p->heap_clean.nunused = 0;
+			if (total_off > p->heap_clean.xlrec.nredirected + p->heap_clean.xlrec.ndead)
+				p->heap_clean.nunused = total_off -
+					(p->heap_clean.xlrec.nredirected + p->heap_clean.xlrec.ndead);
+			break;
+			}
+
+#if PG_VERSION_NUM >= 90000
+		case XLOG_HEAP2_CLEANUP_INFO:
+			copy_payload(dec, &p->heap_cleanup_info, sizeof(xl_heap_cleanup_info));
+			break;
+#endif
+#endif
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info & XLOG_HEAP_OPMASK)
+	{
+	case XLOG_HEAP2_FREEZE:		dec->op = "freeze"; break;
+#if PG_VERSION_NUM >= 80300
+	case XLOG_HEAP2_CLEAN:		dec->op = "clean"; break;
+#if PG_VERSION_NUM < 90000
+	case XLOG_HEAP2_CLEAN_MOVE:	dec->op = "clean_move"; break;
+#endif
+#if PG_VERSION_NUM >= 90000
+	case XLOG_HEAP2_CLEANUP_INFO:	dec->op = "cleanup_info"; break;
+#endif
+#if PG_VERSION_NUM >= 90200
+	case XLOG_HEAP2_VISIBLE:	dec->op = "visible"; break;
+	case XLOG_HEAP2_MULTI_INSERT:	dec->op = "multi_insert"; break;
+#endif
+#endif
+	}
+}
+
+void
+decode_heap(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+	DecodedPayload *p = &dec->payload;
+
+	if (fields & DECODE_RELATION)
+		decode_node(dec);
+
+	if (fields & DECODE_TID)
+	{
+		switch (dec->info & XLOG_HEAP_OPMASK)
+		{
+		case XLOG_HEAP_INSERT:
+		case XLOG_HEAP_DELETE:
+		case XLOG_HEAP_UPDATE:
+#if PG_VERSION_NUM >= 80300
+		case XLOG_HEAP_HOT_UPDATE:
+#endif
+#if PG_VERSION_NUM < 90000
+		case XLOG_HEAP_MOVE:
+#endif
+		case XLOG_HEAP_LOCK:
+		case XLOG_HEAP_INPLACE:
+			if (record->xl_len >= SizeOfHeapTid)
+			{
+				ItemPointerData tid;
+
+				memcpy(&tid, XLogRecGetData(record) + offsetof(xl_heaptid, tid), sizeof(tid));
+				dec->block = ItemPointerGetBlockNumber(&tid);
+				dec->offset = ItemPointerGetOffsetNumber(&tid);
+				dec->has_tid = true;
+			}
+			break;
+
+		case XLOG_HEAP_NEWPAGE:
+			if (record->xl_len >= sizeof(xl_heap_newpage))
+			{
+				xl_heap_newpage xlrec;
+
+				memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
+				dec->block = xlrec.blkno;
+				dec->offset = InvalidOffsetNumber;
+				dec->has_tid = true;
+			}
+			break;
+		}
+	}
+
+	if (fields & DECODE_PAYLOAD)
+	{
+		switch (dec->info & XLOG_HEAP_OPMASK)
+		{
+		case XLOG_HEAP_INSERT:
+			copy_payload(dec, &p->heap_insert.xlrec, sizeof(xl_heap_insert));
+			/* the tuple header is there unless the page is backed up */
+			p->heap_insert.has_header =
+				!(record->xl_info & XLR_BKP_BLOCK_MASK) &&
+				record->xl_len >= SizeOfHeapInsert + SizeOfHeapHeader;
+			if (p->heap_insert.has_header)
+				memcpy(&p->heap_insert.header, XLogRecGetData(record) + SizeOfHeapInsert,
+				       SizeOfHeapHeader);
+			break;
+		case XLOG_HEAP_DELETE:
+			copy_payload(dec, &p->heap_delete, sizeof(xl_heap_delete));
+			break;
+		case XLOG_HEAP_UPDATE:
+#if PG_VERSION_NUM >= 80300
+		case XLOG_HEAP_HOT_UPDATE:
+#endif
+#if PG_VERSION_NUM < 90000
+		case XLOG_HEAP_MOVE:
+#endif
+			copy_payload(dec, &p->heap_update, sizeof(xl_heap_update));
+			break;
+		case XLOG_HEAP_NEWPAGE:
+			copy_payload(dec, &p->heap_newpage, sizeof(xl_heap_newpage));
+			break;
+		case XLOG_HEAP_LOCK:
+			copy_payload(dec, &p->heap_lock, sizeof(xl_heap_lock));
+			break;
+		case XLOG_HEAP_INPLACE:
+			copy_payload(dec, &p->heap_inplace, sizeof(xl_heap_inplace));
+			break;
+		}
+	}
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info & XLOG_HEAP_OPMASK)
+	{
+	case XLOG_HEAP_INSERT:		dec->op = "insert"; break;
+	case XLOG_HEAP_DELETE:		dec->op = "delete"; break;
+	case XLOG_HEAP_UPDATE:		dec->op = "update"; break;
+#if PG_VERSION_NUM >= 80300
+	case XLOG_HEAP_HOT_UPDATE:	dec->op = "hot_update"; break;
+#endif
+#if PG_VERSION_NUM < 90000
+	case XLOG_HEAP_MOVE:		dec->op = "move"; break;
+#endif
+	case XLOG_HEAP_NEWPAGE:		dec->op = "newpage"; break;
+	case XLOG_HEAP_LOCK:		dec->op = "lock"; break;
+	case XLOG_HEAP_INPLACE:		dec->op = "inplace"; break;
+	case XLOG_HEAP_INIT_PAGE:	dec->op = "init_page"; break;
+	}
+}
+
+void
+decode_btree(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+
+	if (fields & DECODE_RELATION)
+		decode_node(dec);
+
+	if ((fields & DECODE_TID) &&
+	    (dec->info == XLOG_BTREE_INSERT_LEAF || dec->info == XLOG_BTREE_INSERT_UPPER) &&
+	    record->xl_len >= SizeOfBtreeInsert)
+	{
+		ItemPointerData tid;
+
+		memcpy(&tid, XLogRecGetData(record) + offsetof(xl_btreetid, tid), sizeof(tid));
+		dec->block = BlockIdGetBlockNumber(&tid.ip_blkid);
+		dec->offset = tid.ip_posid;
+		dec->has_tid = true;
+	}
+
+	if (fields & DECODE_PAYLOAD)
+		decode_btree_payload(dec);
+
+	if (!(fields & DECODE_OP))
+		return;
+
+	switch (dec->info)
+	{
+	case XLOG_BTREE_INSERT_LEAF:	dec->op = "insert_leaf"; break;
+	case XLOG_BTREE_INSERT_UPPER:	dec->op = "insert_upper"; break;
+	case XLOG_BTREE_INSERT_META:	dec->op = "insert_meta"; break;
+	case XLOG_BTREE_SPLIT_L:	dec->op = "split_l"; break;
+	case XLOG_BTREE_SPLIT_L_ROOT:	dec->op = "split_l_root"; break;
+	case XLOG_BTREE_SPLIT_R:	dec->op = "split_r"; break;
+	case XLOG_BTREE_SPLIT_R_ROOT:	dec->op = "split_r_root"; break;
+	case XLOG_BTREE_DELETE:		dec->op = "delete"; break;
+	case XLOG_BTREE_DELETE_PAGE:	dec->op = "delete_page"; break;
+	case XLOG_BTREE_DELETE_PAGE_META:	dec->op = "delete_page_meta"; break;
+	case XLOG_BTREE_NEWROOT:	dec->op = "newroot"; break;
+	case XLOG_BTREE_DELETE_PAGE_HALF:	dec->op = "delete_page_half"; break;
+#if PG_VERSION_NUM >= 90000
+	case XLOG_BTREE_VACUUM:		dec->op = "vacuum"; break;
+	case XLOG_BTREE_REUSE_PAGE:	dec->op = "reuse_page"; break;
+#endif
+	}
+}
+
+/*
+ * decode_btree_payload()
+ *
+ * copies the fixed part of a btree record, and the downlink, the
+ * metadata or the new item which follow it, as btree_redo() reads them.
+ */
+static void
+decode_btree_payload(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	DecodedPayload *p = &dec->payload;
+	char *data = XLogRecGetData(record);
+
+	switch (dec->info)
+	{
+	case XLOG_BTREE_INSERT_LEAF:
+	case XLOG_BTREE_INSERT_UPPER:
+		copy_payload(dec, &p->btree_insert.xlrec, sizeof(xl_btree_insert));
+		break;
+
+	case XLOG_BTREE_INSERT_META:
+		copy_payload(dec, &p->btree_insert.xlrec, sizeof(xl_btree_insert));
+		if (record->xl_len >= SizeOfBtreeInsert + sizeof(BlockNumber) + sizeof(xl_btree_metadata))
+		{
+			memcpy(&p->btree_insert.downlink, data + SizeOfBtreeInsert, sizeof(BlockNumber));
+			memcpy(&p->btree_insert.md, data + SizeOfBtreeInsert + sizeof(BlockNumber),
+			       sizeof(xl_btree_metadata));
+		}
+		else
+		{
+			p->btree_insert.downlink = InvalidBlockNumber;
+			memset(&p->btree_insert.md, 0, sizeof(xl_btree_metadata));
+		}
+		break;
+
+	case XLOG_BTREE_SPLIT_L:
+	case XLOG_BTREE_SPLIT_L_ROOT:
+	case XLOG_BTREE_SPLIT_R:
+	case XLOG_BTREE_SPLIT_R_ROOT:
+		{
+		uint32 off = SizeOfBtreeSplit;
+
+		copy_payload(dec, &p->btree_split.xlrec, sizeof(xl_btree_split));
+		p->btree_split.has_downlink = false;
+		p->btree_split.newitemoff = InvalidOffsetNumber;
+		p->btree_split.has_newitem = false;
+
+		if (p->btree_split.xlrec.level > 0 &&
+		    record->xl_len >= off + sizeof(BlockIdData))
+		{
+			BlockIdData downlink;
+
+			memcpy(&downlink, data + off, sizeof(downlink));
+			p->btree_split.downlink = BlockIdGetBlockNumber(&downlink);
+			p->btree_split.has_downlink = true;
+			off += sizeof(BlockIdData);
+		}
+
+		/* only a left split has the new item */
+		if (dec->info != XLOG_BTREE_SPLIT_L && dec->info != XLOG_BTREE_SPLIT_L_ROOT)
+			break;
+
+		if (record->xl_len >= off + sizeof(OffsetNumber))
+		{
+			memcpy(&p->btree_split.newitemoff, data + off, sizeof(OffsetNumber));
+			off += sizeof(OffsetNumber);
+		}
+		if (!(record->xl_info & XLR_BKP_BLOCK_1) &&
+		    record->xl_len >= off + sizeof(ItemPointerData))
+		{
+			memcpy(&p->btree_split.newitem, data + off, sizeof(ItemPointerData));
+			p->btree_split.has_newitem = true;
+		}
+		break;
+		}
+
+	case XLOG_BTREE_DELETE:
+		copy_payload(dec, &p->btree_delete, sizeof(xl_btree_delete));
+		break;
+
+	case XLOG_BTREE_DELETE_PAGE:
+	case XLOG_BTREE_DELETE_PAGE_HALF:
+		copy_payload(dec, &p->btree_delete_page.xlrec, sizeof(xl_btree_delete_page));
+		break;
+
+	case XLOG_BTREE_DELETE_PAGE_META:
+		copy_payload(dec, &p->btree_delete_page.xlrec, sizeof(xl_btree_delete_page));
+		if (record->xl_len >= sizeof(xl_btree_delete_page) + sizeof(xl_btree_metadata))
+			memcpy(&p->btree_delete_page.md, data + sizeof(xl_btree_delete_page),
+			       sizeof(xl_btree_metadata));
+		else
+			memset(&p->btree_delete_page.md, 0, sizeof(xl_btree_metadata));
+		break;
+
+	case XLOG_BTREE_NEWROOT:
+		copy_payload(dec, &p->btree_newroot, sizeof(xl_btree_newroot));
+		break;
+	}
+}
+
+void
+decode_seq(DecodedRecord *dec, int fields)
+{
+	if (fields & DECODE_RELATION)
+		decode_node(dec);
+}
+
+/*
+ * decode_node()
+ *
+ * gets the relation of a heap, heap2, btree or sequence record. All the
+ * records of those resource managers start with a RelFileNode, either
+ * directly or in a xl_heaptid or a xl_btreetid.
+ */
+static void
+decode_node(DecodedRecord *dec)
+{
+	if (dec->record->xl_len < sizeof(RelFileNode))
+		return;
+
+	memcpy(&dec->node, XLogRecGetData(dec->record), sizeof(RelFileNode));
+	dec->has_node = true;
+}
+
+/*
+ * decode_bkp()
+ *
+ * collects the headers of the backup blocks following the record data,
+ * in the layout of the version of the record. Every BkpBlock begins
+ * with the RelFileNode, and ends with the block number and the hole.
+ */
+static void
+decode_bkp(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	const reader_layout_t *layout;
+	char *blk;
+	int i;
+
+	if (!(record->xl_info & XLR_INFO_MASK))
+		return;
+	layout = reader_layout_of_magic(dec->version->magic);
+
+	blk = (char *) XLogRecGetData(record) + record->xl_len;
+	for (i = 0; i < layout->max_bkp; i++)
+	{
+		DecodedBkpBlock *b;
+
+		if (!(record->xl_info & XLR_SET_BKP_BLOCK(i)))
+			continue;
+
+		b = &dec->bkp[dec->nbkp++];
+		b->id = i;
+		memcpy(&b->node, blk, sizeof(RelFileNode));
+		memcpy(&b->block, blk + layout->bkp_size - 8, sizeof(BlockNumber));
+		memcpy(&b->hole_offset, blk + layout->bkp_size - 4, sizeof(uint16));
+		memcpy(&b->hole_length, blk + layout->bkp_size - 2, sizeof(uint16));
+		blk += layout->bkp_size + (BLCKSZ - b->hole_length);
+
+		dec->bkp_header_len += layout->bkp_size;
+		dec->bkp_len += BLCKSZ - b->hole_length;
+	}
+}
@@ -0,0 +1,213 @@
+/*
+ * xlogdump_decode.h
+ *
+ * a collection of functions to decode the fields of a xlog record
+ * once, to be shared by the statistics, the filters and the output
+ * formats.
+ */
+#ifndef __XLOGDUMP_DECODE_H__
+#define __XLOGDUMP_DECODE_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+#include "storage/block.h"
+#include "storage/off.h"
+#include "storage/relfilenode.h"
+#include "utils/timestamp.h"
+#include "access/htup.h"
+#include "access/multixact.h"
+#include "access/nbtree.h"
+#include "access/xact.h"
+#include "catalog/pg_control.h"
+#include "commands/dbcommands.h"
+
+#if PG_VERSION_NUM >= 90000
+#include "utils/relmapper.h"
+#endif
+
+/* XXX these ought to be in smgr.h, but are not */
+#define XLOG_SMGR_CREATE	0x10
+#define XLOG_SMGR_TRUNCATE	0x20
+
+typedef struct xl_smgr_create
+{
+	RelFileNode rnode;
+} xl_smgr_create;
+
+typedef struct xl_smgr_truncate
+{
+	BlockNumber blkno;
+	RelFileNode rnode;
+} xl_smgr_truncate;
+
+/* the parts of a record which decode_fields() can decode */
+#define DECODE_RELATION		0x01	/* has_node, node */
+#define DECODE_TID		0x02	/* has_tid, block, offset */
+#define DECODE_TIME		0x04	/* has_time, time, commit */
+#define DECODE_REDO		0x08	/* has_redo, redo */
+#define DECODE_OP		0x10	/* op */
+#define DECODE_BKP		0x20	/* nbkp, bkp, bkp_len */
+#define DECODE_PAYLOAD		0x40	/* has_payload, payload */
+#define DECODE_ALL		0x7f
+
+/* the most backup blocks of a record in any version, 4 since 9.2 */
+#define DECODE_MAX_BKP_BLOCKS	4
+
+typedef struct DecodedBkpBlock
+{
+	int			id;				/* the slot in the record, from 0 */
+	RelFileNode node;
+	BlockNumber block;
+	uint16		hole_offset;
+	uint16		hole_length;
+} DecodedBkpBlock;
+
+/*
+ * The fixed part of the record data of each operation, copied out of
+ * the record, with the few values which follow it. The member is the
+ * one of xl_rmid and info; only the operations printed with their
+ * fields have one.
+ */
+typedef union DecodedPayload
+{
+	CheckPoint	checkpoint;		/* XLOG_CHECKPOINT_* */
+	Oid			next_oid;		/* XLOG_NEXTOID */
+	XLogRecPtr	backup_start;	/* XLOG_BACKUP_END */
+
+	xl_xact_commit xact_commit;
+	xl_xact_abort xact_abort;
+	xl_xact_commit_prepared xact_prepared;	/* COMMIT_ and ABORT_PREPARED */
+	xl_xact_abort_prepared xact_abort_prepared;	/* ABORT_PREPARED, over the same bytes */
+#if PG_VERSION_NUM >= 90000
+	xl_xact_assignment xact_assignment;
+#endif
+#if PG_VERSION_NUM >= 90200
+	xl_xact_commit_compact xact_commit_compact;
+#endif
+
+	xl_smgr_create smgr_create;
+	xl_smgr_truncate smgr_truncate;
+
+	int			pageno;			/* CLOG and MultiXact zero pages */
+	xl_multixact_create multixact_create;
+
+	xl_dbase_create_rec dbase_create;
+	xl_dbase_drop_rec dbase_drop;
+#if PG_VERSION_NUM >= 90000
+	xl_relmap_update relmap_update;
+#endif
+
+	xl_heap_freeze heap_freeze;
+#if PG_VERSION_NUM >= 80300
+	struct
+	{
+		xl_heap_clean xlrec;
+		int			nunused;
+	}			heap_clean;
+#endif
+#if PG_VERSION_NUM >= 90000
+	xl_heap_cleanup_info heap_cleanup_info;
+#endif
+
+	struct
+	{
+		xl_heap_insert xlrec;
+		bool		has_header;		/* no backup block */
+		xl_heap_header header;
+	}			heap_insert;
+	xl_heap_delete heap_delete;
+	xl_heap_update heap_update;		/* UPDATE, HOT_UPDATE and MOVE */
+	xl_heap_newpage heap_newpage;
+	xl_heap_lock heap_lock;
+	xl_heap_inplace heap_inplace;
+
+	struct
+	{
+		xl_btree_insert xlrec;
+		BlockNumber downlink;		/* INSERT_META only */
+		xl_btree_metadata md;
+	}			btree_insert;
+	struct
+	{
+		xl_btree_split xlrec;
+		bool		has_downlink;	/* not on the leaf level */
+		BlockNumber downlink;
+		OffsetNumber newitemoff;
+		bool		has_newitem;	/* no backup block of the left page */
+		ItemPointerData newitem;
+	}			btree_split;
+	xl_btree_delete btree_delete;
+	struct
+	{
+		xl_btree_delete_page xlrec;
+		xl_btree_metadata md;		/* DELETE_PAGE_META only */
+	}			btree_delete_page;
+	xl_btree_newroot btree_newroot;
+} DecodedPayload;
+
+/* the version which wrote a record, in xlogdump_version.h */
+typedef struct xlog_version xlog_version_t;
+
+typedef struct DecodedRecord
+{
+	const xlog_version_t *version;
+	XLogRecPtr	lsn;
+	XLogRecord *record;
+	uint8		info;			/* xl_info without XLR_INFO_MASK */
+	bool		partial;		/* only the header has been read */
+	int			decoded;		/* DECODE_* already decoded */
+
+	/* the relation of a heap, heap2, btree or sequence record */
+	bool		has_node;
+	RelFileNode node;
+
+	/* the tuple of a heap or btree record, or the block of a newpage */
+	bool		has_tid;
+	BlockNumber block;
+	OffsetNumber offset;		/* InvalidOffsetNumber for a newpage */
+
+	/* the time of a commit, abort or checkpoint record */
+	bool		has_time;
+	pg_time_t	time;
+	int64		usec;			/* the same in microseconds */
+	bool		commit;
+
+	/* the redo pointer of a checkpoint record */
+	bool		has_redo;
+	XLogRecPtr	redo;
+
+	/* the name of the operation, or NULL if unknown */
+	const char *op;
+
+	/* the fixed part of the record data, absent for the other operations */
+	bool		has_payload;
+	DecodedPayload payload;
+
+	/* the backup blocks, and the length of their headers and page images */
+	int			nbkp;
+	DecodedBkpBlock bkp[DECODE_MAX_BKP_BLOCKS];
+	uint32		bkp_header_len;
+	uint32		bkp_len;
+} DecodedRecord;
+
+void decode_record(DecodedRecord *, const xlog_version_t *, XLogRecPtr, XLogRecord *, bool);
+void decode_fields(DecodedRecord *, int);
+
+/* the decode callbacks of the resource managers */
+void decode_xlog(DecodedRecord *, int);
+void decode_xact(DecodedRecord *, int);
+void decode_smgr(DecodedRecord *, int);
+void decode_clog(DecodedRecord *, int);
+void decode_dbase(DecodedRecord *, int);
+void decode_multixact(DecodedRecord *, int);
+#if PG_VERSION_NUM >= 90000
+void decode_relmap(DecodedRecord *, int);
+#endif
+void decode_heap2(DecodedRecord *, int);
+void decode_heap(DecodedRecord *, int);
+void decode_btree(DecodedRecord *, int);
+void decode_seq(DecodedRecord *, int);
+pg_time_t _timestamptz_to_time_t(TimestampTz);
+int64 _timestamptz_to_usec(TimestampTz);
+
+#endif /* __XLOGDUMP_DECODE_H__ */
@@ -0,0 +1,394 @@
+/*
+ * xlogdump_distinct.c
+ *
+ * a collection of functions to estimate the number of distinct blocks
+ * touched per relation and per checkpoint cycle.
+ *
+ * Each relation has two HyperLogLog counters, one for the whole
+ * segments and one for the current checkpoint cycle, so the memory
+ * is 8kB per relation regardless of the amount of the xlog records.
+ * A cycle is closed at the checkpoint record, not at its redo pointer,
+ * because a HyperLogLog counter can not be split afterwards.
+ *
+ * Only the counters for the whole segments are saved into the stats
+ * files, because a cycle usually spans several segments.
+ */
+#include "xlogdump_distinct.h"
+
+#include "xlogdump_export.h"
+#include "xlogdump_hll.h"
+#include "xlogdump_oid2name.h"
+#include "xlogdump_rmgr.h"
+#include "xlogdump_sidecar.h"
+
+#define DISTINCT_HASH_SIZE	1024
+
+struct distinct_rel_t {
+	RelFileNode node;
+	hll_t total;
+	hll_t cycle;
+	bool in_cycle;			/* touched in the current cycle */
+	uint32 ncycles;
+	double max_cycle;
+	double sum_cycle;
+	double blocks;			/* estimated at the end */
+	struct distinct_rel_t *next;
+};
+
+struct distinct_cycle_t {
+	XLogRecPtr start;
+	bool partial;			/* not seen from the beginning or to the end */
+	int nrels;
+	double blocks;
+};
+
+static struct distinct_rel_t *rel_hash[DISTINCT_HASH_SIZE];
+static struct distinct_rel_t **rels = NULL;
+static int nrels = 0;
+static int maxrels = 0;
+
+static struct distinct_cycle_t *cycles = NULL;
+static int ncycles = 0;
+static int maxcycles = 0;
+
+static bool cycle_started = false;
+static bool finished = false;
+static struct distinct_cycle_t cur_cycle;
+static hll_t cycle_total;
+static int cycle_nrels = 0;
+
+static struct distinct_rel_t *distinct_get_rel(const RelFileNode *);
+static void distinct_close_cycle(void);
+static void distinct_finish(void);
+static int cmp_distinct_rel(const void *, const void *);
+static void distinct_rel_name(const struct distinct_rel_t *, char *, size_t);
+
+/*
+ * distinct_get_rel()
+ *
+ * looks up the counters of the relation, or creates them.
+ */
+static struct distinct_rel_t *
+distinct_get_rel(const RelFileNode *node)
+{
+	uint32 h = (node->relNode ^ (node->dbNode * 31) ^ (node->spcNode * 131)) % DISTINCT_HASH_SIZE;
+	struct distinct_rel_t *rel;
+
+	for (rel = rel_hash[h] ; rel != NULL ; rel = rel->next)
+	{
+		if (rel->node.relNode == node->relNode &&
+		    rel->node.dbNode == node->dbNode &&
+		    rel->node.spcNode == node->spcNode)
+			return rel;
+	}
+
+	if (nrels >= maxrels)
+	{
+		maxrels = (maxrels == 0) ? 64 : maxrels * 2;
+		rels = (struct distinct_rel_t **) realloc(rels, sizeof(struct distinct_rel_t *) * maxrels);
+		if (rels == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the distinct block stats.\n");
+			exit(1);
+		}
+	}
+
+	rel = (struct distinct_rel_t *) malloc(sizeof(struct distinct_rel_t));
+	if (rel == NULL)
+	{
+		fprintf(stderr, "ERROR: out of memory for the distinct block stats.\n");
+		exit(1);
+	}
+	memset(rel, 0, sizeof(struct distinct_rel_t));
+	rel->node = *node;
+	rel->next = rel_hash[h];
+	rel_hash[h] = rel;
+	rels[nrels++] = rel;
+
+	return rel;
+}
+
+void
+distinct_add_block(const RelFileNode *node, BlockNumber block)
+{
+	struct distinct_rel_t *rel = distinct_get_rel(node);
+
+	hll_add_block(&rel->total, node, block);
+	hll_add_block(&rel->cycle, node, block);
+	hll_add_block(&cycle_total, node, block);
+
+	if (!rel->in_cycle)
+	{
+		rel->in_cycle = true;
+		cycle_nrels++;
+	}
+}
+
+/*
+ * distinct_close_cycle()
+ *
+ * saves the estimates of the current cycle, and resets the counters
+ * of the cycle.
+ */
+static void
+distinct_close_cycle(void)
+{
+	int i;
+
+	for (i = 0 ; i < nrels ; i++)
+	{
+		struct distinct_rel_t *rel = rels[i];
+		double e;
+
+		if (!rel->in_cycle)
+			continue;
+
+		e = hll_estimate(&rel->cycle);
+		rel->ncycles++;
+		rel->sum_cycle += e;
+		if (e > rel->max_cycle)
+			rel->max_cycle = e;
+
+		hll_reset(&rel->cycle);
+		rel->in_cycle = false;
+	}
+
+	/* nothing to show for the records before the first checkpoint. */
+	if (cur_cycle.partial && cycle_nrels == 0)
+		return;
+
+	if (ncycles >= maxcycles)
+	{
+		maxcycles = (maxcycles == 0) ? 16 : maxcycles * 2;
+		cycles = (struct distinct_cycle_t *) realloc(cycles, sizeof(struct distinct_cycle_t) * maxcycles);
+		if (cycles == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the distinct block stats.\n");
+			exit(1);
+		}
+	}
+
+	cur_cycle.nrels = cycle_nrels;
+	cur_cycle.blocks = hll_estimate(&cycle_total);
+	cycles[ncycles++] = cur_cycle;
+
+	hll_reset(&cycle_total);
+	cycle_nrels = 0;
+}
+
+/*
+ * distinct_add_record()
+ *
+ * should be called for every xlog record after its blocks are added.
+ * A checkpoint record closes the current cycle, and the next cycle
+ * is labeled with its redo pointer.
+ */
+void
+distinct_add_record(DecodedRecord *dec)
+{
+	if (!cycle_started)
+	{
+		cycle_started = true;
+		cur_cycle.start = dec->lsn;
+		cur_cycle.partial = true;
+	}
+
+	decode_fields(dec, DECODE_REDO);
+	if (!dec->has_redo)
+		return;
+
+	distinct_close_cycle();
+
+	cur_cycle.start = dec->redo;
+	cur_cycle.partial = false;
+}
+
+static int
+cmp_distinct_rel(const void *a, const void *b)
+{
+	const struct distinct_rel_t *x = *(const struct distinct_rel_t * const *) a;
+	const struct distinct_rel_t *y = *(const struct distinct_rel_t * const *) b;
+
+	if (x->blocks != y->blocks)
+		return (x->blocks < y->blocks) ? 1 : -1;
+	return 0;
+}
+
+/*
+ * distinct_finish()
+ *
+ * closes the last cycle, and sorts the relations by the estimates.
+ */
+static void
+distinct_finish(void)
+{
+	int i;
+
+	if (finished)
+		return;
+	finished = true;
+
+	if (cycle_started)
+	{
+		cur_cycle.partial = true;
+		distinct_close_cycle();
+	}
+
+	for (i = 0 ; i < nrels ; i++)
+		rels[i]->blocks = hll_estimate(&rels[i]->total);
+	qsort(rels, nrels, sizeof(struct distinct_rel_t *), cmp_distinct_rel);
+}
+
+static void
+distinct_rel_name(const struct distinct_rel_t *rel, char *buf, size_t buflen)
+{
+	char spaceName[NAMEDATALEN];
+	char dbName[NAMEDATALEN];
+	char relName[NAMEDATALEN];
+
+	getSpaceName(rel->node.spcNode, spaceName, sizeof(spaceName));
+	getDbName(rel->node.dbNode, dbName, sizeof(dbName));
+	getRelName(rel->node.dbNode, rel->node.relNode, relName, sizeof(relName));
+	snprintf(buf, buflen, "%s/%s/%s", spaceName, dbName, relName);
+}
+
+void
+print_xlog_distinct(void)
+{
+	char relation[NAMEDATALEN * 3 + 3];
+	int i;
+
+	distinct_finish();
+
+	printf("---------------------------------------------------------------\n");
+	printf("Distinct blocks per checkpoint cycle:\n\n");
+
+	if (ncycles == 0 && nrels == 0)
+	{
+		printf("No xlog record found.\n\n");
+		return;
+	}
+
+	if (ncycles == 0)
+		printf("No checkpoint cycle found. (not kept in the stats files.)\n");
+	else
+		printf("  %-18s %9s %12s\n", "redo", "relations", "blocks");
+	for (i = 0 ; i < ncycles ; i++)
+	{
+		char start[32];
+
+		snprintf(start, sizeof(start), "%X/%08X%s",
+			 cycles[i].start.xlogid, cycles[i].start.xrecoff,
+			 cycles[i].partial ? "*" : "");
+		printf("  %-18s %9d %12.0f\n", start, cycles[i].nrels, cycles[i].blocks);
+	}
+	if (ncycles > 0)
+		printf("  (*: the cycle is not seen from the beginning or to the end.)\n");
+
+	printf("\nDistinct blocks per relation:\n\n");
+	printf("  %12s %9s %12s %12s  %s\n",
+	       "blocks", "cycles", "max/cycle", "avg/cycle", "relation");
+	for (i = 0 ; i < nrels ; i++)
+	{
+		struct distinct_rel_t *rel = rels[i];
+
+		distinct_rel_name(rel, relation, sizeof(relation));
+
+		printf("  %12.0f %9u %12.0f %12.0f  s/d/r:%s\n",
+		       rel->blocks, rel->ncycles, rel->max_cycle,
+		       (rel->ncycles > 0) ? rel->sum_cycle / rel->ncycles : 0.0,
+		       relation);
+	}
+	printf("  (estimated with HyperLogLog, the standard error is about 1.6%%.)\n");
+	printf("\n");
+}
+
+/*
+ * export_xlog_distinct()
+ *
+ * exports the estimates per cycle and per relation.
+ */
+void
+export_xlog_distinct(void)
+{
+	char redo[32];
+	char relation[NAMEDATALEN * 3 + 3];
+	const char *cycle_labels[] = { "redo", redo, NULL };
+	const char *rel_labels[] = { "relation", relation, NULL };
+	int i;
+
+	distinct_finish();
+
+	for (i = 0 ; i < ncycles ; i++)
+	{
+		snprintf(redo, sizeof(redo), "%X/%08X",
+			 cycles[i].start.xlogid, cycles[i].start.xrecoff);
+		export_gauge("xlogdump_cycle_distinct_blocks",
+			     "Estimated number of distinct blocks touched in the checkpoint cycle.",
+			     cycle_labels, cycles[i].blocks);
+	}
+
+	for (i = 0 ; i < nrels ; i++)
+	{
+		distinct_rel_name(rels[i], relation, sizeof(relation));
+		export_gauge("xlogdump_relation_distinct_blocks",
+			     "Estimated number of distinct blocks touched in the relation.",
+			     rel_labels, rels[i]->blocks);
+	}
+
+	for (i = 0 ; i < nrels ; i++)
+	{
+		distinct_rel_name(rels[i], relation, sizeof(relation));
+		export_gauge("xlogdump_relation_max_cycle_distinct_blocks",
+			     "Largest estimated number of distinct blocks touched in the relation in a checkpoint cycle.",
+			     rel_labels, rels[i]->max_cycle);
+	}
+}
+
+void
+save_xlog_distinct(FILE *fp)
+{
+	long pos;
+	int i;
+
+	pos = sidecar_begin_section(fp, SIDECAR_DISTINCT);
+	sidecar_write_u32(fp, (uint32) nrels);
+	for (i = 0 ; i < nrels ; i++)
+	{
+		sidecar_write(fp, &rels[i]->node, sizeof(RelFileNode));
+		sidecar_write_hll(fp, &rels[i]->total);
+	}
+	sidecar_end_section(fp, pos);
+}
+
+void
+load_xlog_distinct(FILE *fp)
+{
+	uint32 n = sidecar_read_u32(fp);
+	uint32 i;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		RelFileNode node;
+
+		sidecar_read(fp, &node, sizeof(RelFileNode));
+		sidecar_read_hll(fp, &distinct_get_rel(&node)->total);
+	}
+}
+
+void
+reset_xlog_distinct(void)
+{
+	int i;
+
+	for (i = 0 ; i < nrels ; i++)
+		free(rels[i]);
+	nrels = 0;
+	memset(rel_hash, 0, sizeof(rel_hash));
+
+	ncycles = 0;
+	cycle_started = false;
+	finished = false;
+	hll_reset(&cycle_total);
+	cycle_nrels = 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * xlogdump_distinct.h
+ *
+ * a collection of functions to estimate the number of distinct blocks
+ * touched per relation and per checkpoint cycle.
+ */
+#ifndef __XLOGDUMP_DISTINCT_H__
+#define __XLOGDUMP_DISTINCT_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+#include "xlogdump_decode.h"
+
+void distinct_add_block(const RelFileNode *, BlockNumber);
+void distinct_add_record(DecodedRecord *);
+void print_xlog_distinct(void);
+void export_xlog_distinct(void);
+void save_xlog_distinct(FILE *);
+void load_xlog_distinct(FILE *);
+void reset_xlog_distinct(void);
+
+#endif /* __XLOGDUMP_DISTINCT_H__ */
@@ -0,0 +1,326 @@
+/*
+ * xlogdump_export.c
+ *
+ * a collection of functions to write the statistics in machine-readable
+ * formats, JSON and the Prometheus text format.
+ *
+ * A statistic is a sample of a metric family, identified by its name
+ * and labels. The labels are given as a NULL-terminated array of name
+ * and value pairs. The samples of a family must be exported one after
+ * another, because both formats group them by the family.
+ *
+ * When an output file is given, the statistics are written to a
+ * temporary file, which is renamed at the end. So a reader, such as
+ * the textfile collector of node_exporter, never sees a partial file.
+ */
+#include "xlogdump_export.h"
+
+#include <unistd.h>
+
+/* upper bounds of the Prometheus histogram buckets: 2^5-1 .. 2^16-1 */
+#define EXPORT_HIST_MIN_BITS	5
+#define EXPORT_HIST_MAX_BITS	16
+
+static int format = STATS_FORMAT_TEXT;
+static FILE *out = NULL;
+static char *out_file = NULL;
+static char *tmp_file = NULL;
+
+static char cur_family[128] = "";
+static bool first_family = true;
+
+static void print_escaped(const char *, bool);
+static void begin_sample(const char *, const char *, const char *);
+static void print_prom_labels(const char **, const char *, const char *);
+static void print_json_labels(const char **);
+
+int
+export_parse_format(const char *str)
+{
+	if (strcmp(str, "text") == 0)
+		return STATS_FORMAT_TEXT;
+	if (strcmp(str, "json") == 0)
+		return STATS_FORMAT_JSON;
+	if (strcmp(str, "prom") == 0)
+		return STATS_FORMAT_PROM;
+
+	return -1;
+}
+
+/*
+ * export_open()
+ *
+ * starts writing the statistics to the file, or to stdout if NULL.
+ */
+void
+export_open(int fmt, const char *file)
+{
+	format = fmt;
+
+	if (file == NULL)
+	{
+		out = stdout;
+	}
+	else
+	{
+		size_t len = strlen(file) + 5;
+
+		out_file = strdup(file);
+		tmp_file = (char *) malloc(len);
+		snprintf(tmp_file, len, "%s.tmp", file);
+
+		if ((out = fopen(tmp_file, "w")) == NULL)
+		{
+			fprintf(stderr, "ERROR: Can't write %s.\n", tmp_file);
+			exit(1);
+		}
+	}
+
+	cur_family[0] = '\0';
+	first_family = true;
+
+	if (format == STATS_FORMAT_JSON)
+		fprintf(out, "{");
+}
+
+/*
+ * export_close()
+ *
+ * finishes the statistics, and moves the temporary file into place.
+ */
+void
+export_close(void)
+{
+	if (format == STATS_FORMAT_JSON)
+	{
+		if (!first_family)
+			fprintf(out, "\n  ]");
+		fprintf(out, "\n}\n");
+	}
+
+	if (out_file == NULL)
+	{
+		fflush(out);
+		return;
+	}
+
+	if (fflush(out) != 0 || fsync(fileno(out)) != 0 || fclose(out) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't write %s.\n", tmp_file);
+		exit(1);
+	}
+
+	if (rename(tmp_file, out_file) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't rename %s to %s.\n", tmp_file, out_file);
+		exit(1);
+	}
+}
+
+/*
+ * print_escaped()
+ *
+ * prints a string in double quotes. The Prometheus format escapes only
+ * backslashes, double quotes and newlines.
+ */
+static void
+print_escaped(const char *str, bool json)
+{
+	const unsigned char *p;
+
+	fputc('"', out);
+	for (p = (const unsigned char *) str ; *p ; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			fprintf(out, "\\%c", *p);
+		else if (*p == '\n')
+			fprintf(out, "\\n");
+		else if (json && *p < 0x20)
+			fprintf(out, "\\u%04x", *p);
+		else
+			fputc(*p, out);
+	}
+	fputc('"', out);
+}
+
+/*
+ * begin_sample()
+ *
+ * starts a new family if the name differs from the previous sample.
+ */
+static void
+begin_sample(const char *name, const char *help, const char *type)
+{
+	bool new_family = (strcmp(cur_family, name) != 0);
+
+	if (new_family)
+		snprintf(cur_family, sizeof(cur_family), "%s", name);
+
+	if (format == STATS_FORMAT_PROM)
+	{
+		if (new_family)
+		{
+			fprintf(out, "# HELP %s %s\n", name, help);
+			fprintf(out, "# TYPE %s %s\n", name, type);
+		}
+		return;
+	}
+
+	if (new_family)
+	{
+		fprintf(out, "%s\n  \"%s\": [\n    ", first_family ? "" : "\n  ],", name);
+		first_family = false;
+	}
+	else
+		fprintf(out, ",\n    ");
+}
+
+static void
+print_prom_labels(const char **labels, const char *extra_name, const char *extra_value)
+{
+	int i;
+	bool first = true;
+
+	if ((labels == NULL || labels[0] == NULL) && extra_name == NULL)
+		return;
+
+	fputc('{', out);
+	for (i = 0 ; labels != NULL && labels[i] != NULL ; i += 2)
+	{
+		fprintf(out, "%s%s=", first ? "" : ",", labels[i]);
+		print_escaped(labels[i + 1], false);
+		first = false;
+	}
+	if (extra_name != NULL)
+	{
+		fprintf(out, "%s%s=", first ? "" : ",", extra_name);
+		print_escaped(extra_value, false);
+	}
+	fputc('}', out);
+}
+
+static void
+print_json_labels(const char **labels)
+{
+	int i;
+
+	for (i = 0 ; labels != NULL && labels[i] != NULL ; i += 2)
+	{
+		print_escaped(labels[i], true);
+		fprintf(out, ": ");
+		print_escaped(labels[i + 1], true);
+		fprintf(out, ", ");
+	}
+}
+
+void
+export_counter(const char *name, const char *help, const char **labels, uint64 value)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), UINT64_FORMAT, value);
+	begin_sample(name, help, "counter");
+
+	if (format == STATS_FORMAT_PROM)
+	{
+		fprintf(out, "%s", name);
+		print_prom_labels(labels, NULL, NULL);
+		fprintf(out, " %s\n", buf);
+	}
+	else
+	{
+		fprintf(out, "{");
+		print_json_labels(labels);
+		fprintf(out, "\"value\": %s}", buf);
+	}
+}
+
+void
+export_gauge(const char *name, const char *help, const char **labels, double value)
+{
+	begin_sample(name, help, "gauge");
+
+	if (format == STATS_FORMAT_PROM)
+	{
+		fprintf(out, "%s", name);
+		print_prom_labels(labels, NULL, NULL);
+		fprintf(out, " %.15g\n", value);
+	}
+	else
+	{
+		fprintf(out, "{");
+		print_json_labels(labels);
+		fprintf(out, "\"value\": %.15g}", value);
+	}
+}
+
+/*
+ * export_hist()
+ *
+ * exports a histogram. JSON has the percentiles and all the non-empty
+ * buckets. Prometheus has cumulative buckets at 2^n-1, which fall on
+ * the bucket boundaries of hist_t, so the counts are exact.
+ */
+void
+export_hist(const char *name, const char *help, const char **labels, const hist_t *h)
+{
+	char count[32], sum[32];
+	bool first = true;
+	int i;
+
+	snprintf(count, sizeof(count), UINT64_FORMAT, h->count);
+	snprintf(sum, sizeof(sum), UINT64_FORMAT, h->sum);
+	begin_sample(name, help, "histogram");
+
+	if (format == STATS_FORMAT_PROM)
+	{
+		uint64 seen = 0;
+		int b = 0;
+
+		for (i = EXPORT_HIST_MIN_BITS ; i <= EXPORT_HIST_MAX_BITS ; i++)
+		{
+			uint32 le = ((uint32) 1 << i) - 1;
+			char lebuf[16], buf[32];
+
+			while (b < HIST_BUCKETS && hist_upper_bound(b) <= le)
+				seen += h->buckets[b++];
+
+			snprintf(lebuf, sizeof(lebuf), "%u", le);
+			snprintf(buf, sizeof(buf), UINT64_FORMAT, seen);
+			fprintf(out, "%s_bucket", name);
+			print_prom_labels(labels, "le", lebuf);
+			fprintf(out, " %s\n", buf);
+		}
+		fprintf(out, "%s_bucket", name);
+		print_prom_labels(labels, "le", "+Inf");
+		fprintf(out, " %s\n", count);
+
+		fprintf(out, "%s_sum", name);
+		print_prom_labels(labels, NULL, NULL);
+		fprintf(out, " %s\n", sum);
+		fprintf(out, "%s_count", name);
+		print_prom_labels(labels, NULL, NULL);
+		fprintf(out, " %s\n", count);
+		return;
+	}
+
+	fprintf(out, "{");
+	print_json_labels(labels);
+	fprintf(out, "\"count\": %s, \"sum\": %s, \"max\": %u, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"buckets\": [",
+		count, sum, h->max,
+		hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99));
+
+	for (i = 0 ; i < HIST_BUCKETS ; i++)
+	{
+		char buf[32];
+
+		if (h->buckets[i] == 0)
+			continue;
+
+		snprintf(buf, sizeof(buf), UINT64_FORMAT, h->buckets[i]);
+		fprintf(out, "%s{\"le\": %u, \"count\": %s}",
+			first ? "" : ", ", hist_upper_bound(i), buf);
+		first = false;
+	}
+	fprintf(out, "]}");
+}
@@ -0,0 +1,25 @@
+/*
+ * xlogdump_export.h
+ *
+ * a collection of functions to write the statistics in machine-readable
+ * formats, JSON and the Prometheus text format.
+ */
+#ifndef __XLOGDUMP_EXPORT_H__
+#define __XLOGDUMP_EXPORT_H__
+
+#include "postgres.h"
+
+#include "xlogdump_hist.h"
+
+#define STATS_FORMAT_TEXT	0
+#define STATS_FORMAT_JSON	1
+#define STATS_FORMAT_PROM	2
+
+int export_parse_format(const char *);
+void export_open(int, const char *);
+void export_counter(const char *, const char *, const char **, uint64);
+void export_gauge(const char *, const char *, const char **, double);
+void export_hist(const char *, const char *, const char **, const hist_t *);
+void export_close(void);
+
+#endif /* __XLOGDUMP_EXPORT_H__ */
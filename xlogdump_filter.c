@@ -0,0 +1,730 @@
+/*
+ * xlogdump_filter.c
+ *
+ * a collection of functions to compile a filter expression into a flat
+ * postfix program, and to evaluate it on the xlog records.
+ *
+ * An expression is made of predicates combined with "and", "or", "not"
+ * and parentheses, like:
+ *
+ *   rmid in (Heap, Btree) and xid = 1000..2000
+ *   lsn >= 0/2000000 and not rel = 1663/12870/16384
+ *   time = "2012-04-01 12:00:00+09".."2012-04-01 13:00:00+09"
+ *
+ * A predicate tests a field against a value, a range "lo..hi" or a set
+ * of them in parentheses, with "=" (or "in"), "!=", "<", "<=", ">" or
+ * ">=". The fields are rmid, xid, lsn, info (without XLR_INFO_MASK
+ * bits), spc, db and rel, which takes a relfilenode number or a
+ * spc/db/rel triple, and time, which takes a quoted time as --find-time
+ * does. Only the commit, abort and checkpoint records have a time.
+ *
+ * The program is evaluated in three-valued logic, first with the fields
+ * in the record header only. Only if the result is still unknown, the
+ * relation and the time are taken from the record data and the program
+ * is evaluated again, so the rejected records are not decoded at all.
+ */
+#include "xlogdump_filter.h"
+
+#include <ctype.h>
+
+#include "access/xlog_internal.h"
+
+#include "xlogdump.h"
+#include "xlogdump_rmgr.h"
+
+#define FILTER_FALSE	0
+#define FILTER_TRUE	1
+#define FILTER_UNKNOWN	2
+
+#define FILTER_MAX_VALUE	(~((uint64) 0))
+
+enum {
+	OP_PRED,
+	OP_AND,
+	OP_OR,
+	OP_NOT
+};
+
+enum {
+	FIELD_RMID,
+	FIELD_XID,
+	FIELD_LSN,
+	FIELD_INFO,
+	FIELD_SPC,
+	FIELD_DB,
+	FIELD_REL,
+	FIELD_TIME,
+	NUM_FIELDS
+};
+
+static const char * const field_names[NUM_FIELDS] = {
+	"rmid", "xid", "lsn", "info", "spc", "db", "rel", "time"
+};
+
+typedef struct filter_range_t {
+	uint64 lo;
+	uint64 hi;
+	bool has_node;			/* a spc/db/rel triple of rel */
+	RelFileNode node;
+} filter_range_t;
+
+typedef struct filter_op_t {
+	int op;
+	int field;			/* the rest is for OP_PRED */
+	int first;			/* index of the first range */
+	int nranges;
+} filter_op_t;
+
+static filter_op_t *ops = NULL;
+static int nops = 0;
+static int maxops = 0;
+
+static filter_range_t *ranges = NULL;
+static int nranges = 0;
+static int maxranges = 0;
+
+/* DECODE_* of the fields in the record data the program tests */
+static int decode_needed = 0;
+
+/* programs up to this length are evaluated on a stack in the frame */
+#define EVAL_STACK_DEPTH	64
+
+/* the expression being compiled */
+static const char *expr = NULL;
+static const char *pos = NULL;
+static bool failed = false;
+
+static void parse_error(const char *);
+static void skip_spaces(void);
+static bool accept(const char *);
+static bool read_token(char *, size_t);
+static void emit(int, int, int, int);
+static void add_range(uint64, uint64, const RelFileNode *);
+static bool parse_value(int, char *, uint64 *, RelFileNode *);
+static void parse_item(int);
+static void parse_predicate(void);
+static void parse_primary(void);
+static void parse_not(void);
+static void parse_and(void);
+static void parse_or(void);
+static int eval_program(int (*)(const filter_op_t *, const void *), const void *);
+static int test_record(const filter_op_t *, const void *);
+static int test_zone(const filter_op_t *, const void *);
+
+static void
+parse_error(const char *msg)
+{
+	if (failed)
+		return;
+
+	fprintf(stderr, "ERROR: %s at \"%s\" in filter \"%s\"\n", msg, pos, expr);
+	failed = true;
+}
+
+static void
+skip_spaces(void)
+{
+	while (isspace((unsigned char) *pos))
+		pos++;
+}
+
+/*
+ * accept()
+ *
+ * consumes the keyword or the symbol if it comes next. A keyword
+ * must not be followed by a letter.
+ */
+static bool
+accept(const char *tok)
+{
+	size_t len = strlen(tok);
+
+	skip_spaces();
+	if (pg_strncasecmp(pos, tok, len) != 0)
+		return false;
+	if (isalpha((unsigned char) tok[0]) && isalnum((unsigned char) pos[len]))
+		return false;
+
+	pos += len;
+	return true;
+}
+
+/*
+ * read_token()
+ *
+ * reads a word, a number or a LSN-like value, which stops at "..", or
+ * a string in double or single quotes, without them.
+ */
+static bool
+read_token(char *buf, size_t buflen)
+{
+	size_t len = 0;
+
+	skip_spaces();
+	if (*pos == '"' || *pos == '\'')
+	{
+		const char *end = strchr(pos + 1, *pos);
+
+		if (end == NULL || end == pos + 1 || end - pos - 1 >= buflen)
+			return false;
+
+		memcpy(buf, pos + 1, end - pos - 1);
+		buf[end - pos - 1] = '\0';
+		pos = end + 1;
+		return true;
+	}
+
+	while (isalnum((unsigned char) pos[len]) || pos[len] == '/' || pos[len] == '_')
+		len++;
+	if (len == 0 || len >= buflen)
+		return false;
+
+	memcpy(buf, pos, len);
+	buf[len] = '\0';
+	pos += len;
+	return true;
+}
+
+static void
+emit(int op, int field, int first, int n)
+{
+	if (nops == maxops)
+	{
+		maxops = maxops ? maxops * 2 : 16;
+		ops = (filter_op_t *) realloc(ops, sizeof(filter_op_t) * maxops);
+		if (ops == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the filter.\n");
+			exit(1);
+		}
+	}
+
+	ops[nops].op = op;
+	ops[nops].field = field;
+	ops[nops].first = first;
+	ops[nops].nranges = n;
+	nops++;
+}
+
+static void
+add_range(uint64 lo, uint64 hi, const RelFileNode *node)
+{
+	if (nranges == maxranges)
+	{
+		maxranges = maxranges ? maxranges * 2 : 16;
+		ranges = (filter_range_t *) realloc(ranges, sizeof(filter_range_t) * maxranges);
+		if (ranges == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the filter.\n");
+			exit(1);
+		}
+	}
+
+	ranges[nranges].lo = lo;
+	ranges[nranges].hi = hi;
+	ranges[nranges].has_node = (node != NULL);
+	if (node != NULL)
+		ranges[nranges].node = *node;
+	nranges++;
+}
+
+/*
+ * parse_value()
+ *
+ * converts a token into a value of the field. A LSN is taken as its
+ * key, as the geometry is not known yet, a time as microseconds since
+ * the Unix epoch, and a rmid may be given by its name. Returns true with `node' set if a rel is given as a spc/db/rel
+ * triple.
+ */
+static bool
+parse_value(int field, char *tok, uint64 *val, RelFileNode *node)
+{
+	char *end;
+	char dummy;
+	int i;
+
+	if (field == FIELD_LSN)
+	{
+		XLogRecPtr lsn;
+
+		if (sscanf(tok, "%X/%X%c", &lsn.xlogid, &lsn.xrecoff, &dummy) != 2)
+			parse_error("invalid LSN");
+		*val = XLogRecPtrToKey(lsn);
+		return false;
+	}
+
+	if (field == FIELD_TIME)
+	{
+		int64 t;
+
+		if (!parse_time(tok, &t) || t < 0)
+			parse_error("invalid time");
+		*val = (uint64) t;
+		return false;
+	}
+
+	if (field == FIELD_REL && strchr(tok, '/') != NULL)
+	{
+		if (sscanf(tok, "%u/%u/%u%c", &node->spcNode, &node->dbNode,
+			   &node->relNode, &dummy) != 3)
+			parse_error("invalid relfilenode");
+		return true;
+	}
+
+	if (field == FIELD_RMID)
+	{
+		for (i = 0 ; i < RM_MAX_ID + 1 ; i++)
+		{
+			if (pg_strcasecmp(tok, RM_table[i].name) == 0)
+			{
+				*val = i;
+				return false;
+			}
+		}
+	}
+
+	*val = strtoull(tok, &end, 0);
+	if (*end != '\0')
+		parse_error("invalid value");
+	return false;
+}
+
+/*
+ * parse_item()
+ *
+ * parses a value or a range "lo..hi" into a range.
+ */
+static void
+parse_item(int field)
+{
+	char tok[64];
+	uint64 lo, hi;
+	RelFileNode node;
+
+	if (!read_token(tok, sizeof(tok)))
+	{
+		parse_error("value expected");
+		return;
+	}
+	if (parse_value(field, tok, &lo, &node))
+	{
+		add_range(0, 0, &node);
+		return;
+	}
+
+	hi = lo;
+	if (accept(".."))
+	{
+		if (!read_token(tok, sizeof(tok)) || parse_value(field, tok, &hi, &node))
+		{
+			parse_error("invalid range");
+			return;
+		}
+		if (hi < lo)
+			parse_error("empty range");
+	}
+
+	add_range(lo, hi, NULL);
+}
+
+static void
+parse_predicate(void)
+{
+	char tok[64];
+	int field;
+	int first = nranges;
+	bool negate = false;
+	RelFileNode node;
+
+	if (!read_token(tok, sizeof(tok)))
+	{
+		parse_error("field expected");
+		return;
+	}
+	for (field = 0 ; field < NUM_FIELDS ; field++)
+	{
+		if (pg_strcasecmp(tok, field_names[field]) == 0)
+			break;
+	}
+	if (field == NUM_FIELDS)
+	{
+		parse_error("unknown field");
+		return;
+	}
+	if (field == FIELD_TIME)
+		decode_needed |= DECODE_TIME;
+	else if (field == FIELD_SPC || field == FIELD_DB || field == FIELD_REL)
+		decode_needed |= DECODE_RELATION;
+
+	if (accept("<=") || accept(">=") || accept("<") || accept(">"))
+	{
+		char op = pos[-1] == '=' ? pos[-2] : pos[-1];
+		bool inclusive = (pos[-1] == '=');
+		uint64 val;
+
+		if (!read_token(tok, sizeof(tok)) || parse_value(field, tok, &val, &node))
+		{
+			parse_error("invalid value to compare");
+			return;
+		}
+
+		if (op == '<' && inclusive)
+			add_range(0, val, NULL);
+		else if (op == '<' && val > 0)
+			add_range(0, val - 1, NULL);
+		else if (op == '>' && inclusive)
+			add_range(val, FILTER_MAX_VALUE, NULL);
+		else if (op == '>' && val < FILTER_MAX_VALUE)
+			add_range(val + 1, FILTER_MAX_VALUE, NULL);
+
+		emit(OP_PRED, field, first, nranges - first);
+		return;
+	}
+
+	if (accept("!="))
+		negate = true;
+	else if (!accept("=") && !accept("in"))
+	{
+		parse_error("operator expected");
+		return;
+	}
+
+	if (accept("("))
+	{
+		do
+		{
+			parse_item(field);
+		} while (!failed && accept(","));
+
+		if (!accept(")"))
+			parse_error("\")\" expected");
+	}
+	else
+		parse_item(field);
+
+	emit(OP_PRED, field, first, nranges - first);
+	if (negate)
+		emit(OP_NOT, 0, 0, 0);
+}
+
+static void
+parse_primary(void)
+{
+	if (accept("("))
+	{
+		parse_or();
+		if (!accept(")"))
+			parse_error("\")\" expected");
+	}
+	else
+		parse_predicate();
+}
+
+static void
+parse_not(void)
+{
+	if (accept("not"))
+	{
+		parse_not();
+		emit(OP_NOT, 0, 0, 0);
+	}
+	else
+		parse_primary();
+}
+
+static void
+parse_and(void)
+{
+	parse_not();
+	while (!failed && accept("and"))
+	{
+		parse_not();
+		emit(OP_AND, 0, 0, 0);
+	}
+}
+
+static void
+parse_or(void)
+{
+	parse_and();
+	while (!failed && accept("or"))
+	{
+		parse_and();
+		emit(OP_OR, 0, 0, 0);
+	}
+}
+
+/*
+ * filter_add()
+ *
+ * compiles the expression, and adds it to the program with "and".
+ * Returns false if the expression is invalid, leaving the program as
+ * it was.
+ */
+bool
+filter_add(const char *str)
+{
+	int saved_nops = nops;
+	int saved_nranges = nranges;
+	int saved_decode_needed = decode_needed;
+	bool first = (nops == 0);
+
+	expr = pos = str;
+	failed = false;
+
+	parse_or();
+	skip_spaces();
+	if (*pos != '\0')
+		parse_error("end of filter expected");
+	if (failed)
+	{
+		nops = saved_nops;
+		nranges = saved_nranges;
+		decode_needed = saved_decode_needed;
+		return false;
+	}
+
+	if (!first)
+		emit(OP_AND, 0, 0, 0);
+
+	return true;
+}
+
+bool
+filter_enabled(void)
+{
+	return (nops > 0);
+}
+
+/*
+ * eval_program()
+ *
+ * evaluates the program against a record or a zone. It keeps no state
+ * between calls, so the records can be tested from several threads.
+ */
+static int
+eval_program(int (*test)(const filter_op_t *, const void *), const void *arg)
+{
+	char local[EVAL_STACK_DEPTH];
+	char *stack = local;
+	int sp = 0;
+	int result;
+	int i;
+
+	if (nops > EVAL_STACK_DEPTH)
+		stack = (char *) malloc(nops);
+	stack[0] = FILTER_TRUE;		/* of an empty program */
+
+	for (i = 0 ; i < nops ; i++)
+	{
+		const filter_op_t *op = &ops[i];
+		int a, b;
+
+		switch (op->op)
+		{
+		case OP_PRED:
+			stack[sp++] = test(op, arg);
+			break;
+		case OP_NOT:
+			a = stack[sp - 1];
+			stack[sp - 1] = (a == FILTER_UNKNOWN) ? a : !a;
+			break;
+		case OP_AND:
+			b = stack[--sp];
+			a = stack[sp - 1];
+			if (a == FILTER_FALSE || b == FILTER_FALSE)
+				stack[sp - 1] = FILTER_FALSE;
+			else if (a == FILTER_TRUE && b == FILTER_TRUE)
+				stack[sp - 1] = FILTER_TRUE;
+			else
+				stack[sp - 1] = FILTER_UNKNOWN;
+			break;
+		case OP_OR:
+			b = stack[--sp];
+			a = stack[sp - 1];
+			if (a == FILTER_TRUE || b == FILTER_TRUE)
+				stack[sp - 1] = FILTER_TRUE;
+			else if (a == FILTER_FALSE && b == FILTER_FALSE)
+				stack[sp - 1] = FILTER_FALSE;
+			else
+				stack[sp - 1] = FILTER_UNKNOWN;
+			break;
+		}
+	}
+
+	result = stack[0];
+	if (stack != local)
+		free(stack);
+	return result;
+}
+
+static int
+test_record(const filter_op_t *op, const void *arg)
+{
+	const DecodedRecord *dec = (const DecodedRecord *) arg;
+	uint64 val;
+	int i;
+
+	switch (op->field)
+	{
+	case FIELD_RMID:
+		val = dec->record->xl_rmid;
+		break;
+	case FIELD_XID:
+		val = dec->record->xl_xid;
+		break;
+	case FIELD_LSN:
+		val = XLogRecPtrToKey(dec->lsn);
+		break;
+	case FIELD_INFO:
+		val = dec->info;
+		break;
+	case FIELD_TIME:
+		if (!(dec->decoded & DECODE_TIME))
+			return FILTER_UNKNOWN;
+		if (!dec->has_time)
+			return FILTER_FALSE;
+		val = (uint64) dec->usec;
+		break;
+	default:
+		if (!(dec->decoded & DECODE_RELATION))
+			return FILTER_UNKNOWN;
+		if (!dec->has_node)
+			return FILTER_FALSE;
+		if (op->field == FIELD_SPC)
+			val = dec->node.spcNode;
+		else if (op->field == FIELD_DB)
+			val = dec->node.dbNode;
+		else
+			val = dec->node.relNode;
+		break;
+	}
+
+	for (i = op->first ; i < op->first + op->nranges ; i++)
+	{
+		const filter_range_t *r = &ranges[i];
+
+		if (r->has_node)
+		{
+			if (RelFileNodeEquals(r->node, dec->node))
+				return FILTER_TRUE;
+		}
+		else if (r->lo <= val && val <= r->hi)
+			return FILTER_TRUE;
+	}
+
+	return FILTER_FALSE;
+}
+
+/*
+ * filter_match()
+ *
+ * returns true if the record is to be shown. The program is evaluated
+ * on the header first, and the relation and the time are decoded only
+ * if they are still needed. They are not looked at for a partial record.
+ */
+bool
+filter_match(DecodedRecord *dec)
+{
+	int result;
+
+	if (nops == 0)
+		return true;
+
+	result = eval_program(test_record, dec);
+	if (result != FILTER_UNKNOWN)
+		return (result == FILTER_TRUE);
+	if (dec->partial)
+		return true;
+
+	decode_fields(dec, decode_needed);
+
+	return (eval_program(test_record, dec) == FILTER_TRUE);
+}
+
+/*
+ * test_zone()
+ *
+ * returns FILTER_FALSE if no record in the zone can match the
+ * predicate, or FILTER_UNKNOWN.
+ */
+static int
+test_zone(const filter_op_t *op, const void *arg)
+{
+	const zonemap_t *zone = (const zonemap_t *) arg;
+	int i;
+
+	for (i = op->first ; i < op->first + op->nranges ; i++)
+	{
+		const filter_range_t *r = &ranges[i];
+		uint64 v;
+
+		switch (op->field)
+		{
+		case FIELD_RMID:
+			if (r->hi >= 32)
+				return FILTER_UNKNOWN;
+			for (v = r->lo ; v <= r->hi ; v++)
+			{
+				if (zonemap_may_contain_rmid(zone, (int) v))
+					return FILTER_UNKNOWN;
+			}
+			break;
+
+		case FIELD_XID:
+			/* the zone map has only the normal xids */
+			if (r->lo < FirstNormalTransactionId)
+				return FILTER_UNKNOWN;
+			if (r->lo == r->hi)
+			{
+				if (zonemap_may_contain_xid(zone, (TransactionId) r->lo))
+					return FILTER_UNKNOWN;
+			}
+			else if (zone->min_xid != InvalidTransactionId &&
+				 (zone->min_xid > zone->max_xid ||
+				  (r->lo <= zone->max_xid && zone->min_xid <= r->hi)))
+				return FILTER_UNKNOWN;
+			break;
+
+		case FIELD_LSN:
+			if (r->lo <= XLogRecPtrToKey(zone->last_lsn) &&
+			    XLogRecPtrToKey(zone->first_lsn) <= r->hi)
+				return FILTER_UNKNOWN;
+			break;
+
+		case FIELD_REL:
+			if (!r->has_node || zonemap_may_contain_rel(zone, &r->node))
+				return FILTER_UNKNOWN;
+			break;
+
+		case FIELD_TIME:
+			/* the zone map has the times in seconds */
+			if (zonemap_may_contain_time(zone, (pg_time_t) (r->lo / USECS_PER_SEC),
+						     (pg_time_t) (r->hi / USECS_PER_SEC)))
+				return FILTER_UNKNOWN;
+			break;
+
+		default:
+			return FILTER_UNKNOWN;
+		}
+	}
+
+	return FILTER_FALSE;
+}
+
+/*
+ * filter_may_match_zone()
+ *
+ * returns false if the zone map tells that the segment has no record
+ * to match the filter.
+ */
+bool
+filter_may_match_zone(const zonemap_t *zone)
+{
+	if (nops == 0)
+		return true;
+	if (zone->nrecords == 0)
+		return false;
+
+	return (eval_program(test_zone, zone) != FILTER_FALSE);
+}
@@ -0,0 +1,21 @@
+/*
+ * xlogdump_filter.h
+ *
+ * a collection of functions to compile a filter expression, and to
+ * evaluate it on the xlog records and the zone maps.
+ */
+#ifndef __XLOGDUMP_FILTER_H__
+#define __XLOGDUMP_FILTER_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+
+#include "xlogdump_decode.h"
+#include "xlogdump_zonemap.h"
+
+bool filter_add(const char *);
+bool filter_enabled(void);
+bool filter_match(DecodedRecord *);
+bool filter_may_match_zone(const zonemap_t *);
+
+#endif /* __XLOGDUMP_FILTER_H__ */
@@ -0,0 +1,153 @@
+/*
+ * xlogdump_follow.c
+ *
+ * a collection of functions to find the segment being written in a
+ * pg_xlog directory, and to wait for it to be written.
+ *
+ * The directory is watched with inotify from the start, so a write
+ * made while the records are being printed is never missed, and the
+ * process sleeps until the segment, or the next one, is written.
+ *
+ * The segment being written is the one modified last. pg_xlog also
+ * has the segments recycled ahead under the names to come, so the one
+ * with the greatest name may not have been written at all.
+ */
+#include "postgres.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "xlogdump_follow.h"
+
+static char follow_dir[MAXPGPATH];
+static int inotify_fd = -1;
+
+/*
+ * follow_start()
+ *
+ * starts watching the directory, and finds the segment being written
+ * in it.
+ */
+void
+follow_start(const char *dir, char *path, size_t len)
+{
+	DIR *d;
+	struct dirent *de;
+	time_t newest = 0;
+	char newest_name[MAXPGPATH] = "";
+
+#ifdef __linux__
+	inotify_fd = inotify_init();
+	if (inotify_fd < 0 ||
+	    inotify_add_watch(inotify_fd, dir,
+			      IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0)
+	{
+		fprintf(stderr, "ERROR: Can't watch the directory %s: %s\n",
+			dir, strerror(errno));
+		exit(1);
+	}
+#else
+	fprintf(stderr, "ERROR: option \"follow\" needs inotify, which is not on this platform.\n");
+	exit(1);
+#endif
+	strlcpy(follow_dir, dir, sizeof(follow_dir));
+
+	if ((d = opendir(dir)) == NULL)
+	{
+		fprintf(stderr, "ERROR: Can't open the directory %s.\n", dir);
+		exit(1);
+	}
+	while ((de = readdir(d)) != NULL)
+	{
+		char file[MAXPGPATH];
+		struct stat st;
+
+		if (strlen(de->d_name) != 24 ||
+		    strspn(de->d_name, "0123456789ABCDEF") != 24)
+			continue;
+		snprintf(file, sizeof(file), "%s/%s", dir, de->d_name);
+		if (stat(file, &st) != 0)
+			continue;
+		if (st.st_mtime > newest ||
+		    (st.st_mtime == newest && strcmp(de->d_name, newest_name) > 0))
+		{
+			newest = st.st_mtime;
+			strlcpy(newest_name, de->d_name, sizeof(newest_name));
+		}
+	}
+	closedir(d);
+
+	if (newest_name[0] == '\0')
+	{
+		fprintf(stderr, "ERROR: No segment in the directory %s.\n", dir);
+		exit(1);
+	}
+	snprintf(path, len, "%s/%s", dir, newest_name);
+}
+
+/*
+ * follow_segment_path()
+ *
+ * makes the path of a segment in the directory.
+ */
+void
+follow_segment_path(char *path, size_t len, TimeLineID tli, uint32 id, uint32 seg)
+{
+	snprintf(path, len, "%s/%08X%08X%08X", follow_dir, tli, id, seg);
+}
+
+/*
+ * follow_wait()
+ *
+ * sleeps until the file in the directory is written, created or moved
+ * into place.
+ */
+void
+follow_wait(const char *path)
+{
+#ifdef __linux__
+	const char *name = strrchr(path, '/');
+	union {
+		struct inotify_event ev;	/* for the alignment */
+		char	buf[4096];
+	} u;
+	char *buf = u.buf;
+
+	name = name ? name + 1 : path;
+
+	for (;;)
+	{
+		ssize_t n = read(inotify_fd, buf, sizeof(u.buf));
+		char *p;
+		bool found = false;
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			fprintf(stderr, "ERROR: Can't watch the directory %s: %s\n",
+				follow_dir, strerror(errno));
+			exit(1);
+		}
+
+		/* all the events queued are taken at once */
+		for (p = buf; p < buf + n; )
+		{
+			struct inotify_event *ev = (struct inotify_event *) p;
+
+			if ((ev->mask & IN_Q_OVERFLOW) ||
+			    (ev->len > 0 && strcmp(ev->name, name) == 0))
+				found = true;
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+		if (found)
+			return;
+	}
+#endif
+}
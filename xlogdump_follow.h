@@ -0,0 +1,16 @@
+/*
+ * xlogdump_follow.h
+ *
+ * a collection of functions to find the segment being written in a
+ * pg_xlog directory, and to wait for it to be written.
+ */
+#ifndef __XLOGDUMP_FOLLOW_H__
+#define __XLOGDUMP_FOLLOW_H__
+
+#include "postgres.h"
+
+void follow_start(const char *, char *, size_t);
+void follow_segment_path(char *, size_t, TimeLineID, uint32, uint32);
+void follow_wait(const char *);
+
+#endif /* __XLOGDUMP_FOLLOW_H__ */
@@ -0,0 +1,45 @@
+/*
+ * xlogdump_hash.c
+ *
+ * hash functions of the relations and the blocks, shared by the hash
+ * tables and the sketches.
+ *
+ * They are FNV-1a over the 32-bit words of the RelFileNode and the
+ * block number. The bloom filters of the zone maps are saved in files,
+ * so hash_relfilenode() must not be changed.
+ */
+#include "xlogdump_hash.h"
+
+#define FNV_OFFSET_BASIS	2166136261u
+#define FNV_PRIME		16777619u
+
+/*
+ * hash_relfilenode()
+ *
+ * returns the FNV-1a hash of the relation.
+ */
+uint32
+hash_relfilenode(const RelFileNode *node)
+{
+	uint32 h = FNV_OFFSET_BASIS;
+
+	h = (h ^ node->spcNode) * FNV_PRIME;
+	h = (h ^ node->dbNode) * FNV_PRIME;
+	h = (h ^ node->relNode) * FNV_PRIME;
+
+	return h;
+}
+
+/*
+ * hash_block()
+ *
+ * returns the FNV-1a hash of the block, with the high bits folded into
+ * the low ones to be masked for a power-of-two table.
+ */
+uint32
+hash_block(const RelFileNode *node, BlockNumber block)
+{
+	uint32 h = (hash_relfilenode(node) ^ block) * FNV_PRIME;
+
+	return h ^ (h >> 15);
+}
@@ -0,0 +1,17 @@
+/*
+ * xlogdump_hash.h
+ *
+ * hash functions of the relations and the blocks, shared by the hash
+ * tables and the sketches.
+ */
+#ifndef __XLOGDUMP_HASH_H__
+#define __XLOGDUMP_HASH_H__
+
+#include "postgres.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+uint32 hash_relfilenode(const RelFileNode *);
+uint32 hash_block(const RelFileNode *, BlockNumber);
+
+#endif /* __XLOGDUMP_HASH_H__ */
@@ -0,0 +1,103 @@
+/*
+ * xlogdump_hist.c
+ *
+ * a log-linear histogram to summarize the distribution of the xlog
+ * record sizes with a fixed memory footprint.
+ */
+#include "xlogdump_hist.h"
+
+static int hist_index(uint32);
+
+/*
+ * hist_index()
+ *
+ * returns the bucket number for the value. The position of the highest
+ * set bit picks the power of two, and the next HIST_SUB_BITS bits pick
+ * the linear sub-bucket within it.
+ */
+static int
+hist_index(uint32 v)
+{
+	int msb;
+
+	if (v < HIST_SUB_COUNT)
+		return (int) v;
+
+#if defined(__GNUC__)
+	msb = 31 - __builtin_clz(v);
+#else
+	msb = 31;
+	while (!(v & ((uint32) 1 << msb)))
+		msb--;
+#endif
+
+	return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+		(int) ((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+}
+
+/*
+ * hist_upper_bound()
+ *
+ * returns the largest value which falls into the bucket.
+ */
+uint32
+hist_upper_bound(int idx)
+{
+	int shift;
+	uint64 low;
+
+	if (idx < HIST_SUB_COUNT)
+		return (uint32) idx;
+
+	shift = (idx >> HIST_SUB_BITS) - 1;
+	low = (uint64) (HIST_SUB_COUNT + (idx & (HIST_SUB_COUNT - 1))) << shift;
+
+	return (uint32) (low + ((uint64) 1 << shift) - 1);
+}
+
+void
+hist_add(hist_t *h, uint32 v)
+{
+	h->buckets[hist_index(v)]++;
+	h->count++;
+	h->sum += v;
+	if (v > h->max)
+		h->max = v;
+}
+
+/*
+ * hist_percentile()
+ *
+ * returns the value at the given percentile (0-100). The result is the
+ * upper bound of the bucket holding that rank, but never exceeds the
+ * largest value actually seen.
+ */
+uint32
+hist_percentile(const hist_t *h, double pct)
+{
+	uint64 rank;
+	uint64 seen = 0;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+
+	rank = (uint64) (pct / 100.0 * (double) h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	for (i = 0 ; i < HIST_BUCKETS ; i++)
+	{
+		seen += h->buckets[i];
+		if (seen >= rank)
+		{
+			uint32 upper = hist_upper_bound(i);
+
+			return (upper < h->max) ? upper : h->max;
+		}
+	}
+
+	return h->max;
+}
@@ -0,0 +1,32 @@
+/*
+ * xlogdump_hist.h
+ *
+ * a log-linear histogram to summarize the distribution of the xlog
+ * record sizes with a fixed memory footprint.
+ */
+#ifndef __XLOGDUMP_HIST_H__
+#define __XLOGDUMP_HIST_H__
+
+#include "postgres.h"
+
+/*
+ * Values below HIST_SUB_COUNT are counted exactly. Above that, each power
+ * of two is split into HIST_SUB_COUNT linear sub-buckets, so any value is
+ * reported within 1/HIST_SUB_COUNT (about 3%) of its actual size.
+ */
+#define HIST_SUB_BITS	5
+#define HIST_SUB_COUNT	(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS	((32 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+typedef struct hist_t {
+	uint64 count;
+	uint64 sum;
+	uint32 max;
+	uint64 buckets[HIST_BUCKETS];
+} hist_t;
+
+void hist_add(hist_t *, uint32);
+uint32 hist_percentile(const hist_t *, double);
+uint32 hist_upper_bound(int);
+
+#endif /* __XLOGDUMP_HIST_H__ */
@@ -0,0 +1,114 @@
+/*
+ * xlogdump_hll.c
+ *
+ * a HyperLogLog counter to estimate the number of distinct blocks
+ * with a fixed memory footprint.
+ */
+#include "xlogdump_hll.h"
+
+#include <math.h>
+
+static uint64 hll_hash(const RelFileNode *, BlockNumber);
+
+/*
+ * hll_hash()
+ *
+ * returns a 64-bit hash of the block. The finalizer of MurmurHash3
+ * spreads the bits well enough for the consecutive block numbers.
+ */
+static uint64
+hll_hash(const RelFileNode *node, BlockNumber block)
+{
+	uint64 h;
+
+	h = ((uint64) node->relNode << 32) | block;
+	h ^= (((uint64) node->spcNode << 32) | node->dbNode) * UINT64CONST(0x9E3779B97F4A7C15);
+
+	h ^= h >> 33;
+	h *= UINT64CONST(0xFF51AFD7ED558CCD);
+	h ^= h >> 33;
+	h *= UINT64CONST(0xC4CEB9FE1A85EC53);
+	h ^= h >> 33;
+
+	return h;
+}
+
+void
+hll_reset(hll_t *hll)
+{
+	memset(hll->registers, 0, sizeof(hll->registers));
+}
+
+/*
+ * hll_add_block()
+ *
+ * The top HLL_BITS bits of the hash pick the register, and the register
+ * keeps the largest position of the first set bit in the rest.
+ */
+void
+hll_add_block(hll_t *hll, const RelFileNode *node, BlockNumber block)
+{
+	uint64 h = hll_hash(node, block);
+	uint32 idx = (uint32) (h >> (64 - HLL_BITS));
+	uint64 rest = h << HLL_BITS;
+	uint8 rank = 1;
+
+	while (rank <= 64 - HLL_BITS && !(rest & (UINT64CONST(1) << 63)))
+	{
+		rest <<= 1;
+		rank++;
+	}
+
+	if (rank > hll->registers[idx])
+		hll->registers[idx] = rank;
+}
+
+/*
+ * hll_merge()
+ *
+ * merges `src' into `dst', as if all the blocks added to `src'
+ * had been added to `dst'.
+ */
+void
+hll_merge(hll_t *dst, const hll_t *src)
+{
+	int i;
+
+	for (i = 0 ; i < HLL_REGISTERS ; i++)
+	{
+		if (src->registers[i] > dst->registers[i])
+			dst->registers[i] = src->registers[i];
+	}
+}
+
+/*
+ * hll_estimate()
+ *
+ * returns the estimated number of distinct blocks. With few blocks,
+ * linear counting over the empty registers is more accurate, and is
+ * used instead of the raw estimate.
+ */
+double
+hll_estimate(const hll_t *hll)
+{
+	double m = (double) HLL_REGISTERS;
+	double alpha = 0.7213 / (1.0 + 1.079 / m);
+	double sum = 0.0;
+	int zeros = 0;
+	double e;
+	int i;
+
+	for (i = 0 ; i < HLL_REGISTERS ; i++)
+	{
+		sum += ldexp(1.0, -(int) hll->registers[i]);
+		if (hll->registers[i] == 0)
+			zeros++;
+	}
+
+	e = alpha * m * m / sum;
+
+	if (e <= 2.5 * m && zeros > 0)
+		e = m * log(m / (double) zeros);
+
+	return e;
+}
@@ -0,0 +1,30 @@
+/*
+ * xlogdump_hll.h
+ *
+ * a HyperLogLog counter to estimate the number of distinct blocks
+ * with a fixed memory footprint.
+ */
+#ifndef __XLOGDUMP_HLL_H__
+#define __XLOGDUMP_HLL_H__
+
+#include "postgres.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/*
+ * 2^HLL_BITS one-byte registers, 4kB per counter. The standard error
+ * of the estimate is 1.04 / sqrt(HLL_REGISTERS), about 1.6%.
+ */
+#define HLL_BITS		12
+#define HLL_REGISTERS	(1 << HLL_BITS)
+
+typedef struct hll_t {
+	uint8 registers[HLL_REGISTERS];
+} hll_t;
+
+void hll_reset(hll_t *);
+void hll_add_block(hll_t *, const RelFileNode *, BlockNumber);
+void hll_merge(hll_t *, const hll_t *);
+double hll_estimate(const hll_t *);
+
+#endif /* __XLOGDUMP_HLL_H__ */
@@ -0,0 +1,465 @@
+/*
+ * xlogdump_hotblock.c
+ *
+ * a bounded-memory sketch to find the blocks which take the most
+ * xlog records.
+ *
+ * This is the Space-Saving algorithm (Metwally et al., 2005). It keeps
+ * a fixed number of counters. When a block which is not monitored shows
+ * up and all the counters are in use, the block takes over the counter
+ * with the smallest count, and inherits that count as its error.
+ * So, a count is an upper bound of the actual number of records, and
+ * count - error is a lower bound. The error is never larger than
+ * (total records) / (number of counters).
+ */
+#include "xlogdump_hotblock.h"
+
+#include "xlogdump_export.h"
+#include "xlogdump_hash.h"
+#include "xlogdump_oid2name.h"
+#include "xlogdump_sidecar.h"
+
+/* number of the counters per block to be shown */
+#define HOTBLOCK_COUNTERS_PER_TOPK	10
+
+struct hotblock_t {
+	RelFileNode node;
+	BlockNumber block;
+	uint64 count;
+	uint64 error;
+	int heap_pos;			/* position in the min-heap */
+};
+
+static int topk = 0;
+static int ncounters = 0;
+static int nused = 0;
+static uint64 total = 0;
+
+static struct hotblock_t *counters = NULL;
+static int *heap = NULL;		/* min-heap of the counter indexes by count */
+static int *hash = NULL;		/* open addressing: counter index + 1, or 0 */
+static uint32 hash_size = 0;
+
+static uint32 hash_find(const RelFileNode *, BlockNumber);
+static void hash_delete(uint32);
+static void heap_swap(int, int);
+static void heap_down(int);
+static void heap_up(int);
+static int cmp_hotblock(const void *, const void *);
+static void hotblock_name(const struct hotblock_t *, char *, size_t);
+static uint64 hotblock_min(void);
+static void hotblock_rebuild(void);
+
+void
+hotblock_init(int k)
+{
+	topk = k;
+	ncounters = k * HOTBLOCK_COUNTERS_PER_TOPK;
+
+	hash_size = 1;
+	while (hash_size < (uint32) ncounters * 2)
+		hash_size <<= 1;
+
+	counters = (struct hotblock_t *) malloc(sizeof(struct hotblock_t) * ncounters);
+	heap = (int *) malloc(sizeof(int) * ncounters);
+	hash = (int *) malloc(sizeof(int) * hash_size);
+	if (counters == NULL || heap == NULL || hash == NULL)
+	{
+		fprintf(stderr, "ERROR: out of memory for the hot block stats.\n");
+		exit(1);
+	}
+	memset(hash, 0, sizeof(int) * hash_size);
+}
+
+/*
+ * hash_find()
+ *
+ * returns the hash slot of the block, or the empty slot where it
+ * should be inserted.
+ */
+static uint32
+hash_find(const RelFileNode *node, BlockNumber block)
+{
+	uint32 i = hash_block(node, block) & (hash_size - 1);
+
+	while (hash[i] != 0)
+	{
+		struct hotblock_t *c = &counters[hash[i] - 1];
+
+		if (c->block == block && c->node.relNode == node->relNode &&
+		    c->node.dbNode == node->dbNode && c->node.spcNode == node->spcNode)
+			break;
+
+		i = (i + 1) & (hash_size - 1);
+	}
+
+	return i;
+}
+
+/*
+ * hash_delete()
+ *
+ * removes the slot, and moves back the following entries in the same
+ * probe sequence (backward shift deletion for linear probing).
+ */
+static void
+hash_delete(uint32 i)
+{
+	uint32 j = i;
+
+	hash[i] = 0;
+
+	for (;;)
+	{
+		uint32 home;
+		struct hotblock_t *c;
+
+		j = (j + 1) & (hash_size - 1);
+		if (hash[j] == 0)
+			return;
+
+		c = &counters[hash[j] - 1];
+		home = hash_block(&c->node, c->block) & (hash_size - 1);
+
+		/* can the entry at j be moved to the hole at i? */
+		if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+		{
+			hash[i] = hash[j];
+			hash[j] = 0;
+			i = j;
+		}
+	}
+}
+
+static void
+heap_swap(int a, int b)
+{
+	int tmp = heap[a];
+
+	heap[a] = heap[b];
+	heap[b] = tmp;
+	counters[heap[a]].heap_pos = a;
+	counters[heap[b]].heap_pos = b;
+}
+
+static void
+heap_down(int pos)
+{
+	for (;;)
+	{
+		int l = pos * 2 + 1;
+		int r = l + 1;
+		int min = pos;
+
+		if (l < nused && counters[heap[l]].count < counters[heap[min]].count)
+			min = l;
+		if (r < nused && counters[heap[r]].count < counters[heap[min]].count)
+			min = r;
+		if (min == pos)
+			return;
+
+		heap_swap(pos, min);
+		pos = min;
+	}
+}
+
+static void
+heap_up(int pos)
+{
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+
+		if (counters[heap[parent]].count <= counters[heap[pos]].count)
+			return;
+
+		heap_swap(pos, parent);
+		pos = parent;
+	}
+}
+
+/*
+ * hotblock_add()
+ *
+ * counts a xlog record touching the block.
+ */
+void
+hotblock_add(const RelFileNode *node, BlockNumber block)
+{
+	uint32 slot;
+	struct hotblock_t *c;
+
+	if (topk == 0)
+		return;
+
+	total++;
+	slot = hash_find(node, block);
+
+	if (hash[slot] != 0)
+	{
+		c = &counters[hash[slot] - 1];
+		c->count++;
+		heap_down(c->heap_pos);
+		return;
+	}
+
+	if (nused < ncounters)
+	{
+		c = &counters[nused];
+		c->node = *node;
+		c->block = block;
+		c->count = 1;
+		c->error = 0;
+		c->heap_pos = nused;
+		heap[nused] = nused;
+		hash[slot] = nused + 1;
+		nused++;
+		heap_up(c->heap_pos);
+		return;
+	}
+
+	/* take over the counter with the smallest count. */
+	c = &counters[heap[0]];
+	hash_delete(hash_find(&c->node, c->block));
+
+	c->node = *node;
+	c->block = block;
+	c->error = c->count;
+	c->count++;
+	hash[hash_find(node, block)] = heap[0] + 1;
+	heap_down(0);
+}
+
+static int
+cmp_hotblock(const void *a, const void *b)
+{
+	const struct hotblock_t *x = (const struct hotblock_t *) a;
+	const struct hotblock_t *y = (const struct hotblock_t *) b;
+
+	if (x->count != y->count)
+		return (x->count < y->count) ? 1 : -1;
+	if (x->error != y->error)
+		return (x->error > y->error) ? 1 : -1;
+	return 0;
+}
+
+static void
+hotblock_name(const struct hotblock_t *c, char *buf, size_t buflen)
+{
+	char spaceName[NAMEDATALEN];
+	char dbName[NAMEDATALEN];
+	char relName[NAMEDATALEN];
+
+	getSpaceName(c->node.spcNode, spaceName, sizeof(spaceName));
+	getDbName(c->node.dbNode, dbName, sizeof(dbName));
+	getRelName(c->node.dbNode, c->node.relNode, relName, sizeof(relName));
+	snprintf(buf, buflen, "%s/%s/%s", spaceName, dbName, relName);
+}
+
+void
+print_xlog_hotblocks(void)
+{
+	char relation[NAMEDATALEN * 3 + 3];
+	char buf[32];
+	int i;
+
+	printf("---------------------------------------------------------------\n");
+	snprintf(buf, sizeof(buf), UINT64_FORMAT, total);
+	printf("Hot blocks (top %d of %s block references, %d counters):\n\n",
+	       topk, buf, ncounters);
+
+	qsort(counters, nused, sizeof(struct hotblock_t), cmp_hotblock);
+
+	printf("  %12s %12s  %s\n", "records", "error", "block");
+	for (i = 0 ; i < nused && i < topk ; i++)
+	{
+		char count[32], error[32];
+
+		snprintf(count, sizeof(count), UINT64_FORMAT, counters[i].count);
+		snprintf(error, sizeof(error), UINT64_FORMAT, counters[i].error);
+		hotblock_name(&counters[i], relation, sizeof(relation));
+
+		printf("  %12s %12s  s/d/r:%s blk:%u\n",
+		       count, error, relation, counters[i].block);
+	}
+	printf("  (the actual number of records is between records - error and records.)\n");
+	printf("\n");
+}
+
+/*
+ * export_xlog_hotblocks()
+ *
+ * exports the hottest blocks with their error bounds.
+ */
+void
+export_xlog_hotblocks(void)
+{
+	char relation[NAMEDATALEN * 3 + 3];
+	char block[16];
+	const char *labels[] = { "relation", relation, "block", block, NULL };
+	int i;
+
+	qsort(counters, nused, sizeof(struct hotblock_t), cmp_hotblock);
+
+	for (i = 0 ; i < nused && i < topk ; i++)
+	{
+		hotblock_name(&counters[i], relation, sizeof(relation));
+		snprintf(block, sizeof(block), "%u", counters[i].block);
+		export_gauge("xlogdump_hot_block_records",
+			     "Estimated number of xlog records touching the block (upper bound).",
+			     labels, (double) counters[i].count);
+	}
+
+	for (i = 0 ; i < nused && i < topk ; i++)
+	{
+		hotblock_name(&counters[i], relation, sizeof(relation));
+		snprintf(block, sizeof(block), "%u", counters[i].block);
+		export_gauge("xlogdump_hot_block_error",
+			     "Maximum overestimation of xlogdump_hot_block_records.",
+			     labels, (double) counters[i].error);
+	}
+}
+
+/*
+ * hotblock_min()
+ *
+ * returns the smallest count, which bounds the count of any block
+ * not monitored, or 0 if some counters are still free.
+ */
+static uint64
+hotblock_min(void)
+{
+	if (nused < ncounters)
+		return 0;
+
+	return counters[heap[0]].count;
+}
+
+/*
+ * hotblock_rebuild()
+ *
+ * rebuilds the min-heap and the hash table after the counters have
+ * been rearranged.
+ */
+static void
+hotblock_rebuild(void)
+{
+	int i;
+
+	memset(hash, 0, sizeof(int) * hash_size);
+	for (i = 0 ; i < nused ; i++)
+	{
+		counters[i].heap_pos = i;
+		heap[i] = i;
+		hash[hash_find(&counters[i].node, counters[i].block)] = i + 1;
+	}
+	for (i = nused / 2 - 1 ; i >= 0 ; i--)
+		heap_down(i);
+}
+
+void
+save_xlog_hotblocks(FILE *fp)
+{
+	long pos;
+	int i;
+
+	pos = sidecar_begin_section(fp, SIDECAR_HOT_BLOCKS);
+	sidecar_write_u64(fp, total);
+	sidecar_write_u64(fp, hotblock_min());
+	sidecar_write_u32(fp, (uint32) nused);
+	for (i = 0 ; i < nused ; i++)
+	{
+		sidecar_write(fp, &counters[i].node, sizeof(RelFileNode));
+		sidecar_write_u32(fp, counters[i].block);
+		sidecar_write_u64(fp, counters[i].count);
+		sidecar_write_u64(fp, counters[i].error);
+	}
+	sidecar_end_section(fp, pos);
+}
+
+/*
+ * load_xlog_hotblocks()
+ *
+ * merges the counters in a stats file. A block monitored on one side
+ * only may have had up to the smallest count of the other side, which
+ * is added to both its count and its error. Then, the largest counts
+ * are kept (Agarwal et al., Mergeable Summaries, 2012).
+ */
+void
+load_xlog_hotblocks(FILE *fp)
+{
+	struct hotblock_t *merged;
+	bool *matched;
+	uint64 cur_min = hotblock_min();
+	uint64 file_min;
+	int nfile, nmerged = 0;
+	int i;
+
+	total += sidecar_read_u64(fp);
+	file_min = sidecar_read_u64(fp);
+	nfile = (int) sidecar_read_u32(fp);
+
+	merged = (struct hotblock_t *) malloc(sizeof(struct hotblock_t) * (nused + nfile));
+	matched = (bool *) malloc(sizeof(bool) * (nused + 1));
+	if (merged == NULL || matched == NULL)
+	{
+		fprintf(stderr, "ERROR: out of memory for the hot block stats.\n");
+		exit(1);
+	}
+	memset(matched, 0, sizeof(bool) * (nused + 1));
+
+	for (i = 0 ; i < nfile ; i++)
+	{
+		struct hotblock_t c;
+		uint32 slot;
+
+		memset(&c, 0, sizeof(c));
+		sidecar_read(fp, &c.node, sizeof(RelFileNode));
+		c.block = sidecar_read_u32(fp);
+		c.count = sidecar_read_u64(fp);
+		c.error = sidecar_read_u64(fp);
+
+		slot = hash_find(&c.node, c.block);
+		if (hash[slot] != 0)
+		{
+			c.count += counters[hash[slot] - 1].count;
+			c.error += counters[hash[slot] - 1].error;
+			matched[hash[slot] - 1] = true;
+		}
+		else
+		{
+			c.count += cur_min;
+			c.error += cur_min;
+		}
+		merged[nmerged++] = c;
+	}
+
+	for (i = 0 ; i < nused ; i++)
+	{
+		if (matched[i])
+			continue;
+
+		merged[nmerged] = counters[i];
+		merged[nmerged].count += file_min;
+		merged[nmerged].error += file_min;
+		nmerged++;
+	}
+
+	qsort(merged, nmerged, sizeof(struct hotblock_t), cmp_hotblock);
+
+	nused = (nmerged < ncounters) ? nmerged : ncounters;
+	memcpy(counters, merged, sizeof(struct hotblock_t) * nused);
+	hotblock_rebuild();
+
+	free(merged);
+	free(matched);
+}
+
+void
+reset_xlog_hotblocks(void)
+{
+	nused = 0;
+	total = 0;
+	if (hash != NULL)
+		memset(hash, 0, sizeof(int) * hash_size);
+}
@@ -0,0 +1,22 @@
+/*
+ * xlogdump_hotblock.h
+ *
+ * a bounded-memory sketch to find the blocks which take the most
+ * xlog records.
+ */
+#ifndef __XLOGDUMP_HOTBLOCK_H__
+#define __XLOGDUMP_HOTBLOCK_H__
+
+#include "postgres.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+void hotblock_init(int);
+void hotblock_add(const RelFileNode *, BlockNumber);
+void print_xlog_hotblocks(void);
+void export_xlog_hotblocks(void);
+void save_xlog_hotblocks(FILE *);
+void load_xlog_hotblocks(FILE *);
+void reset_xlog_hotblocks(void);
+
+#endif /* __XLOGDUMP_HOTBLOCK_H__ */
@@ -0,0 +1,186 @@
+/*
+ * xlogdump_index.c
+ *
+ * a collection of functions to build and look up the xid index of
+ * a xlog segment, which has the offsets of the records of each xid.
+ *
+ * The index is a stats file (see xlogdump_sidecar.c) with the suffix
+ * ".idx", which has the pairs of a xid and a record offset in the
+ * segment, sorted by both. A lookup is a binary search over the
+ * fixed-size pairs in the file, so the file isn't read entirely.
+ */
+#include "xlogdump_index.h"
+
+#include "access/transam.h"
+
+#include "xlogdump_sidecar.h"
+
+struct index_entry_t {
+	TransactionId xid;
+	uint32 offset;
+};
+
+#define INDEX_ENTRY_SIZE	(sizeof(uint32) * 2)
+
+static struct index_entry_t *entries = NULL;
+static int nentries = 0;
+static int maxentries = 0;
+
+static int cmp_index_entry(const void *, const void *);
+static void index_read_entry(FILE *, long, int, struct index_entry_t *);
+
+void
+index_reset(void)
+{
+	nentries = 0;
+}
+
+/*
+ * index_add_record()
+ *
+ * remembers the offset of a record in the current segment. The records
+ * without a xid are not indexed, because they can't be searched by -x.
+ */
+void
+index_add_record(TransactionId xid, uint32 offset)
+{
+	if (!TransactionIdIsNormal(xid))
+		return;
+
+	if (nentries >= maxentries)
+	{
+		maxentries = (maxentries == 0) ? 4096 : maxentries * 2;
+		entries = (struct index_entry_t *) realloc(entries, sizeof(struct index_entry_t) * maxentries);
+		if (entries == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the xid index.\n");
+			exit(1);
+		}
+	}
+
+	entries[nentries].xid = xid;
+	entries[nentries].offset = offset;
+	nentries++;
+}
+
+static int
+cmp_index_entry(const void *a, const void *b)
+{
+	const struct index_entry_t *x = (const struct index_entry_t *) a;
+	const struct index_entry_t *y = (const struct index_entry_t *) b;
+
+	if (x->xid != y->xid)
+		return (x->xid < y->xid) ? -1 : 1;
+	if (x->offset != y->offset)
+		return (x->offset < y->offset) ? -1 : 1;
+	return 0;
+}
+
+void
+index_save(const char *path)
+{
+	FILE *fp;
+	long pos;
+	int i;
+
+	qsort(entries, nentries, sizeof(struct index_entry_t), cmp_index_entry);
+
+	fp = sidecar_create(path);
+
+	pos = sidecar_begin_section(fp, SIDECAR_XID_INDEX);
+	sidecar_write_u32(fp, (uint32) nentries);
+	for (i = 0 ; i < nentries ; i++)
+	{
+		sidecar_write_u32(fp, entries[i].xid);
+		sidecar_write_u32(fp, entries[i].offset);
+	}
+	sidecar_end_section(fp, pos);
+
+	sidecar_close(fp, path);
+}
+
+static void
+index_read_entry(FILE *fp, long base, int i, struct index_entry_t *e)
+{
+	if (fseek(fp, base + (long) i * INDEX_ENTRY_SIZE, SEEK_SET) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't seek in the xid index.\n");
+		exit(1);
+	}
+	e->xid = sidecar_read_u32(fp);
+	e->offset = sidecar_read_u32(fp);
+}
+
+/*
+ * index_lookup_xid()
+ *
+ * returns the number of the records of the xid in the segment, and
+ * their offsets in ascending order. Returns -1 if the index is not
+ * found or older than the segment.
+ */
+int
+index_lookup_xid(const char *path, const char *segment, TransactionId xid, uint32 **offsets)
+{
+	struct index_entry_t e;
+	FILE *fp;
+	uint32 tag;
+	uint64 len;
+	long base;
+	int n, lo, hi, count;
+
+	*offsets = NULL;
+
+	if (!sidecar_is_fresh(path, segment))
+		return -1;
+
+	fp = sidecar_open(path);
+
+	while (sidecar_next_section(fp, &tag, &len))
+	{
+		if (tag == SIDECAR_XID_INDEX)
+			break;
+		sidecar_skip_section(fp, len);
+	}
+	if (tag != SIDECAR_XID_INDEX)
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	n = (int) sidecar_read_u32(fp);
+	base = ftell(fp);
+
+	/* find the first entry of the xid. */
+	lo = 0;
+	hi = n;
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		index_read_entry(fp, base, mid, &e);
+		if (e.xid < xid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	count = 0;
+	while (lo + count < n)
+	{
+		index_read_entry(fp, base, lo + count, &e);
+		if (e.xid != xid)
+			break;
+
+		*offsets = (uint32 *) realloc(*offsets, sizeof(uint32) * (count + 1));
+		if (*offsets == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the xid index.\n");
+			exit(1);
+		}
+		(*offsets)[count++] = e.offset;
+	}
+
+	fclose(fp);
+
+	return count;
+}
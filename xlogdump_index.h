@@ -0,0 +1,19 @@
+/*
+ * xlogdump_index.h
+ *
+ * a collection of functions to build and look up the xid index of
+ * a xlog segment, which has the offsets of the records of each xid.
+ */
+#ifndef __XLOGDUMP_INDEX_H__
+#define __XLOGDUMP_INDEX_H__
+
+#include "postgres.h"
+
+#define INDEX_SUFFIX		".idx"
+
+void index_reset(void);
+void index_add_record(TransactionId, uint32);
+void index_save(const char *);
+int index_lookup_xid(const char *, const char *, TransactionId, uint32 **);
+
+#endif /* __XLOGDUMP_INDEX_H__ */
@@ -0,0 +1,562 @@
+/*
+ * xlogdump_jsonl.c
+ *
+ * a streaming writer to print each xlog record as a line of JSON.
+ *
+ * Every line has all the keys below in this order, with null for the
+ * ones which the record doesn't have, so the schema doesn't depend on
+ * the kind of the record:
+ *
+ *   lsn, prev, xid, rmid, rmgr, info, len, tot_len, op,
+ *   relfilenode {spc, db, rel}, block, offset, time, redo, fields,
+ *   bkpblocks [{spc, db, rel, block, hole_offset, hole_length}]
+ *
+ * time is in microseconds since the Unix epoch. fields is an object of
+ * the record data which depends on the operation, like the new tuple of
+ * an update or the dropped relations and the subtransactions of a
+ * commit, and is null for the operations without data.
+ *
+ * The fields are taken from the decoded record, and written straight
+ * into the output buffer, without any allocation per record.
+ */
+#include "xlogdump_jsonl.h"
+
+#include "access/xlog_internal.h"
+
+#include "xlogdump_out.h"
+#include "xlogdump_rmgr.h"
+
+static void jsonl_lsn(const char *, XLogRecPtr);
+static void jsonl_uint(const char *, uint32);
+static void jsonl_int(const char *, int32);
+static void jsonl_str(const char *, const char *);
+static void jsonl_null(const char *);
+static void jsonl_node(const RelFileNode *);
+static uint32 jsonl_rels(XLogRecord *, uint32, int);
+static void jsonl_xids(XLogRecord *, uint32, int);
+static void jsonl_fields_xlog(DecodedRecord *);
+static void jsonl_fields_xact(DecodedRecord *);
+static void jsonl_fields_storage(DecodedRecord *);
+static void jsonl_fields_heap2(DecodedRecord *);
+static void jsonl_fields_heap(DecodedRecord *);
+static void jsonl_fields_btree(DecodedRecord *);
+static void jsonl_fields(DecodedRecord *);
+
+static void
+jsonl_lsn(const char *key, XLogRecPtr lsn)
+{
+	out_str(key);
+	out_char('"');
+	out_hex(lsn.xlogid);
+	out_char('/');
+	out_hex(lsn.xrecoff);
+	out_char('"');
+}
+
+static void
+jsonl_uint(const char *key, uint32 val)
+{
+	out_str(key);
+	out_uint(val);
+}
+
+static void
+jsonl_int(const char *key, int32 val)
+{
+	out_str(key);
+	out_int(val);
+}
+
+/* the value must not need escaping, as the rmgr and op names. */
+static void
+jsonl_str(const char *key, const char *val)
+{
+	out_str(key);
+	out_char('"');
+	out_str(val);
+	out_char('"');
+}
+
+static void
+jsonl_null(const char *key)
+{
+	out_str(key);
+	out_str("null");
+}
+
+static void
+jsonl_node(const RelFileNode *node)
+{
+	jsonl_uint("{\"spc\":", node->spcNode);
+	jsonl_uint(",\"db\":", node->dbNode);
+	jsonl_uint(",\"rel\":", node->relNode);
+}
+
+/*
+ * jsonl_rels()
+ *
+ * prints the `n' relfilenodes at `off' of the record data as "rels",
+ * and returns the offset after them. The list ends early at the end of
+ * the record data.
+ */
+static uint32
+jsonl_rels(XLogRecord *record, uint32 off, int n)
+{
+	RelFileNode node;
+	int i;
+
+	out_str(",\"rels\":[");
+	for (i = 0; i < n && off + sizeof(RelFileNode) <= record->xl_len; i++)
+	{
+		memcpy(&node, XLogRecGetData(record) + off, sizeof(RelFileNode));
+		if (i > 0)
+			out_char(',');
+		jsonl_node(&node);
+		out_char('}');
+		off += sizeof(RelFileNode);
+	}
+	out_char(']');
+
+	/* the subtransactions don't follow a cut off list */
+	return (i < n) ? record->xl_len : off;
+}
+
+/*
+ * jsonl_xids()
+ *
+ * prints the `n' transaction ids at `off' of the record data as
+ * "subxacts".
+ */
+static void
+jsonl_xids(XLogRecord *record, uint32 off, int n)
+{
+	TransactionId xid;
+	int i;
+
+	out_str(",\"subxacts\":[");
+	for (i = 0; i < n && off + sizeof(TransactionId) <= record->xl_len; i++)
+	{
+		memcpy(&xid, XLogRecGetData(record) + off, sizeof(TransactionId));
+		if (i > 0)
+			out_char(',');
+		out_uint(xid);
+		off += sizeof(TransactionId);
+	}
+	out_char(']');
+}
+
+static void
+jsonl_fields_xlog(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+
+	switch (dec->info)
+	{
+	case XLOG_CHECKPOINT_SHUTDOWN:
+	case XLOG_CHECKPOINT_ONLINE:
+		jsonl_uint("\"tli\":", p->checkpoint.ThisTimeLineID);
+		jsonl_uint(",\"next_xid\":", p->checkpoint.nextXid);
+		jsonl_uint(",\"next_oid\":", p->checkpoint.nextOid);
+		jsonl_uint(",\"next_multi\":", p->checkpoint.nextMulti);
+		jsonl_uint(",\"next_offset\":", p->checkpoint.nextMultiOffset);
+		break;
+
+	case XLOG_NEXTOID:
+		jsonl_uint("\"next_oid\":", p->next_oid);
+		break;
+
+#if PG_VERSION_NUM >= 90000
+	case XLOG_BACKUP_END:
+		jsonl_lsn("\"start\":", p->backup_start);
+		break;
+#endif
+	}
+}
+
+static void
+jsonl_fields_xact(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	const DecodedPayload *p = &dec->payload;
+	uint32 off;
+
+	switch (dec->info)
+	{
+	case XLOG_XACT_COMMIT:
+		jsonl_int("\"nrels\":", p->xact_commit.nrels);
+		jsonl_int(",\"nsubxacts\":", p->xact_commit.nsubxacts);
+#if PG_VERSION_NUM >= 90000
+		jsonl_uint(",\"db\":", p->xact_commit.dbId);
+		jsonl_uint(",\"spc\":", p->xact_commit.tsId);
+#endif
+		off = jsonl_rels(record, MinSizeOfXactCommit, p->xact_commit.nrels);
+		jsonl_xids(record, off, p->xact_commit.nsubxacts);
+		break;
+
+	case XLOG_XACT_ABORT:
+		jsonl_int("\"nrels\":", p->xact_abort.nrels);
+		jsonl_int(",\"nsubxacts\":", p->xact_abort.nsubxacts);
+		off = jsonl_rels(record, MinSizeOfXactAbort, p->xact_abort.nrels);
+		jsonl_xids(record, off, p->xact_abort.nsubxacts);
+		break;
+
+	case XLOG_XACT_COMMIT_PREPARED:
+		jsonl_uint("\"xid\":", p->xact_prepared.xid);
+		jsonl_int(",\"nrels\":", p->xact_prepared.crec.nrels);
+		jsonl_int(",\"nsubxacts\":", p->xact_prepared.crec.nsubxacts);
+		off = jsonl_rels(record, MinSizeOfXactCommitPrepared, p->xact_prepared.crec.nrels);
+		jsonl_xids(record, off, p->xact_prepared.crec.nsubxacts);
+		break;
+
+	case XLOG_XACT_ABORT_PREPARED:
+		jsonl_uint("\"xid\":", p->xact_abort_prepared.xid);
+		jsonl_int(",\"nrels\":", p->xact_abort_prepared.arec.nrels);
+		jsonl_int(",\"nsubxacts\":", p->xact_abort_prepared.arec.nsubxacts);
+		off = jsonl_rels(record, MinSizeOfXactAbortPrepared, p->xact_abort_prepared.arec.nrels);
+		jsonl_xids(record, off, p->xact_abort_prepared.arec.nsubxacts);
+		break;
+
+#if PG_VERSION_NUM >= 90000
+	case XLOG_XACT_ASSIGNMENT:
+		jsonl_uint("\"xtop\":", p->xact_assignment.xtop);
+		jsonl_int(",\"nsubxacts\":", p->xact_assignment.nsubxacts);
+		jsonl_xids(record, MinSizeOfXactAssignment, p->xact_assignment.nsubxacts);
+		break;
+#endif
+
+#if PG_VERSION_NUM >= 90200
+	case XLOG_XACT_COMMIT_COMPACT:
+		jsonl_int("\"nsubxacts\":", p->xact_commit_compact.nsubxacts);
+		jsonl_xids(record, MinSizeOfXactCommitCompact, p->xact_commit_compact.nsubxacts);
+		break;
+#endif
+	}
+}
+
+/* the records of Storage, CLOG, Database, MultiXact and RelMap */
+static void
+jsonl_fields_storage(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+
+	switch (dec->record->xl_rmid)
+	{
+	case RM_SMGR_ID:
+		if (dec->info == XLOG_SMGR_CREATE)
+		{
+			out_str("\"rel\":");
+			jsonl_node(&p->smgr_create.rnode);
+			out_char('}');
+		}
+		else if (dec->info == XLOG_SMGR_TRUNCATE)
+		{
+			out_str("\"rel\":");
+			jsonl_node(&p->smgr_truncate.rnode);
+			out_char('}');
+			jsonl_uint(",\"blkno\":", p->smgr_truncate.blkno);
+		}
+		break;
+
+	case RM_CLOG_ID:
+		jsonl_int("\"pageno\":", p->pageno);
+		break;
+
+	case RM_DBASE_ID:
+		if (dec->info == XLOG_DBASE_CREATE)
+		{
+			jsonl_uint("\"db\":", p->dbase_create.db_id);
+			jsonl_uint(",\"spc\":", p->dbase_create.tablespace_id);
+			jsonl_uint(",\"src_db\":", p->dbase_create.src_db_id);
+			jsonl_uint(",\"src_spc\":", p->dbase_create.src_tablespace_id);
+		}
+		else if (dec->info == XLOG_DBASE_DROP)
+		{
+			jsonl_uint("\"db\":", p->dbase_drop.db_id);
+			jsonl_uint(",\"spc\":", p->dbase_drop.tablespace_id);
+		}
+		break;
+
+	case RM_MULTIXACT_ID:
+		if ((dec->info & XLOG_HEAP_OPMASK) == XLOG_MULTIXACT_CREATE_ID)
+		{
+			jsonl_uint("\"mid\":", p->multixact_create.mid);
+			jsonl_uint(",\"moff\":", p->multixact_create.moff);
+			jsonl_int(",\"nxids\":", p->multixact_create.nxids);
+		}
+		else
+			jsonl_int("\"pageno\":", p->pageno);
+		break;
+
+#if PG_VERSION_NUM >= 90000
+	case RM_RELMAP_ID:
+		jsonl_uint("\"db\":", p->relmap_update.dbid);
+		jsonl_uint(",\"spc\":", p->relmap_update.tsid);
+		jsonl_int(",\"nbytes\":", p->relmap_update.nbytes);
+		break;
+#endif
+	}
+}
+
+static void
+jsonl_fields_heap2(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+
+	switch (dec->info)
+	{
+	case XLOG_HEAP2_FREEZE:
+		jsonl_uint("\"block\":", p->heap_freeze.block);
+		jsonl_uint(",\"cutoff_xid\":", p->heap_freeze.cutoff_xid);
+		break;
+
+#if PG_VERSION_NUM >= 80300
+	case XLOG_HEAP2_CLEAN:
+#if PG_VERSION_NUM < 90000
+	case XLOG_HEAP2_CLEAN_MOVE:
+#endif
+		jsonl_uint("\"block\":", p->heap_clean.xlrec.block);
+		jsonl_uint(",\"nredirected\":", p->heap_clean.xlrec.nredirected);
+		jsonl_uint(",\"ndead\":", p->heap_clean.xlrec.ndead);
+		jsonl_uint(",\"nunused\":", p->heap_clean.nunused);
+#if PG_VERSION_NUM >= 90000
+		jsonl_uint(",\"latest_removed_xid\":", p->heap_clean.xlrec.latestRemovedXid);
+#endif
+		break;
+
+#if PG_VERSION_NUM >= 90000
+	case XLOG_HEAP2_CLEANUP_INFO:
+		jsonl_uint("\"latest_removed_xid\":", p->heap_cleanup_info.latestRemovedXid);
+		break;
+#endif
+#endif
+	}
+}
+
+static void
+jsonl_fields_heap(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+
+	switch (dec->info & XLOG_HEAP_OPMASK)
+	{
+	case XLOG_HEAP_INSERT:
+		if (p->heap_insert.has_header)
+		{
+#if PG_VERSION_NUM >= 80300
+			jsonl_uint("\"t_infomask2\":", p->heap_insert.header.t_infomask2);
+			jsonl_uint(",\"t_infomask\":", p->heap_insert.header.t_infomask);
+#else
+			jsonl_uint("\"t_infomask\":", p->heap_insert.header.t_infomask);
+#endif
+			jsonl_uint(",\"t_hoff\":", p->heap_insert.header.t_hoff);
+		}
+		break;
+
+	case XLOG_HEAP_UPDATE:
+#if PG_VERSION_NUM >= 80300
+	case XLOG_HEAP_HOT_UPDATE:
+#endif
+#if PG_VERSION_NUM < 90000
+	case XLOG_HEAP_MOVE:
+#endif
+		jsonl_uint("\"new_block\":", ItemPointerGetBlockNumber(&p->heap_update.newtid));
+		jsonl_uint(",\"new_offset\":", ItemPointerGetOffsetNumber(&p->heap_update.newtid));
+		break;
+
+	case XLOG_HEAP_LOCK:
+		jsonl_uint("\"locking_xid\":", p->heap_lock.locking_xid);
+		out_str(p->heap_lock.xid_is_mxact ? ",\"xid_is_mxact\":true" : ",\"xid_is_mxact\":false");
+		out_str(p->heap_lock.shared_lock ? ",\"shared_lock\":true" : ",\"shared_lock\":false");
+		break;
+	}
+}
+
+static void
+jsonl_fields_btree(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+
+	switch (dec->info)
+	{
+	case XLOG_BTREE_INSERT_META:
+		jsonl_uint("\"downlink\":", p->btree_insert.downlink);
+		jsonl_uint(",\"root\":", p->btree_insert.md.root);
+		jsonl_uint(",\"level\":", p->btree_insert.md.level);
+		jsonl_uint(",\"fastroot\":", p->btree_insert.md.fastroot);
+		jsonl_uint(",\"fastlevel\":", p->btree_insert.md.fastlevel);
+		break;
+
+	case XLOG_BTREE_SPLIT_L:
+	case XLOG_BTREE_SPLIT_L_ROOT:
+	case XLOG_BTREE_SPLIT_R:
+	case XLOG_BTREE_SPLIT_R_ROOT:
+#if PG_VERSION_NUM >= 80300
+		jsonl_uint("\"leftsib\":", p->btree_split.xlrec.leftsib);
+		jsonl_uint(",\"rightsib\":", p->btree_split.xlrec.rightsib);
+		jsonl_uint(",\"rnext\":", p->btree_split.xlrec.rnext);
+		jsonl_uint(",\"firstright\":", p->btree_split.xlrec.firstright);
+#else
+		jsonl_uint("\"leftsib\":", p->btree_split.xlrec.leftblk);
+		jsonl_uint(",\"rightsib\":", p->btree_split.xlrec.rightblk);
+#endif
+		jsonl_uint(",\"level\":", p->btree_split.xlrec.level);
+		if (p->btree_split.has_downlink)
+			jsonl_uint(",\"downlink\":", p->btree_split.downlink);
+		else
+			jsonl_null(",\"downlink\":");
+		if (p->btree_split.newitemoff != InvalidOffsetNumber)
+			jsonl_uint(",\"newitemoff\":", p->btree_split.newitemoff);
+		else
+			jsonl_null(",\"newitemoff\":");
+		break;
+
+	case XLOG_BTREE_DELETE:
+		jsonl_uint("\"block\":", p->btree_delete.block);
+		break;
+
+	case XLOG_BTREE_DELETE_PAGE:
+	case XLOG_BTREE_DELETE_PAGE_HALF:
+	case XLOG_BTREE_DELETE_PAGE_META:
+		jsonl_uint("\"deadblk\":", p->btree_delete_page.xlrec.deadblk);
+		jsonl_uint(",\"leftblk\":", p->btree_delete_page.xlrec.leftblk);
+		jsonl_uint(",\"rightblk\":", p->btree_delete_page.xlrec.rightblk);
+		if (dec->info == XLOG_BTREE_DELETE_PAGE_META)
+		{
+			jsonl_uint(",\"root\":", p->btree_delete_page.md.root);
+			jsonl_uint(",\"level\":", p->btree_delete_page.md.level);
+		}
+		break;
+
+	case XLOG_BTREE_NEWROOT:
+		jsonl_uint("\"rootblk\":", p->btree_newroot.rootblk);
+		jsonl_uint(",\"level\":", p->btree_newroot.level);
+		break;
+	}
+}
+
+/*
+ * jsonl_fields()
+ *
+ * prints the "fields" object from the decoded record data, or null if
+ * the operation has no data to decode.
+ */
+static void
+jsonl_fields(DecodedRecord *dec)
+{
+	if (!dec->has_payload)
+	{
+		jsonl_null(",\"fields\":");
+		return;
+	}
+
+	out_str(",\"fields\":{");
+	switch (dec->record->xl_rmid)
+	{
+	case RM_XLOG_ID:
+		jsonl_fields_xlog(dec);
+		break;
+	case RM_XACT_ID:
+		jsonl_fields_xact(dec);
+		break;
+	case RM_SMGR_ID:
+	case RM_CLOG_ID:
+	case RM_DBASE_ID:
+	case RM_MULTIXACT_ID:
+#if PG_VERSION_NUM >= 90000
+	case RM_RELMAP_ID:
+#endif
+		jsonl_fields_storage(dec);
+		break;
+	case RM_HEAP2_ID:
+		jsonl_fields_heap2(dec);
+		break;
+	case RM_HEAP_ID:
+		jsonl_fields_heap(dec);
+		break;
+	case RM_BTREE_ID:
+		jsonl_fields_btree(dec);
+		break;
+	}
+	out_char('}');
+}
+
+/*
+ * jsonl_write_record()
+ *
+ * prints the record as a line of JSON. The record must have been read
+ * as a whole.
+ */
+void
+jsonl_write_record(DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	int i;
+
+	decode_fields(dec, DECODE_OP | DECODE_RELATION | DECODE_TID |
+		      DECODE_TIME | DECODE_REDO | DECODE_PAYLOAD | DECODE_BKP);
+
+	jsonl_lsn("{\"lsn\":", dec->lsn);
+	jsonl_lsn(",\"prev\":", record->xl_prev);
+	jsonl_uint(",\"xid\":", record->xl_xid);
+	jsonl_uint(",\"rmid\":", record->xl_rmid);
+	if (record->xl_rmid <= RM_MAX_ID)
+		jsonl_str(",\"rmgr\":", RM_table[record->xl_rmid].name);
+	else
+		jsonl_null(",\"rmgr\":");
+	jsonl_uint(",\"info\":", record->xl_info);
+	jsonl_uint(",\"len\":", record->xl_len);
+	jsonl_uint(",\"tot_len\":", record->xl_tot_len);
+
+	if (dec->op != NULL)
+		jsonl_str(",\"op\":", dec->op);
+	else
+		jsonl_null(",\"op\":");
+
+	if (dec->has_node)
+	{
+		out_str(",\"relfilenode\":");
+		jsonl_node(&dec->node);
+		out_char('}');
+	}
+	else
+		jsonl_null(",\"relfilenode\":");
+
+	if (dec->has_tid)
+	{
+		jsonl_uint(",\"block\":", dec->block);
+		if (dec->offset != InvalidOffsetNumber)
+			jsonl_uint(",\"offset\":", dec->offset);
+		else
+			jsonl_null(",\"offset\":");
+	}
+	else
+	{
+		jsonl_null(",\"block\":");
+		jsonl_null(",\"offset\":");
+	}
+
+	if (dec->has_time)
+		out_printf(",\"time\":" INT64_FORMAT, dec->usec);
+	else
+		jsonl_null(",\"time\":");
+
+	if (dec->has_redo)
+		jsonl_lsn(",\"redo\":", dec->redo);
+	else
+		jsonl_null(",\"redo\":");
+
+	jsonl_fields(dec);
+
+	out_str(",\"bkpblocks\":[");
+	for (i = 0; i < dec->nbkp; i++)
+	{
+		if (i > 0)
+			out_char(',');
+		jsonl_node(&dec->bkp[i].node);
+		jsonl_uint(",\"block\":", dec->bkp[i].block);
+		jsonl_uint(",\"hole_offset\":", dec->bkp[i].hole_offset);
+		jsonl_uint(",\"hole_length\":", dec->bkp[i].hole_length);
+		out_char('}');
+	}
+	out_str("]}\n");
+}
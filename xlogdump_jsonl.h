@@ -0,0 +1,16 @@
+/*
+ * xlogdump_jsonl.h
+ *
+ * a streaming writer to print each xlog record as a line of JSON.
+ */
+#ifndef __XLOGDUMP_JSONL_H__
+#define __XLOGDUMP_JSONL_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+
+#include "xlogdump_decode.h"
+
+void jsonl_write_record(DecodedRecord *);
+
+#endif /* __XLOGDUMP_JSONL_H__ */
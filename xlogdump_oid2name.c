@@ -6,6 +6,8 @@
  */
 #include "xlogdump_oid2name.h"
 
+#include <pthread.h>
+
 #include "pqexpbuffer.h"
 #include "postgres.h"
 
@@ -13,7 +15,8 @@ static PGconn		*conn = NULL; /* Connection for translating oids of global object
 
 static PGresult		*_res = NULL; /* a result set variable for relname2attr_*() functions */
 
-static char dbName[NAMEDATALEN];
+/* the cache and the connection, for the formatter threads */
+static pthread_mutex_t name_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static char *pghost = NULL;
 static char *pgport = NULL;
@@ -269,7 +272,9 @@ getSpaceName(uint32 spcid, char *buf, size_t buflen)
 
 	snprintf(dbQry, sizeof(dbQry), "SELECT spcname FROM pg_tablespace WHERE oid = %i", spcid);
 
+	pthread_mutex_lock(&name_lock);
 	oid2name_get_name(spcid, buf, buflen, dbQry);
+	pthread_mutex_unlock(&name_lock);
 
 	return buf;
 }
@@ -285,15 +290,9 @@ getDbName(uint32 dbid, char *buf, size_t buflen)
 
 	snprintf(dbQry, sizeof(dbQry), "SELECT datname FROM pg_database WHERE oid = %i", dbid);
 
-	if ( oid2name_get_name(dbid, buf, buflen, dbQry) )
-	{
-		/*
-		 * Need to keep name of the database going to be connected
-		 * in order to retreive object names (tables, indexes, ...)
-		 * at the next step, particularly in getRelName().
-		 */
-		strncpy(dbName, buf, sizeof(dbName));
-	}
+	pthread_mutex_lock(&name_lock);
+	oid2name_get_name(dbid, buf, buflen, dbQry);
+	pthread_mutex_unlock(&name_lock);
 
 	return buf;
 }
@@ -304,17 +303,23 @@ getDbName(uint32 dbid, char *buf, size_t buflen)
  * Copy a string with oid if not found
  */
 char *
-getRelName(uint32 relid, char *buf, size_t buflen)
+getRelName(uint32 dbid, uint32 relid, char *buf, size_t buflen)
 {
 	char dbQry[1024];
+	char relQry[1024];
+	char dbname[NAMEDATALEN];
+
+	snprintf(dbQry, sizeof(dbQry), "SELECT datname FROM pg_database WHERE oid = %i", dbid);
 
 	/* Try the relfilenode and oid just in case the filenode has changed
 	   If it has changed more than once we can't translate it's name */
-	snprintf(dbQry, sizeof(dbQry), "SELECT relname, oid FROM pg_class WHERE relfilenode = %i OR oid = %i", relid, relid);
+	snprintf(relQry, sizeof(relQry), "SELECT relname, oid FROM pg_class WHERE relfilenode = %i OR oid = %i", relid, relid);
 
+	pthread_mutex_lock(&name_lock);
 	if (cache_get(relid))
 	{
 		snprintf(buf, buflen, "%s", cache_get(relid));
+		pthread_mutex_unlock(&name_lock);
 		return buf;
 	}
 
@@ -323,20 +328,25 @@ getRelName(uint32 relid, char *buf, size_t buflen)
 	 * a different database, it needs to establish a new connection
 	 * to the different database in order to retreive a object name
 	 * from the system catalog.
+	 *
+	 * The database is the one of the relation, looked up under the same
+	 * lock as the relation, since the formatter threads look up the
+	 * relations of several databases at once.
 	 */
-	if (conn && strcmp(PQdb(conn), dbName) != 0)
+	if (conn && oid2name_get_name(dbid, dbname, sizeof(dbname), dbQry) &&
+	    strcmp(PQdb(conn), dbname) != 0)
 	{
 		/*
 		 * Re-connect to the different database.
 		 */
-		if (conn)
-			PQfinish(conn);
+		PQfinish(conn);
 
 		conn = PQsetdbLogin(pghost, pgport, NULL, NULL,
-				    dbName, pguser, pgpass);
+				    dbname, pguser, pgpass);
 	}
 
-	oid2name_get_name(relid, buf, buflen, dbQry);
+	oid2name_get_name(relid, buf, buflen, relQry);
+	pthread_mutex_unlock(&name_lock);
 
 	return buf;
 }
@@ -21,7 +21,7 @@ bool oid2name_to_file(const char *);
 
 char *getSpaceName(uint32, char *, size_t);
 char *getDbName(uint32, char *, size_t);
-char *getRelName(uint32, char *, size_t);
+char *getRelName(uint32, uint32, char *, size_t);
 
 int relname2attr_begin(const char *);
 int relname2attr_fetch(int, attrib_t *);
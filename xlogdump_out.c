@@ -0,0 +1,275 @@
+/*
+ * xlogdump_out.c
+ *
+ * a buffered writer for the xlog record dump, with hand-rolled
+ * formatters for the numbers printed in every record.
+ *
+ * The output is collected in a large buffer, and written to stdout
+ * with write() when it gets full or out_flush() is called. Anything
+ * printed with stdio before is flushed first, so the reports printed
+ * with printf() after out_flush() keep their order as well.
+ *
+ * A thread can capture what it prints into a buffer of its own instead,
+ * to format the records in parallel and write them later in order.
+ */
+#include "xlogdump_out.h"
+
+#include <stdarg.h>
+#include <unistd.h>
+
+static char	outbuf[OUT_BUFSIZE];
+static int	outlen = 0;
+
+/* the buffer of the thread capturing its output, or NULL for stdout */
+static __thread out_buffer_t *capture = NULL;
+
+static void out_write(const char *, size_t);
+static void capture_grow(size_t);
+static char *out_room(size_t);
+
+static void
+out_write(const char *data, size_t len)
+{
+	fflush(stdout);
+
+	while (len > 0)
+	{
+		ssize_t n = write(STDOUT_FILENO, data, len);
+
+		if (n < 0)
+		{
+			perror("write");
+			exit(1);
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+/*
+ * Makes room for len more bytes in the capture buffer.
+ */
+static void
+capture_grow(size_t len)
+{
+	size_t size;
+
+	if (capture->len + len <= capture->size)
+		return;
+
+	size = Max(capture->size * 2, 1024);
+	while (size < capture->len + len)
+		size *= 2;
+	capture->data = (char *) realloc(capture->data, size);
+	if (capture->data == NULL)
+	{
+		fprintf(stderr, "ERROR: out of memory for the output.\n");
+		exit(1);
+	}
+	capture->size = size;
+}
+
+/*
+ * Returns room for len bytes at the end of the output, which are taken
+ * as printed. len must not be over OUT_BUFSIZE.
+ */
+static char *
+out_room(size_t len)
+{
+	char *p;
+
+	if (capture != NULL)
+	{
+		capture_grow(len);
+		p = capture->data + capture->len;
+		capture->len += len;
+		return p;
+	}
+
+	if (outlen + len > OUT_BUFSIZE)
+		out_flush();
+	p = outbuf + outlen;
+	outlen += len;
+	return p;
+}
+
+/*
+ * out_capture_begin()
+ *
+ * prints into the buffer instead of stdout in this thread, until
+ * out_capture_end(). The buffer is grown as needed.
+ */
+void
+out_capture_begin(out_buffer_t *buf)
+{
+	capture = buf;
+}
+
+void
+out_capture_end(void)
+{
+	capture = NULL;
+}
+
+void
+out_flush(void)
+{
+	if (capture != NULL)
+		return;
+	if (outlen > 0)
+		out_write(outbuf, outlen);
+	outlen = 0;
+}
+
+void
+out_char(char c)
+{
+	*out_room(1) = c;
+}
+
+void
+out_str(const char *s)
+{
+	out_bytes(s, strlen(s));
+}
+
+void
+out_bytes(const void *data, size_t len)
+{
+	if (capture == NULL && len > OUT_BUFSIZE)
+	{
+		out_flush();
+		out_write(data, len);
+		return;
+	}
+	memcpy(out_room(len), data, len);
+}
+
+/*
+ * out_uint()
+ *
+ * prints the value as printf("%u") does.
+ */
+void
+out_uint(uint32 v)
+{
+	char digits[10];
+	char *p;
+	int n = 0;
+
+	do
+	{
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v > 0);
+
+	p = out_room(n);
+	while (n > 0)
+		*p++ = digits[--n];
+}
+
+/*
+ * out_int()
+ *
+ * prints the value as printf("%d") does.
+ */
+void
+out_int(int32 v)
+{
+	if (v < 0)
+	{
+		out_char('-');
+		out_uint((uint32) 0 - (uint32) v);
+	}
+	else
+		out_uint((uint32) v);
+}
+
+/*
+ * out_hex()
+ *
+ * prints the value as printf("%X") does.
+ */
+void
+out_hex(uint32 v)
+{
+	static const char hexdigits[] = "0123456789ABCDEF";
+	char digits[8];
+	char *p;
+	int n = 0;
+
+	do
+	{
+		digits[n++] = hexdigits[v & 0xF];
+		v >>= 4;
+	} while (v > 0);
+
+	p = out_room(n);
+	while (n > 0)
+		*p++ = digits[--n];
+}
+
+/*
+ * out_printf()
+ *
+ * prints a formatted string into the buffer, for the lines which are
+ * not printed for every record.
+ */
+void
+out_printf(const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	if (capture != NULL)
+	{
+		/* with room for the terminating NUL, which isn't taken */
+		capture_grow(1);
+		va_start(args, fmt);
+		n = vsnprintf(capture->data + capture->len, capture->size - capture->len, fmt, args);
+		va_end(args);
+		if (n < 0)
+			return;
+		if (capture->len + n >= capture->size)
+		{
+			capture_grow(n + 1);
+			va_start(args, fmt);
+			vsnprintf(capture->data + capture->len, capture->size - capture->len, fmt, args);
+			va_end(args);
+		}
+		capture->len += n;
+		return;
+	}
+
+	va_start(args, fmt);
+	n = vsnprintf(outbuf + outlen, OUT_BUFSIZE - outlen, fmt, args);
+	va_end(args);
+
+	if (n < 0)
+		return;
+	if (outlen + n < OUT_BUFSIZE)
+	{
+		outlen += n;
+		return;
+	}
+
+	/* didn't fit; make room, or print it by itself if too long. */
+	out_flush();
+	if (n < OUT_BUFSIZE)
+	{
+		va_start(args, fmt);
+		vsnprintf(outbuf, OUT_BUFSIZE, fmt, args);
+		va_end(args);
+		outlen = n;
+	}
+	else
+	{
+		char *buf = (char *) malloc(n + 1);
+
+		va_start(args, fmt);
+		vsnprintf(buf, n + 1, fmt, args);
+		va_end(args);
+		out_write(buf, n);
+		free(buf);
+	}
+}
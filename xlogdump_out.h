@@ -0,0 +1,32 @@
+/*
+ * xlogdump_out.h
+ *
+ * a buffered writer for the xlog record dump, with hand-rolled
+ * formatters for the numbers printed in every record.
+ */
+#ifndef __XLOGDUMP_OUT_H__
+#define __XLOGDUMP_OUT_H__
+
+#include "postgres.h"
+
+#define OUT_BUFSIZE	65536
+
+/* a buffer to capture the output of a thread */
+typedef struct {
+	char	*data;
+	uint32	len;
+	uint32	size;		/* allocated */
+} out_buffer_t;
+
+void out_char(char);
+void out_str(const char *);
+void out_bytes(const void *, size_t);
+void out_uint(uint32);
+void out_int(int32);
+void out_hex(uint32);
+void out_printf(const char *, ...);
+void out_flush(void);
+void out_capture_begin(out_buffer_t *);
+void out_capture_end(void);
+
+#endif /* __XLOGDUMP_OUT_H__ */
@@ -0,0 +1,470 @@
+/*
+ * xlogdump_pipeline.c
+ *
+ * a collection of functions to read the segments in reader threads,
+ * to format their records in formatter threads, and to pass them to
+ * the main thread through bounded queues.
+ *
+ * The segments are dealt out to the readers in turn, so the main thread
+ * takes the records of the job-th segment from the (job % nreaders)-th
+ * reader, and gets them in the order of their LSNs.
+ *
+ * Each reader owns PIPELINE_QUEUE_LEN batches, and one more for each
+ * formatter, which go around two single-producer single-consumer rings:
+ * the full ones to the main thread, and the consumed ones back to the
+ * reader. A reader running ahead waits for a batch to be given back.
+ * The rings have no lock; a semaphore counts the batches in each, to
+ * sleep on when it's empty.
+ *
+ * With formatters, a full batch is also put on a queue shared by them,
+ * and whichever takes it prints each of its items into the text of the
+ * batch. The main thread waits for the batch to be formatted when it
+ * comes to it in the ring, so the batches of a single segment are
+ * formatted in parallel, and the main thread only writes them in order.
+ */
+#include "postgres.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "xlogdump_out.h"
+#include "xlogdump_pipeline.h"
+
+typedef struct pipeline_batch_t
+{
+	char	*buf;
+	uint32	size;		/* allocated */
+	uint32	used;
+	out_buffer_t text;	/* printed by a formatter */
+	sem_t	formatted;	/* posted when the text is done */
+	struct pipeline_batch_t *next;	/* in the queue to the formatters */
+} pipeline_batch_t;
+
+typedef struct {
+	pipeline_batch_t **slots;
+	uint32	nslots;
+	uint32	head;		/* next slot to put, by the producer only */
+	uint32	tail;		/* next slot to take, by the consumer only */
+	sem_t	count;		/* batches in the ring */
+} pipeline_ring_t;
+
+struct pipeline_reader_t
+{
+	int		id;
+	pthread_t	thread;
+	pipeline_ring_t	full;		/* to the main thread */
+	pipeline_ring_t	empty;		/* back to the reader */
+	pipeline_batch_t *batch;	/* being filled by the reader */
+	pipeline_batch_t *cur;		/* being consumed by the main thread */
+	uint32		curpos;
+	double		busy;		/* seconds, but waiting for a batch */
+	double		wait;
+};
+
+typedef struct {
+	pthread_t	thread;
+	double		busy;		/* seconds, but waiting for a batch */
+	double		wait;
+} pipeline_formatter_t;
+
+static pipeline_reader_t *readers = NULL;
+static int nreaders = 0;
+static int njobs = 0;
+static pipeline_read_fn read_job = NULL;
+
+static pipeline_formatter_t *formatters = NULL;
+static int nformatters = 0;
+static pipeline_format_fn format_item = NULL;
+
+/* the full batches to be formatted, in the order put */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static pipeline_batch_t *queue_head = NULL;
+static pipeline_batch_t *queue_tail = NULL;
+static bool queue_closed = false;
+
+static double started;
+static double writer_wait = 0;
+
+static double now(void);
+static void wait_sem(sem_t *, double *);
+static void ring_init(pipeline_ring_t *, uint32);
+static void ring_put(pipeline_ring_t *, pipeline_batch_t *);
+static pipeline_batch_t *ring_get(pipeline_ring_t *, double *);
+static void queue_put(pipeline_batch_t *);
+static pipeline_batch_t *queue_get(double *);
+static void format_batch(pipeline_batch_t *);
+static void *reader_main(void *);
+static void *formatter_main(void *);
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Waits for the semaphore, and adds the time waited to *wait.
+ */
+static void
+wait_sem(sem_t *sem, double *wait)
+{
+	if (sem_trywait(sem) != 0)
+	{
+		double t = now();
+
+		while (sem_wait(sem) != 0)
+			;
+		*wait += now() - t;
+	}
+}
+
+static void
+ring_init(pipeline_ring_t *ring, uint32 nslots)
+{
+	ring->slots = (pipeline_batch_t **) malloc(sizeof(pipeline_batch_t *) * nslots);
+	ring->nslots = nslots;
+	ring->head = 0;
+	ring->tail = 0;
+	sem_init(&ring->count, 0, 0);
+}
+
+/*
+ * There are never more batches than slots, so a ring can't be full.
+ * sem_post() orders the store of the slot before the count.
+ */
+static void
+ring_put(pipeline_ring_t *ring, pipeline_batch_t *batch)
+{
+	ring->slots[ring->head % ring->nslots] = batch;
+	ring->head++;
+	sem_post(&ring->count);
+}
+
+/*
+ * Takes a batch, waiting for one if the ring is empty, and adds the
+ * time waited to *wait.
+ */
+static pipeline_batch_t *
+ring_get(pipeline_ring_t *ring, double *wait)
+{
+	pipeline_batch_t *batch;
+
+	wait_sem(&ring->count, wait);
+	batch = ring->slots[ring->tail % ring->nslots];
+	ring->tail++;
+
+	return batch;
+}
+
+static void
+queue_put(pipeline_batch_t *batch)
+{
+	pthread_mutex_lock(&queue_lock);
+	batch->next = NULL;
+	if (queue_tail != NULL)
+		queue_tail->next = batch;
+	else
+		queue_head = batch;
+	queue_tail = batch;
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/*
+ * Takes a batch to be formatted, waiting for one, and adds the time
+ * waited to *wait. Returns NULL when the readers are all done.
+ */
+static pipeline_batch_t *
+queue_get(double *wait)
+{
+	pipeline_batch_t *batch;
+
+	pthread_mutex_lock(&queue_lock);
+	if (queue_head == NULL && !queue_closed)
+	{
+		double t = now();
+
+		while (queue_head == NULL && !queue_closed)
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		*wait += now() - t;
+	}
+	batch = queue_head;
+	if (batch != NULL)
+	{
+		queue_head = batch->next;
+		if (queue_head == NULL)
+			queue_tail = NULL;
+	}
+	pthread_mutex_unlock(&queue_lock);
+
+	return batch;
+}
+
+/*
+ * Prints each item of the batch into its text.
+ */
+static void
+format_batch(pipeline_batch_t *batch)
+{
+	uint32 pos;
+
+	out_capture_begin(&batch->text);
+	for (pos = 0; pos < batch->used; )
+	{
+		pipeline_item_t *item = (pipeline_item_t *) (batch->buf + pos);
+
+		item->textoff = batch->text.len;
+		format_item(item);
+		item->textlen = batch->text.len - item->textoff;
+		pos += item->size;
+	}
+	out_capture_end();
+}
+
+/*
+ * Starts n readers to read the segments from 0 to jobs-1 with fn, and
+ * nf formatters to print their items with ffn, if nf is not 0.
+ */
+void
+pipeline_start(int n, int jobs, pipeline_read_fn fn, int nf, pipeline_format_fn ffn)
+{
+	int nbatches = PIPELINE_QUEUE_LEN + nf;
+	int i, j;
+
+	nreaders = n;
+	njobs = jobs;
+	read_job = fn;
+	nformatters = nf;
+	format_item = ffn;
+	started = now();
+
+	readers = (pipeline_reader_t *) malloc(sizeof(pipeline_reader_t) * n);
+	memset(readers, 0, sizeof(pipeline_reader_t) * n);
+
+	for (i = 0; i < n; i++)
+	{
+		pipeline_reader_t *r = &readers[i];
+
+		r->id = i;
+		ring_init(&r->full, nbatches);
+		ring_init(&r->empty, nbatches);
+		for (j = 0; j < nbatches; j++)
+		{
+			pipeline_batch_t *batch = (pipeline_batch_t *) malloc(sizeof(pipeline_batch_t));
+
+			memset(batch, 0, sizeof(pipeline_batch_t));
+			batch->buf = (char *) malloc(PIPELINE_BATCH_SIZE);
+			batch->size = PIPELINE_BATCH_SIZE;
+			sem_init(&batch->formatted, 0, 0);
+			ring_put(&r->empty, batch);
+		}
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (pthread_create(&readers[i].thread, NULL, reader_main, &readers[i]) != 0)
+		{
+			fprintf(stderr, "ERROR: could not create a reader thread.\n");
+			exit(1);
+		}
+	}
+
+	if (nf == 0)
+		return;
+
+	formatters = (pipeline_formatter_t *) malloc(sizeof(pipeline_formatter_t) * nf);
+	memset(formatters, 0, sizeof(pipeline_formatter_t) * nf);
+	for (i = 0; i < nf; i++)
+	{
+		if (pthread_create(&formatters[i].thread, NULL, formatter_main, &formatters[i]) != 0)
+		{
+			fprintf(stderr, "ERROR: could not create a formatter thread.\n");
+			exit(1);
+		}
+	}
+}
+
+static void *
+reader_main(void *arg)
+{
+	pipeline_reader_t *r = (pipeline_reader_t *) arg;
+	double t = now();
+	int job;
+
+	for (job = r->id; job < njobs; job += nreaders)
+		read_job(r, job);
+
+	r->busy = now() - t - r->wait;
+	return NULL;
+}
+
+static void *
+formatter_main(void *arg)
+{
+	pipeline_formatter_t *f = (pipeline_formatter_t *) arg;
+	pipeline_batch_t *batch;
+	double t = now();
+
+	while ((batch = queue_get(&f->wait)) != NULL)
+	{
+		format_batch(batch);
+		sem_post(&batch->formatted);
+	}
+
+	f->busy = now() - t - f->wait;
+	return NULL;
+}
+
+/*
+ * Reserves an item of the kind in the batch being filled, to be filled
+ * by the reader. The batch is passed on when the item doesn't fit.
+ */
+pipeline_item_t *
+pipeline_alloc(pipeline_reader_t *r, int kind, uint32 bodylen, uint32 datalen)
+{
+	uint32 size = MAXALIGN(sizeof(pipeline_item_t)) + MAXALIGN(bodylen) +
+		MAXALIGN(datalen);
+	pipeline_item_t *item;
+
+	if (r->batch != NULL && r->batch->used + size > r->batch->size)
+		pipeline_end_job(r);
+	if (r->batch == NULL)
+	{
+		r->batch = ring_get(&r->empty, &r->wait);
+		r->batch->used = 0;
+		r->batch->text.len = 0;
+	}
+	if (size > r->batch->size)
+	{
+		/* a huge record, which the batch keeps room for from now on */
+		free(r->batch->buf);
+		r->batch->buf = (char *) malloc(size);
+		r->batch->size = size;
+	}
+
+	item = (pipeline_item_t *) (r->batch->buf + r->batch->used);
+	item->kind = kind;
+	item->size = size;
+	item->bodylen = bodylen;
+	item->datalen = datalen;
+	item->textoff = 0;
+	item->textlen = 0;
+	r->batch->used += size;
+
+	return item;
+}
+
+/*
+ * Passes the batch being filled on to the main thread, and to the
+ * formatters, at the end of a segment or when it's full.
+ */
+void
+pipeline_end_job(pipeline_reader_t *r)
+{
+	pipeline_batch_t *batch = r->batch;
+
+	if (batch == NULL)
+		return;
+	r->batch = NULL;
+	ring_put(&r->full, batch);
+	if (nformatters > 0)
+		queue_put(batch);
+}
+
+/*
+ * Gets the next item of the job-th segment in the main thread, once
+ * its batch has been formatted. It's valid until the next call.
+ */
+pipeline_item_t *
+pipeline_get(int job)
+{
+	pipeline_reader_t *r = &readers[job % nreaders];
+	pipeline_item_t *item;
+
+	if (r->cur != NULL && r->curpos >= r->cur->used)
+	{
+		ring_put(&r->empty, r->cur);
+		r->cur = NULL;
+	}
+	if (r->cur == NULL)
+	{
+		r->cur = ring_get(&r->full, &writer_wait);
+		if (nformatters > 0)
+			wait_sem(&r->cur->formatted, &writer_wait);
+		r->curpos = 0;
+	}
+
+	item = (pipeline_item_t *) (r->cur->buf + r->curpos);
+	r->curpos += item->size;
+
+	return item;
+}
+
+/*
+ * Returns the text printed for the item just got, of item->textlen
+ * bytes.
+ */
+const char *
+pipeline_item_text(int job, const pipeline_item_t *item)
+{
+	pipeline_batch_t *batch = readers[job % nreaders].cur;
+
+	if (item->textlen == 0)
+		return "";
+	return batch->text.data + item->textoff;
+}
+
+/*
+ * Waits for the readers and the formatters, and shows how busy each
+ * stage has been.
+ */
+void
+pipeline_finish(void)
+{
+	double elapsed = now() - started;
+	double busy = 0, wait = 0;
+	int i;
+
+	for (i = 0; i < nreaders; i++)
+	{
+		pthread_join(readers[i].thread, NULL);
+		busy += readers[i].busy;
+		wait += readers[i].wait;
+	}
+	if (elapsed <= 0)
+		elapsed = 1e-9;
+
+	fprintf(stderr, "pipeline: %d readers, %d formatters, %d segments, %.3f sec\n",
+		nreaders, nformatters, njobs, elapsed);
+	fprintf(stderr, "  readers: %.1f%% busy, %.1f%% waiting for the writer\n",
+		100.0 * busy / (elapsed * nreaders),
+		100.0 * wait / (elapsed * nreaders));
+
+	if (nformatters > 0)
+	{
+		pthread_mutex_lock(&queue_lock);
+		queue_closed = true;
+		pthread_cond_broadcast(&queue_cond);
+		pthread_mutex_unlock(&queue_lock);
+
+		busy = wait = 0;
+		for (i = 0; i < nformatters; i++)
+		{
+			pthread_join(formatters[i].thread, NULL);
+			busy += formatters[i].busy;
+			wait += formatters[i].wait;
+		}
+		fprintf(stderr, "  formatters: %.1f%% busy, %.1f%% waiting for the readers\n",
+			100.0 * busy / (elapsed * nformatters),
+			100.0 * wait / (elapsed * nformatters));
+	}
+
+	fprintf(stderr, "  writer: %.1f%% busy, %.1f%% waiting for the readers\n",
+		100.0 * (elapsed - writer_wait) / elapsed,
+		100.0 * writer_wait / elapsed);
+}
@@ -0,0 +1,51 @@
+/*
+ * xlogdump_pipeline.h
+ *
+ * a pipeline to read the segments in reader threads, format their
+ * records in formatter threads, and pass them to the main thread in
+ * order through bounded queues.
+ */
+#ifndef __XLOGDUMP_PIPELINE_H__
+#define __XLOGDUMP_PIPELINE_H__
+
+#include "postgres.h"
+
+/* size of a batch of items, and number of batches per reader */
+#define PIPELINE_BATCH_SIZE	(256 * 1024)
+#define PIPELINE_QUEUE_LEN	4
+
+/*
+ * An item in a batch, followed by its body and data. The kinds are up
+ * to the caller. The text printed for the item by the formatters is
+ * kept with the batch.
+ */
+typedef struct {
+	int	kind;
+	uint32	size;		/* of the whole item, MAXALIGNed */
+	uint32	bodylen;
+	uint32	datalen;
+	uint32	textoff;
+	uint32	textlen;
+} pipeline_item_t;
+
+#define PipelineItemBody(item) \
+	((void *) ((char *) (item) + MAXALIGN(sizeof(pipeline_item_t))))
+#define PipelineItemData(item) \
+	((void *) ((char *) PipelineItemBody(item) + MAXALIGN((item)->bodylen)))
+
+typedef struct pipeline_reader_t pipeline_reader_t;
+
+/* reads the job-th segment in a reader thread */
+typedef void (*pipeline_read_fn) (pipeline_reader_t *, int);
+
+/* prints an item with out_*() in a formatter thread */
+typedef void (*pipeline_format_fn) (pipeline_item_t *);
+
+void pipeline_start(int, int, pipeline_read_fn, int, pipeline_format_fn);
+pipeline_item_t *pipeline_alloc(pipeline_reader_t *, int, uint32, uint32);
+void pipeline_end_job(pipeline_reader_t *);
+pipeline_item_t *pipeline_get(int);
+const char *pipeline_item_text(int, const pipeline_item_t *);
+void pipeline_finish(void);
+
+#endif /* __XLOGDUMP_PIPELINE_H__ */
@@ -0,0 +1,405 @@
+/*
+ * xlogdump_rate.c
+ *
+ * a collection of functions to aggregate the WAL generation rate
+ * into time buckets, using the commit/abort and checkpoint timestamps.
+ *
+ * xlog records don't carry a wall clock time. So, the records are kept
+ * in a pending counter until the next record with a timestamp (a time
+ * anchor) shows up, and then are accounted to the bucket of the anchor,
+ * because a commit record is written after the records of its
+ * transaction.
+ */
+#include "xlogdump_rate.h"
+
+#include <limits.h>
+#include <time.h>
+
+#include "xlogdump_sidecar.h"
+
+/*
+ * Upper limit of the number of buckets. A longer time range, or a bogus
+ * timestamp, doubles the bucket width until the range fits.
+ */
+#define RATE_MAX_BUCKETS	(1024 * 1024)
+
+/* the buckets allocated at first, and the slack left on both ends */
+#define RATE_MIN_SLOTS		64
+
+struct rate_bucket_t {
+	uint64 bytes;
+	uint64 records;
+	uint64 commits;
+	uint64 fpi_bytes;
+};
+
+static int base_interval = 0;			/* bucket width given, in seconds */
+static int interval = 0;			/* the same, doubled to fit */
+
+/*
+ * The buckets in use are buckets[first_bucket .. first_bucket+nbuckets-1],
+ * in an array of nslots with room on both ends, so that the array is
+ * reallocated only when the time range doubles, whichever way it grows.
+ */
+static struct rate_bucket_t *buckets = NULL;
+static int64 base_bucket = 0;			/* bucket number of buckets[0] */
+static int nslots = 0;
+static int first_bucket = 0;
+static int nbuckets = 0;
+static int last_bucket = -1;			/* index of the latest anchor */
+
+static struct rate_bucket_t pending;		/* records not anchored yet */
+
+static int64 floor_div(int64, int64);
+static void rate_coarsen(void);
+static int rate_lookup(pg_time_t);
+static void rate_flush(int);
+
+/*
+ * rate_parse_interval()
+ *
+ * parses an interval string like "1s", "10s", "1min" or "60" and
+ * returns the number of seconds, or -1 if invalid.
+ */
+int
+rate_parse_interval(const char *str)
+{
+	char *unit;
+	long secs;
+
+	secs = strtol(str, &unit, 10);
+	if (unit == str || secs <= 0)
+		return -1;
+
+	if (*unit == '\0' || strcmp(unit, "s") == 0 || strcmp(unit, "sec") == 0)
+		return (int) secs;
+	if (strcmp(unit, "m") == 0 || strcmp(unit, "min") == 0)
+		return (int) (secs * 60);
+	if (strcmp(unit, "h") == 0)
+		return (int) (secs * 3600);
+
+	return -1;
+}
+
+void
+rate_init(int secs)
+{
+	base_interval = secs;
+	interval = secs;
+}
+
+/*
+ * rate_add_record()
+ *
+ * accounts a xlog record to the pending counter.
+ */
+void
+rate_add_record(uint32 tot_len, uint32 fpi_len, bool commit)
+{
+	pending.bytes += tot_len;
+	pending.records++;
+	pending.fpi_bytes += fpi_len;
+	if (commit)
+		pending.commits++;
+}
+
+static int64
+floor_div(int64 a, int64 b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/*
+ * rate_coarsen()
+ *
+ * doubles the bucket width, merging the buckets in pairs, so that the
+ * records are kept in the bucket of their time.
+ */
+static void
+rate_coarsen(void)
+{
+	struct rate_bucket_t *old = buckets;
+	int64 old_base = base_bucket;
+	int old_first = first_bucket;
+	int old_last = last_bucket;
+	int64 lo, hi;
+	int i;
+
+	if (interval > INT_MAX / 2)
+	{
+		fprintf(stderr, "ERROR: The timestamps span too long a time for the time buckets.\n");
+		exit(1);
+	}
+	interval *= 2;
+
+	if (old == NULL)
+		return;
+
+	lo = floor_div(old_base + old_first, 2);
+	hi = floor_div(old_base + old_first + nbuckets - 1, 2);
+
+	nslots = Max(RATE_MIN_SLOTS, (int) (hi - lo + 1) * 2);
+	base_bucket = lo - (nslots - (hi - lo + 1)) / 2;
+	buckets = (struct rate_bucket_t *) malloc(sizeof(struct rate_bucket_t) * nslots);
+	if (buckets == NULL)
+	{
+		fprintf(stderr, "ERROR: out of memory.\n");
+		exit(1);
+	}
+	memset(buckets, 0, sizeof(struct rate_bucket_t) * nslots);
+
+	for (i = old_first ; i < old_first + nbuckets ; i++)
+	{
+		struct rate_bucket_t *to = &buckets[floor_div(old_base + i, 2) - base_bucket];
+
+		to->bytes += old[i].bytes;
+		to->records += old[i].records;
+		to->commits += old[i].commits;
+		to->fpi_bytes += old[i].fpi_bytes;
+	}
+
+	first_bucket = (int) (lo - base_bucket);
+	nbuckets = (int) (hi - lo + 1);
+	if (old_last >= 0)
+		last_bucket = (int) (floor_div(old_base + old_last, 2) - base_bucket);
+
+	free(old);
+}
+
+/*
+ * rate_lookup()
+ *
+ * returns the index of the bucket for the timestamp, extending the
+ * bucket range when needed, and widening the buckets if the range gets
+ * longer than RATE_MAX_BUCKETS.
+ */
+static int
+rate_lookup(pg_time_t t)
+{
+	int64 b;
+	int64 lo;
+	int64 hi;
+
+	for (;;)
+	{
+		b = floor_div(t, interval);
+		lo = b;
+		hi = b;
+		if (nbuckets > 0)
+		{
+			lo = Min(b, base_bucket + first_bucket);
+			hi = Max(b, base_bucket + first_bucket + nbuckets - 1);
+		}
+
+		if (hi - lo + 1 <= RATE_MAX_BUCKETS)
+			break;
+		rate_coarsen();
+	}
+
+	if (buckets == NULL || lo < base_bucket || hi >= base_bucket + nslots)
+	{
+		int newslots = Max(RATE_MIN_SLOTS, (int) (hi - lo + 1) * 2);
+		int64 newbase = lo - (newslots - (hi - lo + 1)) / 2;
+		struct rate_bucket_t *newbuckets;
+
+		newbuckets = (struct rate_bucket_t *) malloc(sizeof(struct rate_bucket_t) * newslots);
+		if (newbuckets == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory.\n");
+			exit(1);
+		}
+		memset(newbuckets, 0, sizeof(struct rate_bucket_t) * newslots);
+
+		if (nbuckets > 0)
+		{
+			int shift = (int) (base_bucket - newbase);
+
+			memcpy(newbuckets + first_bucket + shift, buckets + first_bucket,
+			       sizeof(struct rate_bucket_t) * nbuckets);
+			first_bucket += shift;
+			if (last_bucket >= 0)
+				last_bucket += shift;
+		}
+		if (buckets != NULL)
+			free(buckets);
+
+		buckets = newbuckets;
+		base_bucket = newbase;
+		nslots = newslots;
+	}
+
+	first_bucket = (int) (lo - base_bucket);
+	nbuckets = (int) (hi - lo + 1);
+
+	return (int) (b - base_bucket);
+}
+
+/*
+ * rate_flush()
+ *
+ * moves the pending counter into the bucket.
+ */
+static void
+rate_flush(int idx)
+{
+	buckets[idx].bytes += pending.bytes;
+	buckets[idx].records += pending.records;
+	buckets[idx].commits += pending.commits;
+	buckets[idx].fpi_bytes += pending.fpi_bytes;
+
+	memset(&pending, 0, sizeof(pending));
+}
+
+/*
+ * rate_anchor()
+ *
+ * is called with the timestamp of a commit, abort or checkpoint record,
+ * which has already been added with rate_add_record().
+ */
+void
+rate_anchor(pg_time_t t)
+{
+	int idx = rate_lookup(t);
+
+	rate_flush(idx);
+	last_bucket = idx;
+}
+
+void
+print_xlog_rate(void)
+{
+	int i;
+
+	/* the records after the last anchor go to the last bucket. */
+	if (last_bucket >= 0)
+		rate_flush(last_bucket);
+
+	printf("---------------------------------------------------------------\n");
+	printf("WAL generation rate per %d second%s:\n\n", interval, (interval>1) ? "s" : "");
+	if (interval != base_interval)
+		printf("(widened from %d second%s to fit the time range in %d buckets)\n\n",
+		       base_interval, (base_interval>1) ? "s" : "", RATE_MAX_BUCKETS);
+
+	if (buckets == NULL)
+	{
+		printf("No commit, abort or checkpoint record found to get the time.\n\n");
+		return;
+	}
+
+	printf("%-24s %14s %10s %10s %14s\n",
+	       "time", "bytes", "records", "commits", "fpi bytes");
+
+	for (i=first_bucket ; i<first_bucket+nbuckets ; i++)
+	{
+		char buf[32];
+		char bytes[32], records[32], commits[32], fpi_bytes[32];
+		time_t t = (time_t) ((base_bucket + i) * interval);
+
+		strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S %Z", localtime(&t));
+		snprintf(bytes, sizeof(bytes), UINT64_FORMAT, buckets[i].bytes);
+		snprintf(records, sizeof(records), UINT64_FORMAT, buckets[i].records);
+		snprintf(commits, sizeof(commits), UINT64_FORMAT, buckets[i].commits);
+		snprintf(fpi_bytes, sizeof(fpi_bytes), UINT64_FORMAT, buckets[i].fpi_bytes);
+
+		printf("%-24s %14s %10s %10s %14s\n",
+		       buf, bytes, records, commits, fpi_bytes);
+	}
+	printf("\n");
+}
+
+/*
+ * save_xlog_rate()
+ *
+ * writes the non-empty buckets into a stats file. The records after
+ * the last anchor go to the last bucket, as print_xlog_rate() does.
+ */
+void
+save_xlog_rate(FILE *fp)
+{
+	uint32 n = 0;
+	long pos;
+	int i;
+
+	if (last_bucket >= 0)
+		rate_flush(last_bucket);
+
+	for (i=first_bucket ; i<first_bucket+nbuckets ; i++)
+		if (buckets[i].records > 0)
+			n++;
+
+	pos = sidecar_begin_section(fp, SIDECAR_RATE);
+	sidecar_write_u32(fp, (uint32) interval);
+	sidecar_write_u32(fp, n);
+	for (i=first_bucket ; i<first_bucket+nbuckets ; i++)
+	{
+		if (buckets[i].records == 0)
+			continue;
+		sidecar_write_u64(fp, (uint64) (base_bucket + i));
+		sidecar_write_u64(fp, buckets[i].bytes);
+		sidecar_write_u64(fp, buckets[i].records);
+		sidecar_write_u64(fp, buckets[i].commits);
+		sidecar_write_u64(fp, buckets[i].fpi_bytes);
+	}
+	sidecar_end_section(fp, pos);
+}
+
+void
+load_xlog_rate(FILE *fp)
+{
+	uint32 secs = sidecar_read_u32(fp);
+	uint32 n = sidecar_read_u32(fp);
+	uint32 i;
+
+	/* widened from the same width, maybe another number of times */
+	if (secs < (uint32) base_interval || secs % base_interval != 0 ||
+	    ((secs / base_interval) & (secs / base_interval - 1)) != 0)
+	{
+		fprintf(stderr, "ERROR: The stats file has time buckets of %u seconds, not %d.\n",
+			secs, base_interval);
+		exit(1);
+	}
+	while ((uint32) interval < secs)
+		rate_coarsen();
+
+	for (i=0 ; i<n ; i++)
+	{
+		int64 b = (int64) sidecar_read_u64(fp);
+		struct rate_bucket_t saved;
+		int idx;
+
+		saved.bytes = sidecar_read_u64(fp);
+		saved.records = sidecar_read_u64(fp);
+		saved.commits = sidecar_read_u64(fp);
+		saved.fpi_bytes = sidecar_read_u64(fp);
+
+		idx = rate_lookup((pg_time_t) (b * secs));
+
+		buckets[idx].bytes += saved.bytes;
+		buckets[idx].records += saved.records;
+		buckets[idx].commits += saved.commits;
+		buckets[idx].fpi_bytes += saved.fpi_bytes;
+	}
+}
+
+/*
+ * reset_xlog_rate()
+ *
+ * drops the buckets, and the widening of them. save_xlog_rate() has
+ * already moved the records after the last anchor into the last bucket,
+ * so only the records of a segment without any anchor are still
+ * pending, and they go to the bucket of the first anchor in the next
+ * segment.
+ */
+void
+reset_xlog_rate(void)
+{
+	if (buckets != NULL)
+		free(buckets);
+	buckets = NULL;
+	base_bucket = 0;
+	nslots = 0;
+	first_bucket = 0;
+	nbuckets = 0;
+	last_bucket = -1;
+	interval = base_interval;
+}
@@ -0,0 +1,22 @@
+/*
+ * xlogdump_rate.h
+ *
+ * a collection of functions to aggregate the WAL generation rate
+ * into time buckets, using the commit/abort and checkpoint timestamps.
+ */
+#ifndef __XLOGDUMP_RATE_H__
+#define __XLOGDUMP_RATE_H__
+
+#include "postgres.h"
+
+int rate_parse_interval(const char *);
+
+void rate_init(int);
+void rate_add_record(uint32, uint32, bool);
+void rate_anchor(pg_time_t);
+void print_xlog_rate(void);
+void save_xlog_rate(FILE *);
+void load_xlog_rate(FILE *);
+void reset_xlog_rate(void);
+
+#endif /* __XLOGDUMP_RATE_H__ */
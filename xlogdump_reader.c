@@ -0,0 +1,1032 @@
+/*
+ * xlogdump_reader.c
+ *
+ * a collection of functions to read the xlog records in a segment,
+ * checking the page headers and the CRCs, from a file descriptor, a
+ * mapped file or a memory buffer.
+ *
+ * Based on the original ReadRecord() of xlogdump by Tom Lane.
+ */
+#include "postgres.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/pg_crc.h"
+
+#if PG_VERSION_NUM >= 90200
+ #include "utils/pg_crc_tables.h"
+#else
+ #include "pg_crc32_table.h"
+#endif
+
+#include "xlogdump_reader.h"
+
+/* xl_info of 8.3 to 9.1, when the backup blocks can be removed */
+#define LAYOUT_BKP_REMOVABLE	0x01
+
+static const reader_layout_t layouts[] = {
+	/* the version xlogdump is built against, first to be found first */
+	{XLOG_PAGE_MAGIC, PG_VERSION_NUM / 10000 * 10 + PG_VERSION_NUM / 100 % 100,
+	 sizeof(BkpBlock), XLR_MAX_BKP_BLOCKS,
+#if PG_VERSION_NUM < 80300 || PG_VERSION_NUM >= 90200
+	 false},
+#else
+	 true},
+#endif
+	{0xD062, 83, 20, 3, true},	/* BkpBlock without fork */
+	{0xD063, 84, 24, 3, true},
+	{0xD064, 90, 24, 3, true},
+	{0xD066, 91, 24, 3, true},
+	{0xD071, 92, 24, 4, false},
+	{0, 0, 0, 0, false}
+};
+
+struct xlog_reader
+{
+	/* the page source */
+	int		fd;		/* file to read(), or -1 for the memory */
+	bool		seekable;	/* fd is not a pipe */
+	uint32		pending;	/* bytes of the first page read from a pipe */
+	const char	*base;		/* mapped file or memory buffer */
+	size_t		len;
+	bool		mapped;		/* base is to be unmapped */
+
+	/* the segment, from its file name or the first page header */
+	bool		named;
+	TimeLineID	tli;
+	uint32		id;
+	uint32		seg;
+
+	/* the geometry, from the long page header */
+	uint32		blcksz;
+	uint32		segsize;
+
+	/* the layout of the records, from xlp_magic of the first page */
+	const reader_layout_t *layout;
+
+	int32		pageoff;	/* offset of current page in file */
+	int		recoff;		/* offset of next record in page */
+	char		*page;		/* current page */
+	char		*pagebuf;	/* pages read from fd */
+	XLogRecPtr	recptr;		/* logical address of current record */
+	char		*recbuf;	/* reassembled record */
+	uint32		recbufsize;
+	bool		done;		/* the last record has been returned */
+
+	/* the follow mode, for a segment being written */
+	bool		follow;
+	bool		finished;	/* READER_SWITCH or READER_PARTIAL returned */
+	bool		reread;		/* the page of resume_recoff to be read again */
+	int32		resume_pageoff;	/* where READER_END has been returned */
+	int		resume_recoff;
+	int32		hooked;		/* the last page passed to the page hook */
+
+	reader_hooks_t	hooks;
+	bool		hooks_set;
+	bool		broken;		/* a broken record reported in the follow mode */
+	char		messages[256];	/* messages before the hooks are set */
+	reader_stats_t	stats;
+};
+
+static xlog_reader_t *reader_create(const char *);
+static void read_geometry(xlog_reader_t *, XLogLongPageHeader);
+static void name_segment(xlog_reader_t *, XLogLongPageHeader, const char *);
+static size_t read_full(int, char *, size_t);
+static size_t fill_page(xlog_reader_t *);
+static bool seek_fd(xlog_reader_t *, uint32);
+static bool header_is_current(xlog_reader_t *, XLogPageHeader, uint32);
+static bool page_is_current(xlog_reader_t *);
+static bool tail_is_unwritten(xlog_reader_t *);
+static bool read_page(xlog_reader_t *);
+static bool record_is_valid(xlog_reader_t *, XLogRecord *, XLogRecPtr);
+static bool skip_record(xlog_reader_t *, uint32);
+static void report(xlog_reader_t *, const char *, ...);
+static int next_record(xlog_reader_t *, XLogRecPtr *, XLogRecord **);
+
+/*
+ * Creates a reader of the segment named fname, which gives its
+ * timeline, log id and segment, unless it's not named like a segment.
+ */
+static xlog_reader_t *
+reader_create(const char *fname)
+{
+	xlog_reader_t *r = (xlog_reader_t *) malloc(sizeof(xlog_reader_t));
+	const char *fnamebase;
+
+	memset(r, 0, sizeof(xlog_reader_t));
+	r->fd = -1;
+
+	fnamebase = strrchr(fname, '/');
+	if (fnamebase)
+		fnamebase++;
+	else
+		fnamebase = fname;
+	if (sscanf(fnamebase, "%8x%8x%8x", &r->tli, &r->id, &r->seg) == 3)
+		r->named = true;
+	else
+		r->tli = r->id = r->seg = 0;
+
+	r->blcksz = XLOG_BLCKSZ;
+	r->segsize = XLogSegSize;
+	r->layout = &layouts[0];
+	r->pageoff = -XLOG_BLCKSZ;	/* so 1st increment in read_page gives 0 */
+	r->recoff = 0;
+	r->hooked = -1;
+
+	return r;
+}
+
+/*
+ * Returns the layout of the records of the version whose pages begin
+ * with magic, or NULL if unknown.
+ */
+const reader_layout_t *
+reader_layout_of_magic(uint16 magic)
+{
+	int i;
+
+	for (i = 0; layouts[i].magic != 0; i++)
+	{
+		if (layouts[i].magic == magic)
+			return &layouts[i];
+	}
+	return NULL;
+}
+
+/*
+ * Takes the layout of the records from the magic, and the block size
+ * and the segment size from the long page header on the first page.
+ * They are left as compiled when the header doesn't look valid, as in
+ * a recycled segment.
+ */
+static void
+read_geometry(xlog_reader_t *r, XLogLongPageHeader hdr)
+{
+	const reader_layout_t *layout;
+	uint32 blcksz, segsize;
+
+	layout = reader_layout_of_magic(hdr->std.xlp_magic);
+	if (layout == NULL || !(hdr->std.xlp_info & XLP_LONG_HEADER))
+		return;
+	r->layout = layout;
+
+	blcksz = hdr->xlp_xlog_blcksz;
+	segsize = hdr->xlp_seg_size;
+
+	/* as configure allows: 1kB..64kB blocks, 1MB..1GB segments */
+	if (blcksz >= 1024 && blcksz <= 65536 && (blcksz & (blcksz - 1)) == 0 &&
+	    segsize >= 1024 * 1024 && segsize <= 1024 * 1024 * 1024 &&
+	    (segsize & (segsize - 1)) == 0)
+	{
+		r->blcksz = blcksz;
+		r->segsize = segsize;
+		r->pageoff = -(int32) blcksz;
+	}
+	else
+		report(r, "WARNING: invalid block size %u or segment size %u in the long page header\n",
+		       blcksz, segsize);
+}
+
+/*
+ * Names a segment read from a stream without a segment name, like the
+ * standard input, by the address and the timeline of its first page.
+ */
+static void
+name_segment(xlog_reader_t *r, XLogLongPageHeader hdr, const char *fname)
+{
+	const char *fnamebase = strrchr(fname, '/');
+
+	if (r->named)
+		return;
+
+	if (hdr != NULL && hdr->std.xlp_magic == r->layout->magic &&
+	    (hdr->std.xlp_info & XLP_LONG_HEADER))
+	{
+		r->tli = hdr->std.xlp_tli;
+		r->id = hdr->std.xlp_pageaddr.xlogid;
+		r->seg = hdr->std.xlp_pageaddr.xrecoff / r->segsize;
+		r->named = true;
+	}
+	else
+		report(r, "Can't recognize logfile name '%s'\n",
+		       fnamebase ? fnamebase + 1 : fname);
+}
+
+/*
+ * Reads the segment from fd, which is closed by reader_close(). fd can
+ * be a pipe, which is read through without seeking back.
+ */
+xlog_reader_t *
+reader_open_fd(int fd, const char *fname)
+{
+	xlog_reader_t *r = reader_create(fname);
+	XLogLongPageHeaderData hdr;
+	size_t nread;
+
+	r->fd = fd;
+	nread = read_full(fd, (char *) &hdr, sizeof(hdr));
+	if (nread == sizeof(hdr))
+		read_geometry(r, &hdr);
+	name_segment(r, (nread == sizeof(hdr)) ? &hdr : NULL, fname);
+	r->pagebuf = (char *) malloc(r->blcksz);
+
+	r->seekable = (lseek(fd, 0, SEEK_SET) == 0);
+	if (!r->seekable)
+	{
+		/* keep what has been read, for the first page */
+		memcpy(r->pagebuf, &hdr, nread);
+		r->pending = nread;
+	}
+
+	return r;
+}
+
+/*
+ * Reads the segment mapped from the file at path. Returns NULL with
+ * errno set if it can't be opened or mapped.
+ */
+xlog_reader_t *
+reader_open_mmap(const char *path)
+{
+	xlog_reader_t *r;
+	struct stat st;
+	void *base = NULL;
+	int fd;
+
+	fd = open(path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size > 0)
+	{
+		base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (base == MAP_FAILED)
+		{
+			close(fd);
+			return NULL;
+		}
+	}
+	close(fd);
+
+	r = reader_open_buffer((const char *) base, st.st_size, path);
+	r->mapped = (base != NULL);
+
+	return r;
+}
+
+/*
+ * Reads the segment in the memory, which must be kept until
+ * reader_close(). The pages are not copied.
+ */
+xlog_reader_t *
+reader_open_buffer(const char *base, size_t len, const char *fname)
+{
+	xlog_reader_t *r = reader_create(fname);
+
+	r->base = base;
+	r->len = len;
+	if (len >= sizeof(XLogLongPageHeaderData))
+	{
+		read_geometry(r, (XLogLongPageHeader) base);
+		name_segment(r, (XLogLongPageHeader) base, fname);
+	}
+	else
+		name_segment(r, NULL, fname);
+
+	return r;
+}
+
+void
+reader_close(xlog_reader_t *r)
+{
+	if (r->fd >= 0)
+		close(r->fd);
+	if (r->mapped)
+		munmap((void *) r->base, r->len);
+	if (r->pagebuf)
+		free(r->pagebuf);
+	if (r->recbuf)
+		free(r->recbuf);
+	free(r);
+}
+
+void
+reader_set_hooks(xlog_reader_t *r, const reader_hooks_t *hooks)
+{
+	r->hooks = *hooks;
+	r->hooks_set = true;
+
+	/* the messages about the first page, read by reader_open_*() */
+	if (r->messages[0] != '\0' && r->hooks.report)
+		r->hooks.report(r->hooks.arg, r->messages);
+	r->messages[0] = '\0';
+}
+
+void
+reader_segment(xlog_reader_t *r, TimeLineID *tli, uint32 *id, uint32 *seg)
+{
+	*tli = r->tli;
+	*id = r->id;
+	*seg = r->seg;
+}
+
+uint32
+reader_block_size(xlog_reader_t *r)
+{
+	return r->blcksz;
+}
+
+uint32
+reader_seg_size(xlog_reader_t *r)
+{
+	return r->segsize;
+}
+
+/*
+ * Returns the layout of the records in the segment, which is the one
+ * xlogdump is built against unless the first page tells another.
+ */
+const reader_layout_t *
+reader_layout(xlog_reader_t *r)
+{
+	return r->layout;
+}
+
+const reader_stats_t *
+reader_stats(xlog_reader_t *r)
+{
+	return &r->stats;
+}
+
+/*
+ * Passes a message about a broken page or record to the report hook.
+ * The messages before the hooks are set are kept for them, and nothing
+ * is printed without a report hook. In the follow mode, a message about
+ * the end of what has been written is dropped, and the others end the
+ * segment with READER_END.
+ */
+static void
+report(xlog_reader_t *r, const char *fmt, ...)
+{
+	char buf[1024];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	if (r->follow)
+	{
+		if (tail_is_unwritten(r))
+			return;
+		r->broken = true;
+	}
+
+	if (!r->hooks_set)
+		strlcat(r->messages, buf, sizeof(r->messages));
+	else if (r->hooks.report)
+		r->hooks.report(r->hooks.arg, buf);
+}
+
+/*
+ * Reads len bytes, unless the file ends. A pipe may give fewer bytes
+ * at a time.
+ */
+static size_t
+read_full(int fd, char *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len)
+	{
+		ssize_t n = read(fd, buf + done, len - done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+/*
+ * Reads the next page from fd into pagebuf, after the part of the first
+ * page which has been read from a pipe.
+ */
+static size_t
+fill_page(xlog_reader_t *r)
+{
+	size_t nread = r->pending;
+
+	nread += read_full(r->fd, r->pagebuf + r->pending, r->blcksz - r->pending);
+	r->pending = 0;
+
+	return nread;
+}
+
+/*
+ * Moves fd to the offset. A pipe can't move backward, and is read
+ * through up to the offset.
+ */
+static bool
+seek_fd(xlog_reader_t *r, uint32 off)
+{
+	uint32 pos = (uint32) (r->pageoff + r->blcksz);	/* of the next page */
+
+	if (r->seekable)
+		return (lseek(r->fd, off, SEEK_SET) >= 0);
+
+	if (off < pos)
+		return false;
+	for (; pos < off; pos += r->blcksz)
+	{
+		if (fill_page(r) != r->blcksz)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * In the follow mode, the pages after the ones written are zeroed, or
+ * left from the recycled segment, which are told by their addresses.
+ */
+static bool
+header_is_current(xlog_reader_t *r, XLogPageHeader hdr, uint32 off)
+{
+	return (hdr->xlp_magic == r->layout->magic &&
+		hdr->xlp_pageaddr.xlogid == r->id &&
+		hdr->xlp_pageaddr.xrecoff == r->seg * r->segsize + off);
+}
+
+static bool
+page_is_current(xlog_reader_t *r)
+{
+	return header_is_current(r, (XLogPageHeader) r->page,
+				 (uint32) (r->pageoff + r->blcksz));
+}
+
+/*
+ * In the follow mode, a broken record on the last page written is one
+ * being written, unless the page after it has been written too. The
+ * page is looked at without reading it, and the last page of the
+ * segment, or of a pipe, is taken as being written.
+ */
+static bool
+tail_is_unwritten(xlog_reader_t *r)
+{
+	XLogPageHeaderData hdr;
+	uint32 next = (uint32) (r->pageoff + r->blcksz);
+
+	if (next + sizeof(hdr) > r->segsize)
+		return true;
+
+	if (r->fd >= 0)
+	{
+		if (!r->seekable ||
+		    pread(r->fd, &hdr, sizeof(hdr), next) != sizeof(hdr))
+			return true;
+	}
+	else
+	{
+		if (next + sizeof(hdr) > r->len)
+			return true;
+		memcpy(&hdr, r->base + next, sizeof(hdr));
+	}
+
+	return !header_is_current(r, &hdr, next);
+}
+
+/* Read another page, if possible */
+static bool
+read_page(xlog_reader_t *r)
+{
+	size_t nread;
+
+	if (r->fd >= 0)
+	{
+		nread = fill_page(r);
+		r->page = r->pagebuf;
+	}
+	else
+	{
+		size_t pos = (size_t) (r->pageoff + r->blcksz);
+
+		nread = (pos < r->len) ? Min(r->len - pos, r->blcksz) : 0;
+		r->page = (char *) r->base + pos;
+	}
+
+	if (r->follow && (nread != r->blcksz || !page_is_current(r)))
+		return false;
+
+	if (nread == r->blcksz)
+	{
+		r->pageoff += r->blcksz;
+		if (((XLogPageHeader) r->page)->xlp_magic != r->layout->magic)
+		{
+			report(r, "Bogus page magic number %04X at offset %X\n",
+			       ((XLogPageHeader) r->page)->xlp_magic, r->pageoff);
+		}
+
+		/*
+		 * FIXME: check xlp_magic here.
+		 */
+		/* a page read again in the follow mode has been passed */
+		if (r->hooks.page && (!r->follow || r->pageoff > r->hooked))
+			r->hooks.page(r->hooks.arg, (XLogPageHeader) r->page,
+				      r->pageoff / r->blcksz);
+		r->hooked = Max(r->hooked, r->pageoff);
+
+		return true;
+	}
+	if (nread != 0)
+	{
+		report(r, "Partial page of %d bytes ignored\n",
+		       (int) nread);
+	}
+	return false;
+}
+
+/*
+ * reader_set_follow()
+ *
+ * reads a segment being written. The records are read as far as they
+ * have been written, where READER_END is returned without a message
+ * about the record broken there, and reader_retry() goes back there.
+ * A record broken before the pages written after it is reported, and
+ * ends the segment.
+ */
+void
+reader_set_follow(xlog_reader_t *r, bool follow)
+{
+	r->follow = follow;
+}
+
+/*
+ * reader_retry()
+ *
+ * goes back to where READER_END has been returned in the follow mode,
+ * to read the records written since. Returns false if the segment has
+ * been read through, up to its end, a XLOG_SWITCH or a broken record.
+ */
+bool
+reader_retry(xlog_reader_t *r)
+{
+	uint32 next;
+
+	if (r->finished)
+		return false;
+
+	if (r->resume_recoff <= 0 || r->resume_recoff > r->blcksz - SizeOfXLogRecord)
+	{
+		/* the next record begins on the next page */
+		next = (uint32) (r->resume_pageoff + r->blcksz);
+		if (next >= r->segsize)
+			return false;
+		r->reread = false;
+	}
+	else
+	{
+		/* the record begins on the page, which is read again */
+		next = (uint32) r->resume_pageoff;
+		r->reread = true;
+	}
+	if (r->fd >= 0 && !seek_fd(r, next))
+		return false;
+	r->pageoff = (int32) next - r->blcksz;
+	r->recoff = r->reread ? r->resume_recoff : 0;
+	r->done = false;
+
+	return true;
+}
+
+/*
+ * reader_seek_page()
+ *
+ * moves to the first record which starts in the page at the offset,
+ * skipping the rest of a record continued from the previous pages.
+ */
+bool
+reader_seek_page(xlog_reader_t *r, uint32 off)
+{
+	if (r->fd >= 0 && !seek_fd(r, off))
+		return false;
+	r->pageoff = off - r->blcksz;
+	r->done = false;
+	r->finished = false;
+	r->reread = false;
+
+	for (;;)
+	{
+		XLogPageHeader hdr;
+		XLogContRecord *contrecord;
+
+		if (! read_page(r))
+			return false;
+		hdr = (XLogPageHeader) r->page;
+		r->recoff = XLogPageHeaderSize(hdr);
+		if (!(hdr->xlp_info & XLP_FIRST_IS_CONTRECORD))
+			return true;
+
+		contrecord = (XLogContRecord *) (r->page + r->recoff);
+		r->recoff += MAXALIGN(contrecord->xl_rem_len + SizeOfXLogContRecord);
+		if (r->recoff <= r->blcksz - SizeOfXLogRecord)
+			return true;
+	}
+}
+
+/*
+ * reader_seek_record()
+ *
+ * moves to the record at the offset, which must be a record boundary.
+ */
+bool
+reader_seek_record(xlog_reader_t *r, uint32 off)
+{
+	uint32 pageoff = off - off % r->blcksz;
+
+	if (r->fd >= 0 && !r->seekable && r->page != NULL &&
+	    pageoff == (uint32) r->pageoff)
+	{
+		/* the page is still in pagebuf, and a pipe can't read it again */
+		if (r->hooks.page)
+			r->hooks.page(r->hooks.arg, (XLogPageHeader) r->page,
+				      r->pageoff / r->blcksz);
+		r->done = false;
+		r->recoff = off % r->blcksz;
+		return true;
+	}
+	if (r->fd >= 0 && !seek_fd(r, pageoff))
+		return false;
+	r->pageoff = pageoff - r->blcksz;
+	r->done = false;
+	r->finished = false;
+	r->reread = false;
+	if (! read_page(r))
+		return false;
+	r->recoff = off % r->blcksz;
+
+	return true;
+}
+
+/*
+ * CRC-check an XLOG record.  We do not believe the contents of an XLOG
+ * record (other than to the minimal extent of computing the amount of
+ * data to read in) until we've checked the CRCs.
+ *
+ * We assume all of the record has been read into memory at *record.
+ */
+static bool
+record_is_valid(xlog_reader_t *r, XLogRecord *record, XLogRecPtr recptr)
+{
+	pg_crc32	crc;
+	int			i;
+	uint32		len = record->xl_len;
+	const reader_layout_t *layout = r->layout;
+	uint16		hole_offset;
+	uint16		hole_length;
+	char	   *blk;
+
+	/* First the rmgr data */
+	INIT_CRC32(crc);
+	COMP_CRC32(crc, XLogRecGetData(record), len);
+
+	/* Add in the backup blocks, if any */
+	blk = (char *) XLogRecGetData(record) + len;
+	for (i = 0; i < layout->max_bkp; i++)
+	{
+		uint32	blen;
+
+		if (!(record->xl_info & XLR_SET_BKP_BLOCK(i)))
+			continue;
+
+		/* every BkpBlock ends with them */
+		memcpy(&hole_offset, blk + layout->bkp_size - 4, sizeof(uint16));
+		memcpy(&hole_length, blk + layout->bkp_size - 2, sizeof(uint16));
+		if (hole_offset + hole_length > BLCKSZ)
+		{
+			report(r, "incorrect hole size in record at %X/%X\n",
+			       recptr.xlogid, recptr.xrecoff);
+			return false;
+		}
+		blen = layout->bkp_size + BLCKSZ - hole_length;
+		COMP_CRC32(crc, blk, blen);
+		blk += blen;
+	}
+
+	/* skip total xl_tot_len check if physical log has been removed. */
+	if (blk != (char *) XLogRecGetData(record) + len ||
+		(layout->bkp_removable && !(record->xl_info & LAYOUT_BKP_REMOVABLE)))
+	{
+		/* Check that xl_tot_len agrees with our calculation */
+		if (blk != (char *) record + record->xl_tot_len)
+		{
+			report(r, "incorrect total length in record at %X/%X\n",
+			       recptr.xlogid, recptr.xrecoff);
+			return false;
+		}
+	}
+
+	/* Finally include the record header */
+	COMP_CRC32(crc, (char *) record + sizeof(pg_crc32),
+			   SizeOfXLogRecord - sizeof(pg_crc32));
+	FIN_CRC32(crc);
+
+	if (!EQ_CRC32(record->xl_crc, crc))
+	{
+		report(r, "incorrect resource manager data checksum in record at %X/%X\n",
+		       recptr.xlogid, recptr.xrecoff);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * reader_next_record()
+ *
+ * reads the next record, and returns READER_RECORD with its location
+ * and the record, which is valid until the next call. A XLOG_SWITCH,
+ * or the header of a record whose continuation can't be read, is
+ * returned as READER_SWITCH or READER_PARTIAL, and then READER_END.
+ */
+int
+reader_next_record(xlog_reader_t *r, XLogRecPtr *lsn, XLogRecord **result)
+{
+	int ret = next_record(r, lsn, result);
+
+	/* a broken record, not one being written, isn't retried */
+	if (ret == READER_END && r->broken)
+		r->finished = true;
+
+	return ret;
+}
+
+static int
+next_record(xlog_reader_t *r, XLogRecPtr *lsn, XLogRecord **result)
+{
+	char	   *buffer;
+	XLogRecord *record;
+	XLogContRecord *contrecord;
+	uint32		len,
+				total_len;
+	int			retries = 0;
+
+	if (r->done)
+		return READER_END;
+	r->done = true;
+	r->broken = false;
+
+	if (r->reread)
+	{
+		/* the page of the record to be read again, as written by now */
+		if (! read_page(r))
+			return READER_END;
+		r->recoff = r->resume_recoff;
+		r->reread = false;
+	}
+
+restart:
+	r->broken = false;
+	r->resume_pageoff = r->pageoff;
+	r->resume_recoff = r->recoff;
+	while (r->recoff <= 0 || r->recoff > r->blcksz - SizeOfXLogRecord)
+	{
+		/* Need to advance to new page */
+		if (! read_page(r))
+			return READER_END;
+		r->recoff = XLogPageHeaderSize((XLogPageHeader) r->page);
+		if ((((XLogPageHeader) r->page)->xlp_info & ~XLP_LONG_HEADER) != 0)
+		{
+			report(r, "Unexpected page info flags %04X at offset %X\n",
+			       ((XLogPageHeader) r->page)->xlp_info, r->pageoff);
+			/* Check for a continuation record */
+			if (((XLogPageHeader) r->page)->xlp_info & XLP_FIRST_IS_CONTRECORD)
+			{
+				report(r, "Skipping unexpected continuation record at offset %X\n",
+				       r->pageoff);
+				contrecord = (XLogContRecord *) (r->page + r->recoff);
+				r->recoff += MAXALIGN(contrecord->xl_rem_len + SizeOfXLogContRecord);
+			}
+		}
+	}
+
+	r->recptr.xlogid = r->id;
+	r->recptr.xrecoff = r->seg * r->segsize + r->pageoff + r->recoff;
+	record = (XLogRecord *) (r->page + r->recoff);
+	*lsn = r->recptr;
+
+	if (record->xl_len == 0)
+	{
+		/* Stop if XLOG_SWITCH was found. */
+		if (record->xl_rmid == RM_XLOG_ID && record->xl_info == XLOG_SWITCH)
+		{
+			*result = record;
+			r->finished = true;
+			return READER_SWITCH;
+		}
+		/* the rest of the page being written is zeroed */
+		if (r->follow && tail_is_unwritten(r))
+			return READER_END;
+
+		report(r, "ReadRecord: record with zero len at %u/%08X\n",
+		       r->recptr.xlogid, r->recptr.xrecoff);
+
+		/* Attempt to recover on new page, but give up after a few... */
+		r->recoff = 0;
+		if (++retries > 4)
+			return READER_END;
+		goto restart;
+	}
+	if (record->xl_tot_len < SizeOfXLogRecord + record->xl_len ||
+		record->xl_tot_len > SizeOfXLogRecord + record->xl_len +
+		r->layout->max_bkp * (r->layout->bkp_size + BLCKSZ))
+	{
+		report(r,
+		       "invalid record length(expected %lu ~ %lu, actual %d) at %X/%X\n",
+		       (unsigned long) (SizeOfXLogRecord + record->xl_len),
+		       (unsigned long) (SizeOfXLogRecord + record->xl_len +
+					r->layout->max_bkp * (r->layout->bkp_size + BLCKSZ)),
+		       record->xl_tot_len,
+		       r->recptr.xlogid, r->recptr.xrecoff);
+		report(r, "HINT: Make sure you're using the correct xlogdump binary built against\n"
+		       "      the same architecture and version of PostgreSQL where the WAL file\n"
+		       "      comes from.\n");
+		return READER_END;
+	}
+	total_len = record->xl_tot_len;
+
+	/*
+	 * A record which the skip hook rejects on its header is passed over
+	 * without copying or verifying it.
+	 */
+	if (r->hooks.skip && r->hooks.skip(r->hooks.arg, r, r->recptr, record))
+	{
+		if (!skip_record(r, total_len))
+			return READER_END;
+		goto restart;
+	}
+
+	/*
+	 * Allocate or enlarge recbuf as needed.  To avoid useless small
+	 * increases, round its size to a multiple of the block size, and make
+	 * sure it's at least 4*BLCKSZ to start with.  (That is enough for all
+	 * "normal" records, but very large commit or abort records might need
+	 * more space.)
+	 */
+	if (total_len > r->recbufsize)
+	{
+		uint32		newSize = total_len;
+
+		newSize += r->blcksz - (newSize % r->blcksz);
+		newSize = Max(newSize, 4 * r->blcksz);
+		if (r->recbuf)
+			free(r->recbuf);
+		r->recbuf = (char *) malloc(newSize);
+		if (!r->recbuf)
+		{
+			r->recbufsize = 0;
+			/* We treat this as a "bogus data" condition */
+			report(r, "record length %u at %X/%X too long\n",
+			       total_len, r->recptr.xlogid, r->recptr.xrecoff);
+			return READER_END;
+		}
+		r->recbufsize = newSize;
+	}
+
+	buffer = r->recbuf;
+	len = r->blcksz - r->recptr.xrecoff % r->blcksz; /* available in block */
+	if (total_len > len)
+	{
+		/* Need to reassemble record */
+		uint32			gotlen = len;
+
+		memcpy(buffer, record, len);
+		record = (XLogRecord *) buffer;
+		buffer += len;
+		for (;;)
+		{
+			uint32	pageHeaderSize;
+
+			if (! read_page(r))
+			{
+				/* not written yet, unless it's in the next segment */
+				if (r->follow && (uint32) (r->pageoff + r->blcksz) < r->segsize)
+					return READER_END;
+
+				/* XXX ought to be able to advance to new input file! */
+				report(r, "Unable to read continuation page?\n");
+				*result = record;
+				r->finished = true;
+				return READER_PARTIAL;
+			}
+			if (!(((XLogPageHeader) r->page)->xlp_info & XLP_FIRST_IS_CONTRECORD))
+			{
+				report(r, "ReadRecord: there is no ContRecord flag in logfile %u seg %u off %u\n",
+				       r->id, r->seg, r->pageoff);
+				return READER_END;
+			}
+			pageHeaderSize = XLogPageHeaderSize((XLogPageHeader) r->page);
+			contrecord = (XLogContRecord *) (r->page + pageHeaderSize);
+			if (contrecord->xl_rem_len == 0 ||
+				total_len != (contrecord->xl_rem_len + gotlen))
+			{
+				report(r, "ReadRecord: invalid cont-record len %u in logfile %u seg %u off %u\n",
+				       contrecord->xl_rem_len, r->id, r->seg, r->pageoff);
+				return READER_END;
+			}
+			len = r->blcksz - pageHeaderSize - SizeOfXLogContRecord;
+			if (contrecord->xl_rem_len > len)
+			{
+				memcpy(buffer, (char *)contrecord + SizeOfXLogContRecord, len);
+				gotlen += len;
+				buffer += len;
+				continue;
+			}
+			memcpy(buffer, (char *) contrecord + SizeOfXLogContRecord,
+				   contrecord->xl_rem_len);
+			r->recoff = MAXALIGN(pageHeaderSize + SizeOfXLogContRecord + contrecord->xl_rem_len);
+			break;
+		}
+	}
+	else
+	{
+		/* Record is contained in this page */
+		memcpy(buffer, record, total_len);
+		record = (XLogRecord *) buffer;
+		r->recoff += MAXALIGN(total_len);
+	}
+	if (!record_is_valid(r, record, r->recptr))
+		return READER_END;
+	r->stats.verified_records++;
+	r->stats.verified_bytes += total_len;
+
+	r->done = false;
+	*result = record;
+	return READER_RECORD;
+}
+
+/*
+ * skip_record()
+ *
+ * moves to the next record, following the continuation pages of
+ * the current record with checking their headers only.
+ */
+static bool
+skip_record(xlog_reader_t *r, uint32 total_len)
+{
+	uint32		len;
+	uint32		gotlen;
+
+	r->stats.skipped_records++;
+	r->stats.skipped_bytes += total_len;
+
+	len = r->blcksz - r->recptr.xrecoff % r->blcksz; /* available in block */
+	if (total_len <= len)
+	{
+		r->recoff += MAXALIGN(total_len);
+		return true;
+	}
+
+	gotlen = len;
+	for (;;)
+	{
+		XLogContRecord *contrecord;
+		uint32	pageHeaderSize;
+
+		if (! read_page(r))
+			return false;
+		if (!(((XLogPageHeader) r->page)->xlp_info & XLP_FIRST_IS_CONTRECORD))
+		{
+			report(r, "ReadRecord: there is no ContRecord flag in logfile %u seg %u off %u\n",
+			       r->id, r->seg, r->pageoff);
+			return false;
+		}
+		pageHeaderSize = XLogPageHeaderSize((XLogPageHeader) r->page);
+		contrecord = (XLogContRecord *) (r->page + pageHeaderSize);
+		if (contrecord->xl_rem_len == 0 ||
+			total_len != (contrecord->xl_rem_len + gotlen))
+		{
+			report(r, "ReadRecord: invalid cont-record len %u in logfile %u seg %u off %u\n",
+			       contrecord->xl_rem_len, r->id, r->seg, r->pageoff);
+			return false;
+		}
+		len = r->blcksz - pageHeaderSize - SizeOfXLogContRecord;
+		if (contrecord->xl_rem_len > len)
+		{
+			gotlen += len;
+			continue;
+		}
+		r->recoff = MAXALIGN(pageHeaderSize + SizeOfXLogContRecord + contrecord->xl_rem_len);
+		return true;
+	}
+}
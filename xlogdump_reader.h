@@ -0,0 +1,85 @@
+/*
+ * xlogdump_reader.h
+ *
+ * a reader of the xlog records in a segment, which is also built as
+ * libxlogreader.a to be embedded into other programs. All the state
+ * is kept in the reader, so that several segments can be read at once.
+ *
+ *   xlog_reader_t *r = reader_open_fd(fd, fname);
+ *
+ *   while ((rc = reader_next_record(r, &lsn, &record)) != READER_END)
+ *       ...
+ *   reader_close(r);
+ */
+#ifndef __XLOGDUMP_READER_H__
+#define __XLOGDUMP_READER_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+
+/* results of reader_next_record() */
+#define READER_END	0	/* no more records in the segment */
+#define READER_RECORD	1	/* a whole record, checked by its CRC */
+#define READER_SWITCH	2	/* a XLOG_SWITCH, the last one of the segment */
+#define READER_PARTIAL	3	/* the header of a record not continued, the last one */
+
+typedef struct xlog_reader xlog_reader_t;
+
+/*
+ * The layout of the records of a major version, told by xlp_magic of
+ * the pages: the record header and the page headers are the same since
+ * 8.3, but the backup blocks are not. The one xlogdump is built against
+ * is the default, for pages of an unknown magic.
+ */
+typedef struct {
+	uint16	magic;		/* XLOG_PAGE_MAGIC */
+	int	version;	/* major version, like 92 */
+	uint32	bkp_size;	/* sizeof(BkpBlock), ending with hole_offset and hole_length */
+	int	max_bkp;	/* XLR_MAX_BKP_BLOCKS */
+	bool	bkp_removable;	/* XLR_BKP_REMOVABLE in xl_info, 8.3 to 9.1 */
+} reader_layout_t;
+
+/*
+ * Called back with each page read, with a record header to be skipped
+ * without reading it through when returning true, and with a message
+ * about broken pages or records. All of them are optional, and the
+ * reader never prints anything itself: the messages are dropped without
+ * the report hook.
+ */
+typedef struct {
+	void	(*page) (void *arg, XLogPageHeader page, uint32 pageno);
+	bool	(*skip) (void *arg, xlog_reader_t *r, XLogRecPtr lsn, XLogRecord *record);
+	void	(*report) (void *arg, const char *msg);
+	void	*arg;
+} reader_hooks_t;
+
+/* records read through or skipped so far */
+typedef struct {
+	uint32	verified_records;
+	uint64	verified_bytes;
+	uint32	skipped_records;
+	uint64	skipped_bytes;
+} reader_stats_t;
+
+/* the page sources */
+xlog_reader_t *reader_open_fd(int, const char *);
+xlog_reader_t *reader_open_mmap(const char *);
+xlog_reader_t *reader_open_buffer(const char *, size_t, const char *);
+void reader_close(xlog_reader_t *);
+
+void reader_set_hooks(xlog_reader_t *, const reader_hooks_t *);
+int reader_next_record(xlog_reader_t *, XLogRecPtr *, XLogRecord **);
+bool reader_seek_page(xlog_reader_t *, uint32);
+bool reader_seek_record(xlog_reader_t *, uint32);
+void reader_set_follow(xlog_reader_t *, bool);
+bool reader_retry(xlog_reader_t *);
+
+void reader_segment(xlog_reader_t *, TimeLineID *, uint32 *, uint32 *);
+uint32 reader_block_size(xlog_reader_t *);
+uint32 reader_seg_size(xlog_reader_t *);
+const reader_layout_t *reader_layout(xlog_reader_t *);
+const reader_layout_t *reader_layout_of_magic(uint16);
+const reader_stats_t *reader_stats(xlog_reader_t *);
+
+#endif /* __XLOGDUMP_READER_H__ */
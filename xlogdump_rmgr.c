@@ -23,36 +23,64 @@
 #include "utils/relmapper.h"
 #endif
 
+#include "xlogdump_decode.h"
+#include "xlogdump_export.h"
 #include "xlogdump_oid2name.h"
+#include "xlogdump_out.h"
+#include "xlogdump_sidecar.h"
 #include "xlogdump_statement.h"
 
+static void account_xlog(DecodedRecord *);
+static void account_xact(DecodedRecord *);
+static void account_heap(DecodedRecord *);
+
+static void print_rmgr_xlog(DecodedRecord *);
+static void print_rmgr_xact(DecodedRecord *);
+static void print_rmgr_smgr(DecodedRecord *);
+static void print_rmgr_clog(DecodedRecord *);
+static void print_rmgr_dbase(DecodedRecord *);
+static void print_rmgr_tblspc(DecodedRecord *);
+static void print_rmgr_multixact(DecodedRecord *);
+#if PG_VERSION_NUM >= 90000
+static void print_rmgr_relmap(DecodedRecord *);
+static void print_rmgr_standby(DecodedRecord *);
+#endif
+static void print_rmgr_heap2(DecodedRecord *);
+static void print_rmgr_heap(DecodedRecord *);
+static void print_rmgr_btree(DecodedRecord *);
+static void print_rmgr_hash(DecodedRecord *);
+static void print_rmgr_gin(DecodedRecord *);
+static void print_rmgr_gist(DecodedRecord *);
+static void print_rmgr_seq(DecodedRecord *);
+
 /*
- * See access/tramsam/rmgr.c for more details.
+ * The resource managers indexed by xl_rmid, with their decode, account
+ * and format callbacks. See access/tramsam/rmgr.c for more details.
  */
-const char * const RM_names[RM_MAX_ID+1] = {
-	"XLOG",						/* 0 */
-	"Transaction",					/* 1 */
-	"Storage",					/* 2 */
-	"CLOG",						/* 3 */
-	"Database",					/* 4 */
-	"Tablespace",					/* 5 */
-	"MultiXact",					/* 6 */
+const rmgr_desc_t RM_table[RM_MAX_ID+1] = {
+	{"XLOG", decode_xlog, account_xlog, print_rmgr_xlog},		/* 0 */
+	{"Transaction", decode_xact, account_xact, print_rmgr_xact},	/* 1 */
+	{"Storage", decode_smgr, NULL, print_rmgr_smgr},		/* 2 */
+	{"CLOG", decode_clog, NULL, print_rmgr_clog},			/* 3 */
+	{"Database", decode_dbase, NULL, print_rmgr_dbase},		/* 4 */
+	{"Tablespace", NULL, NULL, print_rmgr_tblspc},			/* 5 */
+	{"MultiXact", decode_multixact, NULL, print_rmgr_multixact},	/* 6 */
 #if PG_VERSION_NUM >=90000
-	"RelMap",					/* 7 */
-	"Standby",					/* 8 */
+	{"RelMap", decode_relmap, NULL, print_rmgr_relmap},		/* 7 */
+	{"Standby", NULL, NULL, print_rmgr_standby},			/* 8 */
 #else
-	"Reserved 7",					/* 7 */
-	"Reserved 8",					/* 8 */
+	{"Reserved 7", NULL, NULL, NULL},				/* 7 */
+	{"Reserved 8", NULL, NULL, NULL},				/* 8 */
 #endif
-	"Heap2",					/* 9 */
-	"Heap",						/* 10 */
-	"Btree",					/* 11 */
-	"Hash",						/* 12 */
-	"Gin",						/* 13 */
-	"Gist",						/* 14 */
-	"Sequence",					/* 15 */
+	{"Heap2", decode_heap2, NULL, print_rmgr_heap2},		/* 9 */
+	{"Heap", decode_heap, account_heap, print_rmgr_heap},		/* 10 */
+	{"Btree", decode_btree, NULL, print_rmgr_btree},		/* 11 */
+	{"Hash", NULL, NULL, print_rmgr_hash},				/* 12 */
+	{"Gin", NULL, NULL, print_rmgr_gin},				/* 13 */
+	{"Gist", NULL, NULL, print_rmgr_gist},				/* 14 */
+	{"Sequence", decode_seq, NULL, print_rmgr_seq},			/* 15 */
 #if PG_VERSION_NUM >=90200
-	"SPGist"					/* 16 */
+	{"SPGist", NULL, NULL, NULL}					/* 16 */
 #endif
 };
 
@@ -67,29 +95,40 @@ const char * const RM_names[RM_MAX_ID+1] = {
 #define POSTGRES_EPOCH_JDATE	2451545 /* == date2j(2000, 1, 1) */
 
 static bool dump_enabled = true;
+static bool hide_timestamps = false;
+static bool show_statements = false;
 
 struct xlogdump_rmgr_stats_t {
-	int xlog_checkpoint;
-	int xlog_switch;
-	int xlog_backup_end;
-	int xact_commit;
-	int xact_abort;
-	int heap_insert;
-	int heap_delete;
-	int heap_update;
-	int heap_hot_update;
-	int heap_move;
-	int heap_newpage;
-	int heap_lock;
-	int heap_inplace;
-	int heap_init_page;
+	uint64 xlog_checkpoint;
+	uint64 xlog_switch;
+	uint64 xlog_backup_end;
+	uint64 xact_commit;
+	uint64 xact_abort;
+	uint64 heap_insert;
+	uint64 heap_delete;
+	uint64 heap_update;
+	uint64 heap_hot_update;
+	uint64 heap_move;
+	uint64 heap_newpage;
+	uint64 heap_lock;
+	uint64 heap_inplace;
+	uint64 heap_init_page;
 };
 
 static struct xlogdump_rmgr_stats_t rmgr_stats;
 
-static pg_time_t _timestamptz_to_time_t(TimestampTz);
-static char *str_time(time_t);
-static bool dump_xlog_btree_insert_meta(XLogRecord *);
+#define TIME_STR_LEN	64
+
+/* the parts of a time cached by str_time(), which fit in TIME_STR_LEN */
+#define TIME_PREFIX_LEN	32	/* "%Y-%m-%d %H:%M:" */
+#define TIME_ZONE_LEN	16	/* " %Z" */
+
+static block_ref_t block_refs[MAX_BLOCK_REFS];
+static int nblock_refs = 0;
+
+static void add_block_ref(const RelFileNode *, BlockNumber);
+static char *str_time(time_t, char *, size_t);
+static bool dump_xlog_btree_insert_meta(DecodedRecord *);
 /* GIST stuffs */
 static void decodePageUpdateRecord(PageUpdateRecord *, XLogRecord *);
 static void decodePageSplitRecord(PageSplitRecord *, XLogRecord *);
@@ -100,20 +139,20 @@ print_xlog_rmgr_stats(int rmid)
 	switch (rmid)
 	{
 	case RM_XLOG_ID:
-		printf("                 checkpoint: %d, switch: %d, backup end: %d\n",
+		printf("                 checkpoint: " UINT64_FORMAT ", switch: " UINT64_FORMAT ", backup end: " UINT64_FORMAT "\n",
 		       rmgr_stats.xlog_checkpoint,
 		       rmgr_stats.xlog_switch,
 		       rmgr_stats.xlog_backup_end);
 		break;
 
 	case RM_XACT_ID:
-		printf("                 commit: %d, abort: %d\n",
+		printf("                 commit: " UINT64_FORMAT ", abort: " UINT64_FORMAT "\n",
 		       rmgr_stats.xact_commit,
 		       rmgr_stats.xact_abort);
 		break;
 
 	case RM_HEAP_ID:
-		printf("                 ins: %d, upd/hot_upd: %d/%d, del: %d\n",
+		printf("                 ins: " UINT64_FORMAT ", upd/hot_upd: " UINT64_FORMAT "/" UINT64_FORMAT ", del: " UINT64_FORMAT "\n",
 		       rmgr_stats.heap_insert,
 		       rmgr_stats.heap_update,
 		       rmgr_stats.heap_hot_update,
@@ -122,31 +161,117 @@ print_xlog_rmgr_stats(int rmid)
 	}
 }
 
-/* copy from utils/adt/timestamp.c, and renamed because of the name conflict. */
-static pg_time_t
-_timestamptz_to_time_t(TimestampTz t)
+/*
+ * export_xlog_rmgr_stats()
+ *
+ * exports the same counters as print_xlog_rmgr_stats() as one family.
+ */
+void
+export_xlog_rmgr_stats(void)
 {
-  pg_time_t       result;
+	static const struct {
+		int rmid;
+		const char *op;
+		const uint64 *count;
+	} ops[] = {
+		{ RM_XLOG_ID, "checkpoint", &rmgr_stats.xlog_checkpoint },
+		{ RM_XLOG_ID, "switch", &rmgr_stats.xlog_switch },
+		{ RM_XLOG_ID, "backup_end", &rmgr_stats.xlog_backup_end },
+		{ RM_XACT_ID, "commit", &rmgr_stats.xact_commit },
+		{ RM_XACT_ID, "abort", &rmgr_stats.xact_abort },
+		{ RM_HEAP_ID, "insert", &rmgr_stats.heap_insert },
+		{ RM_HEAP_ID, "update", &rmgr_stats.heap_update },
+		{ RM_HEAP_ID, "hot_update", &rmgr_stats.heap_hot_update },
+		{ RM_HEAP_ID, "delete", &rmgr_stats.heap_delete },
+	};
+	int i;
+
+	for (i = 0 ; i < lengthof(ops) ; i++)
+	{
+		const char *labels[] = { "rmgr", RM_table[ops[i].rmid].name, "op", ops[i].op, NULL };
 
-#ifdef HAVE_INT64_TIMESTAMP
-  result = (pg_time_t) (t / USECS_PER_SEC +
-			((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY));
-#else
-  result = (pg_time_t) (t +
-			((POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY));
-#endif
+		export_counter("xlogdump_rmgr_operations_total",
+			       "Number of xlog records per resource manager operation.",
+			       labels, *ops[i].count);
+	}
+}
 
-  return result;
+/*
+ * save_xlog_rmgr_stats()
+ *
+ * writes the counters into a stats file. All the members of
+ * xlogdump_rmgr_stats_t are uint64 counters.
+ */
+void
+save_xlog_rmgr_stats(FILE *fp)
+{
+	const uint64 *counters = (const uint64 *) &rmgr_stats;
+	uint32 n = sizeof(rmgr_stats) / sizeof(uint64);
+	long pos;
+	uint32 i;
+
+	pos = sidecar_begin_section(fp, SIDECAR_RMGR_STATS);
+	sidecar_write_u32(fp, n);
+	for (i = 0 ; i < n ; i++)
+		sidecar_write_u64(fp, counters[i]);
+	sidecar_end_section(fp, pos);
 }
 
+void
+load_xlog_rmgr_stats(FILE *fp)
+{
+	uint64 *counters = (uint64 *) &rmgr_stats;
+	uint32 n = sidecar_read_u32(fp);
+	uint32 i;
+
+	if (n != sizeof(rmgr_stats) / sizeof(uint64))
+	{
+		fprintf(stderr, "ERROR: The stats file has %u rmgr counters, expected %u.\n",
+			n, (uint32) (sizeof(rmgr_stats) / sizeof(uint64)));
+		exit(1);
+	}
+
+	for (i = 0 ; i < n ; i++)
+		counters[i] += sidecar_read_u64(fp);
+}
+
+void
+reset_xlog_rmgr_stats(void)
+{
+	memset(&rmgr_stats, 0, sizeof(rmgr_stats));
+}
+
+/*
+ * str_time()
+ *
+ * formats the time as "%Y-%m-%d %H:%M:%S %Z" into the buffer. The
+ * date, the hour, the minute and the time zone are cached for the local
+ * minute of the last call, so that localtime() and strftime() are
+ * called only once a minute of the records, and the seconds are filled
+ * in by hand. A minute, unlike an hour, never spans a change of the
+ * offset of the time zone, even of the zones shifted by half an hour.
+ * The cache is per thread, for the formatters of the pipeline.
+ */
 static char *
-str_time(time_t tnow)
+str_time(time_t tnow, char *buf, size_t buflen)
 {
-	static char buf[32];
+	static __thread time_t minute_start = -1;
+	static __thread char minute_prefix[TIME_PREFIX_LEN];
+	static __thread char zone_suffix[TIME_ZONE_LEN];
+	unsigned int secs;
 
-	strftime(buf, sizeof(buf),
-			 "%Y-%m-%d %H:%M:%S %Z",
-			 localtime(&tnow));
+	if (minute_start < 0 || tnow < minute_start || tnow >= minute_start + 60)
+	{
+		struct tm tm;
+
+		localtime_r(&tnow, &tm);
+		minute_start = tnow - tm.tm_sec;
+		strftime(minute_prefix, sizeof(minute_prefix), "%Y-%m-%d %H:%M:", &tm);
+		strftime(zone_suffix, sizeof(zone_suffix), " %Z", &tm);
+	}
+
+	secs = (unsigned int) (tnow - minute_start) % 60;
+	snprintf(buf, buflen, "%s%02u%s", minute_prefix, secs, zone_suffix);
 
 	return buf;
 }
@@ -157,32 +282,335 @@ enable_rmgr_dump(bool flag)
 	dump_enabled = flag;
 }
 
+/*
+ * set_rmgr_format()
+ *
+ * sets how the records are printed: without the timestamps, and with
+ * the fake statements of the heap records.
+ */
+void
+set_rmgr_format(bool hideTimestamps, bool statements)
+{
+	hide_timestamps = hideTimestamps;
+	show_statements = statements;
+}
+
+/*
+ * add_block_ref()
+ *
+ * remembers a block touched by the current xlog record. The same block
+ * is remembered only once.
+ */
+static void
+add_block_ref(const RelFileNode *node, BlockNumber block)
+{
+	int i;
+
+	for (i = 0 ; i < nblock_refs ; i++)
+	{
+		if (block_refs[i].block == block &&
+		    block_refs[i].node.relNode == node->relNode &&
+		    block_refs[i].node.dbNode == node->dbNode &&
+		    block_refs[i].node.spcNode == node->spcNode)
+			return;
+	}
+
+	if (nblock_refs >= MAX_BLOCK_REFS)
+		return;
+
+	block_refs[nblock_refs].node = *node;
+	block_refs[nblock_refs].block = block;
+	nblock_refs++;
+}
+
+int
+get_block_refs(const block_ref_t **refs)
+{
+	*refs = block_refs;
+	return nblock_refs;
+}
+
+/*
+ * collect_block_refs()
+ *
+ * collects the blocks touched by a xlog record from its payload and
+ * its backup blocks, whether the record is printed or not.
+ */
+void
+collect_block_refs(DecodedRecord *dec)
+{
+	const DecodedPayload *p = &dec->payload;
+	int i;
+
+	nblock_refs = 0;
+	decode_fields(dec, DECODE_PAYLOAD | DECODE_BKP);
+
+	if (dec->has_payload)
+	{
+		switch (dec->record->xl_rmid)
+		{
+		case RM_HEAP2_ID:
+			switch (dec->info)
+			{
+			case XLOG_HEAP2_FREEZE:
+				add_block_ref(&p->heap_freeze.node, p->heap_freeze.block);
+				break;
+#if PG_VERSION_NUM >= 80300
+			case XLOG_HEAP2_CLEAN:
+#if PG_VERSION_NUM < 90000
+			case XLOG_HEAP2_CLEAN_MOVE:
+#endif
+				add_block_ref(&p->heap_clean.xlrec.node, p->heap_clean.xlrec.block);
+				break;
+#endif
+			}
+			break;
+
+		case RM_HEAP_ID:
+			switch (dec->info & XLOG_HEAP_OPMASK)
+			{
+			case XLOG_HEAP_INSERT:
+				add_block_ref(&p->heap_insert.xlrec.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_insert.xlrec.target.tid));
+				break;
+			case XLOG_HEAP_DELETE:
+				add_block_ref(&p->heap_delete.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_delete.target.tid));
+				break;
+			case XLOG_HEAP_UPDATE:
+#if PG_VERSION_NUM >= 80300
+			case XLOG_HEAP_HOT_UPDATE:
+#endif
+#if PG_VERSION_NUM < 90000
+			case XLOG_HEAP_MOVE:
+#endif
+				add_block_ref(&p->heap_update.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_update.target.tid));
+				add_block_ref(&p->heap_update.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_update.newtid));
+				break;
+			case XLOG_HEAP_NEWPAGE:
+				add_block_ref(&p->heap_newpage.node, p->heap_newpage.blkno);
+				break;
+			case XLOG_HEAP_LOCK:
+				add_block_ref(&p->heap_lock.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_lock.target.tid));
+				break;
+			case XLOG_HEAP_INPLACE:
+				add_block_ref(&p->heap_inplace.target.node,
+					      ItemPointerGetBlockNumber(&p->heap_inplace.target.tid));
+				break;
+			}
+			break;
+
+		case RM_BTREE_ID:
+			switch (dec->info)
+			{
+			case XLOG_BTREE_INSERT_LEAF:
+			case XLOG_BTREE_INSERT_UPPER:
+			case XLOG_BTREE_INSERT_META:
+				add_block_ref(&p->btree_insert.xlrec.target.node,
+					      BlockIdGetBlockNumber(&p->btree_insert.xlrec.target.tid.ip_blkid));
+				break;
+#if PG_VERSION_NUM >= 80300
+			case XLOG_BTREE_SPLIT_L:
+			case XLOG_BTREE_SPLIT_L_ROOT:
+			case XLOG_BTREE_SPLIT_R:
+			case XLOG_BTREE_SPLIT_R_ROOT:
+				add_block_ref(&p->btree_split.xlrec.node, p->btree_split.xlrec.leftsib);
+				add_block_ref(&p->btree_split.xlrec.node, p->btree_split.xlrec.rightsib);
+				break;
+#endif
+			case XLOG_BTREE_DELETE:
+				add_block_ref(&p->btree_delete.node, p->btree_delete.block);
+				break;
+			case XLOG_BTREE_DELETE_PAGE:
+			case XLOG_BTREE_DELETE_PAGE_META:
+			case XLOG_BTREE_DELETE_PAGE_HALF:
+				add_block_ref(&p->btree_delete_page.xlrec.target.node,
+					      BlockIdGetBlockNumber(&p->btree_delete_page.xlrec.target.tid.ip_blkid));
+				add_block_ref(&p->btree_delete_page.xlrec.target.node,
+					      p->btree_delete_page.xlrec.deadblk);
+				break;
+			case XLOG_BTREE_NEWROOT:
+				add_block_ref(&p->btree_newroot.node, p->btree_newroot.rootblk);
+				break;
+			}
+			break;
+		}
+	}
+
+	else
+	{
+		/* a record of another version has its tuple decoded only */
+		decode_fields(dec, DECODE_RELATION | DECODE_TID);
+		if (dec->has_node && dec->has_tid)
+			add_block_ref(&dec->node, dec->block);
+	}
+
+	for (i = 0; i < dec->nbkp; i++)
+		add_block_ref(&dec->bkp[i].node, dec->bkp[i].block);
+}
+
+static void
+account_xlog(DecodedRecord *dec)
+{
+	switch (dec->info)
+	{
+	case XLOG_CHECKPOINT_SHUTDOWN:
+	case XLOG_CHECKPOINT_ONLINE:
+		rmgr_stats.xlog_checkpoint++;
+		break;
+	case XLOG_SWITCH:
+		rmgr_stats.xlog_switch++;
+		break;
+#if PG_VERSION_NUM >= 90000
+	case XLOG_BACKUP_END:
+		rmgr_stats.xlog_backup_end++;
+		break;
+#endif
+	}
+}
+
+static void
+account_xact(DecodedRecord *dec)
+{
+	switch (dec->info)
+	{
+	case XLOG_XACT_COMMIT:
+		rmgr_stats.xact_commit++;
+		break;
+	case XLOG_XACT_ABORT:
+		rmgr_stats.xact_abort++;
+		break;
+	}
+}
+
+static void
+account_heap(DecodedRecord *dec)
+{
+	switch (dec->info & XLOG_HEAP_OPMASK)
+	{
+	case XLOG_HEAP_INSERT:
+		rmgr_stats.heap_insert++;
+		break;
+	case XLOG_HEAP_DELETE:
+		rmgr_stats.heap_delete++;
+		break;
+	case XLOG_HEAP_UPDATE:
+		rmgr_stats.heap_update++;
+		break;
+#if PG_VERSION_NUM >= 80300
+	case XLOG_HEAP_HOT_UPDATE:
+		rmgr_stats.heap_hot_update++;
+		break;
+#endif
+#if PG_VERSION_NUM < 90000
+	case XLOG_HEAP_MOVE:
+		rmgr_stats.heap_move++;
+		break;
+#endif
+	case XLOG_HEAP_NEWPAGE:
+		rmgr_stats.heap_newpage++;
+		break;
+	case XLOG_HEAP_LOCK:
+		rmgr_stats.heap_lock++;
+		break;
+	case XLOG_HEAP_INPLACE:
+		rmgr_stats.heap_inplace++;
+		break;
+	case XLOG_HEAP_INIT_PAGE:
+		rmgr_stats.heap_init_page++;
+		break;
+	}
+}
+
 /*
  * a common part called by each `print_rmgr_*()' to print a xlog record header
  * with the detail.
  */
 static void
-print_rmgr_record(XLogRecPtr cur, XLogRecord *rec, const char *detail)
+print_rmgr_record(DecodedRecord *dec, const char *detail)
 {
 	if (!dump_enabled)
 		return;
 
-	PRINT_XLOGRECORD_HEADER(cur, rec);
-	printf("%s\n", detail);
+	PRINT_XLOGRECORD_HEADER(dec->lsn, dec->record);
+	out_str(detail);
+	out_char('\n');
 }
 
+/*
+ * print_rmgr_decoded()
+ *
+ * prints a record of another version than the one xlogdump is built
+ * against, whose payload can't be decoded, with the fields which have
+ * been: the name of the operation, the relation and the tuple, the
+ * redo pointer and the time.
+ */
 void
-print_rmgr_xlog(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimestamps)
+print_rmgr_decoded(DecodedRecord *dec)
 {
+	char spaceName[NAMEDATALEN];
+	char dbName[NAMEDATALEN];
+	char relName[NAMEDATALEN];
+	char tbuf[TIME_STR_LEN];
 	char buf[1024];
+	char buf2[256];
+
+	decode_fields(dec, DECODE_OP | DECODE_RELATION | DECODE_TID |
+		      DECODE_REDO | DECODE_TIME);
+
+	if (dec->op != NULL)
+		snprintf(buf, sizeof(buf), "%s:", dec->op);
+	else
+		snprintf(buf, sizeof(buf), "info %02X:", dec->info);
+
+	if (dec->has_node)
+	{
+		getSpaceName(dec->node.spcNode, spaceName, sizeof(spaceName));
+		getDbName(dec->node.dbNode, dbName, sizeof(dbName));
+		getRelName(dec->node.dbNode, dec->node.relNode, relName, sizeof(relName));
+		snprintf(buf2, sizeof(buf2), " s/d/r:%s/%s/%s", spaceName, dbName, relName);
+		strlcat(buf, buf2, sizeof(buf));
+	}
+	if (dec->has_tid && dec->offset != InvalidOffsetNumber)
+		snprintf(buf2, sizeof(buf2), " blk/off:%u/%u", dec->block, dec->offset);
+	else if (dec->has_tid)
+		snprintf(buf2, sizeof(buf2), " blk:%u", dec->block);
+	else
+		buf2[0] = '\0';
+	strlcat(buf, buf2, sizeof(buf));
+
+	if (dec->has_redo)
+	{
+		snprintf(buf2, sizeof(buf2), " redo %u/%08X;", dec->redo.xlogid, dec->redo.xrecoff);
+		strlcat(buf, buf2, sizeof(buf));
+	}
+	if (dec->has_time && !hide_timestamps)
+	{
+		snprintf(buf2, sizeof(buf2), " at %s", str_time(dec->time, tbuf, sizeof(tbuf)));
+		strlcat(buf, buf2, sizeof(buf));
+	}
+
+	print_rmgr_record(dec, buf);
+}
+
+static void
+print_rmgr_xlog(DecodedRecord *dec)
+{
+	uint8	info = dec->info;
+	char buf[1024];
+	char tbuf[TIME_STR_LEN];
 
 	switch (info)
 	{
 	case XLOG_CHECKPOINT_SHUTDOWN:
 	case XLOG_CHECKPOINT_ONLINE:
 	{
-		CheckPoint	*checkpoint = (CheckPoint*) XLogRecGetData(record);
-		if(!hideTimestamps)
+		const CheckPoint *checkpoint = &dec->payload.checkpoint;
+
+		if(!hide_timestamps)
 			snprintf(buf, sizeof(buf), "checkpoint: redo %u/%08X; tli %u; nextxid %u;"
 			       "  nextoid %u; nextmulti %u; nextoffset %u; %s at %s",
 			       checkpoint->redo.xlogid, checkpoint->redo.xrecoff,
@@ -192,7 +620,7 @@ print_rmgr_xlog(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 			       checkpoint->nextMultiOffset,
 			       (info == XLOG_CHECKPOINT_SHUTDOWN) ?
 			       "shutdown" : "online",
-			       str_time(checkpoint->time));
+			       str_time(checkpoint->time, tbuf, sizeof(tbuf)));
 		else
 			snprintf(buf, sizeof(buf), "checkpoint: redo %u/%08X; tli %u; nextxid %u;"
 			       "  nextoid %u; nextmulti %u; nextoffset %u; %s",
@@ -203,8 +631,6 @@ print_rmgr_xlog(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 			       checkpoint->nextMultiOffset,
 			       (info == XLOG_CHECKPOINT_SHUTDOWN) ?
 			       "shutdown" : "online");
-		
-		rmgr_stats.xlog_checkpoint++;
 		break;
 	}
 
@@ -218,30 +644,23 @@ print_rmgr_xlog(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 
 	case XLOG_NEXTOID:
 	{
-		Oid		nextOid;
-		
-		memcpy(&nextOid, XLogRecGetData(record), sizeof(Oid));
-		snprintf(buf, sizeof(buf), "nextOid: %u", nextOid);
+		snprintf(buf, sizeof(buf), "nextOid: %u", dec->payload.next_oid);
 		break;
 	}
 
 	case XLOG_SWITCH:
 	{
 		snprintf(buf, sizeof(buf), "switch:");
-		rmgr_stats.xlog_switch++;
 		break;
 	}
 
 #if PG_VERSION_NUM >= 90000
 	case XLOG_BACKUP_END:
 	{
-		XLogRecPtr startpoint;
+		const XLogRecPtr *startpoint = &dec->payload.backup_start;
 
-		memcpy(&startpoint, XLogRecGetData(record), sizeof(XLogRecPtr));
 		snprintf(buf, sizeof(buf), "backup end: started at %X/%X.",
-			 startpoint.xlogid, startpoint.xrecoff);
-
-		rmgr_stats.xlog_backup_end++;
+			 startpoint->xlogid, startpoint->xrecoff);
 		break;
 	}
 
@@ -273,13 +692,15 @@ print_rmgr_xlog(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 		break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimestamps)
+static void
+print_rmgr_xact(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char buf[1024];
+	char tbuf[TIME_STR_LEN];
 
 	memset(buf, 0, sizeof(buf));
 
@@ -287,22 +708,20 @@ print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 	{
 	case XLOG_XACT_COMMIT:
 		{
-		xl_xact_commit	xlrec;
+		const xl_xact_commit *xlrec = &dec->payload.xact_commit;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 #if PG_VERSION_NUM >= 90000
 		snprintf(buf, sizeof(buf), "d/s:%d/%d commit at %s",
-			 xlrec.dbId, xlrec.tsId,
-			 str_time(_timestamptz_to_time_t(xlrec.xact_time)));
+			 xlrec->dbId, xlrec->tsId,
+			 str_time(_timestamptz_to_time_t(xlrec->xact_time), tbuf, sizeof(tbuf)));
 #elif PG_VERSION_NUM >= 80300
 		snprintf(buf, sizeof(buf), "commit at %s",
-			 str_time(_timestamptz_to_time_t(xlrec.xact_time)));
+			 str_time(_timestamptz_to_time_t(xlrec->xact_time), tbuf, sizeof(tbuf)));
 #else
 		snprintf(buf, sizeof(buf), "commit at %s",
-			 str_time(_timestamptz_to_time_t(xlrec.xtime)));
+			 str_time(_timestamptz_to_time_t(xlrec->xtime), tbuf, sizeof(tbuf)));
 #endif
 		}
-		rmgr_stats.xact_commit++;
 		break;
 
 	case XLOG_XACT_PREPARE:
@@ -311,58 +730,55 @@ print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 
 	case XLOG_XACT_ABORT:
 		{
-		xl_xact_abort	xlrec;
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
+		const xl_xact_abort *xlrec = &dec->payload.xact_abort;
+
 		snprintf(buf, sizeof(buf), "abort at %s",
 #if PG_VERSION_NUM >= 80300
-			 str_time(_timestamptz_to_time_t(xlrec.xact_time)));
+			 str_time(_timestamptz_to_time_t(xlrec->xact_time), tbuf, sizeof(tbuf)));
 #else
-			 str_time(_timestamptz_to_time_t(xlrec.xtime)));
+			 str_time(_timestamptz_to_time_t(xlrec->xtime), tbuf, sizeof(tbuf)));
 #endif
 		}
-		rmgr_stats.xact_abort++;
 		break;
 
 	case XLOG_XACT_COMMIT_PREPARED:
 		{
-		xl_xact_commit_prepared	xlrec;
+		const xl_xact_commit_prepared *xlrec = &dec->payload.xact_prepared;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 #if PG_VERSION_NUM >= 90000
 		snprintf(buf, sizeof(buf), "commit prepared xid:%d, dbid:%d, spcid:%d, commit at %s",
-			 xlrec.xid,
-			 xlrec.crec.dbId, xlrec.crec.tsId,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xact_time)));
+			 xlrec->xid,
+			 xlrec->crec.dbId, xlrec->crec.tsId,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xact_time), tbuf, sizeof(tbuf)));
 #elif PG_VERSION_NUM >= 80300
 		snprintf(buf, sizeof(buf), "commit prepared xid:%d, commit at %s",
-			 xlrec.xid,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xact_time)));
+			 xlrec->xid,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xact_time), tbuf, sizeof(tbuf)));
 #else
 		snprintf(buf, sizeof(buf), "commit prepared xid:%d, commit at %s",
-			 xlrec.xid,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xtime)));
+			 xlrec->xid,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xtime), tbuf, sizeof(tbuf)));
 #endif
 		}
 		break;
 
 	case XLOG_XACT_ABORT_PREPARED:
 		{
-		xl_xact_commit_prepared	xlrec;
+		const xl_xact_commit_prepared *xlrec = &dec->payload.xact_prepared;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 #if PG_VERSION_NUM >= 90000
 		snprintf(buf, sizeof(buf), "abort prepared xid:%d, dbid:%d, spcid:%d, commit at %s",
-			 xlrec.xid,
-			 xlrec.crec.dbId, xlrec.crec.tsId,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xact_time)));
+			 xlrec->xid,
+			 xlrec->crec.dbId, xlrec->crec.tsId,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xact_time), tbuf, sizeof(tbuf)));
 #elif PG_VERSION_NUM >= 80300
 		snprintf(buf, sizeof(buf), "abort prepared xid:%d, commit at %s",
-			 xlrec.xid,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xact_time)));
+			 xlrec->xid,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xact_time), tbuf, sizeof(tbuf)));
 #else
 		snprintf(buf, sizeof(buf), "abort prepared xid:%d, commit at %s",
-			 xlrec.xid,
-			 str_time(_timestamptz_to_time_t(xlrec.crec.xtime)));
+			 xlrec->xid,
+			 str_time(_timestamptz_to_time_t(xlrec->crec.xtime), tbuf, sizeof(tbuf)));
 #endif
 		}
 		break;
@@ -370,12 +786,11 @@ print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 #if PG_VERSION_NUM >= 90000
 	case XLOG_XACT_ASSIGNMENT:
 		{
-		xl_xact_assignment	xlrec;
+		const xl_xact_assignment *xlrec = &dec->payload.xact_assignment;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 		snprintf(buf, sizeof(buf), "assignment xtop:%d, nsubxacts:%d",
-			 xlrec.xtop,
-			 xlrec.nsubxacts);
+			 xlrec->xtop,
+			 xlrec->nsubxacts);
 		}
 		break;
 #endif
@@ -383,17 +798,16 @@ print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 #if PG_VERSION_NUM >= 90200
 	case XLOG_XACT_COMMIT_COMPACT:
 		{
-		xl_xact_commit_compact	xlrec;
+		const xl_xact_commit_compact *xlrec = &dec->payload.xact_commit_compact;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 #ifdef HAVE_INT64_TIMESTAMP
 		snprintf(buf, sizeof(buf), "commit_compact xact_time:" INT64_FORMAT ", nsubxacts:%d",
-			 xlrec.xact_time,
-			 xlrec.nsubxacts);
+			 xlrec->xact_time,
+			 xlrec->nsubxacts);
 #else
 		snprintf(buf, sizeof(buf), "commit_compact xact_time:%f, nsubxacts:%d",
-			 xlrec.xact_time,
-			 xlrec.nsubxacts);
+			 xlrec->xact_time,
+			 xlrec->nsubxacts);
 #endif
 		}
 		break;
@@ -404,12 +818,13 @@ print_rmgr_xact(XLogRecPtr cur, XLogRecord *record, uint8 info, bool hideTimesta
 		break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_smgr(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_smgr(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char spaceName[NAMEDATALEN];
 	char dbName[NAMEDATALEN];
 	char relName[NAMEDATALEN];
@@ -419,12 +834,11 @@ print_rmgr_smgr(XLogRecPtr cur, XLogRecord *record, uint8 info)
 	{
 	case XLOG_SMGR_CREATE:
 		{
-		xl_smgr_create	xlrec;
+		const xl_smgr_create *xlrec = &dec->payload.smgr_create;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-		getSpaceName(xlrec.rnode.spcNode, spaceName, sizeof(spaceName));
-		getDbName(xlrec.rnode.dbNode, dbName, sizeof(dbName));
-		getRelName(xlrec.rnode.relNode, relName, sizeof(relName));
+		getSpaceName(xlrec->rnode.spcNode, spaceName, sizeof(spaceName));
+		getDbName(xlrec->rnode.dbNode, dbName, sizeof(dbName));
+		getRelName(xlrec->rnode.dbNode, xlrec->rnode.relNode, relName, sizeof(relName));
 		snprintf(buf, sizeof(buf), "create rel: s/d/r:%s/%s/%s", 
 			spaceName, dbName, relName);
 		}
@@ -432,14 +846,13 @@ print_rmgr_smgr(XLogRecPtr cur, XLogRecord *record, uint8 info)
 
 	case XLOG_SMGR_TRUNCATE:
 		{
-		xl_smgr_truncate	xlrec;
+		const xl_smgr_truncate *xlrec = &dec->payload.smgr_truncate;
 
-		memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-		getSpaceName(xlrec.rnode.spcNode, spaceName, sizeof(spaceName));
-		getDbName(xlrec.rnode.dbNode, dbName, sizeof(dbName));
-		getRelName(xlrec.rnode.relNode, relName, sizeof(relName));
+		getSpaceName(xlrec->rnode.spcNode, spaceName, sizeof(spaceName));
+		getDbName(xlrec->rnode.dbNode, dbName, sizeof(dbName));
+		getRelName(xlrec->rnode.dbNode, xlrec->rnode.relNode, relName, sizeof(relName));
 		snprintf(buf, sizeof(buf), "truncate rel: s/d/r:%s/%s/%s at block %u",
-			 spaceName, dbName, relName, xlrec.blkno);
+			 spaceName, dbName, relName, xlrec->blkno);
 		}
 		break;
 
@@ -448,16 +861,16 @@ print_rmgr_smgr(XLogRecPtr cur, XLogRecord *record, uint8 info)
 		break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_clog(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_clog(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char buf[1024];
 
-	int		pageno;
-	memcpy(&pageno, XLogRecGetData(record), sizeof(int));
+	int		pageno = dec->payload.pageno;
 
 	switch (info)
 	{
@@ -474,12 +887,13 @@ print_rmgr_clog(XLogRecPtr cur, XLogRecord *record, uint8 info)
 		break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_dbase(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_dbase(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char buf[1024];
 
 	/* FIXME: need to be implemented. */
@@ -487,7 +901,7 @@ print_rmgr_dbase(XLogRecPtr cur, XLogRecord *record, uint8 info)
 	{
 	case XLOG_DBASE_CREATE:
 	  {
-	    xl_dbase_create_rec *xlrec = (xl_dbase_create_rec *)XLogRecGetData(record);
+	    const xl_dbase_create_rec *xlrec = &dec->payload.dbase_create;
 	    snprintf(buf, sizeof(buf), "dbase_create: db_id:%d, tablespace_id:%d, src_db_id:%d, src_tablespace_id:%d",
 		     xlrec->db_id,
 		     xlrec->tablespace_id,
@@ -498,7 +912,7 @@ print_rmgr_dbase(XLogRecPtr cur, XLogRecord *record, uint8 info)
 
 	case XLOG_DBASE_DROP:
 	  {
-	    xl_dbase_drop_rec *xlrec = (xl_dbase_drop_rec *)XLogRecGetData(record);
+	    const xl_dbase_drop_rec *xlrec = &dec->payload.dbase_drop;
 	    snprintf(buf, sizeof(buf), "dbase_drop: db_id:%d, tablespace_id:%d",
 		     xlrec->db_id,
 		     xlrec->tablespace_id);
@@ -510,48 +924,42 @@ print_rmgr_dbase(XLogRecPtr cur, XLogRecord *record, uint8 info)
 		break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_tblspc(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_tblspc(DecodedRecord *dec)
 {
 	/* FIXME: need to be implemented. */
-	print_rmgr_record(cur, record, "tblspc");
+	print_rmgr_record(dec, "tblspc");
 }
 
-void
-print_rmgr_multixact(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_multixact(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char buf[1024];
 
 	switch (info & XLOG_HEAP_OPMASK)
 	{
 		case XLOG_MULTIXACT_ZERO_OFF_PAGE:
 		{
-			int		pageno;
-
-			memcpy(&pageno, XLogRecGetData(record), sizeof(int));
-			snprintf(buf, sizeof(buf), "zero offset page 0x%04x", pageno);
+			snprintf(buf, sizeof(buf), "zero offset page 0x%04x", dec->payload.pageno);
 			break;
 		}
 		case XLOG_MULTIXACT_ZERO_MEM_PAGE:
 		{
-			int		pageno;
-
-			memcpy(&pageno, XLogRecGetData(record), sizeof(int));
-			snprintf(buf, sizeof(buf), "zero members page 0x%04x", pageno);
+			snprintf(buf, sizeof(buf), "zero members page 0x%04x", dec->payload.pageno);
 			break;
 		}
 		case XLOG_MULTIXACT_CREATE_ID:
 		{
-			xl_multixact_create xlrec;
+			const xl_multixact_create *xlrec = &dec->payload.multixact_create;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 			snprintf(buf, sizeof(buf), "multixact create: %u off %u nxids %u",
-				   xlrec.mid,
-				   xlrec.moff,
-				   xlrec.nxids);
+				   xlrec->mid,
+				   xlrec->moff,
+				   xlrec->nxids);
 			break;
 		}
 		default:
@@ -559,21 +967,23 @@ print_rmgr_multixact(XLogRecPtr cur, XLogRecord *record, uint8 info)
 			break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
 #if PG_VERSION_NUM >= 90000
 
-void
-print_rmgr_relmap(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_relmap(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char buf[1024];
 
 	switch (info)
 	{
 		case XLOG_RELMAP_UPDATE:
 		{
-			xl_relmap_update *xlrec = (xl_relmap_update *)XLogRecGetData(record);
+			const xl_relmap_update *xlrec = &dec->payload.relmap_update;
+
 			snprintf(buf, sizeof(buf), "update: dbid:%d, tsid:%d, nbytes:%d",
 				 xlrec->dbid,
 				 xlrec->tsid,
@@ -586,21 +996,22 @@ print_rmgr_relmap(XLogRecPtr cur, XLogRecord *record, uint8 info)
 			break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_standby(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_standby(DecodedRecord *dec)
 {
 	/* FIXME: need to be implemented. */
-	print_rmgr_record(cur, record, "standby");
+	print_rmgr_record(dec, "standby");
 }
 
 #endif 
 
-void
-print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_heap2(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char spaceName[NAMEDATALEN];
 	char dbName[NAMEDATALEN];
 	char relName[NAMEDATALEN];
@@ -610,13 +1021,13 @@ print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
 	{
 		case XLOG_HEAP2_FREEZE:
 		{
-			xl_heap_freeze xlrec;
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
+			const xl_heap_freeze *xlrec = &dec->payload.heap_freeze;
+
 			snprintf(buf, sizeof(buf), "freeze: ts %d db %d rel %d block %d cutoff_xid %d",
-				xlrec.node.spcNode,
-				xlrec.node.dbNode,
-				xlrec.node.relNode,
-				xlrec.block, xlrec.cutoff_xid
+				xlrec->node.spcNode,
+				xlrec->node.dbNode,
+				xlrec->node.relNode,
+				xlrec->block, xlrec->cutoff_xid
 			);
 		}
 		break;
@@ -627,19 +1038,11 @@ print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
 		case XLOG_HEAP2_CLEAN_MOVE:
 #endif
 		{
-			xl_heap_clean xlrec;
-			int total_off;
-			int nunused = 0;
-
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
-
-			total_off = (record->xl_len - SizeOfHeapClean) / sizeof(OffsetNumber);
+			const xl_heap_clean *xlrec = &dec->payload.heap_clean.xlrec;
 
-			if (total_off > xlrec.nredirected + xlrec.ndead)
-				nunused = total_off - (xlrec.nredirected + xlrec.ndead);
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 
 #if PG_VERSION_NUM >= 90000
 			snprintf(buf, sizeof(buf), "clean%s: s/d/r:%s/%s/%s block:%u redirected/dead/unused:%d/%d/%d removed xid:%d",
@@ -649,10 +1052,11 @@ print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
 			       info == XLOG_HEAP2_CLEAN_MOVE ? "_move" : "",
 #endif
 			       spaceName, dbName, relName,
-			       xlrec.block,
-			       xlrec.nredirected, xlrec.ndead, nunused
+			       xlrec->block,
+			       xlrec->nredirected, xlrec->ndead,
+			       dec->payload.heap_clean.nunused
 #if PG_VERSION_NUM >= 90000
-			       , xlrec.latestRemovedXid
+			       , xlrec->latestRemovedXid
 #endif
 			       );
 			break;
@@ -662,16 +1066,15 @@ print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
 #if PG_VERSION_NUM >= 90000
 		case XLOG_HEAP2_CLEANUP_INFO:
 		{
-			xl_heap_cleanup_info xlrec;
+			const xl_heap_cleanup_info *xlrec = &dec->payload.heap_cleanup_info;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "cleanup_info: s/d/r:%s/%s/%s removed xid:%d",
 				 spaceName, dbName, relName,
-				 xlrec.latestRemovedXid);
+				 xlrec->latestRemovedXid);
 		}
 		break;
 #endif
@@ -697,12 +1100,14 @@ print_rmgr_heap2(XLogRecPtr cur, XLogRecord *record, uint8 info)
 			break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
+static void
+print_rmgr_heap(DecodedRecord *dec)
 {
+	XLogRecord *record = dec->record;
+	uint8	info = dec->info;
 	char spaceName[NAMEDATALEN];
 	char dbName[NAMEDATALEN];
 	char relName[NAMEDATALEN];
@@ -712,29 +1117,26 @@ print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
 	{
 		case XLOG_HEAP_INSERT:
 		{
-			xl_heap_insert xlrec;
+			const xl_heap_insert *xlrec = &dec->payload.heap_insert.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
-
-			if(statements)
+			if(show_statements)
 				printInsert((xl_heap_insert *) XLogRecGetData(record), record->xl_len - SizeOfHeapInsert - SizeOfHeapHeader, relName);
 
 			snprintf(buf, sizeof(buf), "insert%s: s/d/r:%s/%s/%s blk/off:%u/%u",
 				   (info & XLOG_HEAP_INIT_PAGE) ? "(init)" : "",
 				   spaceName, dbName, relName,
-				   ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   ItemPointerGetOffsetNumber(&xlrec.target.tid));
+				   ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   ItemPointerGetOffsetNumber(&xlrec->target.tid));
 			/* If backup block doesn't exist, dump rmgr data. */
-			if (!(record->xl_info & XLR_BKP_BLOCK_MASK))
+			if (dec->payload.heap_insert.has_header)
 			{
 				char buf2[1024];
+				const xl_heap_header *header = &dec->payload.heap_insert.header;
 
-				xl_heap_header *header = (xl_heap_header *)
-					(XLogRecGetData(record) + SizeOfHeapInsert);
 #if PG_VERSION_NUM >= 80300
 				snprintf(buf2, sizeof(buf2), " header: t_infomask2 %d t_infomask %d t_hoff %d",
 					header->t_infomask2,
@@ -750,29 +1152,24 @@ print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
 			}
 			else
 				strlcat(buf, " header: none", sizeof(buf));
-
-			rmgr_stats.heap_insert++;
 			break;
 		}
 		case XLOG_HEAP_DELETE:
 		{
-			xl_heap_delete xlrec;
+			const xl_heap_delete *xlrec = &dec->payload.heap_delete;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 					
-			if(statements)
-				printf("DELETE FROM %s WHERE ...", relName);
+			if(show_statements)
+				out_printf("DELETE FROM %s WHERE ...", relName);
 					
 			snprintf(buf, sizeof(buf), "delete%s: s/d/r:%s/%s/%s block %u off %u",
 				   (info & XLOG_HEAP_INIT_PAGE) ? "(init)" : "",
 				   spaceName, dbName, relName,
-				   ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   ItemPointerGetOffsetNumber(&xlrec.target.tid));
-
-			rmgr_stats.heap_delete++;
+				   ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   ItemPointerGetOffsetNumber(&xlrec->target.tid));
 			break;
 		}
 		case XLOG_HEAP_UPDATE:
@@ -780,14 +1177,13 @@ print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
 		case XLOG_HEAP_HOT_UPDATE:
 #endif
 		{
-			xl_heap_update xlrec;
+			const xl_heap_update *xlrec = &dec->payload.heap_update;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
-			if(statements)
+			if(show_statements)
 				printUpdate((xl_heap_update *) XLogRecGetData(record), record->xl_len - SizeOfHeapUpdate - SizeOfHeapHeader, relName);
 
 			snprintf(buf, sizeof(buf), "%supdate%s: s/d/r:%s/%s/%s block %u off %u to block %u off %u",
@@ -798,93 +1194,75 @@ print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
 #endif
 				   (info & XLOG_HEAP_INIT_PAGE) ? "(init)" : "",
 				   spaceName, dbName, relName,
-				   ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   ItemPointerGetOffsetNumber(&xlrec.target.tid),
-				   ItemPointerGetBlockNumber(&xlrec.newtid),
-				   ItemPointerGetOffsetNumber(&xlrec.newtid));
-
-			if ((info & XLOG_HEAP_OPMASK) == XLOG_HEAP_UPDATE)
-				rmgr_stats.heap_update++;
-			else
-				rmgr_stats.heap_hot_update++;
+				   ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   ItemPointerGetOffsetNumber(&xlrec->target.tid),
+				   ItemPointerGetBlockNumber(&xlrec->newtid),
+				   ItemPointerGetOffsetNumber(&xlrec->newtid));
 
 			break;
 		}
 #if PG_VERSION_NUM < 90000
 		case XLOG_HEAP_MOVE:
 		{
-			xl_heap_update xlrec;
+			const xl_heap_update *xlrec = &dec->payload.heap_update;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 			snprintf(buf, sizeof(buf), "move%s: s/d/r:%s/%s/%s block %u off %u to block %u off %u",
 				   (info & XLOG_HEAP_INIT_PAGE) ? "(init)" : "",
 				   spaceName, dbName, relName,
-				   ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   ItemPointerGetOffsetNumber(&xlrec.target.tid),
-				   ItemPointerGetBlockNumber(&xlrec.newtid),
-				   ItemPointerGetOffsetNumber(&xlrec.newtid));
-
-			rmgr_stats.heap_move++;
+				   ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   ItemPointerGetOffsetNumber(&xlrec->target.tid),
+				   ItemPointerGetBlockNumber(&xlrec->newtid),
+				   ItemPointerGetOffsetNumber(&xlrec->newtid));
 			break;
 		}
 #endif
 		case XLOG_HEAP_NEWPAGE:
 		{
-			xl_heap_newpage xlrec;
+			const xl_heap_newpage *xlrec = &dec->payload.heap_newpage;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 			snprintf(buf, sizeof(buf), "newpage: s/d/r:%s/%s/%s block %u", 
 					spaceName, dbName, relName,
-				   xlrec.blkno);
-
-			rmgr_stats.heap_newpage++;
+				   xlrec->blkno);
 			break;
 		}
 		case XLOG_HEAP_LOCK:
 		{
-			xl_heap_lock xlrec;
+			const xl_heap_lock *xlrec = &dec->payload.heap_lock;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 			snprintf(buf, sizeof(buf), "lock %s: s/d/r:%s/%s/%s block %u off %u",
-				   xlrec.shared_lock ? "shared" : "exclusive",
+				   xlrec->shared_lock ? "shared" : "exclusive",
 				   spaceName, dbName, relName,
-				   ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   ItemPointerGetOffsetNumber(&xlrec.target.tid));
-
-			rmgr_stats.heap_lock++;
+				   ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   ItemPointerGetOffsetNumber(&xlrec->target.tid));
 			break;
 		}
 
 		case XLOG_HEAP_INPLACE:
 		{
-			xl_heap_inplace xlrec;
+			const xl_heap_inplace *xlrec = &dec->payload.heap_inplace;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 			snprintf(buf, sizeof(buf), "inplace: s/d/r:%s/%s/%s block %u off %u", 
 					spaceName, dbName, relName,
-				   	ItemPointerGetBlockNumber(&xlrec.target.tid),
-				   	ItemPointerGetOffsetNumber(&xlrec.target.tid));
-
-			rmgr_stats.heap_inplace++;
+				   	ItemPointerGetBlockNumber(&xlrec->target.tid),
+				   	ItemPointerGetOffsetNumber(&xlrec->target.tid));
 			break;
 		}
 
 		case XLOG_HEAP_INIT_PAGE:
 		{
 			snprintf(buf, sizeof(buf), "init page");
-			rmgr_stats.heap_init_page++;
 			break;
 		}
 
@@ -893,55 +1271,39 @@ print_rmgr_heap(XLogRecPtr cur, XLogRecord *record, uint8 info, bool statements)
 			break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
 static bool
-dump_xlog_btree_insert_meta(XLogRecord *record)
+dump_xlog_btree_insert_meta(DecodedRecord *dec)
 {
 	char spaceName[NAMEDATALEN];
 	char dbName[NAMEDATALEN];
 	char relName[NAMEDATALEN];
-
-	xl_btree_insert *xlrec = (xl_btree_insert *) XLogRecGetData(record);
-	char *datapos;
-	int datalen;
-	xl_btree_metadata md;
-	BlockNumber downlink;
-
-	/* copied from btree_xlog_insert(nbtxlog.c:191) */
-	datapos = (char *) xlrec + SizeOfBtreeInsert;
-	datalen = record->xl_len - SizeOfBtreeInsert;
+	const xl_btree_insert *xlrec = &dec->payload.btree_insert.xlrec;
+	const xl_btree_metadata *md = &dec->payload.btree_insert.md;
 
 	if ( getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName))==NULL ||
 	     getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName))==NULL ||
-	     getRelName(xlrec->target.node.relNode, relName, sizeof(relName))==NULL )
+	     getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName))==NULL )
 		return false;
 
-	/* downlink */
-	memcpy(&downlink, datapos, sizeof(BlockNumber));
-	datapos += sizeof(BlockNumber);
-	datalen -= sizeof(BlockNumber);
-
-	/* xl_insert_meta */
-	memcpy(&md, datapos, sizeof(xl_btree_metadata));
-	datapos += sizeof(xl_btree_metadata);
-	datalen -= sizeof(xl_btree_metadata);
 
-	printf("insert_meta: index %s/%s/%s tid %u/%u downlink %u froot %u/%u\n", 
+	out_printf("insert_meta: index %s/%s/%s tid %u/%u downlink %u froot %u/%u\n", 
 		spaceName, dbName, relName,
 		BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
 		xlrec->target.tid.ip_posid,
-		downlink,
-		md.fastroot, md.fastlevel
+		dec->payload.btree_insert.downlink,
+		md->fastroot, md->fastlevel
 	);
 
 	return true;
 }
 
-void
-print_rmgr_btree(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_btree(DecodedRecord *dec)
 {
+	uint8	info = dec->info;
 	char spaceName[NAMEDATALEN];
 	char dbName[NAMEDATALEN];
 	char relName[NAMEDATALEN];
@@ -951,93 +1313,80 @@ print_rmgr_btree(XLogRecPtr cur, XLogRecord *record, uint8 info)
 	{
 		case XLOG_BTREE_INSERT_LEAF:
 		{
-			xl_btree_insert xlrec;
+			const xl_btree_insert *xlrec = &dec->payload.btree_insert.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "insert_leaf: s/d/r:%s/%s/%s tid %u/%u",
 					spaceName, dbName, relName,
-				   	BlockIdGetBlockNumber(&xlrec.target.tid.ip_blkid),
-				   	xlrec.target.tid.ip_posid);
+				   	BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
+				   	xlrec->target.tid.ip_posid);
 			break;
 		}
 		case XLOG_BTREE_INSERT_UPPER:
 		{
-			xl_btree_insert xlrec;
+			const xl_btree_insert *xlrec = &dec->payload.btree_insert.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "insert_upper: s/d/r:%s/%s/%s tid %u/%u",
 					spaceName, dbName, relName,
-				   	BlockIdGetBlockNumber(&xlrec.target.tid.ip_blkid),
-				   	xlrec.target.tid.ip_posid);
+				   	BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
+				   	xlrec->target.tid.ip_posid);
 			break;
 		}
 		case XLOG_BTREE_INSERT_META:
-			dump_xlog_btree_insert_meta(record);
+			buf[0] = '\0';
+			dump_xlog_btree_insert_meta(dec);
 			/* FIXME: need to check the result code. */
 			break;
 		case XLOG_BTREE_SPLIT_L:
 		case XLOG_BTREE_SPLIT_L_ROOT:
 		{
-			char *datapos = XLogRecGetData(record);
-			xl_btree_split xlrec;
-			OffsetNumber newitemoff;
+			const xl_btree_split *xlrec = &dec->payload.btree_split.xlrec;
 			char buf2[1024];
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			datapos += SizeOfBtreeSplit;
 #if PG_VERSION_NUM >= 80300
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 #endif
 
 #if PG_VERSION_NUM >= 80300
 			snprintf(buf, sizeof(buf), "split_l%s: s/d/r:%s/%s/%s rightsib %u"
 				 " lsib %u rsib %u rnext %u level %u firstright %u",
 				info == XLOG_BTREE_SPLIT_L_ROOT ? "_root" : "",
-				spaceName, dbName, relName, xlrec.rightsib,
-				xlrec.leftsib, xlrec.rightsib,
-				xlrec.rnext, xlrec.level, xlrec.firstright);
+				spaceName, dbName, relName, xlrec->rightsib,
+				xlrec->leftsib, xlrec->rightsib,
+				xlrec->rnext, xlrec->level, xlrec->firstright);
 #else
 			snprintf(buf, sizeof(buf), "split_l%s: rightblk %u"
 				 " lblk %u rblk %u level %u",
 				info == XLOG_BTREE_SPLIT_L_ROOT ? "_root" : "",
-				xlrec.rightblk,
-				xlrec.leftblk, xlrec.rightblk,
-				xlrec.level);
+				xlrec->rightblk,
+				xlrec->leftblk, xlrec->rightblk,
+				xlrec->level);
 #endif
 
 			/* downlinks */
-			if (xlrec.level > 0)
-			{
-				BlockIdData downlink;
-				memcpy(&downlink, XLogRecGetData(record) + SizeOfBtreeSplit, sizeof(downlink));
-				datapos += sizeof(downlink);
-				printf("downlink: %u\n",
-					BlockIdGetBlockNumber(&downlink));
-			}
-			/* newitemoff */
-			memcpy(&newitemoff, datapos, sizeof(OffsetNumber));
-			datapos += sizeof(OffsetNumber);
+			if (dec->payload.btree_split.has_downlink)
+				out_printf("downlink: %u\n", dec->payload.btree_split.downlink);
 
-			snprintf(buf2, sizeof(buf2), " newitemoff: %u", newitemoff);
+			snprintf(buf2, sizeof(buf2), " newitemoff: %u", dec->payload.btree_split.newitemoff);
 			strlcat(buf, buf2, sizeof(buf));
 
 			/* newitem (only when bkpblock1 is not recorded) */
-			if (!(record->xl_info & XLR_BKP_BLOCK_1))
+			if (dec->payload.btree_split.has_newitem)
 			{
-				IndexTuple newitem = (IndexTuple)datapos;
+				const ItemPointerData *newitem = &dec->payload.btree_split.newitem;
+
 				snprintf(buf2, sizeof(buf2), " newitem: { block %u pos 0x%x }",
-					BlockIdGetBlockNumber(&newitem->t_tid.ip_blkid),
-					newitem->t_tid.ip_posid);
+					BlockIdGetBlockNumber(&newitem->ip_blkid),
+					newitem->ip_posid);
 				strlcat(buf, buf2, sizeof(buf));
 			}
 			/* items in right page should be here */
@@ -1046,104 +1395,95 @@ print_rmgr_btree(XLogRecPtr cur, XLogRecord *record, uint8 info)
 		case XLOG_BTREE_SPLIT_R:
 		case XLOG_BTREE_SPLIT_R_ROOT:
 		{
-			xl_btree_split xlrec;
+			const xl_btree_split *xlrec = &dec->payload.btree_split.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
 #if PG_VERSION_NUM >= 80300
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 #endif
 
 #if PG_VERSION_NUM >= 80300
 			snprintf(buf, sizeof(buf), "split_r%s: s/d/r:%s/%s/%s leftsib %u\n", 
 					info == XLOG_BTREE_SPLIT_R_ROOT ? "_root" : "",
-					spaceName, dbName, relName, xlrec.leftsib);
+					spaceName, dbName, relName, xlrec->leftsib);
 #else
 			snprintf(buf, sizeof(buf), "split_r%s: leftblk %u\n", 
 					info == XLOG_BTREE_SPLIT_R_ROOT ? "_root" : "",
-					xlrec.leftblk);
+					xlrec->leftblk);
 #endif
 			break;
 		}
 		case XLOG_BTREE_DELETE:
 		{
-			xl_btree_delete xlrec;
+			const xl_btree_delete *xlrec = &dec->payload.btree_delete;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 			snprintf(buf, sizeof(buf), "delete: s/d/r:%s/%s/%s block %u", 
 					spaceName, dbName,	relName,
-				   	xlrec.block);
+				   	xlrec->block);
 			break;
 		}
 		case XLOG_BTREE_DELETE_PAGE:
 		{
-			xl_btree_delete_page xlrec;
+			const xl_btree_delete_page *xlrec = &dec->payload.btree_delete_page.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "delete_page: s/d/r:%s/%s/%s tid %u/%u deadblk %u",
 					spaceName, dbName, relName,
-				   	BlockIdGetBlockNumber(&xlrec.target.tid.ip_blkid),
-				   	xlrec.target.tid.ip_posid,
-				   	xlrec.deadblk);
+				   	BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
+				   	xlrec->target.tid.ip_posid,
+				   	xlrec->deadblk);
 			break;
 		}
 		case XLOG_BTREE_DELETE_PAGE_META:
 		{
-			xl_btree_delete_page xlrec;
-			xl_btree_metadata md;
+			const xl_btree_delete_page *xlrec = &dec->payload.btree_delete_page.xlrec;
+			const xl_btree_metadata *md = &dec->payload.btree_delete_page.md;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
-
-			memcpy(&md, XLogRecGetData(record) + sizeof(xlrec),
-				sizeof(xl_btree_metadata));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "delete_page_meta: s/d/r:%s/%s/%s tid %u/%u deadblk %u root %u/%u froot %u/%u", 
 					spaceName, dbName, relName,
-				   	BlockIdGetBlockNumber(&xlrec.target.tid.ip_blkid),
-				   	xlrec.target.tid.ip_posid,
-				   	xlrec.deadblk,
-					md.root, md.level, md.fastroot, md.fastlevel);
+				   	BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
+				   	xlrec->target.tid.ip_posid,
+				   	xlrec->deadblk,
+					md->root, md->level, md->fastroot, md->fastlevel);
 			break;
 		}
 		case XLOG_BTREE_NEWROOT:
 		{
-			xl_btree_newroot xlrec;
+			const xl_btree_newroot *xlrec = &dec->payload.btree_newroot;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->node.dbNode, xlrec->node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "newroot: s/d/r:%s/%s/%s rootblk %u level %u", 
 					spaceName, dbName, relName,
-				   	xlrec.rootblk, xlrec.level);
+				   	xlrec->rootblk, xlrec->level);
 			break;
 		}
 		case XLOG_BTREE_DELETE_PAGE_HALF:
 		{
-			xl_btree_delete_page xlrec;
+			const xl_btree_delete_page *xlrec = &dec->payload.btree_delete_page.xlrec;
 
-			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
-			getSpaceName(xlrec.target.node.spcNode, spaceName, sizeof(spaceName));
-			getDbName(xlrec.target.node.dbNode, dbName, sizeof(dbName));
-			getRelName(xlrec.target.node.relNode, relName, sizeof(relName));
+			getSpaceName(xlrec->target.node.spcNode, spaceName, sizeof(spaceName));
+			getDbName(xlrec->target.node.dbNode, dbName, sizeof(dbName));
+			getRelName(xlrec->target.node.dbNode, xlrec->target.node.relNode, relName, sizeof(relName));
 
 			snprintf(buf, sizeof(buf), "delete_page_half: s/d/r:%s/%s/%s tid %u/%u deadblk %u",
 					spaceName, dbName, relName,
-				   	BlockIdGetBlockNumber(&xlrec.target.tid.ip_blkid),
-				   	xlrec.target.tid.ip_posid,
-				   	xlrec.deadblk);
+				   	BlockIdGetBlockNumber(&xlrec->target.tid.ip_blkid),
+				   	xlrec->target.tid.ip_posid,
+				   	xlrec->deadblk);
 			break;
 		}
 
@@ -1166,14 +1506,14 @@ print_rmgr_btree(XLogRecPtr cur, XLogRecord *record, uint8 info)
 			break;
 	}
 
-	print_rmgr_record(cur, record, buf);
+	print_rmgr_record(dec, buf);
 }
 
-void
-print_rmgr_hash(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_hash(DecodedRecord *dec)
 {
 	/* FIXME: need to be implemented. */
-	print_rmgr_record(cur, record, "hash");
+	print_rmgr_record(dec, "hash");
 }
 
 /* copied from backend/access/gist/gistxlog.c */
@@ -1246,17 +1586,20 @@ decodePageSplitRecord(PageSplitRecord *decoded, XLogRecord *record)
 	}
 }
 
-void
-print_rmgr_gin(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_gin(DecodedRecord *dec)
 {
 	/* FIXME: need to be implemented. */
-	print_rmgr_record(cur, record, "gin");
+	print_rmgr_record(dec, "gin");
 }
 
-void
-print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_gist(DecodedRecord *dec)
 {
-	print_rmgr_record(cur, record, "git");
+	XLogRecord *record = dec->record;
+	uint8	info = dec->info;
+
+	print_rmgr_record(dec, "git");
 
 	switch (info)
 	{
@@ -1270,7 +1613,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 				decodePageUpdateRecord(&rec, record);
 
 #if PG_VERSION_NUM >= 90100
-				printf("%s: rel=(%u/%u/%u) blk=%u leftchild=%d add=%d ntodelete=%d\n",
+				out_printf("%s: rel=(%u/%u/%u) blk=%u leftchild=%d add=%d ntodelete=%d\n",
 					info == XLOG_GIST_PAGE_UPDATE ? "page_update" : "new_root",
 					rec.data->node.spcNode, rec.data->node.dbNode,
 					rec.data->node.relNode,
@@ -1280,7 +1623,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 					rec.data->ntodelete
 				);
 #else
-				printf("%s: rel=(%u/%u/%u) blk=%u key=(%d,%d) add=%d ntodelete=%d\n",
+				out_printf("%s: rel=(%u/%u/%u) blk=%u key=(%d,%d) add=%d ntodelete=%d\n",
 					info == XLOG_GIST_PAGE_UPDATE ? "page_update" : "new_root",
 					rec.data->node.spcNode, rec.data->node.dbNode,
 					rec.data->node.relNode,
@@ -1293,7 +1636,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 #endif
 				for (i = 0; i < rec.len; i++)
 				{
-					printf("  itup[%d] points (%d, %d)\n",
+					out_printf("  itup[%d] points (%d, %d)\n",
 						i,
 						ItemPointerGetBlockNumber(&rec.itup[i]->t_tid),
 						rec.itup[i]->t_tid.ip_posid
@@ -1301,7 +1644,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 				}
 				for (i = 0; i < rec.data->ntodelete; i++)
 				{
-					printf("  todelete[%d] offset %d\n", i, rec.todelete[i]);
+					out_printf("  todelete[%d] offset %d\n", i, rec.todelete[i]);
 				}
 				free(rec.itup);
 			}
@@ -1313,12 +1656,12 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 
 				decodePageSplitRecord(&rec, record);
 #if PG_VERSION_NUM >= 90100
-				printf("page_split: orig %u leftchild %d\n",
+				out_printf("page_split: orig %u leftchild %d\n",
 					rec.data->origblkno,
 					rec.data->leftchild
 				);
 #else
-				printf("page_split: orig %u key (%d,%d)\n",
+				out_printf("page_split: orig %u key (%d,%d)\n",
 					rec.data->origblkno,
 					ItemPointerGetBlockNumber(&rec.data->key),
 					rec.data->key.ip_posid
@@ -1326,7 +1669,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 #endif
 				for (i = 0; i < rec.data->npage; i++)
 				{
-					printf("  page[%d] block %u tuples %d\n",
+					out_printf("  page[%d] block %u tuples %d\n",
 						i,
 						rec.page[i].header->blkno,
 						rec.page[i].header->num
@@ -1335,7 +1678,7 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 					for (int j = 0; j < rec.page[i].header->num; j++)
 					{
 						NewPage *newpage = rec.page + i;
-						printf("   itup[%d] points (%d,%d)\n",
+						out_printf("   itup[%d] points (%d,%d)\n",
 							j,
 							BlockIdGetBlockNumber(&newpage->itup[j]->t_tid.ip_blkid),
 							newpage->itup[j]->t_tid.ip_posid
@@ -1349,23 +1692,23 @@ print_rmgr_gist(XLogRecPtr cur, XLogRecord *record, uint8 info)
 #if PG_VERSION_NUM < 90100
 		case XLOG_GIST_INSERT_COMPLETE:
 			{
-				printf("insert_complete: \n");
+				out_printf("insert_complete: \n");
 			}
 			break;
 #endif
 		case XLOG_GIST_CREATE_INDEX:
-			printf("create_index: \n");
+			out_printf("create_index: \n");
 			break;
 		case XLOG_GIST_PAGE_DELETE:
-			printf("page_delete: \n");
+			out_printf("page_delete: \n");
 			break;
 	}
 }
 
-void
-print_rmgr_seq(XLogRecPtr cur, XLogRecord *record, uint8 info)
+static void
+print_rmgr_seq(DecodedRecord *dec)
 {
 	/* FIXME: need to be implemented. */
-	print_rmgr_record(cur, record, "seq");
+	print_rmgr_record(dec, "seq");
 }
 
@@ -11,22 +11,10 @@
 #include "access/gist_private.h"
 #include "access/xlog.h"
 #include "storage/block.h"
+#include "storage/off.h"
 #include "storage/relfilenode.h"
 
-/* XXX these ought to be in smgr.h, but are not */
-#define XLOG_SMGR_CREATE	0x10
-#define XLOG_SMGR_TRUNCATE	0x20
-
-typedef struct xl_smgr_create
-{
-	RelFileNode rnode;
-} xl_smgr_create;
-
-typedef struct xl_smgr_truncate
-{
-	BlockNumber blkno;
-	RelFileNode rnode;
-} xl_smgr_truncate;
+#include "xlogdump_decode.h"
 
 typedef struct
 {
@@ -51,30 +39,41 @@ typedef struct
 } PageSplitRecord;
 
 
-extern const char * const RM_names[RM_MAX_ID+1];
+/*
+ * A resource manager, with the callbacks to decode the fields of its
+ * records, to account them to the statistics, and to print them. Any
+ * of the callbacks may be NULL.
+ */
+typedef struct rmgr_desc_t
+{
+	const char *name;
+	void		(*decode) (DecodedRecord *, int);
+	void		(*account) (DecodedRecord *);
+	void		(*format) (DecodedRecord *);
+} rmgr_desc_t;
+
+extern const rmgr_desc_t RM_table[RM_MAX_ID+1];
+
+/* blocks touched by a xlog record, collected from its decoded payload. */
+#define MAX_BLOCK_REFS	(DECODE_MAX_BKP_BLOCKS + 4)
 
-void print_xlog_rmgr_stats(int);
+typedef struct block_ref_t
+{
+	RelFileNode node;
+	BlockNumber block;
+} block_ref_t;
 
-void enable_rmgr_dump(bool);
-void print_rmgr_xlog(XLogRecPtr, XLogRecord *, uint8, bool);
-void print_rmgr_xact(XLogRecPtr, XLogRecord *, uint8, bool);
-void print_rmgr_smgr(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_clog(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_dbase(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_tblspc(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_multixact(XLogRecPtr, XLogRecord *, uint8);
+void collect_block_refs(DecodedRecord *);
+void print_rmgr_decoded(DecodedRecord *);
+int get_block_refs(const block_ref_t **);
 
-#if PG_VERSION_NUM >= 90000
-void print_rmgr_relmap(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_standby(XLogRecPtr, XLogRecord *, uint8);
-#endif
+void print_xlog_rmgr_stats(int);
+void export_xlog_rmgr_stats(void);
+void save_xlog_rmgr_stats(FILE *);
+void load_xlog_rmgr_stats(FILE *);
+void reset_xlog_rmgr_stats(void);
 
-void print_rmgr_heap2(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_heap(XLogRecPtr, XLogRecord *, uint8, bool);
-void print_rmgr_btree(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_hash(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_gin(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_gist(XLogRecPtr, XLogRecord *, uint8);
-void print_rmgr_seq(XLogRecPtr, XLogRecord *, uint8);
+void enable_rmgr_dump(bool);
+void set_rmgr_format(bool, bool);
 
 #endif /* __XLOGDUMP_RMGR_H__ */
@@ -0,0 +1,326 @@
+/*
+ * xlogdump_sidecar.c
+ *
+ * a collection of functions to save the statistics of a xlog segment
+ * into a stats file, and to merge the stats files afterwards.
+ *
+ * A stats file has a header and a sequence of sections, each of which
+ * is a tag, the length of the body, and the body. The sections which
+ * are not needed by the current options are skipped. The values are
+ * written in the native byte order, as well as the xlog segments, so
+ * a stats file can be read only on the same architecture.
+ *
+ * Reading a section always merges it into the current statistics,
+ * so any set of stats files gives the same result as one pass over
+ * the segments.
+ */
+#include "xlogdump_sidecar.h"
+
+#include <sys/stat.h>
+
+#define SIDECAR_MAGIC	"XLDSTAT1"
+
+FILE *
+sidecar_create(const char *path)
+{
+	char tmp[MAXPGPATH];
+	FILE *fp;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((fp = fopen(tmp, "wb")) == NULL)
+	{
+		fprintf(stderr, "ERROR: Can't write %s.\n", tmp);
+		exit(1);
+	}
+
+	sidecar_write(fp, SIDECAR_MAGIC, strlen(SIDECAR_MAGIC));
+
+	return fp;
+}
+
+/*
+ * sidecar_close()
+ *
+ * terminates the stats file, and moves it into place.
+ */
+void
+sidecar_close(FILE *fp, const char *path)
+{
+	char tmp[MAXPGPATH];
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	sidecar_write_u32(fp, SIDECAR_END);
+	sidecar_write_u64(fp, 0);
+
+	if (fclose(fp) != 0 || rename(tmp, path) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't write %s.\n", path);
+		exit(1);
+	}
+}
+
+FILE *
+sidecar_open(const char *path)
+{
+	char magic[sizeof(SIDECAR_MAGIC)];
+	FILE *fp;
+
+	if ((fp = fopen(path, "rb")) == NULL)
+	{
+		fprintf(stderr, "ERROR: %s not found.\n", path);
+		exit(1);
+	}
+
+	memset(magic, 0, sizeof(magic));
+	if (fread(magic, 1, strlen(SIDECAR_MAGIC), fp) != strlen(SIDECAR_MAGIC) ||
+	    strcmp(magic, SIDECAR_MAGIC) != 0)
+	{
+		fprintf(stderr, "ERROR: %s is not a xlogdump stats file.\n", path);
+		exit(1);
+	}
+
+	return fp;
+}
+
+/*
+ * sidecar_is_fresh()
+ *
+ * returns true if the file exists, and is not older than the segment
+ * it has been made from. A recycled segment is newer than its files.
+ */
+bool
+sidecar_is_fresh(const char *path, const char *segment)
+{
+	struct stat st, sst;
+
+	if (stat(path, &st) != 0 || stat(segment, &sst) != 0)
+		return false;
+
+	return (st.st_mtime >= sst.st_mtime);
+}
+
+/*
+ * sidecar_begin_section()
+ *
+ * writes the tag and a placeholder of the length, and returns the
+ * position to be given to sidecar_end_section().
+ */
+long
+sidecar_begin_section(FILE *fp, uint32 tag)
+{
+	long pos;
+
+	sidecar_write_u32(fp, tag);
+	pos = ftell(fp);
+	sidecar_write_u64(fp, 0);
+
+	return pos;
+}
+
+void
+sidecar_end_section(FILE *fp, long pos)
+{
+	long end = ftell(fp);
+
+	if (fseek(fp, pos, SEEK_SET) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't seek in the stats file.\n");
+		exit(1);
+	}
+	sidecar_write_u64(fp, (uint64) (end - pos - sizeof(uint64)));
+	if (fseek(fp, end, SEEK_SET) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't seek in the stats file.\n");
+		exit(1);
+	}
+}
+
+/*
+ * sidecar_next_section()
+ *
+ * reads the tag and the length of the next section. Returns false at
+ * the end of the file.
+ */
+bool
+sidecar_next_section(FILE *fp, uint32 *tag, uint64 *len)
+{
+	*tag = sidecar_read_u32(fp);
+	*len = sidecar_read_u64(fp);
+
+	return (*tag != SIDECAR_END);
+}
+
+void
+sidecar_skip_section(FILE *fp, uint64 len)
+{
+	if (fseek(fp, (long) len, SEEK_CUR) != 0)
+	{
+		fprintf(stderr, "ERROR: Can't seek in the stats file.\n");
+		exit(1);
+	}
+}
+
+void
+sidecar_write(FILE *fp, const void *buf, size_t len)
+{
+	if (fwrite(buf, 1, len, fp) != len)
+	{
+		fprintf(stderr, "ERROR: Can't write the stats file.\n");
+		exit(1);
+	}
+}
+
+void
+sidecar_write_u32(FILE *fp, uint32 v)
+{
+	sidecar_write(fp, &v, sizeof(v));
+}
+
+void
+sidecar_write_u64(FILE *fp, uint64 v)
+{
+	sidecar_write(fp, &v, sizeof(v));
+}
+
+/*
+ * sidecar_write_hist()
+ *
+ * writes only the non-empty buckets, as most of them are empty.
+ */
+void
+sidecar_write_hist(FILE *fp, const hist_t *h)
+{
+	uint32 n = 0;
+	int i;
+
+	for (i = 0 ; i < HIST_BUCKETS ; i++)
+		if (h->buckets[i] > 0)
+			n++;
+
+	sidecar_write_u64(fp, h->count);
+	sidecar_write_u64(fp, h->sum);
+	sidecar_write_u32(fp, h->max);
+	sidecar_write_u32(fp, n);
+	for (i = 0 ; i < HIST_BUCKETS ; i++)
+	{
+		if (h->buckets[i] == 0)
+			continue;
+		sidecar_write_u32(fp, (uint32) i);
+		sidecar_write_u64(fp, h->buckets[i]);
+	}
+}
+
+/*
+ * sidecar_write_hll()
+ *
+ * writes only the non-empty registers, as a relation touching a few
+ * blocks leaves most of them empty.
+ */
+void
+sidecar_write_hll(FILE *fp, const hll_t *hll)
+{
+	uint32 n = 0;
+	int i;
+
+	for (i = 0 ; i < HLL_REGISTERS ; i++)
+		if (hll->registers[i] > 0)
+			n++;
+
+	sidecar_write_u32(fp, n);
+	for (i = 0 ; i < HLL_REGISTERS ; i++)
+	{
+		if (hll->registers[i] == 0)
+			continue;
+		sidecar_write_u32(fp, ((uint32) i << 8) | hll->registers[i]);
+	}
+}
+
+void
+sidecar_read(FILE *fp, void *buf, size_t len)
+{
+	if (fread(buf, 1, len, fp) != len)
+	{
+		fprintf(stderr, "ERROR: Unexpected end of the stats file.\n");
+		exit(1);
+	}
+}
+
+uint32
+sidecar_read_u32(FILE *fp)
+{
+	uint32 v;
+
+	sidecar_read(fp, &v, sizeof(v));
+	return v;
+}
+
+uint64
+sidecar_read_u64(FILE *fp)
+{
+	uint64 v;
+
+	sidecar_read(fp, &v, sizeof(v));
+	return v;
+}
+
+/*
+ * sidecar_read_hist()
+ *
+ * adds the histogram in the stats file to `h'.
+ */
+void
+sidecar_read_hist(FILE *fp, hist_t *h)
+{
+	uint32 max, n, i;
+
+	h->count += sidecar_read_u64(fp);
+	h->sum += sidecar_read_u64(fp);
+	max = sidecar_read_u32(fp);
+	if (max > h->max)
+		h->max = max;
+
+	n = sidecar_read_u32(fp);
+	for (i = 0 ; i < n ; i++)
+	{
+		uint32 idx = sidecar_read_u32(fp);
+		uint64 count = sidecar_read_u64(fp);
+
+		if (idx >= HIST_BUCKETS)
+		{
+			fprintf(stderr, "ERROR: Broken histogram in the stats file.\n");
+			exit(1);
+		}
+		h->buckets[idx] += count;
+	}
+}
+
+/*
+ * sidecar_read_hll()
+ *
+ * merges the HyperLogLog counter in the stats file into `hll'.
+ */
+void
+sidecar_read_hll(FILE *fp, hll_t *hll)
+{
+	hll_t saved;
+	uint32 n, i;
+
+	hll_reset(&saved);
+
+	n = sidecar_read_u32(fp);
+	for (i = 0 ; i < n ; i++)
+	{
+		uint32 v = sidecar_read_u32(fp);
+		uint32 idx = v >> 8;
+
+		if (idx >= HLL_REGISTERS)
+		{
+			fprintf(stderr, "ERROR: Broken HyperLogLog counter in the stats file.\n");
+			exit(1);
+		}
+		saved.registers[idx] = (uint8) (v & 0xFF);
+	}
+
+	hll_merge(hll, &saved);
+}
@@ -0,0 +1,50 @@
+/*
+ * xlogdump_sidecar.h
+ *
+ * a collection of functions to save the statistics of a xlog segment
+ * into a stats file, and to merge the stats files afterwards.
+ */
+#ifndef __XLOGDUMP_SIDECAR_H__
+#define __XLOGDUMP_SIDECAR_H__
+
+#include "postgres.h"
+
+#include "xlogdump_hist.h"
+#include "xlogdump_hll.h"
+
+#define SIDECAR_SUFFIX		".stats"
+
+/* sections in a stats file */
+#define SIDECAR_END		0
+#define SIDECAR_XLOG_STATS	1
+#define SIDECAR_RMGR_STATS	2
+#define SIDECAR_HOT_BLOCKS	3
+#define SIDECAR_DISTINCT	4
+#define SIDECAR_RATE		5
+#define SIDECAR_ZONE_MAP	6
+#define SIDECAR_XID_INDEX	7
+#define SIDECAR_COMMIT_TIME	8
+
+FILE *sidecar_create(const char *);
+void sidecar_close(FILE *, const char *);
+FILE *sidecar_open(const char *);
+bool sidecar_is_fresh(const char *, const char *);
+
+long sidecar_begin_section(FILE *, uint32);
+void sidecar_end_section(FILE *, long);
+bool sidecar_next_section(FILE *, uint32 *, uint64 *);
+void sidecar_skip_section(FILE *, uint64);
+
+void sidecar_write(FILE *, const void *, size_t);
+void sidecar_write_u32(FILE *, uint32);
+void sidecar_write_u64(FILE *, uint64);
+void sidecar_write_hist(FILE *, const hist_t *);
+void sidecar_write_hll(FILE *, const hll_t *);
+
+void sidecar_read(FILE *, void *, size_t);
+uint32 sidecar_read_u32(FILE *);
+uint64 sidecar_read_u64(FILE *);
+void sidecar_read_hist(FILE *, hist_t *);
+void sidecar_read_hll(FILE *, hll_t *);
+
+#endif /* __XLOGDUMP_SIDECAR_H__ */
@@ -13,6 +13,7 @@
 #include "utils/timestamp.h"
 
 #include "xlogdump_oid2name.h"
+#include "xlogdump_out.h"
 
 static int printValue(const char *, const int, const attrib_t, const uint32);
 
@@ -37,10 +38,10 @@ dump_xlrecord(const char *data, const int datlen)
 	for (i=0 ; i<datlen ; i++)
 	{
 		if ( i%16==0 )
-			printf("\n%4d: ", i);
-		printf("%c(%02x) ", isprint(*(data+i) & 0xff) ? *(data+i) & 0xff : '?', *(data+i) & 0xff);
+			out_printf("\n%4d: ", i);
+		out_printf("%c(%02x) ", isprint(*(data+i) & 0xff) ? *(data+i) & 0xff : '?', *(data+i) & 0xff);
 	}
-	printf("\n");
+	out_printf("\n");
 #endif
 }
 
@@ -56,23 +57,23 @@ print_column_values(char *tupdata, int tuplen, const bits8 *nullBitMap, const xl
 
 	cols = relname2attr_begin(relname);
 		
-	printf("%s: %d row(s) found in the table `%s'.\n", op, cols, relname);
+	out_printf("%s: %d row(s) found in the table `%s'.\n", op, cols, relname);
 
 	for (i=0 ; i<cols ; i++)
 	{
 		relname2attr_fetch(i, &att[i]);
-		printf("%s: column %d, name %s, type %d, ", op, i, att[i].attname, att[i].atttypid);
+		out_printf("%s: column %d, name %s, type %d, ", op, i, att[i].attname, att[i].atttypid);
 
 		/* is the attribute value null? */
 		if((hhead.t_infomask & HEAP_HASNULL) && (att_isnull(i, nullBitMap)))
 		{
-			printf("value null\n");
+			out_printf("value null\n");
 		}
 		else
 	        {
-			printf("value ");
+			out_printf("value ");
 			offset = printValue(tupdata, offset, att[i], tuplen);
-			printf("\n");
+			out_printf("\n");
 
 			if ( offset<0 )
 				break;
@@ -209,7 +210,7 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 		data = (char *)tup + new_offset;
 	}
 #ifdef DEBUG
-	printf("(offset=%d, new_offset=%d) ", offset, new_offset);
+	out_printf("(offset=%d, new_offset=%d) ", offset, new_offset);
 #endif
 
 	// Just print out the value of a specific data type from the data array
@@ -217,7 +218,7 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 	{
 		case INT2OID:
 			memcpy(&int16_val, data, sizeof(int16));
-			printf("%d", int16_val);
+			out_printf("%d", int16_val);
 			new_offset += sizeof(int16);
 			break;
 
@@ -226,30 +227,30 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 		case REGPROCOID:
 		case XIDOID:
 			memcpy(&int32_val, data, sizeof(int32));
-			printf("%d", int32_val);
+			out_printf("%d", int32_val);
 			new_offset += sizeof(int32);
 			break;
 
 		case INT8OID:
 			memcpy(&int64_val, data, sizeof(int64));
-			printf(INT64_FORMAT, int64_val);
+			out_printf(INT64_FORMAT, int64_val);
 			new_offset += sizeof(int64);
 			break;
 
 		case FLOAT4OID:
 			memcpy(&float4_val, data, sizeof(float4));
-			printf("%f", float4_val);
+			out_printf("%f", float4_val);
 			new_offset += sizeof(float4);
 			break;
 
 		case FLOAT8OID:
 			memcpy(&float8_val, data, sizeof(float8));
-			printf("%f", float8_val);
+			out_printf("%f", float8_val);
 			new_offset += sizeof(float8);
 			break;
 
 		case CHAROID:
-			printf("%d", *data);
+			out_printf("%d", *data);
 			new_offset += sizeof(char);
 			break;
 
@@ -266,24 +267,24 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 			ptr = VARDATA_ANY(data);
 
 #ifdef DEBUG
-			printf("(varatt_is_4b=%d, varatt_is_1b=%d, ",
+			out_printf("(varatt_is_4b=%d, varatt_is_1b=%d, ",
 			       VARATT_IS_4B(data),
 			       VARATT_IS_1B(data));
-			printf("len=%d, tuplen=%d) ", len, tuplen);
+			out_printf("len=%d, tuplen=%d) ", len, tuplen);
 #endif
 
 			if ( VARATT_IS_4B(data) )
 			{
 				i += 4;
 #ifdef DEBUG
-				printf("(%02x %02x %02x %02x) ", *(data), *(data+1), *(data+2), *(data+3));
+				out_printf("(%02x %02x %02x %02x) ", *(data), *(data+1), *(data+2), *(data+3));
 #endif
 			}
 			else
 			{
 				i += 1;
 #ifdef DEBUG
-				printf("(%02x) ", *(data));
+				out_printf("(%02x) ", *(data));
 #endif
 			}
 
@@ -294,14 +295,14 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 				break;
 			}
 
-			printf("'");
+			out_printf("'");
 			for (; i<len ; i++)
 			{
 				if ( *(data+i)=='\0' )
 					break;
-				printf("%c", *(data+i));
+				out_printf("%c", *(data+i));
 			}
-			printf("'");
+			out_printf("'");
 
 			new_offset += len;
 			break;
@@ -309,13 +310,13 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 
 		case NAMEOID:
 			for(i = 0; i < NAMEDATALEN && *(data+i) != '\0'; i++)
-				printf("%c", *(data+i));
+				out_printf("%c", *(data+i));
 				
 			new_offset += NAMEDATALEN;
 			break;
 
 		case BOOLOID:
-			printf("%c", (*data == 0 ? 'f' : 't'));
+			out_printf("%c", (*data == 0 ? 'f' : 't'));
 			new_offset += sizeof(bool);
 			break;
 
@@ -329,15 +330,15 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 
 			memcpy(&time, data, sizeof(Timestamp));
 #ifdef __DEBUG
-			printf("(ts=%f) ", time);
+			out_printf("(ts=%f) ", time);
 #endif
 
 			TMODULO(time, date, (double) SECS_PER_DAY);
 #ifdef __DEBUG
 #ifdef HAVE_INT64_TIMESTAMP
-			printf("(date=%lld, time=%lld) ", date, time);
+			out_printf("(date=%lld, time=%lld) ", date, time);
 #else
-			printf("(date=%f, time=%f) ", date, time);
+			out_printf("(date=%f, time=%f) ", date, time);
 #endif
 #endif
 
@@ -346,11 +347,11 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 			j2date(date, &y, &m, &d);
 			dt2time(time, &hh, &mm, &ss, &ff);
 
-			printf("%04d-%02d-%02d ", y, m, d);
+			out_printf("%04d-%02d-%02d ", y, m, d);
 #ifdef HAVE_INT64_TIMESTAMP
-			printf("%02d:%02d:%02d.%d", hh, mm, ss, ff);
+			out_printf("%02d:%02d:%02d.%d", hh, mm, ss, ff);
 #else
-			printf("%02d:%02d:%02.6f", hh, mm, ss+ff);
+			out_printf("%02d:%02d:%02.6f", hh, mm, ss+ff);
 #endif
 
 			new_offset += sizeof(Timestamp);
@@ -358,7 +359,7 @@ printValue(const char *tup, const int offset, const attrib_t att, const uint32 t
 		  }
 
 		default:
-			printf("(unsupported type %d)", att.atttypid);
+			out_printf("(unsupported type %d)", att.atttypid);
 			if ( att.attlen>0 )
 				new_offset += att.attlen;
 			else
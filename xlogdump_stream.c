@@ -0,0 +1,625 @@
+/*
+ * xlogdump_stream.c
+ *
+ * a collection of functions to read a segment from the standard input
+ * or from a compressed archive file, decompressing it in a thread.
+ *
+ * stream_open() gives a file descriptor to be read by the reader, as
+ * well as the one of a plain segment file. For the standard input or a
+ * file named with the suffix of a compression, it's the read end of a
+ * pipe, which a thread fills with the segment meanwhile, so that the
+ * decompression overlaps the decoding. The compression is told by the
+ * magic number at the beginning of the stream, not by the suffix.
+ *
+ * gzip, lz4 and zstd are decompressed in the thread with zlib, liblz4
+ * and libzstd. Without its library, a format is decompressed by its
+ * command, which the thread feeds with the stream.
+ *
+ * stream_read_head() reads just the beginning of a segment, to probe
+ * its header, decompressing no more of it than needed in the caller.
+ *
+ * The segment is named by the archive file name, like
+ * 000000010000000000000003.gz, and the reader takes the name of a
+ * segment from the standard input from its first page header.
+ */
+#include "postgres.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+#include "xlogdump_stream.h"
+
+#define STREAM_CHUNK	(64 * 1024)
+#define STREAM_PIPE_SIZE	(1024 * 1024)
+
+typedef struct {
+	int		kind;
+	const char	*suffix;
+	const char	*magic;
+	int		magiclen;
+	const char	*command;	/* decompresses stdin to stdout with -dc */
+} stream_format_t;
+
+static const stream_format_t formats[] = {
+	{STREAM_GZIP, ".gz", "\x1f\x8b", 2, "gzip"},
+	{STREAM_LZ4, ".lz4", "\x04\x22\x4d\x18", 4, "lz4"},
+	{STREAM_ZSTD, ".zst", "\x28\xb5\x2f\xfd", 4, "zstd"},
+	{STREAM_RAW, NULL, NULL, 0, NULL}
+};
+
+/*
+ * a stream being copied or decompressed by its thread, or into the
+ * buffer of stream_read_head()
+ */
+typedef struct {
+	char	*name;
+	int	src;		/* the file, or 0 for stdin */
+	int	out;		/* the write end of the pipe to the reader */
+	char	*head;		/* the buffer instead of the pipe, or NULL */
+	size_t	headlen;
+	size_t	headused;
+	bool	quiet;		/* errors are left to be reported when read */
+} stream_t;
+
+/*
+ * The pipes are created and the commands forked under the lock, so
+ * that a command never inherits the pipe of another stream, and keeps
+ * it from reaching its end.
+ */
+static pthread_mutex_t spawn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* a missing command is reported once, not for every segment */
+static bool command_missing[STREAM_ZSTD + 1];
+
+static bool make_pipe(int *);
+static size_t read_full(int, char *, size_t);
+static bool write_all(int, const char *, size_t);
+static const stream_format_t *format_of_magic(const char *, size_t);
+static void stream_error(stream_t *, const char *, ...);
+static bool emit(stream_t *, const char *, size_t);
+static void copy_stream(stream_t *, char *, size_t);
+#ifdef HAVE_LIBZ
+static void inflate_stream(stream_t *, char *, size_t);
+#endif
+#ifdef HAVE_LIBLZ4
+static void lz4_stream(stream_t *, char *, size_t);
+#endif
+#ifdef HAVE_LIBZSTD
+static void zstd_stream(stream_t *, char *, size_t);
+#endif
+static bool decompress(stream_t *, const stream_format_t *, char *, size_t);
+static void run_command(stream_t *, const stream_format_t *, char *, size_t);
+static void *stream_main(void *);
+
+/*
+ * stream_kind_of_name()
+ *
+ * tells the compression of an archive file from its suffix.
+ */
+int
+stream_kind_of_name(const char *path)
+{
+	size_t len = strlen(path);
+	int i;
+
+	for (i = 0; formats[i].suffix != NULL; i++)
+	{
+		size_t slen = strlen(formats[i].suffix);
+
+		if (len > slen && strcmp(path + len - slen, formats[i].suffix) == 0)
+			return formats[i].kind;
+	}
+	return STREAM_RAW;
+}
+
+bool
+stream_is_stdin(const char *path)
+{
+	return (strcmp(path, STREAM_STDIN) == 0);
+}
+
+/* must be called with spawn_lock */
+static bool
+make_pipe(int *fds)
+{
+	if (pipe(fds) != 0)
+		return false;
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return true;
+}
+
+static size_t
+read_full(int fd, char *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len)
+	{
+		ssize_t n = read(fd, buf + done, len - done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+/*
+ * Fails with EPIPE when the reader has closed the pipe, having read as
+ * far as it wanted.
+ */
+static bool
+write_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = write(fd, buf, len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static const stream_format_t *
+format_of_magic(const char *buf, size_t len)
+{
+	int i;
+
+	for (i = 0; formats[i].suffix != NULL; i++)
+	{
+		if (len >= formats[i].magiclen &&
+		    memcmp(buf, formats[i].magic, formats[i].magiclen) == 0)
+			return &formats[i];
+	}
+	return &formats[i];
+}
+
+static void
+stream_error(stream_t *s, const char *fmt, ...)
+{
+	va_list args;
+
+	if (s->quiet)
+		return;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+}
+
+/*
+ * Passes the data of the segment on to the reader, or into the head
+ * buffer. Returns false when no more of it is wanted.
+ */
+static bool
+emit(stream_t *s, const char *data, size_t len)
+{
+	if (s->head == NULL)
+		return write_all(s->out, data, len);
+
+	if (len > s->headlen - s->headused)
+		len = s->headlen - s->headused;
+	memcpy(s->head + s->headused, data, len);
+	s->headused += len;
+	return s->headused < s->headlen;
+}
+
+/*
+ * Passes an uncompressed segment on, after the first chunk read.
+ */
+static void
+copy_stream(stream_t *s, char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		if (!emit(s, buf, len))
+			return;
+		len = read_full(s->src, buf, STREAM_CHUNK);
+	}
+}
+
+#ifdef HAVE_LIBZ
+static void
+inflate_stream(stream_t *s, char *buf, size_t len)
+{
+	char *out = (char *) malloc(STREAM_CHUNK);
+	z_stream z;
+	int rc = Z_OK;
+
+	memset(&z, 0, sizeof(z));
+	/* 32 for the gzip header as well as the zlib one */
+	if (inflateInit2(&z, 15 + 32) != Z_OK)
+	{
+		stream_error(s, "ERROR: could not initialize zlib for %s\n", s->name);
+		free(out);
+		return;
+	}
+
+	while (len > 0)
+	{
+		z.next_in = (Bytef *) buf;
+		z.avail_in = len;
+		while (z.avail_in > 0)
+		{
+			z.next_out = (Bytef *) out;
+			z.avail_out = STREAM_CHUNK;
+			rc = inflate(&z, Z_NO_FLUSH);
+			if (rc != Z_OK && rc != Z_STREAM_END)
+			{
+				stream_error(s, "ERROR: could not decompress %s: %s\n",
+					s->name, z.msg ? z.msg : "broken data");
+				goto done;
+			}
+			if (!emit(s, out, STREAM_CHUNK - z.avail_out))
+				goto done;
+			/* gzip allows members to be concatenated */
+			if (rc == Z_STREAM_END)
+				inflateReset(&z);
+		}
+		len = read_full(s->src, buf, STREAM_CHUNK);
+	}
+	if (rc != Z_STREAM_END)
+		stream_error(s, "ERROR: %s is truncated\n", s->name);
+
+done:
+	inflateEnd(&z);
+	free(out);
+}
+#endif
+
+#ifdef HAVE_LIBLZ4
+static void
+lz4_stream(stream_t *s, char *buf, size_t len)
+{
+	char *out = (char *) malloc(STREAM_CHUNK);
+	LZ4F_dctx *ctx;
+	size_t rc = 0;
+
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION)))
+	{
+		stream_error(s, "ERROR: could not initialize liblz4 for %s\n", s->name);
+		free(out);
+		return;
+	}
+
+	while (len > 0)
+	{
+		size_t pos = 0;
+		size_t outlen;
+
+		/* and once more while the output is full, for what's left */
+		do
+		{
+			size_t inlen = len - pos;
+
+			outlen = STREAM_CHUNK;
+			rc = LZ4F_decompress(ctx, out, &outlen, buf + pos, &inlen, NULL);
+			if (LZ4F_isError(rc))
+			{
+				stream_error(s, "ERROR: could not decompress %s: %s\n",
+					s->name, LZ4F_getErrorName(rc));
+				goto done;
+			}
+			pos += inlen;
+			if (outlen > 0 && !emit(s, out, outlen))
+				goto done;
+		} while (pos < len || outlen == STREAM_CHUNK);
+		len = read_full(s->src, buf, STREAM_CHUNK);
+	}
+	/* 0 at the end of a frame, and frames may be concatenated */
+	if (rc != 0)
+		stream_error(s, "ERROR: %s is truncated\n", s->name);
+
+done:
+	LZ4F_freeDecompressionContext(ctx);
+	free(out);
+}
+#endif
+
+#ifdef HAVE_LIBZSTD
+static void
+zstd_stream(stream_t *s, char *buf, size_t len)
+{
+	char *out = (char *) malloc(STREAM_CHUNK);
+	ZSTD_DStream *ds = ZSTD_createDStream();
+	size_t rc = 0;
+
+	if (ds == NULL || ZSTD_isError(ZSTD_initDStream(ds)))
+	{
+		stream_error(s, "ERROR: could not initialize libzstd for %s\n", s->name);
+		ZSTD_freeDStream(ds);
+		free(out);
+		return;
+	}
+
+	while (len > 0)
+	{
+		ZSTD_inBuffer in = {buf, len, 0};
+		ZSTD_outBuffer o;
+
+		/* and once more while the output is full, for what's left */
+		do
+		{
+			o.dst = out;
+			o.size = STREAM_CHUNK;
+			o.pos = 0;
+			rc = ZSTD_decompressStream(ds, &o, &in);
+			if (ZSTD_isError(rc))
+			{
+				stream_error(s, "ERROR: could not decompress %s: %s\n",
+					s->name, ZSTD_getErrorName(rc));
+				goto done;
+			}
+			if (o.pos > 0 && !emit(s, out, o.pos))
+				goto done;
+		} while (in.pos < in.size || o.pos == o.size);
+		len = read_full(s->src, buf, STREAM_CHUNK);
+	}
+	/* 0 at the end of a frame, and frames may be concatenated */
+	if (rc != 0)
+		stream_error(s, "ERROR: %s is truncated\n", s->name);
+
+done:
+	ZSTD_freeDStream(ds);
+	free(out);
+}
+#endif
+
+/*
+ * Decompresses the stream of the format in this thread, after the
+ * first chunk read. Returns false if it needs the command.
+ */
+static bool
+decompress(stream_t *s, const stream_format_t *fmt, char *buf, size_t len)
+{
+	switch (fmt->kind)
+	{
+		case STREAM_RAW:
+			copy_stream(s, buf, len);
+			return true;
+#ifdef HAVE_LIBZ
+		case STREAM_GZIP:
+			inflate_stream(s, buf, len);
+			return true;
+#endif
+#ifdef HAVE_LIBLZ4
+		case STREAM_LZ4:
+			lz4_stream(s, buf, len);
+			return true;
+#endif
+#ifdef HAVE_LIBZSTD
+		case STREAM_ZSTD:
+			zstd_stream(s, buf, len);
+			return true;
+#endif
+	}
+	return false;
+}
+
+/*
+ * Feeds the command of the format with the stream, which writes the
+ * segment to the reader by itself.
+ */
+static void
+run_command(stream_t *s, const stream_format_t *fmt, char *buf, size_t len)
+{
+	int in[2];
+	pid_t pid;
+	int status = 0;
+
+	pthread_mutex_lock(&spawn_lock);
+	if (!make_pipe(in))
+	{
+		pthread_mutex_unlock(&spawn_lock);
+		fprintf(stderr, "ERROR: could not create a pipe for %s\n", s->name);
+		return;
+	}
+	pid = fork();
+	if (pid == 0)
+	{
+		sigset_t set;
+
+		sigemptyset(&set);
+		sigaddset(&set, SIGPIPE);
+		sigprocmask(SIG_UNBLOCK, &set, NULL);
+		dup2(in[0], 0);
+		dup2(s->out, 1);
+		execlp(fmt->command, fmt->command, "-dc", (char *) NULL);
+		_exit(127);
+	}
+	pthread_mutex_unlock(&spawn_lock);
+
+	close(in[0]);
+	if (pid < 0)
+	{
+		close(in[1]);
+		fprintf(stderr, "ERROR: could not run \"%s\" for %s\n", fmt->command, s->name);
+		return;
+	}
+
+	while (len > 0)
+	{
+		if (!write_all(in[1], buf, len))
+			break;
+		len = read_full(s->src, buf, STREAM_CHUNK);
+	}
+	close(in[1]);
+
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+		;
+	/* a command killed by SIGPIPE has been stopped by the reader */
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+	{
+		pthread_mutex_lock(&spawn_lock);
+		if (!command_missing[fmt->kind])
+			fprintf(stderr, "ERROR: could not run \"%s\" to decompress %s\n",
+				fmt->command, s->name);
+		command_missing[fmt->kind] = true;
+		pthread_mutex_unlock(&spawn_lock);
+	}
+	else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+		fprintf(stderr, "ERROR: \"%s -dc\" failed on %s\n", fmt->command, s->name);
+}
+
+static void *
+stream_main(void *arg)
+{
+	stream_t *s = (stream_t *) arg;
+	char *buf = (char *) malloc(STREAM_CHUNK);
+	const stream_format_t *fmt;
+	sigset_t set;
+	size_t len;
+
+	/*
+	 * The reader closes the pipe when it has read as far as it wants,
+	 * which fails the writes here instead of killing the process.
+	 */
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	len = read_full(s->src, buf, STREAM_CHUNK);
+	fmt = format_of_magic(buf, len);
+
+	/* the command has its own copy of the pipe */
+	if (!decompress(s, fmt, buf, len))
+		run_command(s, fmt, buf, len);
+
+	close(s->out);
+	if (s->src != 0)
+		close(s->src);
+	free(s->name);
+	free(s);
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * stream_open()
+ *
+ * opens a segment file, or the standard input for "-". Returns -1 with
+ * errno set if it can't be opened.
+ */
+int
+stream_open(const char *path)
+{
+	stream_t *s;
+	pthread_t thread;
+	int src, fds[2];
+
+	if (stream_is_stdin(path))
+		src = 0;
+	else
+	{
+		src = open(path, O_RDONLY | PG_BINARY, 0);
+		if (src < 0 || stream_kind_of_name(path) == STREAM_RAW)
+			return src;
+	}
+
+	pthread_mutex_lock(&spawn_lock);
+	if (!make_pipe(fds))
+	{
+		int save_errno = errno;
+
+		pthread_mutex_unlock(&spawn_lock);
+		if (src != 0)
+			close(src);
+		errno = save_errno;
+		return -1;
+	}
+	pthread_mutex_unlock(&spawn_lock);
+#ifdef F_SETPIPE_SZ
+	fcntl(fds[1], F_SETPIPE_SZ, STREAM_PIPE_SIZE);
+#endif
+
+	s = (stream_t *) malloc(sizeof(stream_t));
+	memset(s, 0, sizeof(stream_t));
+	s->name = strdup(path);
+	s->src = src;
+	s->out = fds[1];
+
+	if (pthread_create(&thread, NULL, stream_main, s) != 0)
+	{
+		fprintf(stderr, "ERROR: could not create a decompressor thread.\n");
+		exit(1);
+	}
+	pthread_detach(thread);
+
+	return fds[0];
+}
+
+/*
+ * stream_read_head()
+ *
+ * reads the first len bytes of a segment file, to probe its header.
+ * A compressed one is decompressed here only as far as needed, or by
+ * its command through stream_open() without its library. Returns the
+ * bytes read, or -1 with errno set if it can't be opened.
+ */
+ssize_t
+stream_read_head(const char *path, char *head, size_t len)
+{
+	stream_t s;
+	char *buf;
+	size_t n;
+	int fd;
+
+	if (stream_kind_of_name(path) == STREAM_RAW)
+	{
+		fd = open(path, O_RDONLY | PG_BINARY, 0);
+		if (fd < 0)
+			return -1;
+		n = read_full(fd, head, len);
+		close(fd);
+		return n;
+	}
+
+	memset(&s, 0, sizeof(s));
+	s.name = (char *) path;
+	s.src = open(path, O_RDONLY | PG_BINARY, 0);
+	if (s.src < 0)
+		return -1;
+	s.head = head;
+	s.headlen = len;
+	s.quiet = true;
+
+	buf = (char *) malloc(STREAM_CHUNK);
+	n = read_full(s.src, buf, STREAM_CHUNK);
+	if (decompress(&s, format_of_magic(buf, n), buf, n))
+		n = s.headused;
+	else
+	{
+		/* the command stops when the pipe is closed */
+		fd = stream_open(path);
+		n = (fd < 0) ? 0 : read_full(fd, head, len);
+		if (fd >= 0)
+			close(fd);
+	}
+	close(s.src);
+	free(buf);
+
+	return n;
+}
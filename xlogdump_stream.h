@@ -0,0 +1,28 @@
+/*
+ * xlogdump_stream.h
+ *
+ * a collection of functions to read a segment from the standard input
+ * or from a compressed archive file, decompressing it in a thread.
+ */
+#ifndef __XLOGDUMP_STREAM_H__
+#define __XLOGDUMP_STREAM_H__
+
+#include "postgres.h"
+
+#include <sys/types.h>
+
+/* the file name which stands for the standard input */
+#define STREAM_STDIN	"-"
+
+/* how a segment is compressed */
+#define STREAM_RAW	0
+#define STREAM_GZIP	1
+#define STREAM_LZ4	2
+#define STREAM_ZSTD	3
+
+int stream_kind_of_name(const char *);
+bool stream_is_stdin(const char *);
+int stream_open(const char *);
+ssize_t stream_read_head(const char *, char *, size_t);
+
+#endif /* __XLOGDUMP_STREAM_H__ */
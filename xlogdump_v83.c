@@ -0,0 +1,11 @@
+/*
+ * xlogdump_v83.c
+ *
+ * the decoder of the xlog records of PostgreSQL 8.3, for xlogdump
+ * built against another version. See xlogdump_vdecode.h.
+ */
+#define XLOGDUMP_V	83
+#define XLOGDUMP_MAGIC	0xD062
+#define V(name)		v83_##name
+
+#include "xlogdump_vdecode.h"
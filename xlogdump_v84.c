@@ -0,0 +1,11 @@
+/*
+ * xlogdump_v84.c
+ *
+ * the decoder of the xlog records of PostgreSQL 8.4, for xlogdump
+ * built against another version. See xlogdump_vdecode.h.
+ */
+#define XLOGDUMP_V	84
+#define XLOGDUMP_MAGIC	0xD063
+#define V(name)		v84_##name
+
+#include "xlogdump_vdecode.h"
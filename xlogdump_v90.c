@@ -0,0 +1,11 @@
+/*
+ * xlogdump_v90.c
+ *
+ * the decoder of the xlog records of PostgreSQL 9.0, for xlogdump
+ * built against another version. See xlogdump_vdecode.h.
+ */
+#define XLOGDUMP_V	90
+#define XLOGDUMP_MAGIC	0xD064
+#define V(name)		v90_##name
+
+#include "xlogdump_vdecode.h"
@@ -0,0 +1,11 @@
+/*
+ * xlogdump_v91.c
+ *
+ * the decoder of the xlog records of PostgreSQL 9.1, for xlogdump
+ * built against another version. See xlogdump_vdecode.h.
+ */
+#define XLOGDUMP_V	91
+#define XLOGDUMP_MAGIC	0xD066
+#define V(name)		v91_##name
+
+#include "xlogdump_vdecode.h"
@@ -0,0 +1,11 @@
+/*
+ * xlogdump_v92.c
+ *
+ * the decoder of the xlog records of PostgreSQL 9.2, for xlogdump
+ * built against another version. See xlogdump_vdecode.h.
+ */
+#define XLOGDUMP_V	92
+#define XLOGDUMP_MAGIC	0xD071
+#define V(name)		v92_##name
+
+#include "xlogdump_vdecode.h"
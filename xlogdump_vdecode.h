@@ -0,0 +1,373 @@
+/*
+ * xlogdump_vdecode.h
+ *
+ * the decoder of the xlog records of a PostgreSQL major version other
+ * than the one xlogdump is built against. It's included by each of
+ * xlogdump_v<version>.c, with XLOGDUMP_V set to the version, like 91,
+ * XLOGDUMP_MAGIC to its XLOG_PAGE_MAGIC, and V() prefixing the names.
+ *
+ * The structures are copied from the headers of each version, up to
+ * the members read here. The resource manager ids and the info codes
+ * are the same from 8.3 to 9.2. Only the fields shared by the filters,
+ * the statistics and the output formats are decoded: the relation, the
+ * tuple, the time, the redo pointer and the name of the operation. The
+ * rest of the record data is left to the xlogdump of that version.
+ */
+#if !defined(XLOGDUMP_V) || !defined(XLOGDUMP_MAGIC)
+#error XLOGDUMP_V and XLOGDUMP_MAGIC must be defined
+#endif
+
+#include "postgres.h"
+#include "access/xlog.h"
+
+#include <math.h>
+
+#include "xlogdump_decode.h"
+#include "xlogdump_version.h"
+
+#define V_XLOG_CHECKPOINT_SHUTDOWN	0x00
+#define V_XLOG_CHECKPOINT_ONLINE	0x10
+#define V_XLOG_XACT_COMMIT		0x00
+#define V_XLOG_XACT_ABORT		0x20
+#define V_XLOG_XACT_COMMIT_PREPARED	0x30
+#define V_XLOG_XACT_ABORT_PREPARED	0x40
+#define V_XLOG_XACT_COMMIT_COMPACT	0x60	/* 9.2 */
+#define V_XLOG_HEAP_OPMASK		0x70
+#define V_XLOG_HEAP_NEWPAGE		0x50
+#define V_XLOG_BTREE_INSERT_LEAF	0x00
+#define V_XLOG_BTREE_INSERT_UPPER	0x10
+
+/* access/xlog_internal.h, catalog/pg_control.h */
+typedef struct V(CheckPoint)
+{
+	XLogRecPtr	redo;
+	TimeLineID	ThisTimeLineID;
+#if XLOGDUMP_V >= 92
+	bool		fullPageWrites;
+#endif
+	uint32		nextXidEpoch;
+	TransactionId nextXid;
+	Oid			nextOid;
+	MultiXactId nextMulti;
+	MultiXactOffset nextMultiOffset;
+#if XLOGDUMP_V >= 90
+	TransactionId oldestXid;
+	Oid			oldestXidDB;
+#endif
+	pg_time_t	time;
+} V(CheckPoint);
+
+/* access/xact.h: the commit and abort records begin with their time */
+typedef struct V(xl_xact_commit)
+{
+	TimestampTz xact_time;
+} V(xl_xact_commit);
+
+typedef struct V(xl_xact_commit_prepared)
+{
+	TransactionId xid;
+	V(xl_xact_commit) crec;		/* or xl_xact_abort, the same */
+} V(xl_xact_commit_prepared);
+
+/* access/htup.h, access/nbtree.h */
+typedef struct V(xl_heaptid)
+{
+	RelFileNode node;
+	ItemPointerData tid;
+} V(xl_heaptid);
+
+typedef struct V(xl_heap_newpage)
+{
+	RelFileNode node;
+#if XLOGDUMP_V >= 84
+	ForkNumber	forknum;
+#endif
+	BlockNumber blkno;
+} V(xl_heap_newpage);
+
+typedef V(xl_heaptid) V(xl_btreetid);
+
+/* as written, without the tail padding of the structs */
+#define V_SizeOfTid	(offsetof(V(xl_heaptid), tid) + sizeof(ItemPointerData))
+
+/* the names of the operations, by info >> 4 */
+static const char * const V(xlog_ops)[] = {
+	"checkpoint_shutdown", "checkpoint_online", "noop", "nextoid", "switch",
+#if XLOGDUMP_V >= 90
+	"backup_end", "parameter_change",
+#endif
+#if XLOGDUMP_V >= 91
+	"restore_point",
+#endif
+#if XLOGDUMP_V >= 92
+	"fpw_change",
+#endif
+};
+
+static const char * const V(xact_ops)[] = {
+	"commit", "prepare", "abort", "commit_prepared", "abort_prepared",
+#if XLOGDUMP_V >= 90
+	"assignment",
+#endif
+#if XLOGDUMP_V >= 92
+	"commit_compact",
+#endif
+};
+
+static const char * const V(smgr_ops)[] = {
+	NULL, "create", "truncate"
+};
+
+static const char * const V(dbase_ops)[] = {
+	"create", "drop"
+};
+
+static const char * const V(heap2_ops)[] = {
+	"freeze", "clean",
+#if XLOGDUMP_V < 90
+	"clean_move",
+#else
+	NULL, "cleanup_info",
+#endif
+#if XLOGDUMP_V >= 92
+	"visible", "multi_insert",
+#endif
+};
+
+static const char * const V(heap_ops)[] = {
+	"insert", "delete", "update",
+#if XLOGDUMP_V < 90
+	"move",
+#else
+	NULL,
+#endif
+	"hot_update", "newpage", "lock", "inplace"
+};
+
+static const char * const V(btree_ops)[] = {
+	"insert_leaf", "insert_upper", "insert_meta", "split_l", "split_r",
+	"split_l_root", "split_r_root", "delete", "delete_page",
+	"delete_page_meta", "newroot", "delete_page_half",
+#if XLOGDUMP_V >= 90
+	"vacuum", "reuse_page",
+#endif
+};
+
+#define V_OP(ops, info) \
+	(((info) >> 4) < lengthof(ops) ? (ops)[(info) >> 4] : NULL)
+
+/* the times after 2000 which a TimestampTz is taken for, 100 years */
+#define V_MAX_TIMESTAMP_SECS	((int64) 36525 * SECS_PER_DAY)
+
+/*
+ * Gets the time of a commit or an abort from its TimestampTz. The
+ * server may have been built with float timestamps, the default before
+ * 8.4, or with int64 ones, whichever the version xlogdump is built
+ * against uses, and pg_control, which tells, is not read. The two are
+ * told by the value: the bits of a double of a time since 2000 are a
+ * far too large int64, and those of an int64 one a denormal double. A
+ * time neither way is left undecoded.
+ */
+static void
+V(decode_timestamp)(DecodedRecord *dec, const char *p)
+{
+	int64		i;
+	double		f;
+	int64		usec;
+
+	memcpy(&i, p, sizeof(i));
+	memcpy(&f, p, sizeof(f));
+
+	if (i >= 0 && i < V_MAX_TIMESTAMP_SECS * USECS_PER_SEC)
+		usec = i;
+	else if (f >= 0 && f < (double) V_MAX_TIMESTAMP_SECS)
+		usec = (int64) rint(f * USECS_PER_SEC);
+	else
+		return;
+
+	dec->usec = usec +
+		(int64) (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY * USECS_PER_SEC;
+	dec->time = (pg_time_t) (dec->usec / USECS_PER_SEC);
+	dec->has_time = true;
+}
+
+/*
+ * Gets the relation of a heap, heap2, btree or sequence record, which
+ * all begin with a RelFileNode.
+ */
+static void
+V(decode_node)(DecodedRecord *dec)
+{
+	if (dec->record->xl_len < sizeof(RelFileNode))
+		return;
+
+	memcpy(&dec->node, XLogRecGetData(dec->record), sizeof(RelFileNode));
+	dec->has_node = true;
+}
+
+static void
+V(decode_xlog)(DecodedRecord *dec, int fields)
+{
+	V(CheckPoint) checkpoint;
+
+	if ((fields & (DECODE_TIME | DECODE_REDO)) &&
+	    (dec->info == V_XLOG_CHECKPOINT_SHUTDOWN ||
+	     dec->info == V_XLOG_CHECKPOINT_ONLINE) &&
+	    dec->record->xl_len >= sizeof(checkpoint))
+	{
+		memcpy(&checkpoint, XLogRecGetData(dec->record), sizeof(checkpoint));
+		if (fields & DECODE_TIME)
+		{
+			dec->time = checkpoint.time;
+			dec->usec = (int64) checkpoint.time * USECS_PER_SEC;
+			dec->has_time = true;
+		}
+		if (fields & DECODE_REDO)
+		{
+			dec->redo = checkpoint.redo;
+			dec->has_redo = true;
+		}
+	}
+
+	if (fields & DECODE_OP)
+		dec->op = V_OP(V(xlog_ops), dec->info);
+}
+
+static void
+V(decode_xact)(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+
+	if (fields & DECODE_TIME)
+	{
+		switch (dec->info)
+		{
+		case V_XLOG_XACT_COMMIT:
+		case V_XLOG_XACT_ABORT:
+#if XLOGDUMP_V >= 92
+		case V_XLOG_XACT_COMMIT_COMPACT:
+#endif
+			if (record->xl_len < sizeof(TimestampTz))
+				break;
+			V(decode_timestamp)(dec, XLogRecGetData(record));
+			dec->commit = (dec->info != V_XLOG_XACT_ABORT);
+			break;
+
+		case V_XLOG_XACT_COMMIT_PREPARED:
+		case V_XLOG_XACT_ABORT_PREPARED:
+			if (record->xl_len < sizeof(V(xl_xact_commit_prepared)))
+				break;
+			V(decode_timestamp)(dec, XLogRecGetData(record) +
+					    offsetof(V(xl_xact_commit_prepared), crec.xact_time));
+			dec->commit = (dec->info == V_XLOG_XACT_COMMIT_PREPARED);
+			break;
+		}
+	}
+
+	if (fields & DECODE_OP)
+		dec->op = V_OP(V(xact_ops), dec->info);
+}
+
+static void
+V(decode_heap)(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+	uint8 op = dec->info & V_XLOG_HEAP_OPMASK;
+
+	if (fields & DECODE_RELATION)
+		V(decode_node)(dec);
+
+	if ((fields & DECODE_TID) && op == V_XLOG_HEAP_NEWPAGE)
+	{
+		V(xl_heap_newpage) xlrec;
+
+		if (record->xl_len >= sizeof(xlrec))
+		{
+			memcpy(&xlrec, XLogRecGetData(record), sizeof(xlrec));
+			dec->block = xlrec.blkno;
+			dec->offset = InvalidOffsetNumber;
+			dec->has_tid = true;
+		}
+	}
+	else if ((fields & DECODE_TID) && V_OP(V(heap_ops), op) != NULL)
+	{
+		ItemPointerData tid;
+
+		/* all the others begin with a xl_heaptid */
+		if (record->xl_len >= V_SizeOfTid)
+		{
+			memcpy(&tid, XLogRecGetData(record) + offsetof(V(xl_heaptid), tid), sizeof(tid));
+			dec->block = ItemPointerGetBlockNumber(&tid);
+			dec->offset = ItemPointerGetOffsetNumber(&tid);
+			dec->has_tid = true;
+		}
+	}
+
+	if (fields & DECODE_OP)
+		dec->op = V_OP(V(heap_ops), op);
+}
+
+static void
+V(decode_btree)(DecodedRecord *dec, int fields)
+{
+	XLogRecord *record = dec->record;
+	ItemPointerData tid;
+
+	if (fields & DECODE_RELATION)
+		V(decode_node)(dec);
+
+	if ((fields & DECODE_TID) &&
+	    (dec->info == V_XLOG_BTREE_INSERT_LEAF || dec->info == V_XLOG_BTREE_INSERT_UPPER) &&
+	    record->xl_len >= V_SizeOfTid)
+	{
+		memcpy(&tid, XLogRecGetData(record) + offsetof(V(xl_btreetid), tid), sizeof(tid));
+		dec->block = BlockIdGetBlockNumber(&tid.ip_blkid);
+		dec->offset = tid.ip_posid;
+		dec->has_tid = true;
+	}
+
+	if (fields & DECODE_OP)
+		dec->op = V_OP(V(btree_ops), dec->info);
+}
+
+static void
+V(decode)(DecodedRecord *dec, int fields)
+{
+	switch (dec->record->xl_rmid)
+	{
+	case RM_XLOG_ID:
+		V(decode_xlog)(dec, fields);
+		break;
+	case RM_XACT_ID:
+		V(decode_xact)(dec, fields);
+		break;
+	case RM_SMGR_ID:
+		if (fields & DECODE_OP)
+			dec->op = V_OP(V(smgr_ops), dec->info);
+		break;
+	case RM_DBASE_ID:
+		if (fields & DECODE_OP)
+			dec->op = V_OP(V(dbase_ops), dec->info);
+		break;
+	case RM_HEAP2_ID:
+		if (fields & DECODE_RELATION)
+			V(decode_node)(dec);
+		if (fields & DECODE_OP)
+			dec->op = V_OP(V(heap2_ops), dec->info & V_XLOG_HEAP_OPMASK);
+		break;
+	case RM_HEAP_ID:
+		V(decode_heap)(dec, fields);
+		break;
+	case RM_BTREE_ID:
+		V(decode_btree)(dec, fields);
+		break;
+	case RM_SEQ_ID:
+		if (fields & DECODE_RELATION)
+			V(decode_node)(dec);
+		break;
+	}
+}
+
+const xlog_version_t V(xlog_version) = {
+	XLOGDUMP_MAGIC, XLOGDUMP_V, false, V(decode)
+};
@@ -0,0 +1,71 @@
+/*
+ * xlogdump_version.c
+ *
+ * a table of the PostgreSQL major versions whose xlog records can be
+ * decoded, told by xlp_magic of the pages.
+ *
+ * The records of the version xlogdump is built against are decoded
+ * with the structures of its headers, by the resource managers in
+ * xlogdump_rmgr.c. The layouts of the other versions differ, so each
+ * of them has its own translation unit, xlogdump_v<version>.c, with
+ * the structures vendored under prefixed names. The version of each
+ * segment is looked up when it is opened, so the segments of several
+ * versions can be given at once.
+ */
+#include "postgres.h"
+
+#include "access/xlog_internal.h"
+
+#include "xlogdump_rmgr.h"
+#include "xlogdump_version.h"
+
+static void decode_native(DecodedRecord *, int);
+
+static const xlog_version_t native = {
+	XLOG_PAGE_MAGIC, XLOGDUMP_MAJOR_VERSION, true, decode_native
+};
+
+/* the native one first, to be found first */
+static const xlog_version_t * const versions[] = {
+	&native,
+	&v83_xlog_version,
+	&v84_xlog_version,
+	&v90_xlog_version,
+	&v91_xlog_version,
+	&v92_xlog_version,
+	NULL
+};
+
+static void
+decode_native(DecodedRecord *dec, int fields)
+{
+	if (dec->record->xl_rmid <= RM_MAX_ID &&
+	    RM_table[dec->record->xl_rmid].decode != NULL)
+		RM_table[dec->record->xl_rmid].decode(dec, fields);
+}
+
+/*
+ * Returns the version whose pages begin with magic. The native one is
+ * returned for an unknown magic, to leave it to the page checks.
+ */
+const xlog_version_t *
+version_of_magic(uint16 magic)
+{
+	int i;
+
+	for (i = 0; versions[i] != NULL; i++)
+	{
+		if (versions[i]->magic == magic)
+			return versions[i];
+	}
+	return &native;
+}
+
+/*
+ * Returns the version of the segment being read by r.
+ */
+const xlog_version_t *
+version_of_reader(xlog_reader_t *r)
+{
+	return version_of_magic(reader_layout(r)->magic);
+}
@@ -0,0 +1,45 @@
+/*
+ * xlogdump_version.h
+ *
+ * a table of the PostgreSQL major versions whose xlog records can be
+ * decoded, told by xlp_magic of the pages, so that the segments of any
+ * of them, even mixed, can be read in one run.
+ */
+#ifndef __XLOGDUMP_VERSION_H__
+#define __XLOGDUMP_VERSION_H__
+
+#include "postgres.h"
+
+#include "xlogdump_decode.h"
+#include "xlogdump_reader.h"
+
+/* major version this xlogdump is built for, like 92 */
+#define XLOGDUMP_MAJOR_VERSION \
+	(PG_VERSION_NUM / 10000 * 10 + PG_VERSION_NUM / 100 % 100)
+
+/*
+ * A major version, with the callback to decode the fields of its
+ * records. Only the records of the version xlogdump is built against
+ * (native) have their payload decoded and printed in full; the other
+ * versions have their own decoder, built from the structures vendored
+ * in xlogdump_vdecode.h, which decodes all the fields but the payload.
+ */
+struct xlog_version
+{
+	uint16		magic;			/* XLOG_PAGE_MAGIC */
+	int			version;		/* major version, like 92 */
+	bool		native;
+	void		(*decode) (DecodedRecord *, int);
+};
+
+/* the decoders of the other versions, in xlogdump_v*.c */
+extern const xlog_version_t v83_xlog_version;
+extern const xlog_version_t v84_xlog_version;
+extern const xlog_version_t v90_xlog_version;
+extern const xlog_version_t v91_xlog_version;
+extern const xlog_version_t v92_xlog_version;
+
+const xlog_version_t *version_of_magic(uint16);
+const xlog_version_t *version_of_reader(xlog_reader_t *);
+
+#endif /* __XLOGDUMP_VERSION_H__ */
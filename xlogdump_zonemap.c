@@ -0,0 +1,270 @@
+/*
+ * xlogdump_zonemap.c
+ *
+ * a collection of functions to summarize a xlog segment into a zone
+ * map, which tells whether the segment may have the records to be
+ * shown without reading it.
+ *
+ * A zone map is saved in a stats file (see xlogdump_sidecar.c) with
+ * the suffix ".zone", and is used only while it is newer than the
+ * segment, so a recycled segment gets a new one.
+ */
+#include "xlogdump_zonemap.h"
+
+#include "access/transam.h"
+
+#include "xlogdump_hash.h"
+#include "xlogdump_rmgr.h"
+#include "xlogdump_sidecar.h"
+
+/* the length of the body of a SIDECAR_ZONE_MAP section */
+#define ZONEMAP_SECTION_LEN	(7 * sizeof(uint32) + 2 * sizeof(uint64) + \
+				 sizeof(uint32) + ZONEMAP_BLOOM_BITS / 8)
+
+static bool xid_precedes(TransactionId, TransactionId);
+static void bloom_hash(const RelFileNode *, uint32 *, uint32 *);
+static void bloom_add(zonemap_t *, const RelFileNode *);
+
+/*
+ * xid_precedes()
+ *
+ * compares two normal xids in the modulo-2^32 space, as the backend
+ * does in TransactionIdPrecedes().
+ */
+static bool
+xid_precedes(TransactionId a, TransactionId b)
+{
+	return ((int32) (a - b) < 0);
+}
+
+static void
+bloom_hash(const RelFileNode *node, uint32 *h1, uint32 *h2)
+{
+	uint32 h = hash_relfilenode(node);
+
+	*h1 = h;
+
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	*h2 = h | 1;
+}
+
+static void
+bloom_add(zonemap_t *zone, const RelFileNode *node)
+{
+	uint32 h1, h2;
+	int i;
+
+	bloom_hash(node, &h1, &h2);
+	for (i = 0 ; i < ZONEMAP_BLOOM_HASHES ; i++)
+	{
+		uint32 bit = (h1 + i * h2) % ZONEMAP_BLOOM_BITS;
+
+		zone->bloom[bit / 8] |= (1 << (bit % 8));
+	}
+}
+
+void
+zonemap_reset(zonemap_t *zone)
+{
+	memset(zone, 0, sizeof(zonemap_t));
+}
+
+/*
+ * zonemap_add_record()
+ *
+ * accounts a xlog record to the zone map of the current segment.
+ * Only the header is used for a partial record, which continues to
+ * the next segment.
+ */
+void
+zonemap_add_record(zonemap_t *zone, DecodedRecord *dec)
+{
+	XLogRecord *record = dec->record;
+	int i;
+
+	if (zone->nrecords == 0)
+		zone->first_lsn = dec->lsn;
+	zone->last_lsn = dec->lsn;
+	zone->nrecords++;
+
+	if (TransactionIdIsNormal(record->xl_xid))
+	{
+		if (zone->min_xid == InvalidTransactionId ||
+		    xid_precedes(record->xl_xid, zone->min_xid))
+			zone->min_xid = record->xl_xid;
+		if (zone->max_xid == InvalidTransactionId ||
+		    xid_precedes(zone->max_xid, record->xl_xid))
+			zone->max_xid = record->xl_xid;
+	}
+
+	if (record->xl_rmid < 32)
+		zone->rmids |= ((uint32) 1 << record->xl_rmid);
+
+	if (dec->partial)
+		return;
+
+	decode_fields(dec, DECODE_TIME | DECODE_RELATION | DECODE_BKP);
+
+	if (dec->has_time)
+	{
+		if (zone->min_time == 0 || dec->time < zone->min_time)
+			zone->min_time = dec->time;
+		if (zone->max_time == 0 || dec->time > zone->max_time)
+			zone->max_time = dec->time;
+		if (dec->commit)
+		{
+			if (zone->first_commit_time == 0)
+				zone->first_commit_time = dec->usec;
+			zone->last_commit_time = dec->usec;
+		}
+	}
+
+	if (dec->has_node)
+		bloom_add(zone, &dec->node);
+
+	for (i = 0; i < dec->nbkp; i++)
+		bloom_add(zone, &dec->bkp[i].node);
+}
+
+bool
+zonemap_may_contain_xid(const zonemap_t *zone, TransactionId xid)
+{
+	if (zone->min_xid == InvalidTransactionId)
+		return false;
+
+	return !xid_precedes(xid, zone->min_xid) && !xid_precedes(zone->max_xid, xid);
+}
+
+bool
+zonemap_may_contain_rmid(const zonemap_t *zone, int rmid)
+{
+	if (rmid < 0 || rmid >= 32)
+		return true;
+
+	return (zone->rmids & ((uint32) 1 << rmid)) != 0;
+}
+
+bool
+zonemap_may_contain_rel(const zonemap_t *zone, const RelFileNode *node)
+{
+	uint32 h1, h2;
+	int i;
+
+	bloom_hash(node, &h1, &h2);
+	for (i = 0 ; i < ZONEMAP_BLOOM_HASHES ; i++)
+	{
+		uint32 bit = (h1 + i * h2) % ZONEMAP_BLOOM_BITS;
+
+		if (!(zone->bloom[bit / 8] & (1 << (bit % 8))))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * zonemap_may_contain_time()
+ *
+ * Only the commit, abort and checkpoint records have a time, so a
+ * segment without any of them has no record between `from' and `to'.
+ */
+bool
+zonemap_may_contain_time(const zonemap_t *zone, pg_time_t from, pg_time_t to)
+{
+	if (zone->min_time == 0)
+		return false;
+
+	return !(zone->max_time < from || zone->min_time > to);
+}
+
+void
+zonemap_save(const zonemap_t *zone, const char *path)
+{
+	FILE *fp;
+	long pos;
+
+	fp = sidecar_create(path);
+
+	pos = sidecar_begin_section(fp, SIDECAR_ZONE_MAP);
+	sidecar_write_u32(fp, zone->nrecords);
+	sidecar_write_u32(fp, zone->first_lsn.xlogid);
+	sidecar_write_u32(fp, zone->first_lsn.xrecoff);
+	sidecar_write_u32(fp, zone->last_lsn.xlogid);
+	sidecar_write_u32(fp, zone->last_lsn.xrecoff);
+	sidecar_write_u32(fp, zone->min_xid);
+	sidecar_write_u32(fp, zone->max_xid);
+	sidecar_write_u64(fp, (uint64) zone->min_time);
+	sidecar_write_u64(fp, (uint64) zone->max_time);
+	sidecar_write_u32(fp, zone->rmids);
+	sidecar_write(fp, zone->bloom, sizeof(zone->bloom));
+	sidecar_end_section(fp, pos);
+
+	pos = sidecar_begin_section(fp, SIDECAR_COMMIT_TIME);
+	sidecar_write_u64(fp, (uint64) zone->first_commit_time);
+	sidecar_write_u64(fp, (uint64) zone->last_commit_time);
+	sidecar_end_section(fp, pos);
+
+	sidecar_close(fp, path);
+}
+
+/*
+ * zonemap_load()
+ *
+ * reads the zone map of the segment. Returns false if it is not found,
+ * older than the segment, or of another layout. The commit times are
+ * in a section of their own, which a file of an older version lacks.
+ */
+bool
+zonemap_load(zonemap_t *zone, const char *path, const char *segment)
+{
+	FILE *fp;
+	uint32 tag;
+	uint64 len;
+	bool found = false;
+
+	if (!sidecar_is_fresh(path, segment))
+		return false;
+
+	fp = sidecar_open(path);
+
+	zone->has_commit_time = false;
+	zone->first_commit_time = 0;
+	zone->last_commit_time = 0;
+
+	while (sidecar_next_section(fp, &tag, &len))
+	{
+		if (tag == SIDECAR_COMMIT_TIME && len == 2 * sizeof(uint64))
+		{
+			zone->first_commit_time = (int64) sidecar_read_u64(fp);
+			zone->last_commit_time = (int64) sidecar_read_u64(fp);
+			zone->has_commit_time = true;
+			continue;
+		}
+		if (tag != SIDECAR_ZONE_MAP || len != ZONEMAP_SECTION_LEN)
+		{
+			sidecar_skip_section(fp, len);
+			continue;
+		}
+
+		zone->nrecords = sidecar_read_u32(fp);
+		zone->first_lsn.xlogid = sidecar_read_u32(fp);
+		zone->first_lsn.xrecoff = sidecar_read_u32(fp);
+		zone->last_lsn.xlogid = sidecar_read_u32(fp);
+		zone->last_lsn.xrecoff = sidecar_read_u32(fp);
+		zone->min_xid = sidecar_read_u32(fp);
+		zone->max_xid = sidecar_read_u32(fp);
+		zone->min_time = (pg_time_t) sidecar_read_u64(fp);
+		zone->max_time = (pg_time_t) sidecar_read_u64(fp);
+		zone->rmids = sidecar_read_u32(fp);
+		sidecar_read(fp, zone->bloom, sizeof(zone->bloom));
+		found = true;
+	}
+
+	fclose(fp);
+
+	return found;
+}
@@ -0,0 +1,49 @@
+/*
+ * xlogdump_zonemap.h
+ *
+ * a collection of functions to summarize a xlog segment into a zone
+ * map, which tells whether the segment may have the records to be
+ * shown without reading it.
+ */
+#ifndef __XLOGDUMP_ZONEMAP_H__
+#define __XLOGDUMP_ZONEMAP_H__
+
+#include "postgres.h"
+#include "access/xlog.h"
+#include "storage/relfilenode.h"
+
+#include "xlogdump_decode.h"
+
+#define ZONEMAP_SUFFIX		".zone"
+
+/* bloom filter of the relfilenodes, 4096 bits with 4 hash functions */
+#define ZONEMAP_BLOOM_BITS	4096
+#define ZONEMAP_BLOOM_HASHES	4
+
+typedef struct zonemap_t {
+	uint32 nrecords;
+	XLogRecPtr first_lsn;		/* first record in the segment */
+	XLogRecPtr last_lsn;		/* last record in the segment */
+	TransactionId min_xid;		/* InvalidTransactionId if none */
+	TransactionId max_xid;
+	pg_time_t min_time;		/* commit, abort and checkpoint time, */
+	pg_time_t max_time;		/* 0 if none */
+	uint32 rmids;			/* bitmap of xl_rmid */
+	uint8 bloom[ZONEMAP_BLOOM_BITS / 8];
+	bool has_commit_time;		/* false if loaded from an older file */
+	int64 first_commit_time;	/* time of the first and the last */
+	int64 last_commit_time;		/* commit in microseconds, 0 if none */
+} zonemap_t;
+
+void zonemap_reset(zonemap_t *);
+void zonemap_add_record(zonemap_t *, DecodedRecord *);
+
+bool zonemap_may_contain_xid(const zonemap_t *, TransactionId);
+bool zonemap_may_contain_rmid(const zonemap_t *, int);
+bool zonemap_may_contain_rel(const zonemap_t *, const RelFileNode *);
+bool zonemap_may_contain_time(const zonemap_t *, pg_time_t, pg_time_t);
+
+void zonemap_save(const zonemap_t *, const char *);
+bool zonemap_load(zonemap_t *, const char *, const char *);
+
+#endif /* __XLOGDUMP_ZONEMAP_H__ */